@@ -0,0 +1,130 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <folly/lang/Bits.h>
+
+namespace {
+// Values below kExactValues get a bucket each, every power of two above gets
+// kSubBuckets of them
+constexpr uint64_t kExactValues = 128;
+constexpr uint64_t kSubBuckets = kExactValues / 2;
+constexpr size_t kSubBucketBits = 6;
+constexpr size_t kNumBuckets = (64 - kSubBucketBits) * kSubBuckets + 64;
+}
+
+namespace LoadGenService {
+
+LatencyHistogram::LatencyHistogram() : buckets_(kNumBuckets, 0) {
+}
+
+size_t LatencyHistogram::getBucket(uint64_t value) {
+  if (value < kExactValues) {
+    return value;
+  }
+  // Keep the top 7 bits of the value
+  size_t shift = folly::findLastSet(value) - 1 - kSubBucketBits;
+  return shift * kSubBuckets + (value >> shift);
+}
+
+uint64_t LatencyHistogram::getBucketStart(size_t bucket) {
+  if (bucket < kExactValues) {
+    return bucket;
+  }
+  size_t shift = bucket / kSubBuckets - 1;
+  return (bucket % kSubBuckets + kSubBuckets) << shift;
+}
+
+uint64_t LatencyHistogram::getBucketValue(size_t bucket) {
+  if (bucket < kExactValues) {
+    return bucket;
+  }
+  size_t shift = bucket / kSubBuckets - 1;
+  uint64_t top = bucket % kSubBuckets + kSubBuckets;
+  // Wraps to UINT64_MAX for the last bucket
+  return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value, uint64_t count) {
+  if (count == 0) {
+    return;
+  }
+  buckets_[getBucket(value)] += count;
+  count_ += count;
+  sum_ += value * count;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::recordCorrected(uint64_t value,
+                                       uint64_t expectedInterval,
+                                       uint64_t count) {
+  record(value, count);
+  if (expectedInterval == 0 || value <= expectedInterval || count == 0) {
+    return;
+  }
+  // The missing values step down by expectedInterval to it; add the ones
+  // landing in each bucket at once, as a long response with a short interval
+  // can make millions of them
+  uint64_t missing = value - expectedInterval;
+  while (missing >= expectedInterval) {
+    auto bucket = getBucket(missing);
+    auto lowest = std::max(getBucketStart(bucket), expectedInterval);
+    uint64_t steps = (missing - lowest) / expectedInterval + 1;
+    buckets_[bucket] += steps * count;
+    count_ += steps * count;
+    sum_ += (steps * missing - expectedInterval * steps * (steps - 1) / 2) *
+            count;
+    missing -= (steps - 1) * expectedInterval;
+    min_ = std::min(min_, missing);
+    missing -= expectedInterval;
+  }
+}
+
+LatencyHistogram LatencyHistogram::corrected(uint64_t expectedInterval) const {
+  LatencyHistogram result;
+  for (size_t bucket = 0; bucket < buckets_.size(); bucket++) {
+    if (buckets_[bucket] > 0) {
+      auto value = std::max(min_, std::min(getBucketValue(bucket), max_));
+      result.recordCorrected(value, expectedInterval, buckets_[bucket]);
+    }
+  }
+  return result;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  for (size_t bucket = 0; bucket < buckets_.size(); bucket++) {
+    buckets_[bucket] += other.buckets_[bucket];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::getPercentile(double percent) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  auto rank = uint64_t(std::ceil(count_ * std::min(percent, 100.0) / 100));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < buckets_.size(); bucket++) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      return std::max(min_, std::min(getBucketValue(bucket), max_));
+    }
+  }
+  return max_;
+}
+
+}
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace LoadGenService {
+
+/**
+ * Histogram of latencies in microseconds, with log-linear buckets in the
+ * style of HdrHistogram: values below 128 are exact, larger ones land in one
+ * of 64 buckets per power of two, so every reported value is within 1.6% of
+ * the ones recorded.  Recording is a few shifts and an increment, and
+ * histograms from several workers are merged by adding their buckets.
+ */
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  void record(uint64_t value, uint64_t count = 1);
+
+  /**
+   * Record a value measured by a client that waits for each response before
+   * sending its next request, expected to send one every expectedInterval.
+   * A response taking longer held back the requests that should have been
+   * sent meanwhile, so their latencies are recorded as well: value minus
+   * one interval, minus two, and so on.
+   */
+  void recordCorrected(uint64_t value,
+                       uint64_t expectedInterval,
+                       uint64_t count = 1);
+
+  /**
+   * A copy of this histogram with every value recorded through
+   * recordCorrected()
+   */
+  LatencyHistogram corrected(uint64_t expectedInterval) const;
+
+  void merge(const LatencyHistogram& other);
+
+  /**
+   * Highest value that percentile percent (0-100) of the recorded values do
+   * not exceed, 0 when empty
+   */
+  uint64_t getPercentile(double percent) const;
+
+  uint64_t getCount() const {
+    return count_;
+  }
+
+  uint64_t getMin() const {
+    return count_ ? min_ : 0;
+  }
+
+  uint64_t getMax() const {
+    return max_;
+  }
+
+  double getMean() const {
+    return count_ ? double(sum_) / count_ : 0;
+  }
+
+ private:
+  static size_t getBucket(uint64_t value);
+  // Lowest value landing in bucket
+  static uint64_t getBucketStart(size_t bucket);
+  // Highest value landing in bucket
+  static uint64_t getBucketValue(size_t bucket);
+
+  std::vector<uint64_t> buckets_;
+  uint64_t count_{0};
+  uint64_t sum_{0};
+  uint64_t min_{UINT64_MAX};
+  uint64_t max_{0};
+};
+
+}
@@ -0,0 +1,200 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ *
+ *  Sends HTTP load to one server, typically a proxygen server on loopback,
+ *  and reports the throughput and latency distribution it got, e.g.:
+ *
+ *    proxygen_loadgen --url=http://127.0.0.1:11000/ --protocol=h2 \
+ *        --workers=4 --connections=64 --streams=16 --duration=30
+ *
+ *  Without --rate each stream sends its next request as soon as it gets a
+ *  response, which measures the most the server can take.  With --rate the
+ *  requests are sent at that rate whatever the response times, and their
+ *  latency counts from when they were due, as seen by clients that do not
+ *  wait for each other.
+ *
+ */
+#include <folly/Format.h>
+#include <folly/portability/GFlags.h>
+
+#include <proxygen/lib/utils/URL.h>
+#if PROXYGEN_LOADGEN_HQ
+#include <proxygen/lib/http/session/HQSession.h>
+#endif
+
+#include <iostream>
+#include <thread>
+
+#include "LoadWorker.h"
+
+using namespace LoadGenService;
+using namespace proxygen;
+
+DEFINE_string(url, "http://127.0.0.1:11000/", "URL to send requests to");
+DEFINE_string(protocol, "h1", "Protocol to use: h1, h2 (h2c) or hq");
+DEFINE_string(http_method, "GET", "HTTP method to use");
+DEFINE_int32(body_size, 0, "Size of the body sent with each request");
+DEFINE_int32(workers, 1, "Worker threads, each with its own EventBase");
+DEFINE_int32(connections, 16, "Connections, split between the workers");
+DEFINE_int32(streams, 1, "Concurrent requests per h2 or hq connection");
+DEFINE_double(rate,
+              0,
+              "Requests per second over all workers, sent open-loop on a "
+              "fixed schedule.  0 runs closed-loop, keeping every stream "
+              "busy.");
+DEFINE_int32(duration, 10, "Seconds to send load for");
+DEFINE_int32(connect_timeout, 1000, "Connect timeout in milliseconds");
+DEFINE_int32(request_timeout, 5000, "Request timeout in milliseconds");
+DEFINE_int32(recv_window, 1 << 20, "Flow control receive window for h2");
+DEFINE_bool(io_uring, false, "Send and receive h1 and h2 through io_uring");
+#if PROXYGEN_LOADGEN_HQ
+DEFINE_string(hq_alpn, kH3FBCurrentDraft, "Application protocol for hq");
+#endif
+
+namespace {
+
+void printLatency(const std::string& name, const LatencyHistogram& histogram) {
+  std::cout << folly::sformat(
+                   "  {:<14}{:>10}{:>10}{:>10}{:>10}{:>10}{:>10}{:>12.1f}",
+                   name,
+                   histogram.getPercentile(50),
+                   histogram.getPercentile(90),
+                   histogram.getPercentile(99),
+                   histogram.getPercentile(99.9),
+                   histogram.getPercentile(99.99),
+                   histogram.getMax(),
+                   histogram.getMean())
+            << std::endl;
+}
+
+void printStats(const LoadStats& stats) {
+  double seconds = stats.elapsed.count() / 1e6;
+  std::cout << folly::sformat(
+                   "Requests: {} completed, {} non-2xx, {} errors, {} unsent, "
+                   "{} connect errors",
+                   stats.completed,
+                   stats.non2xx,
+                   stats.errors,
+                   stats.unsent,
+                   stats.connectErrors)
+            << std::endl;
+  if (seconds > 0) {
+    std::cout << folly::sformat(
+                     "Throughput: {:.1f} requests/s, {:.2f} MB/s of body",
+                     stats.completed / seconds,
+                     stats.bodyBytes / seconds / (1024 * 1024))
+              << std::endl;
+  }
+  std::cout << folly::sformat(
+                   "  {:<14}{:>10}{:>10}{:>10}{:>10}{:>10}{:>10}{:>12}",
+                   "usecs",
+                   "p50",
+                   "p90",
+                   "p99",
+                   "p99.9",
+                   "p99.99",
+                   "max",
+                   "mean")
+            << std::endl;
+  printLatency("latency", stats.latency);
+  printLatency("service time", stats.serviceTime);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  URL url(FLAGS_url);
+  if (!url.isValid() || !url.hasHost()) {
+    LOG(ERROR) << "Invalid url: " << FLAGS_url;
+    return EXIT_FAILURE;
+  }
+  auto method = stringToMethod(FLAGS_http_method);
+  if (!method) {
+    LOG(ERROR) << "Unsupported http_method: " << FLAGS_http_method;
+    return EXIT_FAILURE;
+  }
+  if (FLAGS_workers < 1 || FLAGS_connections < FLAGS_workers ||
+      FLAGS_streams < 1 || FLAGS_duration < 1 || FLAGS_rate < 0) {
+    LOG(ERROR) << "Need at least a connection per worker, a stream per "
+               << "connection and a duration";
+    return EXIT_FAILURE;
+  }
+
+  LoadOptions options;
+  if (FLAGS_protocol == "h1") {
+    options.protocol = Protocol::HTTP1;
+  } else if (FLAGS_protocol == "h2") {
+    options.protocol = Protocol::H2;
+  } else if (FLAGS_protocol == "hq") {
+#if PROXYGEN_LOADGEN_HQ
+    options.protocol = Protocol::HQ;
+    options.hqAlpn = FLAGS_hq_alpn;
+#else
+    LOG(ERROR) << "Built without HQ support";
+    return EXIT_FAILURE;
+#endif
+  } else {
+    LOG(ERROR) << "Unknown protocol: " << FLAGS_protocol;
+    return EXIT_FAILURE;
+  }
+  options.address = folly::SocketAddress(url.getHost(), url.getPort(), true);
+  options.host = url.getHostAndPort();
+  options.path = url.makeRelativeURL();
+  options.method = *method;
+  options.body.assign(FLAGS_body_size, 'a');
+  options.streams = FLAGS_streams;
+  options.duration = std::chrono::seconds(FLAGS_duration);
+  options.connectTimeout = std::chrono::milliseconds(FLAGS_connect_timeout);
+  options.requestTimeout = std::chrono::milliseconds(FLAGS_request_timeout);
+  options.recvWindow = FLAGS_recv_window;
+  options.useIoUring = FLAGS_io_uring;
+
+  std::cout << folly::sformat(
+                   "Sending {} {} to {} for {}s over {}: {} workers, "
+                   "{} connections, {} streams each, {}",
+                   FLAGS_http_method,
+                   options.path,
+                   options.address.describe(),
+                   FLAGS_duration,
+                   FLAGS_protocol,
+                   FLAGS_workers,
+                   FLAGS_connections,
+                   options.protocol == Protocol::HTTP1 ? 1 : FLAGS_streams,
+                   FLAGS_rate > 0
+                       ? folly::sformat("{} requests/s", FLAGS_rate)
+                       : std::string("closed-loop"))
+            << std::endl;
+
+  std::vector<LoadStats> results(FLAGS_workers);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < FLAGS_workers; i++) {
+    auto workerOptions = options;
+    // Spread the connections and the rate evenly
+    workerOptions.connections =
+        FLAGS_connections / FLAGS_workers +
+        (i < FLAGS_connections % FLAGS_workers ? 1 : 0);
+    workerOptions.rate = FLAGS_rate / FLAGS_workers;
+    threads.emplace_back([workerOptions, &result = results[i]] {
+      LoadWorker worker(workerOptions);
+      result = worker.run();
+    });
+  }
+  LoadStats total;
+  for (int i = 0; i < FLAGS_workers; i++) {
+    threads[i].join();
+    total.merge(results[i]);
+  }
+  printStats(total);
+
+  return total.completed > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,401 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "LoadWorker.h"
+
+#include <folly/io/async/EventBaseManager.h>
+#include <proxygen/lib/http/codec/HTTP2Constants.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#if PROXYGEN_LOADGEN_HQ
+#include <fizz/client/FizzClientContext.h>
+#include <proxygen/httpserver/samples/hq/InsecureVerifierDangerousDoNotUseInProduction.h>
+#include <proxygen/lib/http/session/HQUpstreamSession.h>
+#endif
+
+using namespace proxygen;
+
+namespace {
+uint64_t microsecondsBetween(TimePoint start, TimePoint end) {
+  if (end <= start) {
+    return 0;
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+      .count();
+}
+}
+
+namespace LoadGenService {
+
+void LoadStats::merge(const LoadStats& other) {
+  latency.merge(other.latency);
+  serviceTime.merge(other.serviceTime);
+  completed += other.completed;
+  non2xx += other.non2xx;
+  errors += other.errors;
+  unsent += other.unsent;
+  connectErrors += other.connectErrors;
+  bodyBytes += other.bodyBytes;
+  // Workers run side by side
+  elapsed = std::max(elapsed, other.elapsed);
+}
+
+/**
+ * One request, from the time a stream was free to send it until its
+ * transaction is detached
+ */
+class LoadWorker::Request : public HTTPTransactionHandler {
+ public:
+  Request(LoadWorker& worker, TimePoint due) : worker_(worker), due_(due) {
+  }
+
+  void send() {
+    const auto& options = worker_.options_;
+    sent_ = getCurrentTime();
+    HTTPMessage request;
+    request.setMethod(options.method);
+    request.setHTTPVersion(1, 1);
+    request.setURL(options.path);
+    request.getHeaders().set(HTTP_HEADER_HOST, options.host);
+    request.getHeaders().set(HTTP_HEADER_USER_AGENT, "proxygen_loadgen");
+    if (options.body.empty()) {
+      txn_->sendHeadersWithEOM(request);
+      return;
+    }
+    request.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                             folly::to<std::string>(options.body.size()));
+    txn_->sendHeaders(request);
+    txn_->sendBody(
+        folly::IOBuf::wrapBuffer(options.body.data(), options.body.size()));
+    txn_->sendEOM();
+  }
+
+  TimePoint getDue() const {
+    return due_;
+  }
+
+  TimePoint getSent() const {
+    return sent_;
+  }
+
+  uint16_t getStatus() const {
+    return status_;
+  }
+
+  uint64_t getBodyBytes() const {
+    return bodyBytes_;
+  }
+
+  bool isComplete() const {
+    return complete_;
+  }
+
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+
+  void detachTransaction() noexcept override {
+    worker_.onRequestDone(*this);
+    delete this;
+  }
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    status_ = msg->getStatusCode();
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    bodyBytes_ += chain->computeChainDataLength();
+  }
+
+  void onTrailers(std::unique_ptr<HTTPHeaders>) noexcept override {
+  }
+
+  void onEOM() noexcept override {
+    complete_ = true;
+  }
+
+  void onUpgrade(UpgradeProtocol) noexcept override {
+  }
+
+  void onError(const HTTPException& error) noexcept override {
+    VLOG(4) << "Request failed: " << error.what();
+    complete_ = false;
+  }
+
+  void onEgressPaused() noexcept override {
+  }
+
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  LoadWorker& worker_;
+  HTTPTransaction* txn_{nullptr};
+  const TimePoint due_;
+  TimePoint sent_;
+  uint16_t status_{0};
+  uint64_t bodyBytes_{0};
+  bool complete_{false};
+};
+
+LoadWorker::Connector::Connector(LoadWorker& worker) : worker_(worker) {
+}
+
+void LoadWorker::Connector::connect() {
+  const auto& options = worker_.options_;
+  if (options.protocol == Protocol::HQ) {
+#if PROXYGEN_LOADGEN_HQ
+    auto context = std::make_shared<fizz::client::FizzClientContext>();
+    context->setSupportedAlpns({options.hqAlpn});
+    hqConnector_ = std::make_unique<HQConnector>(this, options.requestTimeout);
+    hqConnector_->connect(
+        &worker_.evb_,
+        options.address,
+        std::move(context),
+        std::make_shared<InsecureVerifierDangerousDoNotUseInProduction>(),
+        options.connectTimeout,
+        folly::AsyncSocket::emptyOptionMap,
+        options.host);
+#else
+    LOG(FATAL) << "HQ support is not built in";
+#endif
+    return;
+  }
+  connector_ = std::make_unique<HTTPConnector>(this, worker_.timer_.get());
+  connector_->setUseIoUring(options.useIoUring);
+  if (options.protocol == Protocol::H2) {
+    connector_->setPlaintextProtocol(http2::kProtocolString);
+  }
+  const folly::AsyncSocket::OptionMap opts{{{SOL_SOCKET, SO_REUSEADDR}, 1}};
+  connector_->connect(
+      &worker_.evb_, options.address, options.connectTimeout, opts);
+}
+
+void LoadWorker::Connector::connectSuccess(HTTPUpstreamSession* session) {
+  const auto& options = worker_.options_;
+  if (options.protocol == Protocol::H2) {
+    session->setFlowControl(
+        options.recvWindow, options.recvWindow, options.recvWindow);
+  }
+  worker_.onConnectSuccess(this, session);
+}
+
+void LoadWorker::Connector::connectError(
+    const folly::AsyncSocketException& ex) {
+  worker_.onConnectError(this, folly::exceptionStr(ex).toStdString());
+}
+
+#if PROXYGEN_LOADGEN_HQ
+void LoadWorker::Connector::connectSuccess(HQUpstreamSession* session) {
+  worker_.onConnectSuccess(this, session);
+}
+
+void LoadWorker::Connector::connectError(const quic::QuicErrorCode& code) {
+  worker_.onConnectError(this, quic::toString(code));
+}
+#endif
+
+LoadWorker::LoadWorker(const LoadOptions& options) : options_(options) {
+}
+
+LoadWorker::~LoadWorker() {
+  // Connects and sessions go before the EventBase and timer they use
+  connecting_.clear();
+  pool_.reset();
+}
+
+LoadStats LoadWorker::run() {
+  folly::EventBaseManager::get()->setEventBase(&evb_, false);
+  timer_ = folly::HHWheelTimer::newTimer(
+      &evb_,
+      std::chrono::milliseconds(folly::HHWheelTimer::DEFAULT_TICK_INTERVAL),
+      folly::AsyncTimeout::InternalEnum::NORMAL,
+      options_.requestTimeout);
+  // Sessions stay pooled while idle for the whole run
+  pool_ = std::make_unique<SessionPool>(nullptr,
+                                        options_.connections,
+                                        options_.duration +
+                                            options_.requestTimeout);
+  maybeConnect();
+  evb_.loopForever();
+  folly::EventBaseManager::get()->clearEventBase();
+
+  if (!isOpenLoop() && stats_.completed > 0) {
+    // Each stream is expected to send a request every mean response time
+    uint64_t streams = uint64_t(options_.connections) * getStreams();
+    uint64_t interval = stats_.elapsed.count() * streams / stats_.completed;
+    stats_.latency = stats_.serviceTime.corrected(interval);
+  }
+  return stats_;
+}
+
+void LoadWorker::maybeConnect() {
+  auto open = pool_->getNumSessions() + connecting_.size();
+  // A connect can fail before connect() returns
+  for (; open < options_.connections && !stopping_; open++) {
+    connecting_.push_back(std::make_unique<Connector>(*this));
+    connecting_.back()->connect();
+  }
+}
+
+void LoadWorker::finishConnect(Connector* connector) {
+  // Called from the connector's callback, which it returns from right away
+  connecting_.remove_if([connector](const std::unique_ptr<Connector>& c) {
+    return c.get() == connector;
+  });
+}
+
+void LoadWorker::onConnectSuccess(Connector* connector,
+                                  HTTPSessionBase* session) {
+  finishConnect(connector);
+  VLOG(4) << "Connected to " << options_.address;
+  session->setMaxConcurrentOutgoingStreams(options_.streams);
+  pool_->putSession(session);
+  if (!started_) {
+    if (connecting_.empty()) {
+      startLoad();
+    }
+    return;
+  }
+  sendQueued();
+}
+
+void LoadWorker::onConnectError(Connector* connector,
+                                const std::string& error) {
+  finishConnect(connector);
+  LOG(ERROR) << "Failed to connect to " << options_.address << ": " << error;
+  stats_.connectErrors++;
+  if (!started_ && connecting_.empty()) {
+    if (pool_->empty()) {
+      // Nothing to send load over
+      stopping_ = true;
+      if (!isLoopCallbackScheduled()) {
+        evb_.runInLoop(this);
+      }
+      return;
+    }
+    startLoad();
+  }
+}
+
+void LoadWorker::startLoad() {
+  started_ = true;
+  start_ = getCurrentTime();
+  lastDone_ = start_;
+  stopTimeout_ =
+      folly::AsyncTimeout::schedule(options_.duration, evb_, [this]() noexcept {
+        stopLoad();
+      });
+  if (isOpenLoop()) {
+    interval_ = std::chrono::nanoseconds(uint64_t(1e9 / options_.rate));
+    nextDue_ = start_;
+    scheduleTimeout_ = folly::AsyncTimeout::make(
+        evb_, [this]() noexcept { scheduleRequests(); });
+    scheduleRequests();
+    return;
+  }
+  // Start every stream off together
+  queued_.assign(size_t(options_.connections) * getStreams(), start_);
+  sendQueued();
+}
+
+void LoadWorker::scheduleRequests() {
+  auto now = getCurrentTime();
+  while (nextDue_ <= now) {
+    queued_.push_back(nextDue_);
+    nextDue_ += interval_;
+  }
+  sendQueued();
+  // Timeouts have millisecond resolution: requests due within the next one
+  // go out together, each measured from its own due time
+  auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+      nextDue_ - now + std::chrono::milliseconds(1) -
+      std::chrono::nanoseconds(1));
+  scheduleTimeout_->scheduleTimeout(wait);
+}
+
+void LoadWorker::sendQueued() {
+  while (!queued_.empty() && !stopping_) {
+    if (pool_->getNumIdleSessions() == 0 &&
+        pool_->getNumActiveNonFullSessions() == 0) {
+      // Make up for connections the server closed
+      maybeConnect();
+      return;
+    }
+    auto request = new Request(*this, queued_.front());
+    auto txn = pool_->getTransaction(request);
+    if (!txn) {
+      delete request;
+      maybeConnect();
+      return;
+    }
+    queued_.pop_front();
+    inFlight_++;
+    request->send();
+  }
+}
+
+void LoadWorker::onRequestDone(const Request& request) {
+  inFlight_--;
+  auto now = getCurrentTime();
+  lastDone_ = now;
+  if (request.isComplete()) {
+    stats_.completed++;
+    auto status = request.getStatus();
+    if (status < 200 || status >= 300) {
+      stats_.non2xx++;
+    }
+    stats_.bodyBytes += request.getBodyBytes();
+    stats_.serviceTime.record(microsecondsBetween(request.getSent(), now));
+    if (isOpenLoop()) {
+      stats_.latency.record(microsecondsBetween(request.getDue(), now));
+    }
+  } else {
+    stats_.errors++;
+  }
+  if (!stopping_ && !isOpenLoop()) {
+    // This stream sends its next request right away
+    queued_.push_back(now);
+  }
+  if (!isLoopCallbackScheduled()) {
+    evb_.runInLoop(this);
+  }
+}
+
+void LoadWorker::runLoopCallback() noexcept {
+  if (stopping_) {
+    if (inFlight_ == 0 && pool_) {
+      finish();
+    }
+    return;
+  }
+  sendQueued();
+}
+
+void LoadWorker::stopLoad() {
+  stopping_ = true;
+  scheduleTimeout_.reset();
+  if (isOpenLoop()) {
+    stats_.unsent = queued_.size();
+  }
+  queued_.clear();
+  connecting_.clear();
+  if (inFlight_ == 0) {
+    finish();
+  }
+}
+
+void LoadWorker::finish() {
+  stats_.elapsed = std::chrono::microseconds(
+      started_ ? microsecondsBetween(start_, lastDone_) : 0);
+  // Idle sessions close as the pool drains them
+  pool_.reset();
+  evb_.terminateLoopSoon();
+}
+
+}
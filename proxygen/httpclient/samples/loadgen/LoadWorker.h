@@ -0,0 +1,174 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/SocketAddress.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/http/HTTPConnector.h>
+#include <proxygen/lib/http/connpool/SessionPool.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/utils/Time.h>
+#if PROXYGEN_LOADGEN_HQ
+#include <proxygen/lib/http/HQConnector.h>
+#endif
+
+#include <deque>
+#include <list>
+
+#include "LatencyHistogram.h"
+
+namespace LoadGenService {
+
+enum class Protocol { HTTP1, H2, HQ };
+
+struct LoadOptions {
+  folly::SocketAddress address;
+  std::string host;
+  std::string path{"/"};
+  proxygen::HTTPMethod method{proxygen::HTTPMethod::GET};
+  // Sent with every request when not empty
+  std::string body;
+  Protocol protocol{Protocol::HTTP1};
+  // Application protocol offered to HQ servers
+  std::string hqAlpn;
+  // Connections opened by the worker, kept open for the whole run
+  uint32_t connections{16};
+  // Requests in flight on each connection at once.  HTTP/1.1 connections
+  // only carry one.
+  uint32_t streams{1};
+  // Requests per second the worker sends, on a fixed schedule whether or not
+  // earlier ones got their response (open-loop).  0 keeps every stream busy
+  // instead, sending the next request as soon as one completes
+  // (closed-loop).
+  double rate{0};
+  std::chrono::milliseconds duration{10000};
+  std::chrono::milliseconds connectTimeout{1000};
+  std::chrono::milliseconds requestTimeout{5000};
+  // Flow control window for HTTP/2 streams and connections
+  uint32_t recvWindow{1 << 20};
+  // Send and receive through io_uring, for h1 and h2
+  bool useIoUring{false};
+};
+
+struct LoadStats {
+  void merge(const LoadStats& other);
+
+  // Microseconds from the time each request was due to the end of its
+  // response.  Open-loop requests are due on their schedule, so requests held
+  // back by slow responses count the time they waited.  Closed-loop latencies
+  // are corrected for the requests each stream would have sent while waiting.
+  LatencyHistogram latency;
+  // Microseconds from the time each request was actually sent
+  LatencyHistogram serviceTime;
+  // Requests that got a complete response
+  uint64_t completed{0};
+  // Of those, the ones with a status other than 2xx
+  uint64_t non2xx{0};
+  // Requests that failed before their response completed
+  uint64_t errors{0};
+  // Open-loop requests that were due but found no free stream by the end
+  uint64_t unsent{0};
+  uint64_t connectErrors{0};
+  uint64_t bodyBytes{0};
+  std::chrono::microseconds elapsed{0};
+};
+
+/**
+ * Generates load from one EventBase: opens its connections, sends requests
+ * over them for the configured duration, then waits for those in flight and
+ * closes them.  Each worker thread runs its own.
+ */
+class LoadWorker : private folly::EventBase::LoopCallback {
+ public:
+  explicit LoadWorker(const LoadOptions& options);
+  ~LoadWorker();
+
+  /**
+   * Run the whole load on the calling thread, returning once every
+   * connection is closed
+   */
+  LoadStats run();
+
+ private:
+  class Request;
+
+#if PROXYGEN_LOADGEN_HQ
+  class Connector : public proxygen::HTTPConnector::Callback,
+                    public proxygen::HQConnector::Callback {
+#else
+  class Connector : public proxygen::HTTPConnector::Callback {
+#endif
+   public:
+    explicit Connector(LoadWorker& worker);
+
+    void connect();
+
+   private:
+    void connectSuccess(proxygen::HTTPUpstreamSession* session) override;
+    void connectError(const folly::AsyncSocketException& ex) override;
+#if PROXYGEN_LOADGEN_HQ
+    void connectSuccess(proxygen::HQUpstreamSession* session) override;
+    void connectError(const quic::QuicErrorCode& code) override;
+#endif
+
+    LoadWorker& worker_;
+    std::unique_ptr<proxygen::HTTPConnector> connector_;
+#if PROXYGEN_LOADGEN_HQ
+    std::unique_ptr<proxygen::HQConnector> hqConnector_;
+#endif
+  };
+
+  void maybeConnect();
+  void onConnectSuccess(Connector* connector,
+                        proxygen::HTTPSessionBase* session);
+  void onConnectError(Connector* connector, const std::string& error);
+  void finishConnect(Connector* connector);
+
+  bool isOpenLoop() const {
+    return options_.rate > 0;
+  }
+  // Requests each connection carries at once
+  uint32_t getStreams() const {
+    return options_.protocol == Protocol::HTTP1 ? 1 : options_.streams;
+  }
+  void startLoad();
+  void stopLoad();
+  void scheduleRequests();
+  // Send the queued requests while the sessions have streams free
+  void sendQueued();
+  void onRequestDone(const Request& request);
+  void finish();
+
+  // Sends the requests queued and finishes the run once stopped, outside of
+  // the callbacks of the transactions that completed
+  void runLoopCallback() noexcept override;
+
+  const LoadOptions options_;
+  folly::EventBase evb_;
+  folly::HHWheelTimer::UniquePtr timer_;
+  std::unique_ptr<proxygen::SessionPool> pool_;
+  std::list<std::unique_ptr<Connector>> connecting_;
+  std::unique_ptr<folly::AsyncTimeout> scheduleTimeout_;
+  std::unique_ptr<folly::AsyncTimeout> stopTimeout_;
+  // Due times of requests waiting for a stream
+  std::deque<proxygen::TimePoint> queued_;
+  proxygen::TimePoint start_;
+  proxygen::TimePoint nextDue_;
+  proxygen::TimePoint lastDone_;
+  std::chrono::nanoseconds interval_{0};
+  uint32_t inFlight_{0};
+  bool started_{false};
+  bool stopping_{false};
+  LoadStats stats_;
+};
+
+}
@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpclient/samples/loadgen/LatencyHistogram.h>
+#include <folly/portability/GTest.h>
+
+using namespace LoadGenService;
+
+namespace {
+
+// The median of a and b, a < b: b when they share a bucket, whose value is
+// capped at the max recorded, and a otherwise
+uint64_t median(uint64_t a, uint64_t b) {
+  LatencyHistogram histogram;
+  histogram.record(a);
+  histogram.record(b);
+  return histogram.getPercentile(50);
+}
+
+}
+
+TEST(LatencyHistogramTest, Empty) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.getCount(), 0);
+  EXPECT_EQ(histogram.getMin(), 0);
+  EXPECT_EQ(histogram.getMax(), 0);
+  EXPECT_EQ(histogram.getPercentile(50), 0);
+  EXPECT_EQ(histogram.getMean(), 0);
+}
+
+TEST(LatencyHistogramTest, BucketBoundaries) {
+  // Exact below 128
+  EXPECT_EQ(median(0, 1), 0);
+  EXPECT_EQ(median(126, 127), 126);
+  EXPECT_EQ(median(127, 128), 127);
+  // Then buckets of 2 up to 256, of 4 up to 512, and so on
+  EXPECT_EQ(median(128, 129), 129);
+  EXPECT_EQ(median(129, 130), 129);
+  EXPECT_EQ(median(254, 255), 255);
+  EXPECT_EQ(median(255, 256), 255);
+  EXPECT_EQ(median(256, 259), 259);
+  EXPECT_EQ(median(259, 260), 259);
+  // The last bucket ends at the largest value
+  const uint64_t lastStart = uint64_t(127) << 57;
+  EXPECT_EQ(median(lastStart - 1, lastStart), lastStart - 1);
+  EXPECT_EQ(median(lastStart, UINT64_MAX), UINT64_MAX);
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram histogram;
+  for (uint64_t value = 1; value <= 10000; value++) {
+    histogram.record(value);
+  }
+  EXPECT_EQ(histogram.getCount(), 10000);
+  EXPECT_EQ(histogram.getMin(), 1);
+  EXPECT_EQ(histogram.getMax(), 10000);
+  EXPECT_DOUBLE_EQ(histogram.getMean(), 5000.5);
+  EXPECT_EQ(histogram.getPercentile(0), 1);
+  // The highest value of the bucket holding the percentile: 4992-5055,
+  // 8960-9087 and 9856-9983
+  EXPECT_EQ(histogram.getPercentile(50), 5055);
+  EXPECT_EQ(histogram.getPercentile(90), 9087);
+  EXPECT_EQ(histogram.getPercentile(99), 9983);
+  EXPECT_EQ(histogram.getPercentile(100), 10000);
+}
+
+TEST(LatencyHistogramTest, Merge) {
+  LatencyHistogram low;
+  LatencyHistogram high;
+  for (uint64_t value = 1; value <= 100; value++) {
+    (value <= 50 ? low : high).record(value);
+  }
+  low.merge(high);
+  EXPECT_EQ(low.getCount(), 100);
+  EXPECT_EQ(low.getMin(), 1);
+  EXPECT_EQ(low.getMax(), 100);
+  EXPECT_EQ(low.getPercentile(50), 50);
+  EXPECT_EQ(low.getPercentile(99), 99);
+}
+
+TEST(LatencyHistogramTest, RecordCorrected) {
+  // 1000 with a request due every 100: 900, 800, ... 100 were held back
+  LatencyHistogram histogram;
+  histogram.recordCorrected(1000, 100);
+  EXPECT_EQ(histogram.getCount(), 10);
+  EXPECT_EQ(histogram.getMin(), 100);
+  EXPECT_EQ(histogram.getMax(), 1000);
+  EXPECT_DOUBLE_EQ(histogram.getMean(), 550);
+  EXPECT_EQ(histogram.getPercentile(10), 100);
+  EXPECT_EQ(histogram.getPercentile(100), 1000);
+
+  // Each of count responses held back the same ones
+  histogram.recordCorrected(1000, 100, 3);
+  EXPECT_EQ(histogram.getCount(), 40);
+  // Nothing held back by a response within the interval, or without one
+  histogram.recordCorrected(100, 100);
+  histogram.recordCorrected(50, 0);
+  EXPECT_EQ(histogram.getCount(), 42);
+  EXPECT_EQ(histogram.getMin(), 50);
+}
+
+TEST(LatencyHistogramTest, RecordCorrectedMatchesRecord) {
+  // The values held back are added a bucket at a time; the result is the
+  // same as recording each of them
+  LatencyHistogram corrected;
+  corrected.recordCorrected(123457, 37);
+  LatencyHistogram expected;
+  for (uint64_t value = 123457; value >= 37; value -= 37) {
+    expected.record(value);
+  }
+  EXPECT_EQ(corrected.getCount(), expected.getCount());
+  EXPECT_EQ(corrected.getMin(), expected.getMin());
+  EXPECT_EQ(corrected.getMax(), expected.getMax());
+  EXPECT_DOUBLE_EQ(corrected.getMean(), expected.getMean());
+  for (double percent : {0.0, 1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+    EXPECT_EQ(corrected.getPercentile(percent),
+              expected.getPercentile(percent))
+        << percent;
+  }
+}
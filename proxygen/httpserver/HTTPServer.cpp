@@ -11,14 +11,24 @@
 #include <proxygen/httpserver/HTTPServer.h>
 
 #include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/portability/Sockets.h>
 #include <folly/system/ThreadName.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <proxygen/httpserver/HTTPServerAcceptor.h>
 #include <proxygen/httpserver/SignalHandler.h>
+#include <proxygen/httpserver/WorkerThreadLayout.h>
+#include <proxygen/httpserver/filters/CacheFilter.h>
 #include <proxygen/httpserver/filters/RejectConnectFilter.h>
 #include <proxygen/httpserver/filters/CompressionFilter.h>
+#include <proxygen/httpserver/filters/DecompressionFilter.h>
+#include <proxygen/lib/http/session/EgressMemoryBudget.h>
+#include <proxygen/lib/http/session/ReceiveWindowAutotuner.h>
 #include <wangle/ssl/SSLContextManager.h>
 
+#ifdef __linux__
+#include <linux/filter.h>
+#endif
+
 using folly::AsyncServerSocket;
 using folly::EventBase;
 using folly::EventBaseManager;
@@ -77,6 +87,24 @@ HTTPServer::HTTPServer(HTTPServerOptions options):
         options_->handlerFactories.begin(),
         std::make_unique<CompressionFilterFactory>(opts));
   }
+
+  if (options_->enableRequestDecompression) {
+    DecompressionFilterFactory::Options opts;
+    opts.maxDecompressedBytes = options_->requestDecompressionMaxSize;
+    opts.maxExpansionRatio = options_->requestDecompressionMaxRatio;
+    opts.ratioGraceBytes = options_->requestDecompressionRatioGraceBytes;
+    options_->handlerFactories.insert(
+        options_->handlerFactories.begin(),
+        std::make_unique<DecompressionFilterFactory>(opts));
+  }
+
+  // The cache goes in front of compression, so hits are sent as stored
+  // rather than compressed again
+  if (options_->responseCache) {
+    options_->handlerFactories.insert(
+        options_->handlerFactories.begin(),
+        std::make_unique<CacheFilterFactory>(options_->responseCache));
+  }
 }
 
 HTTPServer::~HTTPServer() {
@@ -91,6 +119,40 @@ void HTTPServer::bind(std::vector<IPConfig> const& addrs) {
   addresses_ = addrs;
 }
 
+namespace {
+
+/**
+ * Attaches a classic BPF program to the SO_REUSEPORT group fd belongs to
+ * which picks socket (CPU % numSockets) for every new connection.  Sockets are
+ * indexed in the order they were bound, which is the worker order.
+ */
+void attachReusePortCpuSteering(int fd, uint32_t numSockets) {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+  struct sock_filter code[] = {
+    // A = current CPU
+    {BPF_LD | BPF_W | BPF_ABS, 0, 0, uint32_t(SKF_AD_OFF + SKF_AD_CPU)},
+    // A = A % numSockets
+    {BPF_ALU | BPF_MOD | BPF_K, 0, 0, numSockets},
+    // return A
+    {BPF_RET | BPF_A, 0, 0, 0},
+  };
+  struct sock_fprog prog;
+  prog.len = sizeof(code) / sizeof(code[0]);
+  prog.filter = code;
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                 &prog, sizeof(prog)) != 0) {
+    LOG(WARNING) << "Failed to attach reuseport CPU steering, errno="
+                 << errno;
+  }
+#else
+  (void)fd;
+  (void)numSockets;
+  LOG(WARNING) << "reuseport CPU steering is not supported on this platform";
+#endif
+}
+
+}
+
 class HandlerCallbacks : public ThreadPoolExecutor::Observer {
  public:
   explicit HandlerCallbacks(std::shared_ptr<HTTPServerOptions> options) : options_(options) {}
@@ -121,40 +183,49 @@ void HTTPServer::start(std::function<void()> onSuccess,
                        std::function<void(std::exception_ptr)> onError) {
   mainEventBase_ = EventBaseManager::get()->getEventBase();
 
-  auto accExe = std::make_shared<IOThreadPoolExecutor>(1);
-  auto exe = std::make_shared<IOThreadPoolExecutor>(options_->threads,
-    std::make_shared<folly::NamedThreadFactory>("HTTPSrvExec"));
-  auto exeObserver = std::make_shared<HandlerCallbacks>(options_);
-  // Observer has to be set before bind(), so onServerStart() callbacks run
-  exe->addObserver(exeObserver);
+  EgressMemoryBudget::setLimits(options_->egressMemoryBudgetPerWorker,
+                                options_->egressMemoryBudgetPerProcess);
+  ReceiveWindowAutotuner::setProcessLimit(
+      options_->receiveWindowAutotuningMemoryLimit);
+
+  std::shared_ptr<IOThreadPoolExecutor> exe;
+  if (options_->threads > 0) {
+    std::shared_ptr<folly::ThreadFactory> threadFactory;
+    if (options_->pinWorkerThreads) {
+      threadFactory = std::make_shared<WorkerThreadFactory>(
+          "HTTPSrvExec",
+          WorkerThreadLayout::makeLayout(options_->threads,
+                                         options_->workerCpus),
+          options_->numaLocalArenas);
+    } else {
+      threadFactory = std::make_shared<folly::NamedThreadFactory>(
+          "HTTPSrvExec");
+    }
+    exe = std::make_shared<IOThreadPoolExecutor>(options_->threads,
+                                                 threadFactory);
+    auto exeObserver = std::make_shared<HandlerCallbacks>(options_);
+    // Observer has to be set before bind(), so onServerStart() callbacks run
+    exe->addObserver(exeObserver);
+  } else {
+    // Serve from this thread's loop
+    inlineWorker_ = true;
+    for (auto& factory: options_->handlerFactories) {
+      factory->onServerStart(mainEventBase_);
+    }
+  }
 
   try {
-    FOR_EACH_RANGE (i, 0, addresses_.size()) {
-      auto codecFactory = addresses_[i].codecFactory;
-      auto accConfig = HTTPServerAcceptor::makeConfig(addresses_[i], *options_);
-      auto factory = std::make_shared<AcceptorFactory>(
-          options_,
-          codecFactory,
-          accConfig,
-          sessionInfoCb_);
-      bootstrap_.push_back(
-          wangle::ServerBootstrap<wangle::DefaultPipeline>());
-      bootstrap_[i].childHandler(factory);
-      if (accConfig.enableTCPFastOpen) {
-        // We need to do this because wangle's bootstrap has 2 acceptor configs
-        // and the socketConfig gets passed to the SocketFactory. The number of
-        // configs should really be one, and when that happens, we can remove
-        // this code path.
-        bootstrap_[i].socketConfig.enableTCPFastOpen = true;
-        bootstrap_[i].socketConfig.fastOpenQueueSize =
-            accConfig.fastOpenQueueSize;
-      }
-      bootstrap_[i].group(accExe, exe);
-      if (options_->preboundSockets_.size() > 0) {
-        bootstrap_[i].bind(std::move(options_->preboundSockets_[i]));
-      } else {
-        bootstrap_[i].bind(addresses_[i].address);
+    if (!exe) {
+      bindWorkerListeners({mainEventBase_}, false);
+    } else if (options_->perWorkerListeners) {
+      workerExe_ = exe;
+      std::vector<EventBase*> evbs;
+      for (auto& evb : exe->getAllEventBases()) {
+        evbs.push_back(evb.get());
       }
+      bindWorkerListeners(evbs, true);
+    } else {
+      bindAcceptorThread(exe);
     }
   } catch (const std::exception& ex) {
     stop();
@@ -185,10 +256,102 @@ void HTTPServer::start(std::function<void()> onSuccess,
   mainEventBase_->loopForever();
 }
 
+void HTTPServer::bindAcceptorThread(
+    const std::shared_ptr<IOThreadPoolExecutor>& exe) {
+  auto accExe = std::make_shared<IOThreadPoolExecutor>(1);
+  FOR_EACH_RANGE (i, 0, addresses_.size()) {
+    auto codecFactory = addresses_[i].codecFactory;
+    auto accConfig = HTTPServerAcceptor::makeConfig(addresses_[i], *options_);
+    auto factory = std::make_shared<AcceptorFactory>(
+        options_,
+        codecFactory,
+        accConfig,
+        sessionInfoCb_);
+    bootstrap_.push_back(
+        wangle::ServerBootstrap<wangle::DefaultPipeline>());
+    bootstrap_[i].childHandler(factory);
+    if (accConfig.enableTCPFastOpen) {
+      // We need to do this because wangle's bootstrap has 2 acceptor configs
+      // and the socketConfig gets passed to the SocketFactory. The number of
+      // configs should really be one, and when that happens, we can remove
+      // this code path.
+      bootstrap_[i].socketConfig.enableTCPFastOpen = true;
+      bootstrap_[i].socketConfig.fastOpenQueueSize =
+          accConfig.fastOpenQueueSize;
+    }
+    bootstrap_[i].group(accExe, exe);
+    if (options_->preboundSockets_.size() > 0) {
+      bootstrap_[i].bind(std::move(options_->preboundSockets_[i]));
+    } else {
+      bootstrap_[i].bind(addresses_[i].address);
+    }
+  }
+}
+
+void HTTPServer::bindWorkerListeners(const std::vector<EventBase*>& evbs,
+                                     bool reusePort) {
+  if (!options_->preboundSockets_.empty()) {
+    throw std::invalid_argument(
+        "Existing sockets require an acceptor thread");
+  }
+  FOR_EACH_RANGE (i, 0, addresses_.size()) {
+    auto accConfig = HTTPServerAcceptor::makeConfig(addresses_[i], *options_);
+    auto factory = std::make_shared<AcceptorFactory>(
+        options_,
+        addresses_[i].codecFactory,
+        accConfig,
+        sessionInfoCb_);
+    auto first = workerListeners_.size();
+    for (auto evb : evbs) {
+      workerListeners_.emplace_back();
+      auto& listener = workerListeners_.back();
+      listener.evb = evb;
+      std::exception_ptr ex;
+      evb->runImmediatelyOrRunInEventBaseThreadAndWait([&] {
+        try {
+          listener.socket.reset(new AsyncServerSocket(evb));
+          listener.socket->setReusePortEnabled(reusePort);
+          if (accConfig.enableTCPFastOpen) {
+            listener.socket->setTFOEnabled(true, accConfig.fastOpenQueueSize);
+          }
+          listener.socket->bind(addresses_[i].address);
+          listener.socket->listen(accConfig.acceptBacklog);
+          listener.acceptor = factory->newAcceptor(evb);
+          // No EventBase: connections are accepted inline on this worker
+          listener.socket->addAcceptCallback(listener.acceptor.get(),
+                                             nullptr);
+          listener.socket->startAccepting();
+        } catch (...) {
+          ex = std::current_exception();
+        }
+      });
+      if (ex) {
+        std::rethrow_exception(ex);
+      }
+      // The other workers must join the port the first one bound, even when
+      // an ephemeral port was requested
+      listener.socket->getAddress(&addresses_[i].address);
+    }
+    if (reusePort && options_->reusePortCpuSteering) {
+      attachReusePortCpuSteering(
+          workerListeners_[first].socket->getNetworkSocket().toFd(),
+          evbs.size());
+    }
+  }
+}
+
 void HTTPServer::stopListening() {
   for (auto& bootstrap : bootstrap_) {
     bootstrap.stop();
   }
+  for (auto& listener : workerListeners_) {
+    listener.evb->runImmediatelyOrRunInEventBaseThreadAndWait([&listener] {
+      if (listener.socket) {
+        listener.socket->stopAccepting();
+        listener.socket.reset();
+      }
+    });
+  }
 }
 
 void HTTPServer::stop() {
@@ -198,6 +361,29 @@ void HTTPServer::stop() {
     bootstrap.join();
   }
 
+  for (auto& listener : workerListeners_) {
+    listener.evb->runImmediatelyOrRunInEventBaseThreadAndWait([&listener] {
+      if (listener.acceptor) {
+        listener.acceptor->dropAllConnections();
+        listener.acceptor.reset();
+      }
+    });
+  }
+  workerListeners_.clear();
+  if (workerExe_) {
+    workerExe_->join();
+    workerExe_.reset();
+  }
+
+  if (inlineWorker_ && mainEventBase_) {
+    inlineWorker_ = false;
+    mainEventBase_->runImmediatelyOrRunInEventBaseThreadAndWait([&] {
+      for (auto& factory: options_->handlerFactories) {
+        factory->onServerStop();
+      }
+    });
+  }
+
   if (signalHandler_) {
     signalHandler_.reset();
   }
@@ -218,11 +404,21 @@ const std::vector<const folly::AsyncSocketBase*>
       sockets.push_back(bootstrapSockets[j].get());
     }
   }
+  for (auto& listener : workerListeners_) {
+    if (listener.socket) {
+      sockets.push_back(listener.socket.get());
+    }
+  }
 
   return sockets;
 }
 
 int HTTPServer::getListenSocket() const {
+  if (!workerListeners_.empty()) {
+    auto& socket = workerListeners_[0].socket;
+    return socket ? socket->getNetworkSocket().toFd() : -1;
+  }
+
   if (bootstrap_.size() == 0) {
     return -1;
   }
@@ -243,39 +439,49 @@ int HTTPServer::getListenSocket() const {
 }
 
 
-void HTTPServer::updateTLSCredentials() {
+void HTTPServer::forEachAcceptor(
+    const std::function<void(wangle::Acceptor*)>& fn) {
   for (auto& bootstrap : bootstrap_) {
-    bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
-      if (!acceptor || !acceptor->isSSL()) {
-        return;
-      }
-      auto evb = acceptor->getEventBase();
-      if (!evb) {
-        return;
+    bootstrap.forEachWorker(fn);
+  }
+  for (auto& listener : workerListeners_) {
+    fn(listener.acceptor.get());
+  }
+}
+
+void HTTPServer::updateTLSCredentials() {
+  forEachAcceptor([&](wangle::Acceptor* acceptor) {
+    if (!acceptor || !acceptor->isSSL()) {
+      return;
+    }
+    auto evb = acceptor->getEventBase();
+    if (!evb) {
+      return;
+    }
+    evb->runInEventBaseThread([acceptor] {
+      acceptor->resetSSLContextConfigs();
+      auto sessionAcceptor = dynamic_cast<HTTPSessionAcceptor*>(acceptor);
+      if (sessionAcceptor) {
+        sessionAcceptor->enableKernelTLS();
       }
-      evb->runInEventBaseThread([acceptor] {
-        acceptor->resetSSLContextConfigs();
-      });
     });
-  }
+  });
 }
 
 void HTTPServer::updateTicketSeeds(wangle::TLSTicketKeySeeds seeds) {
-  for (auto& bootstrap : bootstrap_) {
-    bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
-      if (!acceptor || !acceptor->isSSL()) {
-        return;
-      }
-      auto evb = acceptor->getEventBase();
-      if (!evb) {
-        return;
-      }
-      evb->runInEventBaseThread([acceptor, seeds] {
-        acceptor->setTLSTicketSecrets(
-            seeds.oldSeeds, seeds.currentSeeds, seeds.newSeeds);
-      });
+  forEachAcceptor([&](wangle::Acceptor* acceptor) {
+    if (!acceptor || !acceptor->isSSL()) {
+      return;
+    }
+    auto evb = acceptor->getEventBase();
+    if (!evb) {
+      return;
+    }
+    evb->runInEventBaseThread([acceptor, seeds] {
+      acceptor->setTLSTicketSecrets(
+          seeds.oldSeeds, seeds.currentSeeds, seeds.newSeeds);
     });
-  }
+  });
 }
 
 }
@@ -183,6 +183,27 @@ class HTTPServer final {
   std::vector<IPConfig> addresses_;
   std::vector<wangle::ServerBootstrap<wangle::DefaultPipeline>> bootstrap_;
 
+  /**
+   * With HTTPServerOptions::perWorkerListeners, or with no worker threads,
+   * the listening socket and acceptor each worker owns for each address.
+   * Both live and die on the worker's EventBase.
+   */
+  struct WorkerListener {
+    folly::EventBase* evb{nullptr};
+    folly::AsyncServerSocket::UniquePtr socket;
+    std::shared_ptr<wangle::Acceptor> acceptor;
+  };
+  std::vector<WorkerListener> workerListeners_;
+  std::shared_ptr<folly::IOThreadPoolExecutor> workerExe_;
+  // threads == 0: requests are served on mainEventBase_
+  bool inlineWorker_{false};
+
+  void bindAcceptorThread(
+      const std::shared_ptr<folly::IOThreadPoolExecutor>& exe);
+  void bindWorkerListeners(const std::vector<folly::EventBase*>& evbs,
+                           bool reusePort);
+  void forEachAcceptor(const std::function<void(wangle::Acceptor*)>& fn);
+
   /**
    * Callback for session create/destruction
    */
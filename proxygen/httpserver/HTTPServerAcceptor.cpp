@@ -31,8 +31,13 @@ AcceptorConfiguration HTTPServerAcceptor::makeConfig(
   conf.initialReceiveWindow = opts.initialReceiveWindow;
   conf.receiveStreamWindowSize = opts.receiveStreamWindowSize;
   conf.receiveSessionWindowSize = opts.receiveSessionWindowSize;
+  conf.maxReceiveSessionWindowSize = opts.maxReceiveSessionWindowSize;
+  conf.maxReceiveStreamWindowSize = opts.maxReceiveStreamWindowSize;
   conf.acceptBacklog = opts.listenBacklog;
   conf.maxConcurrentIncomingStreams = opts.maxConcurrentIncomingStreams;
+  conf.maxPipelinedRequests = opts.maxPipelinedRequests;
+  conf.useIoUring = opts.useIoUring;
+  conf.useKernelTLS = opts.useKernelTLS;
 
   if (opts.enableExHeaders) {
     conf.egressSettings.push_back(
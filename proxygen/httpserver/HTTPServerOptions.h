@@ -14,6 +14,7 @@
 #include <folly/io/async/AsyncServerSocket.h>
 #include <proxygen/httpserver/Filters.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/filters/ResponseCache.h>
 #include <signal.h>
 
 namespace proxygen {
@@ -42,13 +43,32 @@ class HTTPServerOptions {
    * Number of threads to start to handle requests. Note that this excludes
    * the thread you call `HTTPServer.start()` in.
    *
+   * When `threads == 0` no threads are created: connections are accepted and
+   * served on the event loop of the thread that calls `HTTPServer.start()`.
+   * Existing sockets (useExistingSocket) are not supported in that mode.
+   *
    * XXX: Put some perf numbers to help user decide how many threads to
    *      create.
-   * XXX: Maybe support not creating any more worker threads and doing all
-   *      the work in same thread when `threads == 0`.
    */
   size_t threads = 1;
 
+  /**
+   * Pin each worker thread to one CPU.  Worker i runs on
+   * workerCpus[i % workerCpus.size()], or when workerCpus is empty, on the
+   * i-th CPU this process may use, filling one NUMA node before moving to
+   * the next.  Combine with perWorkerListeners and reusePortCpuSteering to
+   * keep a connection on one core end to end.
+   */
+  bool pinWorkerThreads{false};
+  std::vector<uint32_t> workerCpus;
+
+  /**
+   * With pinWorkerThreads and jemalloc, give every NUMA node its own jemalloc
+   * arena and have each worker allocate from its node's arena, so session,
+   * codec and buffer memory is local to the node serving the connection.
+   */
+  bool numaLocalArenas{false};
+
   /**
    * Chain of RequestHandlerFactory that are used to create RequestHandler
    * which handles requests.
@@ -81,6 +101,25 @@ class HTTPServerOptions {
    */
   uint32_t listenBacklog{1024};
 
+  /**
+   * By default a single acceptor thread accepts every connection and hands
+   * it to a worker.  When set, each worker binds its own SO_REUSEPORT
+   * listening socket for every address and accepts on it directly, so
+   * accepts scale with the number of workers.  The kernel spreads new
+   * connections across the workers' sockets.  Not supported together with
+   * useExistingSocket().
+   */
+  bool perWorkerListeners{false};
+
+  /**
+   * With perWorkerListeners, attach a reuseport BPF program which hands each
+   * connection to worker (CPU % threads), where CPU is the core that
+   * processed the incoming SYN.  Keeps a connection on the core its packets
+   * arrive on when workers are pinned in order to CPUs and RSS/RFS steer
+   * flows to those CPUs.  Linux only, ignored elsewhere.
+   */
+  bool reusePortCpuSteering{false};
+
   /**
    * Enable cleartext upgrades to HTTP/2
    */
@@ -107,12 +146,58 @@ class HTTPServerOptions {
   size_t receiveStreamWindowSize{65536};
   size_t receiveSessionWindowSize{65536};
 
+  /**
+   * Receive window autotuning for HTTP/2.  When non-zero, each session grows
+   * its session and stream windows from the sizes above towards the measured
+   * bandwidth-delay product of its connection, up to these sizes, so idle
+   * connections keep small windows while bulk uploads over long links are
+   * not window bound.  receiveWindowAutotuningMemoryLimit caps the growth of
+   * all sessions in the process together, 0 means unlimited.  See
+   * ReceiveWindowAutotuner.
+   */
+  uint32_t maxReceiveSessionWindowSize{0};
+  uint32_t maxReceiveStreamWindowSize{0};
+  uint64_t receiveWindowAutotuningMemoryLimit{0};
+
   /**
    * The maximum number of transactions the remote could initiate
    * per connection on protocols that allow multiplexing.
    */
   uint32_t maxConcurrentIncomingStreams{100};
 
+  /**
+   * The number of pipelined HTTP/1.1 requests each connection parses ahead
+   * of the one being responded to.  Responses that become ready together
+   * are sent in one write.  The default of 1 stops reading at the second
+   * request, processing pipelined requests one at a time; raise it to have
+   * them processed together.
+   */
+  uint32_t maxPipelinedRequests{1};
+
+  /**
+   * Batch plaintext connections' reads and writes through an io_uring per
+   * worker thread, instead of a readiness event and a syscall for each.
+   * Falls back to regular sockets when the kernel lacks io_uring.
+   */
+  bool useIoUring{false};
+
+  /**
+   * Have the kernel encrypt and decrypt TLS records once the handshake is
+   * done (kTLS), sparing the userspace copy and cipher on every write.
+   * Connections stay with OpenSSL when the kernel, the OpenSSL build or the
+   * negotiated cipher does not allow it.
+   */
+  bool useKernelTLS{false};
+
+  /**
+   * Limits on egress bytes buffered across all sessions on each worker
+   * thread, and across the whole process, on top of each session's own write
+   * buffer limit.  Once exceeded, the sessions buffering the most are paused
+   * first.  0 means unlimited.  See EgressMemoryBudget.
+   */
+  uint64_t egressMemoryBudgetPerWorker{0};
+  uint64_t egressMemoryBudgetPerProcess{0};
+
   /**
    * Set to true to enable gzip content compression. Currently false for
    * backwards compatibility.
@@ -130,6 +215,24 @@ class HTTPServerOptions {
    */
   int contentCompressionLevel{-1};
 
+  /**
+   * Set to true to decode request bodies sent with a gzip, deflate or zstd
+   * Content-Encoding before they reach the handlers.  Requests decoding to
+   * more than requestDecompressionMaxSize bytes, or expanding more than
+   * requestDecompressionMaxRatio times once past
+   * requestDecompressionRatioGraceBytes, are rejected with a 413.
+   */
+  bool enableRequestDecompression{false};
+  uint64_t requestDecompressionMaxSize{64 * 1024 * 1024};
+  uint32_t requestDecompressionMaxRatio{100};
+  uint64_t requestDecompressionRatioGraceBytes{1024 * 1024};
+
+  /**
+   * If set, cacheable responses are stored in and served from this cache,
+   * shared by every worker.  Keep a reference to read its stats.
+   */
+  std::shared_ptr<ResponseCache> responseCache;
+
   /**
    * Enable support for pub-sub extension.
    */
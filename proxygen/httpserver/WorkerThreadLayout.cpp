@@ -0,0 +1,213 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/WorkerThreadLayout.h>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
+#include <folly/String.h>
+#include <folly/memory/MallctlHelper.h>
+#include <folly/memory/Malloc.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace proxygen {
+
+namespace {
+
+// Number of NUMA nodes to probe in sysfs
+const uint32_t kMaxNumaNodes = 64;
+
+#ifdef __linux__
+void pinCurrentThread(uint32_t cpu) {
+  // Sized for cpu, which may be past CPU_SETSIZE on large hosts
+  auto cpuset = CPU_ALLOC(cpu + 1);
+  if (!cpuset) {
+    LOG(WARNING) << "Failed to allocate a cpu set for cpu " << cpu;
+    return;
+  }
+  SCOPE_EXIT {
+    CPU_FREE(cpuset);
+  };
+  auto setSize = CPU_ALLOC_SIZE(cpu + 1);
+  CPU_ZERO_S(setSize, cpuset);
+  CPU_SET_S(cpu, setSize, cpuset);
+  auto rc = pthread_setaffinity_np(pthread_self(), setSize, cpuset);
+  if (rc != 0) {
+    LOG(WARNING) << "Failed to pin thread to cpu " << cpu << ", rc=" << rc;
+  }
+}
+#endif
+
+// Creates, once per node, the jemalloc arena threads on that node share
+bool getNodeArena(uint32_t node, unsigned* arena) {
+  static std::mutex mutex;
+  static std::map<uint32_t, unsigned> arenas;
+  std::lock_guard<std::mutex> g(mutex);
+  auto it = arenas.find(node);
+  if (it == arenas.end()) {
+    unsigned created = 0;
+    try {
+      folly::mallctlRead<unsigned>("arenas.create", &created);
+    } catch (const std::exception& ex) {
+      LOG(WARNING) << "Failed to create arena for NUMA node " << node << ": "
+                   << ex.what();
+      return false;
+    }
+    it = arenas.emplace(node, created).first;
+  }
+  *arena = it->second;
+  return true;
+}
+
+}
+
+std::vector<uint32_t> WorkerThreadLayout::parseCpuList(
+    const std::string& cpuList) {
+  std::vector<uint32_t> cpus;
+  std::vector<folly::StringPiece> ranges;
+  folly::split(',', folly::trimWhitespace(cpuList), ranges);
+  for (auto range : ranges) {
+    if (range.empty()) {
+      continue;
+    }
+    folly::StringPiece first;
+    folly::StringPiece last;
+    if (folly::split('-', range, first, last)) {
+      auto lo = folly::to<uint32_t>(first);
+      auto hi = folly::to<uint32_t>(last);
+      if (lo > hi) {
+        throw std::invalid_argument(
+            folly::to<std::string>("Invalid cpu range: ", range));
+      }
+      for (auto cpu = lo; cpu <= hi; cpu++) {
+        cpus.push_back(cpu);
+      }
+    } else {
+      cpus.push_back(folly::to<uint32_t>(range));
+    }
+  }
+  return cpus;
+}
+
+std::vector<WorkerPlacement> WorkerThreadLayout::getAvailableCpus() {
+  std::vector<WorkerPlacement> result;
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return result;
+  }
+  std::map<uint32_t, uint32_t> cpuToNode;
+  for (uint32_t node = 0; node < kMaxNumaNodes; node++) {
+    std::string cpuList;
+    if (!folly::readFile(
+            folly::to<std::string>(
+                "/sys/devices/system/node/node", node, "/cpulist").c_str(),
+            cpuList)) {
+      continue;
+    }
+    try {
+      for (auto cpu : parseCpuList(cpuList)) {
+        cpuToNode[cpu] = node;
+      }
+    } catch (const std::exception&) {
+      // Leave this node's CPUs on node 0
+    }
+  }
+  for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed)) {
+      auto it = cpuToNode.find(cpu);
+      result.push_back({cpu, it == cpuToNode.end() ? 0 : it->second});
+    }
+  }
+  std::stable_sort(
+      result.begin(), result.end(),
+      [](const WorkerPlacement& a, const WorkerPlacement& b) {
+        return a.numaNode < b.numaNode;
+      });
+#endif
+  return result;
+}
+
+std::vector<WorkerPlacement> WorkerThreadLayout::makeLayout(
+    size_t threads, const std::vector<uint32_t>& cpus) {
+  auto available = getAvailableCpus();
+  std::vector<WorkerPlacement> choices;
+  if (cpus.empty()) {
+    choices = std::move(available);
+  } else {
+    for (auto cpu : cpus) {
+      auto it = std::find_if(
+          available.begin(), available.end(),
+          [cpu](const WorkerPlacement& p) { return p.cpu == cpu; });
+      choices.push_back({cpu, it == available.end() ? 0 : it->numaNode});
+    }
+  }
+  std::vector<WorkerPlacement> layout;
+  if (choices.empty()) {
+    return layout;
+  }
+  for (size_t i = 0; i < threads; i++) {
+    layout.push_back(choices[i % choices.size()]);
+  }
+  return layout;
+}
+
+void WorkerThreadLayout::applyToCurrentThread(
+    const WorkerPlacement& placement, bool numaLocalArenas) {
+#ifdef __linux__
+  pinCurrentThread(placement.cpu);
+#else
+  LOG(WARNING) << "Thread pinning is not supported on this platform";
+#endif
+  if (!numaLocalArenas) {
+    return;
+  }
+  if (!folly::usingJEMalloc()) {
+    LOG(WARNING) << "NUMA local arenas require jemalloc";
+    return;
+  }
+  unsigned arena = 0;
+  if (!getNodeArena(placement.numaNode, &arena)) {
+    return;
+  }
+  try {
+    folly::mallctlWrite<unsigned>("thread.arena", arena);
+  } catch (const std::exception& ex) {
+    LOG(WARNING) << "Failed to bind thread to arena " << arena << ": "
+                 << ex.what();
+  }
+}
+
+std::thread WorkerThreadFactory::newThread(folly::Func&& func) {
+  if (layout_.empty()) {
+    return folly::NamedThreadFactory::newThread(std::move(func));
+  }
+  auto placement = layout_[next_++ % layout_.size()];
+  return folly::NamedThreadFactory::newThread(
+      [placement, numaLocalArenas = numaLocalArenas_,
+       func = std::move(func)]() mutable {
+        WorkerThreadLayout::applyToCurrentThread(placement, numaLocalArenas);
+        func();
+      });
+}
+
+}
@@ -0,0 +1,84 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Where a worker thread runs: a CPU and the NUMA node that CPU belongs to.
+ */
+struct WorkerPlacement {
+  uint32_t cpu{0};
+  uint32_t numaNode{0};
+};
+
+/**
+ * Helpers to lay out HTTPServer worker threads over the machine's CPUs.
+ */
+class WorkerThreadLayout {
+ public:
+  /**
+   * Parses a kernel cpulist such as "0-3,8,10-11".  Throws
+   * std::invalid_argument on malformed input.
+   */
+  static std::vector<uint32_t> parseCpuList(const std::string& cpuList);
+
+  /**
+   * CPUs this process may run on, ordered by NUMA node and then CPU id, so
+   * that consecutive workers share a node.  Every CPU is reported on node 0
+   * when the topology is not available.
+   */
+  static std::vector<WorkerPlacement> getAvailableCpus();
+
+  /**
+   * Placement for each of `threads` workers.  Worker i gets
+   * cpus[i % cpus.size()] when cpus is given, otherwise the i-th available
+   * CPU, wrapping around when there are more workers than CPUs.
+   */
+  static std::vector<WorkerPlacement> makeLayout(
+      size_t threads, const std::vector<uint32_t>& cpus);
+
+  /**
+   * Pins the calling thread to placement.cpu and, if numaLocalArenas is set
+   * and jemalloc is in use, binds it to a jemalloc arena shared by all
+   * threads placed on the same node.  Failures are logged, not fatal.
+   */
+  static void applyToCurrentThread(const WorkerPlacement& placement,
+                                   bool numaLocalArenas);
+};
+
+/**
+ * NamedThreadFactory which applies the next placement of a layout to each
+ * thread it starts.
+ */
+class WorkerThreadFactory : public folly::NamedThreadFactory {
+ public:
+  WorkerThreadFactory(folly::StringPiece prefix,
+                      std::vector<WorkerPlacement> layout,
+                      bool numaLocalArenas)
+      : folly::NamedThreadFactory(prefix),
+        layout_(std::move(layout)),
+        numaLocalArenas_(numaLocalArenas) {}
+
+  std::thread newThread(folly::Func&& func) override;
+
+ private:
+  const std::vector<WorkerPlacement> layout_;
+  const bool numaLocalArenas_;
+  std::atomic<size_t> next_{0};
+};
+
+}
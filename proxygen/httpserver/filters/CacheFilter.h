@@ -0,0 +1,243 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/filters/ResponseCache.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter that answers requests from a ResponseCache and stores
+ * the cacheable responses of the handlers behind it.
+ *
+ * With a fresh entry the request is answered right away on the worker
+ * thread, and the handler never sees it.  With a stale entry the request is
+ * made conditional on its ETag; a 304 refreshes the entry, which is then
+ * sent in place of the 304.  A 304 for some other ETag cannot refresh the
+ * entry, and the stale entry is sent in its place instead.
+ */
+class CacheFilter : public Filter {
+ public:
+  /**
+   * entry is the fresh entry to answer from when fresh is set, otherwise a
+   * stale entry to revalidate or null.
+   */
+  CacheFilter(RequestHandler* upstream,
+              std::shared_ptr<ResponseCache> cache,
+              std::shared_ptr<const CachedResponse> entry,
+              bool fresh)
+      : Filter(upstream),
+        cache_(std::move(cache)),
+        entry_(std::move(entry)),
+        fresh_(fresh) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    if (fresh_) {
+      // The handler is released without ever seeing the request
+      upstream_->onError(kErrorNone);
+      upstream_ = nullptr;
+      sendCached(*entry_, *msg);
+      Filter::sendEOM();
+      return;
+    }
+
+    if (ResponseCache::canStore(*msg) || entry_) {
+      request_ = std::make_unique<HTTPMessage>(*msg);
+    }
+    if (entry_ && !msg->getHeaders().exists(HTTP_HEADER_IF_NONE_MATCH)) {
+      msg->getHeaders().set(HTTP_HEADER_IF_NONE_MATCH, entry_->etag);
+      addedConditional_ = true;
+    }
+    Filter::onRequest(std::move(msg));
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (upstream_) {
+      Filter::onBody(std::move(body));
+    }
+  }
+
+  void onUpgrade(UpgradeProtocol protocol) noexcept override {
+    if (upstream_) {
+      Filter::onUpgrade(protocol);
+    }
+  }
+
+  void onEOM() noexcept override {
+    if (upstream_) {
+      Filter::onEOM();
+    }
+  }
+
+  void requestComplete() noexcept override {
+    if (upstream_) {
+      Filter::requestComplete();
+      return;
+    }
+    delete this;
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    if (upstream_) {
+      Filter::onError(err);
+      return;
+    }
+    delete this;
+  }
+
+  void onEgressPaused() noexcept override {
+    if (upstream_) {
+      Filter::onEgressPaused();
+    }
+  }
+
+  void onEgressResumed() noexcept override {
+    if (upstream_) {
+      Filter::onEgressResumed();
+    }
+  }
+
+  // Response handler
+  void sendHeaders(HTTPMessage& msg) noexcept override {
+    if (entry_ && msg.getStatusCode() == 304) {
+      const auto& etag = msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_ETAG);
+      auto entry = entry_;
+      if (etag.empty() || etag == entry_->etag) {
+        entry = cache_->refresh(*request_, entry_, msg);
+      }
+      if (addedConditional_) {
+        // The client asked for the whole response, and the 304 cannot be
+        // passed on to it
+        sendCached(*entry, *request_);
+        swallow_ = true;
+        return;
+      }
+    }
+    if (request_ && ResponseCache::canStore(*request_) &&
+        ResponseCache::getFreshnessLifetime(msg)) {
+      response_ = std::make_unique<HTTPMessage>(msg);
+    }
+    Filter::sendHeaders(msg);
+  }
+
+  void sendChunkHeader(size_t len) noexcept override {
+    if (!swallow_) {
+      Filter::sendChunkHeader(len);
+    }
+  }
+
+  void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (swallow_) {
+      return;
+    }
+    if (response_ && body) {
+      if (body_.chainLength() + body->computeChainDataLength() >
+          cache_->getOptions().maxObjectBytes) {
+        // Too big to store, stop keeping it
+        response_.reset();
+        body_.move();
+      } else {
+        body_.append(body->clone());
+      }
+    }
+    Filter::sendBody(std::move(body));
+  }
+
+  void sendChunkTerminator() noexcept override {
+    if (!swallow_) {
+      Filter::sendChunkTerminator();
+    }
+  }
+
+  void sendEOM() noexcept override {
+    if (response_) {
+      cache_->store(*request_, *response_, body_.move());
+      response_.reset();
+    }
+    Filter::sendEOM();
+  }
+
+  void sendAbort() noexcept override {
+    response_.reset();
+    Filter::sendAbort();
+  }
+
+ private:
+  // Send the headers and body of entry in response to request
+  void sendCached(const CachedResponse& entry, const HTTPMessage& request) {
+    auto response = ResponseCache::makeResponse(
+        entry, request, CachedResponse::Clock::now());
+    Filter::sendHeaders(*response);
+    if (entry.body && response->getStatusCode() != 304 &&
+        request.getMethod() != HTTPMethod::HEAD) {
+      Filter::sendBody(entry.body->clone());
+    }
+  }
+
+  std::shared_ptr<ResponseCache> cache_;
+  std::shared_ptr<const CachedResponse> entry_;
+  // Copy of the request, as received from the client
+  std::unique_ptr<HTTPMessage> request_;
+  // The response being stored, and its body so far
+  std::unique_ptr<HTTPMessage> response_;
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+  const bool fresh_;
+  bool addedConditional_{false};
+  // The handler's response was replaced by the cached one
+  bool swallow_{false};
+};
+
+class CacheFilterFactory : public RequestHandlerFactory {
+ public:
+  explicit CacheFilterFactory(std::shared_ptr<ResponseCache> cache)
+      : cache_(std::move(cache)) {
+  }
+
+  explicit CacheFilterFactory(const ResponseCache::Options& opts)
+      : cache_(std::make_shared<ResponseCache>(opts)) {
+  }
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+  }
+
+  void onServerStop() noexcept override {
+  }
+
+  RequestHandler* onRequest(RequestHandler* h,
+                            HTTPMessage* msg) noexcept override {
+    std::shared_ptr<const CachedResponse> entry;
+    if (ResponseCache::canLookup(*msg)) {
+      entry = cache_->lookup(*msg);
+    }
+    bool fresh = entry && entry->isFresh(CachedResponse::Clock::now());
+    if (entry && !fresh && entry->etag.empty()) {
+      // Nothing to revalidate it with
+      entry.reset();
+    }
+    if (!entry && !ResponseCache::canStore(*msg)) {
+      // No need to insert this filter
+      return h;
+    }
+    return new CacheFilter(h, cache_, std::move(entry), fresh);
+  }
+
+  const std::shared_ptr<ResponseCache>& getCache() const {
+    return cache_;
+  }
+
+ private:
+  std::shared_ptr<ResponseCache> cache_;
+};
+
+} // namespace proxygen
@@ -10,10 +10,12 @@
 #pragma once
 
 #include <folly/Memory.h>
+#include <folly/ThreadLocal.h>
 
 #include <proxygen/httpserver/Filters.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
 #include <proxygen/lib/http/RFC2616.h>
+#include <proxygen/lib/utils/StreamCodecPool.h>
 #include <proxygen/lib/utils/StreamCompressor.h>
 #include <proxygen/lib/utils/ZlibStreamCompressor.h>
 
@@ -215,11 +217,15 @@ class CompressionFilterFactory : public RequestHandlerFactory {
     uint32_t minimumCompressionSize = 1000;
     std::set<std::string> compressibleContentTypes = {};
     int32_t zlibCompressionLevel = 4;
+    // Compressors each worker thread keeps for reuse once their response is
+    // done.  0 creates a new compressor for every response.
+    size_t compressorPoolSize = 16;
   };
 
   CompressionFilterFactory(const Options& opts)
       : minimumCompressionSize_(opts.minimumCompressionSize),
         zlibCompressionLevel_(opts.zlibCompressionLevel),
+        compressorPoolSize_(opts.compressorPoolSize),
         compressibleContentTypes_(std::make_shared<std::set<std::string>>(
             opts.compressibleContentTypes)) {
   }
@@ -237,23 +243,48 @@ class CompressionFilterFactory : public RequestHandlerFactory {
                             HTTPMessage* msg) noexcept override {
     switch (determineCompressionType(msg)) {
       case CodecType::ZLIB:
-        return new CompressionFilter{
-            h,
-            minimumCompressionSize_,
-            [level =
-                 zlibCompressionLevel_]() -> std::unique_ptr<StreamCompressor> {
-              return std::make_unique<ZlibStreamCompressor>(
-                  proxygen::CompressionType::GZIP, level);
-            },
-            "gzip",
-            compressibleContentTypes_};
+        return new CompressionFilter{h,
+                                     minimumCompressionSize_,
+                                     getCompressorFactory(),
+                                     "gzip",
+                                     compressibleContentTypes_};
       case CodecType::NO_COMPRESSION:
         return h;
     };
     return h;
   }
 
+  /**
+   * Stats of the calling thread's compressor pool
+   */
+  StreamCodecPoolStats getCompressorPoolStats() const {
+    return *pool_ ? (*pool_)->getStats() : StreamCodecPoolStats();
+  }
+
  private:
+  using ZlibCompressorPool = StreamCodecPool<ZlibStreamCompressor>;
+
+  CompressionFilter::StreamCompressorFactory getCompressorFactory() {
+    auto level = zlibCompressionLevel_;
+    auto makeCompressor = [level]() {
+      return std::make_unique<ZlibStreamCompressor>(
+          proxygen::CompressionType::GZIP, level);
+    };
+    if (compressorPoolSize_ == 0) {
+      return [makeCompressor]() -> std::unique_ptr<StreamCompressor> {
+        return makeCompressor();
+      };
+    }
+    if (!*pool_) {
+      *pool_ = std::make_shared<ZlibCompressorPool>(makeCompressor,
+                                                    compressorPoolSize_);
+    }
+    return [pool = *pool_]() -> std::unique_ptr<StreamCompressor> {
+      return std::make_unique<PooledStreamCompressor<ZlibStreamCompressor>>(
+          pool);
+    };
+  }
+
   // Check whether the client supports a compression type we support
   CodecType determineCompressionType(HTTPMessage* msg) noexcept {
 
@@ -280,6 +311,9 @@ class CompressionFilterFactory : public RequestHandlerFactory {
 
   const uint32_t minimumCompressionSize_;
   const int32_t zlibCompressionLevel_;
+  const size_t compressorPoolSize_;
   const std::shared_ptr<std::set<std::string>> compressibleContentTypes_;
+  // Each worker's compressors, shared with the filters using them
+  folly::ThreadLocal<std::shared_ptr<ZlibCompressorPool>> pool_;
 };
 } // namespace proxygen
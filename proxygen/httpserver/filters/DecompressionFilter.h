@@ -0,0 +1,371 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/String.h>
+#include <folly/ThreadLocal.h>
+#include <folly/io/IOBufQueue.h>
+
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/utils/StreamCodecPool.h>
+#include <proxygen/lib/utils/UtilInl.h>
+#include <proxygen/lib/utils/ZlibStreamDecompressor.h>
+#include <proxygen/lib/utils/ZstdStreamDecompressor.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter that decompresses request bodies sent with a gzip, deflate
+ * or zstd Content-Encoding, so the handler behind it only sees the decoded
+ * body.
+ *
+ * Each chunk is decompressed as it arrives, and the decompressor gives up as
+ * soon as the output would go past the limits: the decoded body can be at
+ * most maxBytes, and at most maxRatio times the compressed bytes read so far
+ * once it is past ratioGraceBytes.  A request going over them is answered
+ * with a 413, one that fails to decode with a 400, and the handler is
+ * released with kErrorBadDecompress.
+ *
+ * Input is decoded a piece at a time, as the handler reads.  When it pauses
+ * ingress, the compressed input that keeps arriving is held and only decoded
+ * once it resumes, so no more than one piece's output is ever held.  Ingress
+ * stays paused downstream until the held input is drained.
+ */
+class DecompressionFilter : public Filter {
+ public:
+  struct Limits {
+    uint64_t maxBytes;
+    uint32_t maxRatio;
+    uint64_t ratioGraceBytes;
+  };
+
+  // Most decoded bytes passed to the handler in one onBody
+  static constexpr size_t kMaxChunkSize = 64 * 1024;
+  // Most compressed bytes decoded at once
+  static constexpr size_t kMaxInputChunkSize = 16 * 1024;
+
+  DecompressionFilter(RequestHandler* upstream,
+                      std::unique_ptr<StreamDecompressor> decompressor,
+                      const Limits& limits)
+      : Filter(upstream),
+        decompressor_(std::move(decompressor)),
+        limits_(limits) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    // The handler gets the decoded body, whose length is not known yet
+    auto& headers = msg->getHeaders();
+    headers.remove(HTTP_HEADER_CONTENT_ENCODING);
+    headers.remove(HTTP_HEADER_CONTENT_LENGTH);
+    Filter::onRequest(std::move(msg));
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (!upstream_ || !body) {
+      return;
+    }
+    DestructorGuard g(*this);
+    compressed_.append(std::move(body));
+    deliver();
+  }
+
+  void onUpgrade(UpgradeProtocol protocol) noexcept override {
+    if (upstream_) {
+      Filter::onUpgrade(protocol);
+    }
+  }
+
+  void onEOM() noexcept override {
+    if (!upstream_) {
+      return;
+    }
+    DestructorGuard g(*this);
+    eom_ = true;
+    deliver();
+  }
+
+  void requestComplete() noexcept override {
+    if (upstream_) {
+      upstream_->requestComplete();
+      upstream_ = nullptr;
+    }
+    destroy();
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    if (upstream_) {
+      upstream_->onError(err);
+      upstream_ = nullptr;
+    }
+    destroy();
+  }
+
+  void onEgressPaused() noexcept override {
+    if (upstream_) {
+      Filter::onEgressPaused();
+    }
+  }
+
+  void onEgressResumed() noexcept override {
+    if (upstream_) {
+      Filter::onEgressResumed();
+    }
+  }
+
+  // Response handler
+  void sendHeaders(HTTPMessage& msg) noexcept override {
+    responseStarted_ = true;
+    Filter::sendHeaders(msg);
+  }
+
+  void pauseIngress() noexcept override {
+    paused_ = true;
+    Filter::pauseIngress();
+  }
+
+  void resumeIngress() noexcept override {
+    DestructorGuard g(*this);
+    paused_ = false;
+    deliver();
+    // Keep reading paused until the held input is drained
+    if (upstream_ && !paused_ && pending_.empty() && compressed_.empty()) {
+      Filter::resumeIngress();
+    }
+  }
+
+ private:
+  // The handler may finish the request, and the transaction with it, from
+  // any of its callbacks.  Destroying the filter waits until the outermost
+  // callback into it has returned.
+  class DestructorGuard {
+   public:
+    explicit DestructorGuard(DecompressionFilter& filter) : filter_(filter) {
+      filter_.guards_++;
+    }
+    ~DestructorGuard() {
+      if (--filter_.guards_ == 0 && filter_.destroyPending_) {
+        delete &filter_;
+      }
+    }
+
+   private:
+    DecompressionFilter& filter_;
+  };
+
+  void destroy() {
+    if (guards_ > 0) {
+      destroyPending_ = true;
+      return;
+    }
+    delete this;
+  }
+
+  // Most decoded bytes allowed after compressedBytes_ of input
+  uint64_t getAllowedBytes() const {
+    uint64_t allowed = std::max(limits_.ratioGraceBytes,
+                                compressedBytes_ * limits_.maxRatio);
+    return std::min(allowed, limits_.maxBytes);
+  }
+
+  // Decode the held input and pass the output, then the EOM, to the handler
+  // while it reads.  Callers hold a DestructorGuard.
+  void deliver() {
+    while (upstream_ && !paused_) {
+      if (!pending_.empty()) {
+        upstream_->onBody(pending_.splitAtMost(kMaxChunkSize));
+      } else if (!compressed_.empty()) {
+        if (!decompress(compressed_.splitAtMost(kMaxInputChunkSize))) {
+          return;
+        }
+      } else {
+        if (eom_) {
+          eom_ = false;
+          if (compressedBytes_ > 0 && !decompressor_->finished()) {
+            // The body ended in the middle of the compressed stream
+            reject(400, "Bad Request");
+            return;
+          }
+          upstream_->onEOM();
+        }
+        return;
+      }
+    }
+  }
+
+  // Decode input into pending_, rejecting the request if it fails
+  bool decompress(std::unique_ptr<folly::IOBuf> input) {
+    compressedBytes_ += input->computeChainDataLength();
+    decompressor_->setOutputLimit(getAllowedBytes() - decompressedBytes_);
+    auto decompressed = decompressor_->decompress(input.get());
+    if (!decompressed || decompressor_->hasError()) {
+      if (decompressor_->outputLimitExceeded()) {
+        reject(413, "Payload Too Large");
+      } else {
+        reject(400, "Bad Request");
+      }
+      return false;
+    }
+    decompressedBytes_ += decompressed->computeChainDataLength();
+    pending_.append(std::move(decompressed));
+    return true;
+  }
+
+  // Answer the request ourselves and release the handler
+  void reject(uint16_t code, const std::string& message) {
+    VLOG(4) << "Rejecting request body after " << compressedBytes_
+            << " compressed bytes: " << message;
+    upstream_->onError(kErrorBadDecompress);
+    upstream_ = nullptr;
+    pending_.move();
+    compressed_.move();
+    if (responseStarted_) {
+      Filter::sendAbort();
+      return;
+    }
+    if (paused_) {
+      paused_ = false;
+      Filter::resumeIngress();
+    }
+    ResponseBuilder(downstream_)
+        .status(code, message)
+        .closeConnection()
+        .sendWithEOM();
+  }
+
+  std::unique_ptr<StreamDecompressor> decompressor_;
+  const Limits limits_;
+  // Input not decoded yet, held while the handler is paused
+  folly::IOBufQueue compressed_{folly::IOBufQueue::cacheChainLength()};
+  // Decoded output the handler has not taken yet
+  folly::IOBufQueue pending_{folly::IOBufQueue::cacheChainLength()};
+  uint64_t compressedBytes_{0};
+  uint64_t decompressedBytes_{0};
+  bool paused_{false};
+  bool eom_{false};
+  bool responseStarted_{false};
+  uint32_t guards_{0};
+  bool destroyPending_{false};
+};
+
+class DecompressionFilterFactory : public RequestHandlerFactory {
+ public:
+  struct Options {
+    Options() = default;
+    // Largest decoded request body
+    uint64_t maxDecompressedBytes = 64 * 1024 * 1024;
+    // Largest ratio of decoded to compressed bytes, checked once the decoded
+    // body is past ratioGraceBytes
+    uint32_t maxExpansionRatio = 100;
+    uint64_t ratioGraceBytes = 1024 * 1024;
+    // Decompressors of each type each worker thread keeps for reuse once
+    // their request is done.  0 creates a new one for every request.
+    size_t decompressorPoolSize = 16;
+  };
+
+  explicit DecompressionFilterFactory(const Options& opts)
+      : limits_{opts.maxDecompressedBytes,
+                opts.maxExpansionRatio,
+                opts.ratioGraceBytes},
+        decompressorPoolSize_(opts.decompressorPoolSize) {
+  }
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+  }
+
+  void onServerStop() noexcept override {
+  }
+
+  RequestHandler* onRequest(RequestHandler* h,
+                            HTTPMessage* msg) noexcept override {
+    auto decompressor = getDecompressor(getCompressionType(*msg));
+    if (!decompressor) {
+      // No need to insert this filter
+      return h;
+    }
+    return new DecompressionFilter(h, std::move(decompressor), limits_);
+  }
+
+ private:
+  using ZlibDecompressorPool = StreamCodecPool<ZlibStreamDecompressor>;
+  using ZstdDecompressorPool = StreamCodecPool<ZstdStreamDecompressor>;
+
+  struct Pools {
+    std::shared_ptr<ZlibDecompressorPool> gzip;
+    std::shared_ptr<ZlibDecompressorPool> deflate;
+    std::shared_ptr<ZstdDecompressorPool> zstd;
+  };
+
+  // The encoding of the request body, NONE when it is not one we decode
+  static CompressionType getCompressionType(const HTTPMessage& msg) {
+    auto encoding =
+        msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_ENCODING);
+    auto trimmed = folly::trimWhitespace(encoding);
+    if (caseInsensitiveEqual(trimmed, "gzip") ||
+        caseInsensitiveEqual(trimmed, "x-gzip")) {
+      return CompressionType::GZIP;
+    }
+    if (caseInsensitiveEqual(trimmed, "deflate")) {
+      return CompressionType::DEFLATE;
+    }
+    if (caseInsensitiveEqual(trimmed, "zstd")) {
+      return CompressionType::ZSTD;
+    }
+    return CompressionType::NONE;
+  }
+
+  std::unique_ptr<StreamDecompressor> getDecompressor(CompressionType type) {
+    switch (type) {
+      case CompressionType::GZIP:
+      case CompressionType::DEFLATE: {
+        auto makeDecompressor = [type]() {
+          return std::make_unique<ZlibStreamDecompressor>(type);
+        };
+        if (decompressorPoolSize_ == 0) {
+          return makeDecompressor();
+        }
+        auto& pool =
+            type == CompressionType::GZIP ? pools_->gzip : pools_->deflate;
+        if (!pool) {
+          pool = std::make_shared<ZlibDecompressorPool>(makeDecompressor,
+                                                        decompressorPoolSize_);
+        }
+        return std::make_unique<
+            PooledStreamDecompressor<ZlibStreamDecompressor>>(pool);
+      }
+      case CompressionType::ZSTD: {
+        auto makeDecompressor = []() {
+          return std::make_unique<ZstdStreamDecompressor>();
+        };
+        if (decompressorPoolSize_ == 0) {
+          return makeDecompressor();
+        }
+        auto& pool = pools_->zstd;
+        if (!pool) {
+          pool = std::make_shared<ZstdDecompressorPool>(makeDecompressor,
+                                                        decompressorPoolSize_);
+        }
+        return std::make_unique<
+            PooledStreamDecompressor<ZstdStreamDecompressor>>(pool);
+      }
+      case CompressionType::NONE:
+        return nullptr;
+    }
+    return nullptr;
+  }
+
+  const DecompressionFilter::Limits limits_;
+  const size_t decompressorPoolSize_;
+  // Each worker's decompressors, shared with the filters using them
+  folly::ThreadLocal<Pools> pools_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,432 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/filters/ResponseCache.h>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+using namespace proxygen;
+
+// Calls f with the lower cased name and the value of each directive in the
+// comma separated list, stopping when it returns true
+template <typename F>
+bool forEachDirective(folly::StringPiece list, F f) {
+  std::vector<folly::StringPiece> items;
+  folly::split(',', list, items);
+  for (auto item : items) {
+    auto name = folly::trimWhitespace(item.split_step('='));
+    if (name.empty()) {
+      continue;
+    }
+    auto value = folly::trimWhitespace(item);
+    value.removePrefix('"');
+    value.removeSuffix('"');
+    auto lowerName = name.str();
+    folly::toLowerAscii(lowerName);
+    if (f(lowerName, value)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool hasDirective(const HTTPHeaders& headers,
+                  HTTPHeaderCode code,
+                  folly::StringPiece directive) {
+  return headers.forEachValueOfHeader(
+      code, [&](const std::string& value) -> bool {
+        return forEachDirective(
+            value, [&](const std::string& name, folly::StringPiece) {
+              return directive == folly::StringPiece(name);
+            });
+      });
+}
+
+folly::Optional<std::chrono::seconds> parseSeconds(folly::StringPiece value) {
+  auto seconds = folly::tryTo<int64_t>(value);
+  if (seconds.hasError() || seconds.value() < 0) {
+    return folly::none;
+  }
+  return std::chrono::seconds(seconds.value());
+}
+
+// Names of the request headers the response varies on
+std::vector<std::string> getVaryNames(const HTTPMessage& response) {
+  std::vector<std::string> names;
+  response.getHeaders().forEachValueOfHeader(
+      HTTP_HEADER_VARY, [&](const std::string& value) -> bool {
+        std::vector<folly::StringPiece> items;
+        folly::split(',', value, items);
+        for (auto item : items) {
+          item = folly::trimWhitespace(item);
+          if (!item.empty()) {
+            names.push_back(item.str());
+          }
+        }
+        return false;
+      });
+  // Compression is decided per request without adding a Vary, so encoded
+  // responses are also matched on Accept-Encoding
+  if (response.getHeaders().exists(HTTP_HEADER_CONTENT_ENCODING)) {
+    auto it = std::find_if(
+        names.begin(), names.end(), [](const std::string& name) {
+          return folly::caseInsensitiveEqual(name, "Accept-Encoding");
+        });
+    if (it == names.end()) {
+      names.emplace_back("Accept-Encoding");
+    }
+  }
+  return names;
+}
+
+folly::StringPiece stripWeak(folly::StringPiece etag) {
+  etag.removePrefix("W/");
+  return etag;
+}
+
+}
+
+namespace proxygen {
+
+ResponseCache::ResponseCache(const Options& options)
+    : options_(options),
+      maxShardBytes_(options.maxBytes / std::max<size_t>(options.shards, 1)) {
+  for (size_t i = 0; i < std::max<size_t>(options_.shards, 1); i++) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+bool ResponseCache::canLookup(const HTTPMessage& request) {
+  auto method = request.getMethod();
+  if (method != HTTPMethod::GET && method != HTTPMethod::HEAD) {
+    return false;
+  }
+  const auto& headers = request.getHeaders();
+  if (headers.exists(HTTP_HEADER_AUTHORIZATION) ||
+      headers.exists(HTTP_HEADER_RANGE)) {
+    return false;
+  }
+  return !hasDirective(headers, HTTP_HEADER_CACHE_CONTROL, "no-cache") &&
+      !hasDirective(headers, HTTP_HEADER_PRAGMA, "no-cache");
+}
+
+bool ResponseCache::canStore(const HTTPMessage& request) {
+  // HEAD responses have no body to store
+  if (request.getMethod() != HTTPMethod::GET) {
+    return false;
+  }
+  const auto& headers = request.getHeaders();
+  if (headers.exists(HTTP_HEADER_AUTHORIZATION) ||
+      headers.exists(HTTP_HEADER_RANGE)) {
+    return false;
+  }
+  return !hasDirective(headers, HTTP_HEADER_CACHE_CONTROL, "no-store");
+}
+
+folly::Optional<std::chrono::seconds> ResponseCache::getFreshnessLifetime(
+    const HTTPMessage& response) {
+  switch (response.getStatusCode()) {
+    case 200:
+    case 203:
+    case 204:
+    case 300:
+    case 301:
+    case 404:
+    case 410:
+      break;
+    default:
+      return folly::none;
+  }
+  const auto& headers = response.getHeaders();
+  // This is a shared cache, so responses for one client are never stored
+  if (headers.exists(HTTP_HEADER_SET_COOKIE)) {
+    return folly::none;
+  }
+  for (const auto& name : getVaryNames(response)) {
+    if (name == "*") {
+      return folly::none;
+    }
+  }
+  bool storable = true;
+  folly::Optional<std::chrono::seconds> maxAge;
+  folly::Optional<std::chrono::seconds> sMaxAge;
+  headers.forEachValueOfHeader(
+      HTTP_HEADER_CACHE_CONTROL, [&](const std::string& value) -> bool {
+        return forEachDirective(
+            value, [&](const std::string& name, folly::StringPiece arg) {
+              if (name == "no-store" || name == "no-cache" ||
+                  name == "private") {
+                storable = false;
+              } else if (name == "max-age") {
+                maxAge = parseSeconds(arg);
+              } else if (name == "s-maxage") {
+                sMaxAge = parseSeconds(arg);
+              }
+              return !storable;
+            });
+      });
+  if (!storable) {
+    return folly::none;
+  }
+  return sMaxAge ? sMaxAge : maxAge;
+}
+
+bool ResponseCache::matchesIfNoneMatch(const HTTPMessage& request,
+                                       const std::string& etag) {
+  if (etag.empty()) {
+    return false;
+  }
+  return request.getHeaders().forEachValueOfHeader(
+      HTTP_HEADER_IF_NONE_MATCH, [&](const std::string& value) -> bool {
+        std::vector<folly::StringPiece> tags;
+        folly::split(',', value, tags);
+        for (auto tag : tags) {
+          tag = folly::trimWhitespace(tag);
+          if (tag == "*" || stripWeak(tag) == stripWeak(etag)) {
+            return true;
+          }
+        }
+        return false;
+      });
+}
+
+std::string ResponseCache::makeKey(const HTTPMessage& request) {
+  return folly::to<std::string>(
+      request.getURL(),
+      '\n',
+      request.getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST));
+}
+
+bool ResponseCache::matchesVary(const CachedResponse& entry,
+                                const HTTPMessage& request) {
+  for (const auto& vary : entry.varyValues) {
+    if (request.getHeaders().combine(vary.first) != vary.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t ResponseCache::computeSize(const std::string& key,
+                                  const CachedResponse& entry) {
+  size_t size = sizeof(CachedResponse) + key.size() +
+      (entry.body ? entry.body->computeChainDataLength() : 0);
+  entry.response.getHeaders().forEach(
+      [&](const std::string& name, const std::string& value) {
+        size += name.size() + value.size();
+      });
+  return size;
+}
+
+ResponseCache::Shard& ResponseCache::getShard(const std::string& key) {
+  return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+std::shared_ptr<const CachedResponse> ResponseCache::lookup(
+    const HTTPMessage& request) {
+  auto key = makeKey(request);
+  auto& shard = getShard(key);
+  auto now = CachedResponse::Clock::now();
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  auto range = shard.index.equal_range(key);
+  for (auto it = range.first; it != range.second; ++it) {
+    auto lruIt = it->second;
+    if (!matchesVary(*lruIt->second, request)) {
+      continue;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, lruIt);
+    if (lruIt->second->isFresh(now)) {
+      shard.stats.hits++;
+    } else {
+      shard.stats.staleHits++;
+    }
+    return lruIt->second;
+  }
+  shard.stats.misses++;
+  return nullptr;
+}
+
+std::shared_ptr<const CachedResponse> ResponseCache::store(
+    const HTTPMessage& request,
+    const HTTPMessage& response,
+    std::unique_ptr<folly::IOBuf> body) {
+  auto lifetime = getFreshnessLifetime(response);
+  if (!lifetime) {
+    return nullptr;
+  }
+  size_t length = body ? body->computeChainDataLength() : 0;
+  if (length > options_.maxObjectBytes) {
+    return nullptr;
+  }
+
+  auto entry = std::make_shared<CachedResponse>();
+  entry->response = response;
+  auto& headers = entry->response.getHeaders();
+  headers.remove(HTTP_HEADER_TRANSFER_ENCODING);
+  headers.remove(HTTP_HEADER_CONNECTION);
+  headers.set(HTTP_HEADER_CONTENT_LENGTH, folly::to<std::string>(length));
+  entry->response.setIsChunked(false);
+  entry->body = std::move(body);
+  entry->etag = headers.getSingleOrEmpty(HTTP_HEADER_ETAG);
+  if (lifetime->count() == 0 && entry->etag.empty()) {
+    // Always stale and nothing to revalidate with
+    return nullptr;
+  }
+  for (auto& name : getVaryNames(response)) {
+    auto value = request.getHeaders().combine(name);
+    entry->varyValues.emplace_back(std::move(name), std::move(value));
+  }
+  auto age = parseSeconds(headers.getSingleOrEmpty(HTTP_HEADER_AGE));
+  headers.remove(HTTP_HEADER_AGE);
+  entry->initialAge = age.value_or(std::chrono::seconds(0));
+  entry->storedAt = CachedResponse::Clock::now();
+  entry->expires = entry->storedAt +
+      std::max(*lifetime - entry->initialAge, std::chrono::seconds(0));
+
+  auto key = makeKey(request);
+  entry->size = computeSize(key, *entry);
+  if (entry->size > maxShardBytes_) {
+    return nullptr;
+  }
+
+  auto& shard = getShard(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  insert(shard, key, entry, request);
+  shard.stats.stores++;
+  return entry;
+}
+
+std::shared_ptr<const CachedResponse> ResponseCache::refresh(
+    const HTTPMessage& request,
+    const std::shared_ptr<const CachedResponse>& entry,
+    const HTTPMessage& notModified) {
+  auto refreshed = std::make_shared<CachedResponse>();
+  refreshed->response = entry->response;
+  refreshed->body = entry->body ? entry->body->clone() : nullptr;
+  refreshed->varyValues = entry->varyValues;
+
+  // The stored headers are replaced by any sent with the 304, other than
+  // those describing its own (empty) body
+  std::vector<std::pair<std::string, std::string>> updated;
+  notModified.getHeaders().forEachWithCode([&](HTTPHeaderCode code,
+                                               const std::string& name,
+                                               const std::string& value) {
+    if (code != HTTP_HEADER_CONTENT_LENGTH &&
+        code != HTTP_HEADER_TRANSFER_ENCODING &&
+        code != HTTP_HEADER_CONNECTION) {
+      updated.emplace_back(name, value);
+    }
+  });
+  auto& headers = refreshed->response.getHeaders();
+  for (const auto& header : updated) {
+    headers.remove(header.first);
+  }
+  for (const auto& header : updated) {
+    headers.add(header.first, header.second);
+  }
+  refreshed->etag = headers.getSingleOrEmpty(HTTP_HEADER_ETAG);
+  auto age = parseSeconds(headers.getSingleOrEmpty(HTTP_HEADER_AGE));
+  headers.remove(HTTP_HEADER_AGE);
+  refreshed->initialAge = age.value_or(std::chrono::seconds(0));
+  refreshed->storedAt = CachedResponse::Clock::now();
+  auto lifetime = getFreshnessLifetime(refreshed->response);
+  refreshed->expires = refreshed->storedAt +
+      std::max(lifetime.value_or(std::chrono::seconds(0)) -
+                   refreshed->initialAge,
+               std::chrono::seconds(0));
+
+  // The 304 may have added or grown headers
+  auto key = makeKey(request);
+  refreshed->size = computeSize(key, *refreshed);
+  auto& shard = getShard(key);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  shard.stats.revalidated++;
+  auto range = shard.index.equal_range(key);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second->second == entry) {
+      erase(shard, it->second);
+      break;
+    }
+  }
+  if (lifetime && refreshed->size <= maxShardBytes_) {
+    insert(shard, key, refreshed, request);
+  }
+  return refreshed;
+}
+
+std::unique_ptr<HTTPMessage> ResponseCache::makeResponse(
+    const CachedResponse& entry,
+    const HTTPMessage& request,
+    CachedResponse::Clock::time_point now) {
+  auto response = std::make_unique<HTTPMessage>(entry.response);
+  response->getHeaders().set(
+      HTTP_HEADER_AGE, folly::to<std::string>(entry.getAge(now).count()));
+  if (matchesIfNoneMatch(request, entry.etag)) {
+    response->setStatusCode(304);
+    response->setStatusMessage("Not Modified");
+    response->getHeaders().remove(HTTP_HEADER_CONTENT_LENGTH);
+  }
+  return response;
+}
+
+ResponseCacheStats ResponseCache::getStats() const {
+  ResponseCacheStats total;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->mutex);
+    total.hits += shard->stats.hits;
+    total.misses += shard->stats.misses;
+    total.staleHits += shard->stats.staleHits;
+    total.revalidated += shard->stats.revalidated;
+    total.stores += shard->stats.stores;
+    total.evictions += shard->stats.evictions;
+    total.entries += shard->lru.size();
+    total.bytes += shard->bytes;
+  }
+  return total;
+}
+
+void ResponseCache::insert(Shard& shard,
+                           const std::string& key,
+                           std::shared_ptr<const CachedResponse> entry,
+                           const HTTPMessage& request) {
+  auto range = shard.index.equal_range(key);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (matchesVary(*it->second->second, request)) {
+      erase(shard, it->second);
+      break;
+    }
+  }
+  shard.bytes += entry->size;
+  shard.lru.emplace_front(key, std::move(entry));
+  shard.index.emplace(key, shard.lru.begin());
+  while (shard.bytes > maxShardBytes_) {
+    erase(shard, std::prev(shard.lru.end()));
+    shard.stats.evictions++;
+  }
+}
+
+void ResponseCache::erase(Shard& shard, LRUList::iterator it) {
+  auto range = shard.index.equal_range(it->first);
+  for (auto indexIt = range.first; indexIt != range.second; ++indexIt) {
+    if (indexIt->second == it) {
+      shard.index.erase(indexIt);
+      break;
+    }
+  }
+  shard.bytes -= it->second->size;
+  shard.lru.erase(it);
+}
+
+} // namespace proxygen
@@ -0,0 +1,187 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/io/IOBuf.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * A stored response.  Entries are immutable once stored: hits send the
+ * headers from a copy of response and the body from a clone of body, so
+ * every hit shares the same body buffers.
+ */
+struct CachedResponse {
+  using Clock = std::chrono::steady_clock;
+
+  bool isFresh(Clock::time_point now) const {
+    return now < expires;
+  }
+
+  // Seconds since the origin generated the response
+  std::chrono::seconds getAge(Clock::time_point now) const {
+    return initialAge +
+        std::chrono::duration_cast<std::chrono::seconds>(now - storedAt);
+  }
+
+  // Headers, with Content-Length set to the length of body
+  HTTPMessage response;
+  std::unique_ptr<folly::IOBuf> body;
+  // Request header values of the headers the response varies on
+  std::vector<std::pair<std::string, std::string>> varyValues;
+  std::string etag;
+  std::chrono::seconds initialAge{0};
+  Clock::time_point storedAt;
+  Clock::time_point expires;
+  // Bytes charged against the cache size
+  size_t size{0};
+};
+
+struct ResponseCacheStats {
+  // Fresh entries served
+  uint64_t hits{0};
+  uint64_t misses{0};
+  // Stale entries found, to be revalidated upstream
+  uint64_t staleHits{0};
+  // Stale entries the origin confirmed with a 304
+  uint64_t revalidated{0};
+  uint64_t stores{0};
+  // Entries dropped to stay within maxBytes
+  uint64_t evictions{0};
+  uint64_t entries{0};
+  uint64_t bytes{0};
+};
+
+/**
+ * Memory bounded HTTP response cache implementing a subset of RFC 7234:
+ * responses are stored only with an explicit s-maxage or max-age, are
+ * revalidated with If-None-Match once stale, and are matched to requests
+ * by URL, Host and the request headers named by their Vary.
+ *
+ * The cache is shared by every worker thread.  It is split into shards,
+ * each with its own lock and LRU list, so workers rarely contend.  Locks
+ * are only held to find, store or evict entries, never while sending.
+ */
+class ResponseCache {
+ public:
+  struct Options {
+    Options() = default;
+    // Total bytes of stored responses, headers and bodies
+    size_t maxBytes{64 * 1024 * 1024};
+    // Responses with a larger body are not stored
+    size_t maxObjectBytes{1024 * 1024};
+    size_t shards{16};
+  };
+
+  explicit ResponseCache(const Options& options);
+
+  /**
+   * Whether the response to request may come from the cache and whether it
+   * may be stored.  Only GET and HEAD requests without credentials or a
+   * Range qualify; no-cache skips the lookup and no-store the store.
+   */
+  static bool canLookup(const HTTPMessage& request);
+  static bool canStore(const HTTPMessage& request);
+
+  /**
+   * How long response may be served from the cache, or none if it may not
+   * be stored.
+   */
+  static folly::Optional<std::chrono::seconds> getFreshnessLifetime(
+      const HTTPMessage& response);
+
+  /**
+   * Whether the If-None-Match of request matches etag
+   */
+  static bool matchesIfNoneMatch(const HTTPMessage& request,
+                                 const std::string& etag);
+
+  /**
+   * The entry matching request, fresh or stale, or null
+   */
+  std::shared_ptr<const CachedResponse> lookup(const HTTPMessage& request);
+
+  /**
+   * Store the response to request, replacing any entry for the same variant.
+   * Returns the new entry, or null if the response may not be stored.
+   */
+  std::shared_ptr<const CachedResponse> store(
+      const HTTPMessage& request,
+      const HTTPMessage& response,
+      std::unique_ptr<folly::IOBuf> body);
+
+  /**
+   * Update a stale entry with the headers of the 304 that revalidated it.
+   * Returns the refreshed entry.
+   */
+  std::shared_ptr<const CachedResponse> refresh(
+      const HTTPMessage& request,
+      const std::shared_ptr<const CachedResponse>& entry,
+      const HTTPMessage& notModified);
+
+  /**
+   * Build the response to send for entry.  For a conditional request
+   * matching its ETag this is a 304.
+   */
+  static std::unique_ptr<HTTPMessage> makeResponse(
+      const CachedResponse& entry,
+      const HTTPMessage& request,
+      CachedResponse::Clock::time_point now);
+
+  ResponseCacheStats getStats() const;
+
+  const Options& getOptions() const {
+    return options_;
+  }
+
+ private:
+  using LRUList =
+      std::list<std::pair<std::string, std::shared_ptr<const CachedResponse>>>;
+
+  struct Shard {
+    mutable std::mutex mutex;
+    // Most recently used first
+    LRUList lru;
+    // Every variant of a URL has the same key
+    std::unordered_multimap<std::string, LRUList::iterator> index;
+    size_t bytes{0};
+    ResponseCacheStats stats;
+  };
+
+  static std::string makeKey(const HTTPMessage& request);
+  static bool matchesVary(const CachedResponse& entry,
+                          const HTTPMessage& request);
+  // Bytes entry is charged against the cache size
+  static size_t computeSize(const std::string& key,
+                            const CachedResponse& entry);
+  Shard& getShard(const std::string& key);
+  // Callers hold the shard lock
+  void insert(Shard& shard,
+              const std::string& key,
+              std::shared_ptr<const CachedResponse> entry,
+              const HTTPMessage& request);
+  void erase(Shard& shard, LRUList::iterator it);
+
+  const Options options_;
+  const size_t maxShardBytes_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/json.h>
+#include <proxygen/httpserver/RequestHandler.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/statistics/StatsRegistry.h>
+
+namespace proxygen {
+
+/**
+ * Serves a StatsRegistry as "key value" text lines, or as a JSON object when
+ * the request has `?format=json` or accepts application/json.
+ */
+class StatsHandler : public RequestHandler {
+ public:
+  explicit StatsHandler(const StatsRegistry& registry): registry_(registry) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> headers) noexcept override {
+    json_ = headers->getQueryParam("format") == "json" ||
+      headers->getHeaders().getSingleOrEmpty(HTTP_HEADER_ACCEPT).find(
+        "application/json") != std::string::npos;
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {}
+
+  void onUpgrade(UpgradeProtocol /*prot*/) noexcept override {}
+
+  void onEOM() noexcept override {
+    std::string body;
+    std::string contentType;
+    if (json_) {
+      body = folly::toJson(registry_.toDynamic());
+      contentType = "application/json";
+    } else {
+      body = registry_.toText();
+      contentType = "text/plain";
+    }
+    ResponseBuilder(downstream_)
+        .status(200, "OK")
+        .header(HTTP_HEADER_CONTENT_TYPE, contentType)
+        .header(HTTP_HEADER_CACHE_CONTROL, "no-cache")
+        .body(folly::IOBuf::copyBuffer(body))
+        .sendWithEOM();
+  }
+
+  void requestComplete() noexcept override {
+    delete this;
+  }
+
+  void onError(ProxygenError /*err*/) noexcept override { delete this; }
+
+ private:
+  const StatsRegistry& registry_;
+  bool json_{false};
+};
+
+/**
+ * Answers GET requests for `path` with a StatsHandler and passes everything
+ * else on.  Best placed first in HTTPServerOptions::handlerFactories so
+ * stats requests never reach the application's handlers.
+ */
+class StatsHandlerFactory : public RequestHandlerFactory {
+ public:
+  explicit StatsHandlerFactory(
+      std::string path = "/stats",
+      const StatsRegistry& registry = StatsRegistry::getDefault())
+      : path_(std::move(path)),
+        registry_(registry) {
+  }
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {}
+
+  void onServerStop() noexcept override {}
+
+  RequestHandler* onRequest(RequestHandler* h, HTTPMessage* msg)
+      noexcept override {
+    if (msg->getMethod() != HTTPMethod::GET || msg->getPath() != path_) {
+      return h;
+    }
+    if (h) {
+      // A handler created before us will never see this request
+      h->onError(kErrorNone);
+    }
+    return new StatsHandler(registry_);
+  }
+
+ private:
+  const std::string path_;
+  const StatsRegistry& registry_;
+};
+
+}
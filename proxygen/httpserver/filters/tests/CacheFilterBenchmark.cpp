@@ -0,0 +1,169 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/httpserver/filters/CacheFilter.h>
+
+using namespace folly;
+using namespace proxygen;
+
+DEFINE_int32(body_size, 16 * 1024, "Response body size");
+
+// Each iteration is one GET through the filter chain to a handler that
+// answers with body_size bytes, and back to a response handler that drops
+// it.  NoCache is the handler alone, CacheHit answers every request from
+// the cache, and CacheMissEvicting requests a new URL each time from a
+// cache that holds only a few responses.
+
+namespace {
+
+class BodyHandler : public RequestHandler {
+ public:
+  explicit BodyHandler(const IOBuf& body) : body_(body) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> /*headers*/) noexcept override {
+  }
+
+  void onBody(std::unique_ptr<IOBuf> /*body*/) noexcept override {
+  }
+
+  void onUpgrade(UpgradeProtocol /*prot*/) noexcept override {
+  }
+
+  void onEOM() noexcept override {
+    ResponseBuilder(downstream_)
+        .status(200, "OK")
+        .header(HTTP_HEADER_CACHE_CONTROL, "max-age=600")
+        .body(body_.clone())
+        .sendWithEOM();
+  }
+
+  void requestComplete() noexcept override {
+    delete this;
+  }
+
+  void onError(ProxygenError /*err*/) noexcept override {
+    delete this;
+  }
+
+ private:
+  const IOBuf& body_;
+};
+
+class NullResponseHandler : public ResponseHandler {
+ public:
+  explicit NullResponseHandler(RequestHandler* upstream)
+      : ResponseHandler(upstream) {
+  }
+
+  void sendHeaders(HTTPMessage& /*msg*/) noexcept override {
+  }
+  void sendChunkHeader(size_t /*len*/) noexcept override {
+  }
+  void sendBody(std::unique_ptr<IOBuf> body) noexcept override {
+    folly::doNotOptimizeAway(body);
+  }
+  void sendChunkTerminator() noexcept override {
+  }
+  void sendEOM() noexcept override {
+  }
+  void sendAbort() noexcept override {
+  }
+  void refreshTimeout() noexcept override {
+  }
+  void pauseIngress() noexcept override {
+  }
+  void resumeIngress() noexcept override {
+  }
+  ResponseHandler* newPushedResponse(PushHandler* /*handler*/) noexcept
+      override {
+    return nullptr;
+  }
+  const wangle::TransportInfo& getSetupTransportInfo() const
+      noexcept override {
+    return tinfo_;
+  }
+  void getCurrentTransportInfo(wangle::TransportInfo* /*tinfo*/)
+      const override {
+  }
+
+ private:
+  wangle::TransportInfo tinfo_;
+};
+
+HTTPMessage makeRequest(const std::string& url) {
+  HTTPMessage req;
+  req.setMethod(HTTPMethod::GET);
+  req.setURL(url);
+  req.getHeaders().set(HTTP_HEADER_HOST, "localhost");
+  req.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, "gzip");
+  return req;
+}
+
+void runRequests(UserCounters& counters,
+                 uint32_t iters,
+                 CacheFilterFactory* factory,
+                 bool distinctUrls) {
+  std::unique_ptr<IOBuf> body;
+  std::unique_ptr<BodyHandler> dummy;
+  std::unique_ptr<NullResponseHandler> client;
+  BENCHMARK_SUSPEND {
+    body = IOBuf::copyBuffer(std::string(FLAGS_body_size, 'a'));
+    dummy = std::make_unique<BodyHandler>(*body);
+    client = std::make_unique<NullResponseHandler>(dummy.get());
+  }
+  for (uint32_t i = 0; i < iters; i++) {
+    auto msg = std::make_unique<HTTPMessage>(
+        makeRequest(distinctUrls ? folly::to<std::string>("/", i) : "/"));
+    RequestHandler* h = new BodyHandler(*body);
+    if (factory) {
+      h = factory->onRequest(h, msg.get());
+    }
+    h->setResponseHandler(client.get());
+    h->onRequest(std::move(msg));
+    h->onEOM();
+    h->requestComplete();
+  }
+  BENCHMARK_SUSPEND {
+    if (factory) {
+      auto stats = factory->getCache()->getStats();
+      counters["hits"] = int(stats.hits);
+      counters["evictions"] = int(stats.evictions);
+      counters["entries"] = int(stats.entries);
+      counters["kbytes"] = int(stats.bytes / 1024);
+    }
+  }
+}
+}
+
+BENCHMARK_COUNTERS(NoCache, counters, iters) {
+  runRequests(counters, iters, nullptr, false);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(CacheHit, counters, iters) {
+  CacheFilterFactory factory{ResponseCache::Options()};
+  runRequests(counters, iters, &factory, false);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(CacheMissEvicting, counters, iters) {
+  ResponseCache::Options opts;
+  opts.maxBytes = 16 * FLAGS_body_size;
+  opts.shards = 4;
+  CacheFilterFactory factory{opts};
+  runRequests(counters, iters, &factory, true);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
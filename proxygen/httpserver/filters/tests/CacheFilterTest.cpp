@@ -0,0 +1,303 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/httpserver/filters/CacheFilter.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+using Respond = std::function<void(ResponseHandler*)>;
+
+struct Received {
+  // The request as the handler got it, if it got it
+  std::unique_ptr<HTTPMessage> forwarded;
+  std::unique_ptr<HTTPMessage> response;
+  std::string body;
+  const uint8_t* bodyData{nullptr};
+  bool eom{false};
+};
+
+HTTPMessage makeRequest(const std::string& url) {
+  HTTPMessage req;
+  req.setMethod(HTTPMethod::GET);
+  req.setURL(url);
+  req.getHeaders().set(HTTP_HEADER_HOST, "localhost");
+  return req;
+}
+
+Respond respondWith(const std::string& cacheControl,
+                    const std::string& body,
+                    const std::string& etag = "") {
+  return [=](ResponseHandler* downstream) {
+    ResponseBuilder builder(downstream);
+    builder.status(200, "OK");
+    if (!cacheControl.empty()) {
+      builder.header(HTTP_HEADER_CACHE_CONTROL, cacheControl);
+    }
+    if (!etag.empty()) {
+      builder.header(HTTP_HEADER_ETAG, etag);
+    }
+    builder.body(body).sendWithEOM();
+  };
+}
+
+}
+
+class CacheFilterTest : public Test {
+ public:
+  void SetUp() override {
+    ResponseCache::Options opts;
+    opts.shards = 4;
+    cache_ = std::make_shared<ResponseCache>(opts);
+    factory_ = std::make_unique<CacheFilterFactory>(cache_);
+  }
+
+ protected:
+  // Send request through the filter to a handler answering with respond
+  Received fetch(const HTTPMessage& request, const Respond& respond) {
+    Received received;
+    MockRequestHandler handler;
+    MockResponseHandler client(&handler);
+    ResponseHandler* downstream = nullptr;
+
+    EXPECT_CALL(handler, setResponseHandler(_))
+        .WillRepeatedly(SaveArg<0>(&downstream));
+    EXPECT_CALL(handler, onRequest(_))
+        .WillRepeatedly(Invoke([&](std::shared_ptr<HTTPMessage> msg) {
+          received.forwarded = std::make_unique<HTTPMessage>(*msg);
+        }));
+    EXPECT_CALL(handler, onEOM()).WillRepeatedly(Invoke([&] {
+      respond(downstream);
+    }));
+    EXPECT_CALL(handler, onError(_)).WillRepeatedly(Return());
+    EXPECT_CALL(handler, requestComplete()).WillRepeatedly(Return());
+
+    EXPECT_CALL(client, sendHeaders(_))
+        .WillRepeatedly(Invoke([&](HTTPMessage& msg) {
+          received.response = std::make_unique<HTTPMessage>(msg);
+        }));
+    EXPECT_CALL(client, sendBody(_))
+        .WillRepeatedly(Invoke([&](std::shared_ptr<folly::IOBuf> body) {
+          received.bodyData = body->data();
+          auto range = body->clone()->coalesce();
+          received.body.append(reinterpret_cast<const char*>(range.data()),
+                               range.size());
+        }));
+    EXPECT_CALL(client, sendEOM()).WillRepeatedly(Invoke([&] {
+      received.eom = true;
+    }));
+
+    auto msg = std::make_unique<HTTPMessage>(request);
+    auto h = factory_->onRequest(&handler, msg.get());
+    h->setResponseHandler(&client);
+    h->onRequest(std::move(msg));
+    h->onEOM();
+    h->requestComplete();
+    return received;
+  }
+
+  std::shared_ptr<ResponseCache> cache_;
+  std::unique_ptr<CacheFilterFactory> factory_;
+};
+
+TEST_F(CacheFilterTest, HitSharesStoredBody) {
+  auto respond = respondWith("max-age=60", "hello");
+  auto first = fetch(makeRequest("/a"), respond);
+  ASSERT_TRUE(first.forwarded);
+  EXPECT_EQ(first.body, "hello");
+
+  auto second = fetch(makeRequest("/a"), respond);
+  EXPECT_FALSE(second.forwarded);
+  ASSERT_TRUE(second.response);
+  EXPECT_EQ(second.response->getStatusCode(), 200);
+  EXPECT_TRUE(second.response->getHeaders().exists(HTTP_HEADER_AGE));
+  EXPECT_EQ(second.body, "hello");
+  EXPECT_TRUE(second.eom);
+  // The hit is sent from the very buffer the handler sent
+  EXPECT_EQ(second.bodyData, first.bodyData);
+
+  auto stats = cache_->getStats();
+  EXPECT_EQ(stats.stores, 1u);
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.entries, 1u);
+}
+
+TEST_F(CacheFilterTest, NotStored) {
+  for (auto cacheControl : {"", "private, max-age=60", "no-store"}) {
+    auto url = folly::to<std::string>("/", cacheControl);
+    fetch(makeRequest(url), respondWith(cacheControl, "hello"));
+    auto second = fetch(makeRequest(url), respondWith(cacheControl, "hello"));
+    EXPECT_TRUE(second.forwarded) << cacheControl;
+  }
+  EXPECT_EQ(cache_->getStats().stores, 0u);
+}
+
+TEST_F(CacheFilterTest, RequestNoCacheSkipsLookup) {
+  auto respond = respondWith("max-age=60", "hello");
+  fetch(makeRequest("/a"), respond);
+  auto req = makeRequest("/a");
+  req.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, "no-cache");
+  EXPECT_TRUE(fetch(req, respond).forwarded);
+}
+
+TEST_F(CacheFilterTest, VaryKeepsVariantsApart) {
+  auto respond = [](ResponseHandler* downstream) {
+    ResponseBuilder(downstream)
+        .status(200, "OK")
+        .header(HTTP_HEADER_CACHE_CONTROL, "s-maxage=60")
+        .header(HTTP_HEADER_VARY, "Accept-Language")
+        .body("hello")
+        .sendWithEOM();
+  };
+  auto en = makeRequest("/a");
+  en.getHeaders().set(HTTP_HEADER_ACCEPT_LANGUAGE, "en");
+  auto fr = makeRequest("/a");
+  fr.getHeaders().set(HTTP_HEADER_ACCEPT_LANGUAGE, "fr");
+
+  EXPECT_TRUE(fetch(en, respond).forwarded);
+  EXPECT_TRUE(fetch(fr, respond).forwarded);
+  EXPECT_FALSE(fetch(en, respond).forwarded);
+  EXPECT_FALSE(fetch(fr, respond).forwarded);
+  EXPECT_EQ(cache_->getStats().entries, 2u);
+}
+
+TEST_F(CacheFilterTest, RevalidatesStaleEntry) {
+  fetch(makeRequest("/a"), respondWith("max-age=0", "hello", "\"v1\""));
+
+  auto notModified = [](ResponseHandler* downstream) {
+    ResponseBuilder(downstream)
+        .status(304, "Not Modified")
+        .header(HTTP_HEADER_CACHE_CONTROL, "max-age=60")
+        .header(HTTP_HEADER_ETAG, "\"v1\"")
+        .sendWithEOM();
+  };
+  auto second = fetch(makeRequest("/a"), notModified);
+  ASSERT_TRUE(second.forwarded);
+  EXPECT_EQ(second.forwarded->getHeaders().getSingleOrEmpty(
+                HTTP_HEADER_IF_NONE_MATCH),
+            "\"v1\"");
+  ASSERT_TRUE(second.response);
+  EXPECT_EQ(second.response->getStatusCode(), 200);
+  EXPECT_EQ(second.body, "hello");
+  EXPECT_TRUE(second.eom);
+  EXPECT_EQ(cache_->getStats().revalidated, 1u);
+
+  // Fresh again after the 304
+  EXPECT_FALSE(fetch(makeRequest("/a"), notModified).forwarded);
+}
+
+TEST_F(CacheFilterTest, NotModifiedForOtherETag) {
+  fetch(makeRequest("/a"), respondWith("max-age=0", "hello", "\"v1\""));
+
+  auto notModified = [](ResponseHandler* downstream) {
+    ResponseBuilder(downstream)
+        .status(304, "Not Modified")
+        .header(HTTP_HEADER_CACHE_CONTROL, "max-age=60")
+        .header(HTTP_HEADER_ETAG, "\"v2\"")
+        .sendWithEOM();
+  };
+  // The client gets the stored response, not a 304 it did not ask for
+  auto second = fetch(makeRequest("/a"), notModified);
+  ASSERT_TRUE(second.forwarded);
+  ASSERT_TRUE(second.response);
+  EXPECT_EQ(second.response->getStatusCode(), 200);
+  EXPECT_EQ(second.body, "hello");
+  EXPECT_TRUE(second.eom);
+
+  // And the entry was not refreshed from it
+  EXPECT_EQ(cache_->getStats().revalidated, 0u);
+  EXPECT_TRUE(fetch(makeRequest("/a"), notModified).forwarded);
+}
+
+TEST_F(CacheFilterTest, ConditionalHit) {
+  auto respond = respondWith("max-age=60", "hello", "\"v1\"");
+  fetch(makeRequest("/a"), respond);
+  auto req = makeRequest("/a");
+  req.getHeaders().set(HTTP_HEADER_IF_NONE_MATCH, "W/\"v0\", \"v1\"");
+  auto received = fetch(req, respond);
+  EXPECT_FALSE(received.forwarded);
+  ASSERT_TRUE(received.response);
+  EXPECT_EQ(received.response->getStatusCode(), 304);
+  EXPECT_TRUE(received.body.empty());
+  EXPECT_TRUE(received.eom);
+}
+
+TEST(ResponseCacheTest, EvictsLeastRecentlyUsed) {
+  HTTPMessage response;
+  response.setStatusCode(200);
+  response.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, "max-age=60");
+  auto body = std::string(1000, 'x');
+
+  // Measure one entry to size the cache for two
+  ResponseCache::Options opts;
+  opts.shards = 1;
+  size_t entrySize =
+      ResponseCache(opts)
+          .store(makeRequest("/a"), response, folly::IOBuf::copyBuffer(body))
+          ->size;
+  opts.maxBytes = 2 * entrySize + entrySize / 2;
+  ResponseCache cache(opts);
+
+  cache.store(makeRequest("/a"), response, folly::IOBuf::copyBuffer(body));
+  cache.store(makeRequest("/b"), response, folly::IOBuf::copyBuffer(body));
+  EXPECT_TRUE(cache.lookup(makeRequest("/a")));
+  cache.store(makeRequest("/c"), response, folly::IOBuf::copyBuffer(body));
+
+  EXPECT_FALSE(cache.lookup(makeRequest("/b")));
+  EXPECT_TRUE(cache.lookup(makeRequest("/a")));
+  EXPECT_TRUE(cache.lookup(makeRequest("/c")));
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.evictions, 1u);
+  EXPECT_EQ(stats.entries, 2u);
+  EXPECT_LE(stats.bytes, opts.maxBytes);
+}
+
+TEST(ResponseCacheTest, RefreshUpdatesSize) {
+  HTTPMessage response;
+  response.setStatusCode(200);
+  response.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, "max-age=0");
+  response.getHeaders().set(HTTP_HEADER_ETAG, "\"v1\"");
+  ResponseCache::Options opts;
+  opts.shards = 1;
+  ResponseCache cache(opts);
+  auto entry = cache.store(
+      makeRequest("/a"), response, folly::IOBuf::copyBuffer("hello"));
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(cache.getStats().bytes, entry->size);
+
+  HTTPMessage notModified;
+  notModified.setStatusCode(304);
+  notModified.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, "max-age=60");
+  notModified.getHeaders().set("X-Debug", std::string(1000, 'x'));
+  auto refreshed = cache.refresh(makeRequest("/a"), entry, notModified);
+  EXPECT_GT(refreshed->size, entry->size + 1000);
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.entries, 1u);
+  EXPECT_EQ(stats.bytes, refreshed->size);
+}
+
+TEST(ResponseCacheTest, TooLargeNotStored) {
+  HTTPMessage response;
+  response.setStatusCode(200);
+  response.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, "max-age=60");
+  ResponseCache::Options opts;
+  opts.maxObjectBytes = 10;
+  ResponseCache cache(opts);
+  EXPECT_FALSE(cache.store(makeRequest("/a"),
+                           response,
+                           folly::IOBuf::copyBuffer(std::string(11, 'x'))));
+  EXPECT_EQ(cache.getStats().entries, 0u);
+}
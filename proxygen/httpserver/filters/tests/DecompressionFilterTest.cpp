@@ -0,0 +1,330 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/compression/Compression.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/DecompressionFilter.h>
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+std::string compress(CompressionType type, const std::string& body) {
+  auto in = folly::IOBuf::copyBuffer(body);
+  if (type == CompressionType::ZSTD) {
+    auto codec = folly::io::getCodec(folly::io::CodecType::ZSTD);
+    return codec->compress(in.get())->moveToFbString().toStdString();
+  }
+  ZlibStreamCompressor compressor(type, 6);
+  return compressor.compress(in.get(), true)->moveToFbString().toStdString();
+}
+
+std::string makeBody(size_t size) {
+  std::string body;
+  while (body.size() < size) {
+    body += folly::to<std::string>("{\"id\": ", body.size(), "}\n");
+  }
+  body.resize(size);
+  return body;
+}
+
+HTTPMessage makeRequest(const std::string& encoding) {
+  HTTPMessage req;
+  req.setMethod(HTTPMethod::POST);
+  req.setURL("/upload");
+  req.getHeaders().set(HTTP_HEADER_HOST, "localhost");
+  req.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH, "100");
+  if (!encoding.empty()) {
+    req.getHeaders().set(HTTP_HEADER_CONTENT_ENCODING, encoding);
+  }
+  return req;
+}
+
+}
+
+class DecompressionFilterTest : public Test {
+ public:
+  void SetUp() override {
+    opts_.ratioGraceBytes = 64 * 1024;
+    opts_.decompressorPoolSize = 0;
+  }
+
+ protected:
+  // Send request through the filter to handler_, up to its headers
+  RequestHandler* start(const HTTPMessage& request) {
+    EXPECT_CALL(handler_, setResponseHandler(_))
+        .WillRepeatedly(SaveArg<0>(&downstream_));
+    EXPECT_CALL(handler_, onRequest(_))
+        .WillRepeatedly(Invoke([&](std::shared_ptr<HTTPMessage> msg) {
+          forwarded_ = std::make_unique<HTTPMessage>(*msg);
+        }));
+    EXPECT_CALL(handler_, onBody(_))
+        .WillRepeatedly(Invoke([&](std::shared_ptr<folly::IOBuf> body) {
+          bodyCalls_++;
+          body_ += body->clone()->moveToFbString().toStdString();
+          if (onBody_) {
+            onBody_();
+          }
+          if (pauseOnBody_) {
+            downstream_->pauseIngress();
+          }
+        }));
+    EXPECT_CALL(handler_, onEOM()).WillRepeatedly(Invoke([&] {
+      eom_ = true;
+    }));
+    EXPECT_CALL(handler_, onError(_)).WillRepeatedly(SaveArg<0>(&error_));
+    EXPECT_CALL(handler_, requestComplete()).WillRepeatedly(Return());
+
+    EXPECT_CALL(client_, sendHeaders(_))
+        .WillRepeatedly(Invoke([&](HTTPMessage& msg) {
+          response_ = std::make_unique<HTTPMessage>(msg);
+        }));
+    EXPECT_CALL(client_, sendEOM()).WillRepeatedly(Return());
+    EXPECT_CALL(client_, pauseIngress()).WillRepeatedly(Invoke([&] {
+      clientPaused_ = true;
+    }));
+    EXPECT_CALL(client_, resumeIngress()).WillRepeatedly(Invoke([&] {
+      clientPaused_ = false;
+    }));
+
+    factory_ = std::make_unique<DecompressionFilterFactory>(opts_);
+    auto msg = std::make_unique<HTTPMessage>(request);
+    auto h = factory_->onRequest(&handler_, msg.get());
+    h->setResponseHandler(&client_);
+    h->onRequest(std::move(msg));
+    return h;
+  }
+
+  // Send body in pieces of at most size bytes
+  void sendBody(RequestHandler* h, const std::string& body, size_t size) {
+    for (size_t offset = 0; offset < body.size(); offset += size) {
+      h->onBody(folly::IOBuf::copyBuffer(body.substr(offset, size)));
+    }
+  }
+
+  DecompressionFilterFactory::Options opts_;
+  std::unique_ptr<DecompressionFilterFactory> factory_;
+  MockRequestHandler handler_;
+  MockResponseHandler client_{&handler_};
+  ResponseHandler* downstream_{nullptr};
+  bool pauseOnBody_{false};
+  std::function<void()> onBody_;
+
+  // What the handler got
+  std::unique_ptr<HTTPMessage> forwarded_;
+  std::string body_;
+  size_t bodyCalls_{0};
+  bool eom_{false};
+  ProxygenError error_{kErrorNone};
+  // What the client got
+  std::unique_ptr<HTTPMessage> response_;
+  bool clientPaused_{false};
+};
+
+TEST_F(DecompressionFilterTest, GzipDecodedAcrossChunks) {
+  auto body = makeBody(100 * 1000);
+  auto h = start(makeRequest("gzip"));
+  EXPECT_NE(h, &handler_);
+  sendBody(h, compress(CompressionType::GZIP, body), 1000);
+  h->onEOM();
+  h->requestComplete();
+
+  ASSERT_TRUE(forwarded_);
+  EXPECT_FALSE(
+      forwarded_->getHeaders().exists(HTTP_HEADER_CONTENT_ENCODING));
+  EXPECT_FALSE(forwarded_->getHeaders().exists(HTTP_HEADER_CONTENT_LENGTH));
+  EXPECT_EQ(body_, body);
+  EXPECT_TRUE(eom_);
+  EXPECT_FALSE(response_);
+}
+
+TEST_F(DecompressionFilterTest, DeflateWithPooledDecompressors) {
+  opts_.decompressorPoolSize = 4;
+  auto body = makeBody(10 * 1000);
+  auto compressed = compress(CompressionType::DEFLATE, body);
+  for (int i = 0; i < 2; i++) {
+    body_.clear();
+    auto h = start(makeRequest(" Deflate"));
+    sendBody(h, compressed, compressed.size());
+    h->onEOM();
+    h->requestComplete();
+    EXPECT_EQ(body_, body);
+  }
+}
+
+TEST_F(DecompressionFilterTest, OtherEncodingsNotFiltered) {
+  for (auto encoding : {"", "identity", "br", "gzip, gzip"}) {
+    auto req = makeRequest(encoding);
+    EXPECT_EQ(DecompressionFilterFactory(opts_).onRequest(&handler_, &req),
+              &handler_)
+        << encoding;
+  }
+}
+
+TEST_F(DecompressionFilterTest, ExpansionRatioRejected) {
+  auto compressed = compress(CompressionType::GZIP, std::string(8 << 20, 0));
+  auto h = start(makeRequest("gzip"));
+  sendBody(h, compressed, 4096);
+  h->onEOM();
+  h->requestComplete();
+
+  ASSERT_TRUE(response_);
+  EXPECT_EQ(response_->getStatusCode(), 413);
+  EXPECT_EQ(error_, kErrorBadDecompress);
+  EXPECT_FALSE(eom_);
+  // Nothing past the limit for the first piece was decoded
+  EXPECT_LE(body_.size(), opts_.ratioGraceBytes);
+}
+
+TEST_F(DecompressionFilterTest, ZstdDecoded) {
+  auto body = makeBody(100 * 1000);
+  auto h = start(makeRequest("zstd"));
+  sendBody(h, compress(CompressionType::ZSTD, body), 1000);
+  h->onEOM();
+  h->requestComplete();
+
+  EXPECT_EQ(body_, body);
+  EXPECT_TRUE(eom_);
+  EXPECT_FALSE(response_);
+}
+
+TEST_F(DecompressionFilterTest, ZstdExpansionRatioRejected) {
+  auto compressed = compress(CompressionType::ZSTD, std::string(8 << 20, 0));
+  auto h = start(makeRequest("zstd"));
+  sendBody(h, compressed, 64);
+  h->onEOM();
+  h->requestComplete();
+
+  ASSERT_TRUE(response_);
+  EXPECT_EQ(response_->getStatusCode(), 413);
+  EXPECT_EQ(error_, kErrorBadDecompress);
+  EXPECT_FALSE(eom_);
+  EXPECT_LE(body_.size(), opts_.ratioGraceBytes);
+}
+
+TEST_F(DecompressionFilterTest, ZstdSizeLimitRejected) {
+  opts_.maxDecompressedBytes = 50 * 1000;
+  auto h = start(makeRequest("zstd"));
+  sendBody(h, compress(CompressionType::ZSTD, makeBody(100 * 1000)), 1000);
+  h->onEOM();
+  h->requestComplete();
+
+  ASSERT_TRUE(response_);
+  EXPECT_EQ(response_->getStatusCode(), 413);
+  EXPECT_EQ(error_, kErrorBadDecompress);
+  EXPECT_LE(body_.size(), opts_.maxDecompressedBytes);
+}
+
+TEST_F(DecompressionFilterTest, SizeLimitRejected) {
+  opts_.maxDecompressedBytes = 50 * 1000;
+  auto h = start(makeRequest("gzip"));
+  sendBody(h, compress(CompressionType::GZIP, makeBody(100 * 1000)), 1000);
+  h->onEOM();
+  h->requestComplete();
+
+  ASSERT_TRUE(response_);
+  EXPECT_EQ(response_->getStatusCode(), 413);
+  EXPECT_LE(body_.size(), opts_.maxDecompressedBytes);
+}
+
+TEST_F(DecompressionFilterTest, CorruptBodyRejected) {
+  auto h = start(makeRequest("gzip"));
+  sendBody(h, "this is not gzip", 100);
+  h->onEOM();
+  h->requestComplete();
+
+  ASSERT_TRUE(response_);
+  EXPECT_EQ(response_->getStatusCode(), 400);
+  EXPECT_EQ(error_, kErrorBadDecompress);
+}
+
+TEST_F(DecompressionFilterTest, TruncatedBodyRejected) {
+  auto compressed = compress(CompressionType::GZIP, makeBody(10 * 1000));
+  auto h = start(makeRequest("gzip"));
+  sendBody(h, compressed.substr(0, compressed.size() / 2), 1000);
+  h->onEOM();
+  h->requestComplete();
+
+  ASSERT_TRUE(response_);
+  EXPECT_EQ(response_->getStatusCode(), 400);
+  EXPECT_FALSE(eom_);
+}
+
+TEST_F(DecompressionFilterTest, PauseHoldsOutput) {
+  auto body = makeBody(300 * 1000);
+  pauseOnBody_ = true;
+  auto h = start(makeRequest("gzip"));
+  sendBody(h, compress(CompressionType::GZIP, body), body.size());
+  h->onEOM();
+
+  // The handler paused after the first chunk, the rest waits in the filter
+  EXPECT_EQ(bodyCalls_, 1u);
+  EXPECT_EQ(body_.size(), size_t(DecompressionFilter::kMaxChunkSize));
+  EXPECT_TRUE(clientPaused_);
+  EXPECT_FALSE(eom_);
+
+  // Resuming drains one chunk at a time while the handler keeps pausing
+  downstream_->resumeIngress();
+  EXPECT_EQ(bodyCalls_, 2u);
+  EXPECT_TRUE(clientPaused_);
+
+  pauseOnBody_ = false;
+  downstream_->resumeIngress();
+  EXPECT_EQ(body_, body);
+  EXPECT_TRUE(eom_);
+  EXPECT_FALSE(clientPaused_);
+  h->requestComplete();
+}
+
+TEST_F(DecompressionFilterTest, PausedInputNotDecoded) {
+  opts_.ratioGraceBytes = 1024 * 1024;
+  auto compressed = compress(CompressionType::GZIP, std::string(8 << 20, 0));
+  pauseOnBody_ = true;
+  auto h = start(makeRequest("gzip"));
+  h->onBody(folly::IOBuf::copyBuffer(compressed.substr(0, 200)));
+  EXPECT_EQ(bodyCalls_, 1u);
+  EXPECT_TRUE(clientPaused_);
+
+  // The rest of the bomb is held undecoded while the handler is paused
+  h->onBody(folly::IOBuf::copyBuffer(compressed.substr(200)));
+  h->onEOM();
+  EXPECT_FALSE(response_);
+  EXPECT_EQ(bodyCalls_, 1u);
+
+  pauseOnBody_ = false;
+  downstream_->resumeIngress();
+  ASSERT_TRUE(response_);
+  EXPECT_EQ(response_->getStatusCode(), 413);
+  EXPECT_FALSE(eom_);
+  EXPECT_LE(body_.size(), opts_.ratioGraceBytes);
+  h->requestComplete();
+}
+
+TEST_F(DecompressionFilterTest, RequestCompletesWhileResuming) {
+  auto body = makeBody(300 * 1000);
+  pauseOnBody_ = true;
+  auto h = start(makeRequest("gzip"));
+  sendBody(h, compress(CompressionType::GZIP, body), body.size());
+  h->onEOM();
+  EXPECT_EQ(bodyCalls_, 1u);
+
+  // The transaction goes away from inside the handler's onBody, as when
+  // the handler aborts it.  The filter must not touch itself afterwards.
+  pauseOnBody_ = false;
+  onBody_ = [&] { h->requestComplete(); };
+  downstream_->resumeIngress();
+
+  EXPECT_EQ(bodyCalls_, 2u);
+  EXPECT_FALSE(eom_);
+  EXPECT_TRUE(clientPaused_);
+}
@@ -0,0 +1,447 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "CollapsedForwarder.h"
+
+#include <folly/String.h>
+
+#include "ProxyStats.h"
+
+using namespace proxygen;
+
+namespace {
+
+// Whether the comma separated list has token, ignoring any "=value"
+bool hasToken(folly::StringPiece list, folly::StringPiece token) {
+  std::vector<folly::StringPiece> items;
+  folly::split(',', list, items);
+  for (auto item : items) {
+    auto name = folly::trimWhitespace(item.split_step('='));
+    if (folly::caseInsensitiveEqual(name, token)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}
+
+namespace ProxyService {
+
+std::atomic<uint64_t> CollapsedForwarder::originRequestsSaved_{0};
+
+CollapsedForwarder::CollapsedForwarder(UpstreamPools* upstreams,
+                                       ProxyStats* stats,
+                                       std::vector<std::string> varyHeaders)
+    : upstreams_(upstreams),
+      stats_(stats),
+      varyHeaders_(std::move(varyHeaders)) {
+}
+
+CollapsedForwarder::~CollapsedForwarder() {
+  // Flights finish on their own, they just stop taking waiters
+  auto flights = std::move(flights_);
+  for (auto& flight : flights) {
+    flight.second->detachForwarder();
+  }
+}
+
+bool CollapsedForwarder::isCollapsible(const HTTPMessage& request) {
+  if (request.getMethod() != HTTPMethod::GET) {
+    return false;
+  }
+  const auto& headers = request.getHeaders();
+  // Requests that carry credentials or a body, that ask for part of the
+  // resource, or that may switch protocols get responses of their own
+  if (headers.exists(HTTP_HEADER_AUTHORIZATION) ||
+      headers.exists(HTTP_HEADER_COOKIE) ||
+      headers.exists(HTTP_HEADER_RANGE) ||
+      headers.exists(HTTP_HEADER_CONTENT_LENGTH) ||
+      headers.exists(HTTP_HEADER_TRANSFER_ENCODING) ||
+      headers.exists(HTTP_HEADER_UPGRADE)) {
+    return false;
+  }
+  bool noCache = false;
+  headers.forEachValueOfHeader(
+      HTTP_HEADER_CACHE_CONTROL, [&](const std::string& value) -> bool {
+        noCache = hasToken(value, "no-cache") || hasToken(value, "no-store");
+        return noCache;
+      });
+  headers.forEachValueOfHeader(
+      HTTP_HEADER_PRAGMA, [&](const std::string& value) -> bool {
+        noCache = noCache || hasToken(value, "no-cache");
+        return noCache;
+      });
+  return !noCache;
+}
+
+void CollapsedForwarder::join(const folly::SocketAddress& addr,
+                              const HTTPMessage& request,
+                              Waiter* waiter) {
+  auto key = makeKey(request);
+  auto it = flights_.find(key);
+  if (it != flights_.end()) {
+    stats_->recordCollapsedFollower();
+    VLOG(4) << "Collapsing " << request.getURL() << " into a flight";
+    it->second->addWaiter(waiter);
+    return;
+  }
+  stats_->recordCollapsedLeader();
+  auto flight = new Flight(this, key, request);
+  flights_.emplace(std::move(key), flight);
+  flight->addWaiter(waiter);
+  flight->start(upstreams_, addr);
+}
+
+std::string CollapsedForwarder::makeKey(const HTTPMessage& request) const {
+  const auto& headers = request.getHeaders();
+  auto key = folly::to<std::string>(
+      request.getURL(), '\n', headers.getSingleOrEmpty(HTTP_HEADER_HOST));
+  for (const auto& name : varyHeaders_) {
+    folly::toAppend('\n', name, ':', headers.combine(name), &key);
+  }
+  // A conditional request may get a 304, 412 or 206 with no full body, which
+  // only requests with the same preconditions can share
+  for (auto code : {HTTP_HEADER_IF_MATCH,
+                    HTTP_HEADER_IF_MODIFIED_SINCE,
+                    HTTP_HEADER_IF_NONE_MATCH,
+                    HTTP_HEADER_IF_RANGE,
+                    HTTP_HEADER_IF_UNMODIFIED_SINCE}) {
+    if (headers.exists(code)) {
+      folly::toAppend('\n',
+                      *HTTPCommonHeaders::getPointerToHeaderName(code),
+                      ':',
+                      headers.combine(code),
+                      &key);
+    }
+  }
+  return key;
+}
+
+bool CollapsedForwarder::isShareable(const HTTPMessage& response) const {
+  const auto& headers = response.getHeaders();
+  if (headers.exists(HTTP_HEADER_SET_COOKIE)) {
+    return false;
+  }
+  bool shareable = true;
+  headers.forEachValueOfHeader(
+      HTTP_HEADER_CACHE_CONTROL, [&](const std::string& value) -> bool {
+        shareable =
+            !hasToken(value, "private") && !hasToken(value, "no-store");
+        return !shareable;
+      });
+  // Every waiter sent the same values of the headers in the key, so the
+  // response can only Vary on those
+  headers.forEachValueOfHeader(
+      HTTP_HEADER_VARY, [&](const std::string& value) -> bool {
+        std::vector<folly::StringPiece> names;
+        folly::split(',', value, names);
+        for (auto name : names) {
+          name = folly::trimWhitespace(name);
+          if (name.empty()) {
+            continue;
+          }
+          bool keyed = false;
+          for (const auto& vary : varyHeaders_) {
+            if (folly::caseInsensitiveEqual(name, vary)) {
+              keyed = true;
+              break;
+            }
+          }
+          if (!keyed) {
+            shareable = false;
+            break;
+          }
+        }
+        return !shareable;
+      });
+  return shareable;
+}
+
+CollapsedForwarder::Flight::Flight(CollapsedForwarder* forwarder,
+                                   std::string key,
+                                   const HTTPMessage& request)
+    : forwarder_(forwarder), key_(std::move(key)), request_(request) {
+}
+
+CollapsedForwarder::Flight::~Flight() {
+  DCHECK(waiters_.empty());
+  DCHECK(!txn_);
+}
+
+void CollapsedForwarder::Flight::start(UpstreamPools* upstreams,
+                                       const folly::SocketAddress& addr) {
+  DestructorGuard g(*this);
+  upstreams_ = upstreams;
+  waitingForUpstream_ = true;
+  VLOG(4) << "Starting flight for " << request_.getURL() << " to " << addr;
+  upstreams_->getTransaction(addr, this);
+}
+
+void CollapsedForwarder::Flight::addWaiter(Waiter* waiter) {
+  DCHECK(!headersReceived_);
+  DCHECK(!waiter->flight_);
+  waiter->flight_ = this;
+  waiters_.emplace_back(waiter);
+}
+
+void CollapsedForwarder::Flight::removeWaiter(Waiter* waiter) {
+  DestructorGuard g(*this);
+  if (!findWaiter(waiter)) {
+    return;
+  }
+  eraseWaiter(waiter);
+  if (waiters_.empty() && !upstreamDone_) {
+    // Nobody is left to take the response
+    leaveForwarder();
+    if (waitingForUpstream_) {
+      upstreams_->cancel(this);
+      waitingForUpstream_ = false;
+    } else if (txn_) {
+      txn_->sendAbort();
+    }
+  }
+  updateUpstreamPause();
+}
+
+void CollapsedForwarder::Flight::pauseWaiter(Waiter* waiter) {
+  auto state = findWaiter(waiter);
+  if (state) {
+    state->paused = true;
+  }
+}
+
+void CollapsedForwarder::Flight::resumeWaiter(Waiter* waiter) {
+  DestructorGuard g(*this);
+  auto state = findWaiter(waiter);
+  if (!state) {
+    return;
+  }
+  state->paused = false;
+  deliverQueued(waiter);
+  updateUpstreamPause();
+}
+
+void CollapsedForwarder::Flight::detachForwarder() {
+  forwarder_ = nullptr;
+}
+
+CollapsedForwarder::Flight::WaiterState*
+CollapsedForwarder::Flight::findWaiter(Waiter* waiter) {
+  for (auto& state : waiters_) {
+    if (state.waiter == waiter) {
+      return &state;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<CollapsedForwarder::Waiter*>
+CollapsedForwarder::Flight::getWaiters() const {
+  // Callbacks may remove any waiter, so walk a snapshot
+  std::vector<Waiter*> waiters;
+  waiters.reserve(waiters_.size());
+  for (const auto& state : waiters_) {
+    waiters.push_back(state.waiter);
+  }
+  return waiters;
+}
+
+void CollapsedForwarder::Flight::eraseWaiter(Waiter* waiter) {
+  waiter->flight_ = nullptr;
+  waiters_.remove_if(
+      [waiter](const WaiterState& state) { return state.waiter == waiter; });
+}
+
+void CollapsedForwarder::Flight::deliverQueued(Waiter* waiter) {
+  auto state = findWaiter(waiter);
+  if (!state->queued.empty()) {
+    waiter->onCollapsedBody(state->queued.move());
+    state = findWaiter(waiter);
+    if (!state) {
+      return;
+    }
+  }
+  if (state->eomQueued && !state->paused) {
+    finishWaiter(waiter);
+  }
+}
+
+void CollapsedForwarder::Flight::updateUpstreamPause() {
+  if (!txn_) {
+    return;
+  }
+  bool full = false;
+  for (const auto& state : waiters_) {
+    if (state.queued.chainLength() > kMaxWaiterBuffer) {
+      full = true;
+      break;
+    }
+  }
+  if (full && !upstreamPaused_) {
+    upstreamPaused_ = true;
+    txn_->pauseIngress();
+  } else if (!full && upstreamPaused_) {
+    upstreamPaused_ = false;
+    txn_->resumeIngress();
+  }
+}
+
+void CollapsedForwarder::Flight::failWaiters() {
+  for (auto waiter : getWaiters()) {
+    if (findWaiter(waiter)) {
+      eraseWaiter(waiter);
+      waiter->onCollapsedError();
+    }
+  }
+}
+
+void CollapsedForwarder::Flight::finishWaiter(Waiter* waiter) {
+  eraseWaiter(waiter);
+  if (trailers_) {
+    waiter->onCollapsedTrailers(*trailers_);
+  }
+  waiter->onCollapsedEOM();
+}
+
+void CollapsedForwarder::Flight::leaveForwarder() {
+  if (!forwarder_) {
+    return;
+  }
+  auto it = forwarder_->flights_.find(key_);
+  if (it != forwarder_->flights_.end() && it->second == this) {
+    forwarder_->flights_.erase(it);
+  }
+  forwarder_ = nullptr;
+}
+
+void CollapsedForwarder::Flight::maybeDestroy() {
+  if (guards_ == 0 && waiters_.empty() && !txn_ && !waitingForUpstream_) {
+    leaveForwarder();
+    delete this;
+  }
+}
+
+void CollapsedForwarder::Flight::upstreamTransactionReady(
+    HTTPTransaction* txn) noexcept {
+  DestructorGuard g(*this);
+  waitingForUpstream_ = false;
+  txn_ = txn;
+  txn_->sendHeaders(request_);
+  txn_->sendEOM();
+}
+
+void CollapsedForwarder::Flight::upstreamConnectError(
+    const folly::AsyncSocketException& ex) noexcept {
+  DestructorGuard g(*this);
+  LOG(ERROR) << "Flight failed to connect: " << folly::exceptionStr(ex);
+  waitingForUpstream_ = false;
+  upstreamDone_ = true;
+  leaveForwarder();
+  failWaiters();
+}
+
+void CollapsedForwarder::Flight::detachTransaction() noexcept {
+  DestructorGuard g(*this);
+  txn_ = nullptr;
+  upstreamPaused_ = false;
+  if (!upstreamDone_) {
+    upstreamDone_ = true;
+    leaveForwarder();
+    failWaiters();
+  }
+}
+
+void CollapsedForwarder::Flight::onHeadersComplete(
+    std::unique_ptr<HTTPMessage> msg) noexcept {
+  DestructorGuard g(*this);
+  if (msg->is1xxResponse()) {
+    // The final response is still to come, and waiters may still join
+    for (auto waiter : getWaiters()) {
+      if (findWaiter(waiter)) {
+        waiter->onCollapsedHeaders(*msg);
+      }
+    }
+    return;
+  }
+  headersReceived_ = true;
+  bool shareable = forwarder_ && forwarder_->isShareable(*msg);
+  // Requests arriving from now on start a flight of their own
+  leaveForwarder();
+  auto waiters = getWaiters();
+  if (shareable && !waiters.empty()) {
+    originRequestsSaved_.fetch_add(waiters.size() - 1,
+                                   std::memory_order_relaxed);
+  } else if (waiters.size() > 1) {
+    VLOG(4) << "Response for " << request_.getURL() << " is not shareable, "
+            << "rejecting " << waiters.size() - 1 << " followers";
+    for (auto it = waiters.begin() + 1; it != waiters.end(); ++it) {
+      eraseWaiter(*it);
+    }
+    for (auto it = waiters.begin() + 1; it != waiters.end(); ++it) {
+      (*it)->onCollapseRejected();
+    }
+    waiters.resize(1);
+  }
+  for (auto waiter : waiters) {
+    if (findWaiter(waiter)) {
+      waiter->onCollapsedHeaders(*msg);
+    }
+  }
+}
+
+void CollapsedForwarder::Flight::onBody(
+    std::unique_ptr<folly::IOBuf> chain) noexcept {
+  DestructorGuard g(*this);
+  // Waiters share the buffers, each gets a clone of the chain
+  for (auto waiter : getWaiters()) {
+    auto state = findWaiter(waiter);
+    if (!state) {
+      continue;
+    }
+    if (state->paused || !state->queued.empty()) {
+      state->queued.append(chain->clone());
+    } else {
+      waiter->onCollapsedBody(chain->clone());
+    }
+  }
+  updateUpstreamPause();
+}
+
+void CollapsedForwarder::Flight::onTrailers(
+    std::unique_ptr<HTTPHeaders> trailers) noexcept {
+  // Delivered to each waiter along with its EOM, which comes next
+  trailers_ = std::move(trailers);
+}
+
+void CollapsedForwarder::Flight::onEOM() noexcept {
+  DestructorGuard g(*this);
+  upstreamDone_ = true;
+  for (auto waiter : getWaiters()) {
+    auto state = findWaiter(waiter);
+    if (!state) {
+      continue;
+    }
+    if (state->paused || !state->queued.empty()) {
+      state->eomQueued = true;
+    } else {
+      finishWaiter(waiter);
+    }
+  }
+}
+
+void CollapsedForwarder::Flight::onError(const HTTPException& error) noexcept {
+  DestructorGuard g(*this);
+  LOG(ERROR) << "Flight upstream error: " << error;
+  upstreamDone_ = true;
+  leaveForwarder();
+  failWaiters();
+}
+
+}
@@ -0,0 +1,226 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+
+#include "UpstreamPools.h"
+
+#include <atomic>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ProxyService {
+
+class ProxyStats;
+
+/**
+ * Collapsed forwarding: identical GETs in flight at the same time share one
+ * upstream request.  The first request for a key starts a Flight, and
+ * requests for the same key that arrive before its response headers attach
+ * to it.  Every attached request gets the response, with the body IOBufs
+ * cloned rather than copied.  Informational (1xx) responses are passed on
+ * to the requests attached when they arrive, ahead of the final response.
+ *
+ * Requests are keyed by URL, Host and the configured request headers
+ * responses may Vary on.  Responses that Vary on anything else, or that are
+ * not shareable (private, no-store, Set-Cookie), go only to the request that
+ * started the flight; the others are rejected and forward on their own.
+ *
+ * Each waiter has its own egress backpressure: while it is paused its body
+ * is queued, and the upstream transaction is paused while any waiter has
+ * more than kMaxWaiterBuffer queued.
+ *
+ * One per worker, used from its EventBase thread only.
+ */
+class CollapsedForwarder {
+ public:
+  class Flight;
+
+  class Waiter {
+   public:
+    virtual ~Waiter() {
+    }
+    // Called for each 1xx response, then once for the final response
+    virtual void onCollapsedHeaders(const proxygen::HTTPMessage& msg)
+        noexcept = 0;
+    virtual void onCollapsedBody(std::unique_ptr<folly::IOBuf> chain)
+        noexcept = 0;
+    // Called right before onCollapsedEOM, if the response has trailers
+    virtual void onCollapsedTrailers(const proxygen::HTTPHeaders& trailers)
+        noexcept = 0;
+    virtual void onCollapsedEOM() noexcept = 0;
+    virtual void onCollapsedError() noexcept = 0;
+    // The response cannot be shared, forward the request separately
+    virtual void onCollapseRejected() noexcept = 0;
+
+   protected:
+    // The flight this waiter is attached to, if any.  Cleared before the
+    // last callback from it.
+    Flight* getFlight() const {
+      return flight_;
+    }
+
+   private:
+    friend class Flight;
+    Flight* flight_{nullptr};
+  };
+
+  CollapsedForwarder(UpstreamPools* upstreams,
+                     ProxyStats* stats,
+                     std::vector<std::string> varyHeaders);
+  ~CollapsedForwarder();
+
+  /**
+   * Whether request may share an upstream request with identical ones
+   */
+  static bool isCollapsible(const proxygen::HTTPMessage& request);
+
+  /**
+   * Attach waiter to the flight for request, starting one to addr if there
+   * is none.  Waiter callbacks may run before this returns.
+   */
+  void join(const folly::SocketAddress& addr,
+            const proxygen::HTTPMessage& request,
+            Waiter* waiter);
+
+  // Followers that were served the shared response, process wide
+  static uint64_t getOriginRequestsSaved() {
+    return originRequestsSaved_.load(std::memory_order_relaxed);
+  }
+
+  static const size_t kMaxWaiterBuffer = 256 * 1024;
+
+  class Flight : private proxygen::HTTPTransactionHandler,
+                 private UpstreamPools::Callback {
+   public:
+    Flight(CollapsedForwarder* forwarder,
+           std::string key,
+           const proxygen::HTTPMessage& request);
+
+    void start(UpstreamPools* upstreams, const folly::SocketAddress& addr);
+
+    void addWaiter(Waiter* waiter);
+
+    /**
+     * The waiter is going away, no more callbacks to it
+     */
+    void removeWaiter(Waiter* waiter);
+
+    void pauseWaiter(Waiter* waiter);
+    void resumeWaiter(Waiter* waiter);
+
+    // Called by the forwarder when it is destroyed
+    void detachForwarder();
+
+   private:
+    struct WaiterState {
+      explicit WaiterState(Waiter* w) : waiter(w) {
+      }
+      Waiter* waiter;
+      folly::IOBufQueue queued{folly::IOBufQueue::cacheChainLength()};
+      bool paused{false};
+      bool eomQueued{false};
+    };
+
+    // Defers destroying the flight while it is calling out to waiters,
+    // which may remove themselves
+    class DestructorGuard {
+     public:
+      explicit DestructorGuard(Flight& flight) : flight_(flight) {
+        flight_.guards_++;
+      }
+      ~DestructorGuard() {
+        if (--flight_.guards_ == 0) {
+          flight_.maybeDestroy();
+        }
+      }
+
+     private:
+      Flight& flight_;
+    };
+
+    ~Flight() override;
+
+    WaiterState* findWaiter(Waiter* waiter);
+    std::vector<Waiter*> getWaiters() const;
+    // Detach waiter, it gets no more callbacks
+    void eraseWaiter(Waiter* waiter);
+    void deliverQueued(Waiter* waiter);
+    void updateUpstreamPause();
+    void failWaiters();
+    // Detach waiter and complete its response
+    void finishWaiter(Waiter* waiter);
+    void leaveForwarder();
+    void maybeDestroy();
+
+    // UpstreamPools::Callback
+    proxygen::HTTPTransaction::Handler* getUpstreamHandler() noexcept
+        override {
+      return this;
+    }
+    void upstreamTransactionReady(proxygen::HTTPTransaction* txn) noexcept
+        override;
+    void upstreamConnectError(const folly::AsyncSocketException& ex) noexcept
+        override;
+
+    // HTTPTransactionHandler
+    void setTransaction(proxygen::HTTPTransaction* /*txn*/) noexcept
+        override {
+    }
+    void detachTransaction() noexcept override;
+    void onHeadersComplete(std::unique_ptr<proxygen::HTTPMessage> msg)
+        noexcept override;
+    void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override;
+    void onTrailers(std::unique_ptr<proxygen::HTTPHeaders> trailers)
+        noexcept override;
+    void onEOM() noexcept override;
+    void onUpgrade(proxygen::UpgradeProtocol /*protocol*/) noexcept override {
+    }
+    void onError(const proxygen::HTTPException& error) noexcept override;
+    void onEgressPaused() noexcept override {
+    }
+    void onEgressResumed() noexcept override {
+    }
+
+    // Cleared once the flight stops accepting waiters
+    CollapsedForwarder* forwarder_;
+    const std::string key_;
+    proxygen::HTTPMessage request_;
+    UpstreamPools* upstreams_{nullptr};
+    proxygen::HTTPTransaction* txn_{nullptr};
+    std::list<WaiterState> waiters_;
+    std::unique_ptr<proxygen::HTTPHeaders> trailers_;
+    uint32_t guards_{0};
+    bool waitingForUpstream_{false};
+    bool upstreamDone_{false};
+    bool upstreamPaused_{false};
+    bool headersReceived_{false};
+  };
+
+ private:
+  friend class Flight;
+
+  std::string makeKey(const proxygen::HTTPMessage& request) const;
+  bool isShareable(const proxygen::HTTPMessage& response) const;
+
+  UpstreamPools* const upstreams_;
+  ProxyStats* const stats_;
+  const std::vector<std::string> varyHeaders_;
+  std::unordered_map<std::string, Flight*> flights_;
+
+  static std::atomic<uint64_t> originRequestsSaved_;
+};
+
+}
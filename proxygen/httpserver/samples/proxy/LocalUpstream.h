@@ -0,0 +1,42 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/httpserver/ScopedHTTPServer.h>
+
+namespace ProxyService {
+
+/**
+ * Stand-in upstream for trying out and benchmarking the proxy without a
+ * real origin: answers every request with a 200 and bodySize bytes.
+ */
+inline std::unique_ptr<proxygen::ScopedHTTPServer> startLocalUpstream(
+    uint16_t port,
+    proxygen::HTTPServer::Protocol protocol,
+    size_t bodySize,
+    int threads) {
+  auto body = std::make_shared<std::string>(bodySize, 'u');
+  auto handler = [body](const proxygen::HTTPMessage& /*request*/,
+                        std::unique_ptr<folly::IOBuf> /*requestBody*/,
+                        proxygen::ResponseBuilder& response) {
+    response.status(200, "OK")
+        .body(folly::IOBuf::wrapBuffer(body->data(), body->size()));
+  };
+  proxygen::HTTPServerOptions options;
+  options.threads = threads;
+  options.handlerFactories.push_back(
+      std::make_unique<proxygen::ScopedHandlerFactory<decltype(handler)>>(
+          handler));
+  return proxygen::ScopedHTTPServer::start(
+      {folly::SocketAddress("127.0.0.1", port), protocol},
+      std::move(options));
+}
+
+}
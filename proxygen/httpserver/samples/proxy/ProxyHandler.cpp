@@ -36,9 +36,12 @@ static const uint8_t CLOSED = READS_SHUTDOWN | WRITES_SHUTDOWN;
 
 namespace ProxyService {
 
-ProxyHandler::ProxyHandler(ProxyStats* stats, folly::HHWheelTimer* timer):
+ProxyHandler::ProxyHandler(ProxyStats* stats,
+                           UpstreamPools* upstreams,
+                           CollapsedForwarder* collapser):
     stats_(stats),
-    connector_{this, timer},
+    upstreams_(upstreams),
+    collapser_(collapser),
     serverHandler_(*this) {
 }
 
@@ -52,13 +55,23 @@ void ProxyHandler::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
 
   stats_->recordRequest();
   request_ = std::move(headers);
-  proxygen::URL url(request_->getURL());
+  bool isConnect = request_->getMethod() == HTTPMethod::CONNECT;
 
   folly::SocketAddress addr;
+  folly::Optional<folly::SocketAddress> upstream;
+  if (!isConnect) {
+    upstream = upstreams_->selectUpstream(
+        std::hash<std::string>()(request_->getURL()));
+  }
   try {
-    // Note, this does a synchronous DNS lookup which is bad in event driven
-    // code
-    addr.setFromHostPort(url.getHost(), url.getPort());
+    if (upstream) {
+      addr = *upstream;
+    } else {
+      // Note, this does a synchronous DNS lookup which is bad in event
+      // driven code
+      proxygen::URL url(request_->getURL());
+      addr.setFromHostPort(url.getHost(), url.getPort());
+    }
   } catch (...) {
     ResponseBuilder(downstream_)
       .status(503, "Bad Gateway")
@@ -68,27 +81,28 @@ void ProxyHandler::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
     return;
   }
 
-
   downstream_->pauseIngress();
-  LOG(INFO) << "Trying to connect to " << addr;
-  auto evb = folly::EventBaseManager::get()->getEventBase();
-  if (request_->getMethod() == HTTPMethod::CONNECT) {
+  if (isConnect) {
+    LOG(INFO) << "Trying to connect to " << addr;
+    auto evb = folly::EventBaseManager::get()->getEventBase();
     upstreamSock_ = folly::AsyncSocket::newSocket(evb);
     upstreamSock_->connect(this, addr, FLAGS_proxy_connect_timeout);
+  } else if (collapser_ && CollapsedForwarder::isCollapsible(*request_)) {
+    // Ingress stays paused until the response is ours, in case it is not
+    // shareable and the request has to be forwarded after all
+    upstreamAddr_ = addr;
+    collapsed_ = true;
+    collapser_->join(addr, *request_, this);
   } else {
-    // A more sophisticated proxy would have a connection pool here
-    const folly::AsyncSocket::OptionMap opts{
-      {{SOL_SOCKET, SO_REUSEADDR}, 1}};
-    downstream_->pauseIngress();
-    connector_.connect(folly::EventBaseManager::get()->getEventBase(), addr,
-                       std::chrono::milliseconds(FLAGS_proxy_connect_timeout),
-                       opts);
+    VLOG(4) << "Getting a transaction to " << addr;
+    waitingForUpstream_ = true;
+    upstreams_->getTransaction(addr, this);
   }
 }
 
 void ProxyHandler::onBody(std::unique_ptr<folly::IOBuf> body) noexcept {
   if (txn_) {
-    LOG(INFO) << "Forwarding " <<
+    VLOG(4) << "Forwarding " <<
       ((body) ? body->computeChainDataLength() : 0) << " body bytes to server";
     txn_->sendBody(std::move(body));
   } else if (upstreamSock_) {
@@ -106,28 +120,29 @@ void ProxyHandler::onBody(std::unique_ptr<folly::IOBuf> body) noexcept {
 
 void ProxyHandler::onEOM() noexcept {
   if (txn_) {
-    LOG(INFO) << "Forwarding client EOM to server";
+    VLOG(4) << "Forwarding client EOM to server";
     txn_->sendEOM();
   } else if (upstreamSock_) {
     LOG(INFO) << "Closing upgraded socket";
     sockStatus_ |= WRITES_SHUTDOWN;
     upstreamSock_->shutdownWrite();
-  } else {
+  } else if (!collapsed_) {
     LOG(INFO) << "Dropping client EOM to server";
   }
 }
 
-void ProxyHandler::connectSuccess(HTTPUpstreamSession* session) {
-  LOG(INFO) << "Established " << *session;
-  session_ = std::make_unique<SessionWrapper>(session);
-  txn_ = session->newTransaction(&serverHandler_);
-  LOG(INFO) << "Forwarding client request: " << request_->getURL()
-            << " to server";
+void ProxyHandler::upstreamTransactionReady(HTTPTransaction* txn) noexcept {
+  waitingForUpstream_ = false;
+  txn_ = txn;
+  VLOG(4) << "Forwarding client request: " << request_->getURL()
+          << " to server";
   txn_->sendHeaders(*request_);
   downstream_->resumeIngress();
 }
 
-void ProxyHandler::connectError(const folly::AsyncSocketException& ex) {
+void ProxyHandler::upstreamConnectError(
+    const folly::AsyncSocketException& ex) noexcept {
+  waitingForUpstream_ = false;
   LOG(ERROR) << "Failed to connect: " << folly::exceptionStr(ex);
   if (!clientTerminated_) {
     ResponseBuilder(downstream_)
@@ -139,23 +154,71 @@ void ProxyHandler::connectError(const folly::AsyncSocketException& ex) {
   }
 }
 
+void ProxyHandler::onCollapsedHeaders(const HTTPMessage& msg) noexcept {
+  VLOG(4) << "Forwarding collapsed " << msg.getStatusCode()
+          << " response to client";
+  HTTPMessage response(msg);
+  if (!msg.is1xxResponse()) {
+    collapsedHeadersSent_ = true;
+    downstream_->resumeIngress();
+  }
+  downstream_->sendHeaders(response);
+}
+
+void ProxyHandler::onCollapsedBody(std::unique_ptr<folly::IOBuf> chain)
+    noexcept {
+  downstream_->sendBody(std::move(chain));
+}
+
+void ProxyHandler::onCollapsedTrailers(const HTTPHeaders& trailers) noexcept {
+  sendDownstreamTrailers(trailers);
+}
+
+void ProxyHandler::onCollapsedEOM() noexcept {
+  downstream_->sendEOM();
+}
+
+void ProxyHandler::onCollapsedError() noexcept {
+  if (!collapsedHeadersSent_) {
+    ResponseBuilder(downstream_)
+      .status(503, "Bad Gateway")
+      .sendWithEOM();
+  } else {
+    abortDownstream();
+  }
+}
+
+void ProxyHandler::onCollapseRejected() noexcept {
+  VLOG(4) << "Getting a transaction of our own to " << upstreamAddr_;
+  collapsed_ = false;
+  waitingForUpstream_ = true;
+  upstreams_->getTransaction(upstreamAddr_, this);
+}
+
 void ProxyHandler::onServerHeadersComplete(
   unique_ptr<HTTPMessage> msg) noexcept {
   CHECK(!clientTerminated_);
-  LOG(INFO) << "Forwarding " << msg->getStatusCode() << " response to client";
+  VLOG(4) << "Forwarding " << msg->getStatusCode() << " response to client";
   downstream_->sendHeaders(*msg);
 }
 
 void ProxyHandler::onServerBody(std::unique_ptr<folly::IOBuf> chain) noexcept {
   CHECK(!clientTerminated_);
-  LOG(INFO) << "Forwarding " <<
+  VLOG(4) << "Forwarding " <<
     ((chain) ? chain->computeChainDataLength() : 0) << " body bytes to client";
   downstream_->sendBody(std::move(chain));
 }
 
+void ProxyHandler::onServerTrailers(
+  std::unique_ptr<HTTPHeaders> trailers) noexcept {
+  if (!clientTerminated_) {
+    sendDownstreamTrailers(*trailers);
+  }
+}
+
 void ProxyHandler::onServerEOM() noexcept {
   if (!clientTerminated_) {
-    LOG(INFO) << "Forwarding server EOM to client";
+    VLOG(4) << "Forwarding server EOM to client";
     downstream_->sendEOM();
   }
 }
@@ -190,6 +253,13 @@ void ProxyHandler::requestComplete() noexcept {
 void ProxyHandler::onError(ProxygenError err) noexcept {
   LOG(ERROR) << "Client error: " << proxygen::getErrorString(err);
   clientTerminated_ = true;
+  if (waitingForUpstream_) {
+    upstreams_->cancel(this);
+    waitingForUpstream_ = false;
+  }
+  if (getFlight()) {
+    getFlight()->removeWaiter(this);
+  }
   if (txn_) {
     LOG(ERROR) << "Aborting server txn: " << *txn_;
     txn_->sendAbort();
@@ -202,6 +272,8 @@ void ProxyHandler::onError(ProxygenError err) noexcept {
 void ProxyHandler::onEgressPaused() noexcept {
   if (txn_) {
     txn_->pauseIngress();
+  } else if (getFlight()) {
+    getFlight()->pauseWaiter(this);
   } else if (upstreamSock_) {
     upstreamSock_->setReadCB(nullptr);
   }
@@ -210,6 +282,8 @@ void ProxyHandler::onEgressPaused() noexcept {
 void ProxyHandler::onEgressResumed() noexcept {
   if (txn_) {
     txn_->resumeIngress();
+  } else if (getFlight()) {
+    getFlight()->resumeWaiter(this);
   } else if (upstreamSock_) {
     upstreamSock_->setReadCB(this);
   }
@@ -221,8 +295,17 @@ void ProxyHandler::abortDownstream() {
   }
 }
 
+void ProxyHandler::sendDownstreamTrailers(const HTTPHeaders& trailers) {
+  // ResponseHandler has no trailers API, go to the transaction like
+  // ResponseBuilder does
+  auto txn = downstream_->getTransaction();
+  if (txn) {
+    txn->sendTrailers(trailers);
+  }
+}
+
 bool ProxyHandler::checkForShutdown() {
-  if (clientTerminated_ && !txn_ &&
+  if (clientTerminated_ && !txn_ && !waitingForUpstream_ && !getFlight() &&
       (!upstreamSock_ || (sockStatus_ == CLOSED && !upstreamEgressPaused_))) {
     delete this;
     return true;
@@ -12,8 +12,9 @@
 #include <folly/Memory.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <proxygen/httpserver/RequestHandler.h>
-#include <proxygen/lib/http/HTTPConnector.h>
-#include "SessionWrapper.h"
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+#include "CollapsedForwarder.h"
+#include "UpstreamPools.h"
 
 namespace proxygen {
 class ResponseHandler;
@@ -24,12 +25,16 @@ namespace ProxyService {
 class ProxyStats;
 
 class ProxyHandler : public proxygen::RequestHandler,
-                     private proxygen::HTTPConnector::Callback,
+                     private UpstreamPools::Callback,
+                     private CollapsedForwarder::Waiter,
                      private folly::AsyncSocket::ConnectCallback,
                      private folly::AsyncReader::ReadCallback,
                      private folly::AsyncWriter::WriteCallback {
  public:
-  ProxyHandler(ProxyStats* stats, folly::HHWheelTimer* timer);
+  // collapser is null when collapsed forwarding is off
+  ProxyHandler(ProxyStats* stats,
+               UpstreamPools* upstreams,
+               CollapsedForwarder* collapser);
 
   ~ProxyHandler() override;
 
@@ -54,6 +59,8 @@ class ProxyHandler : public proxygen::RequestHandler,
   void onServerHeadersComplete(
     std::unique_ptr<proxygen::HTTPMessage> msg) noexcept;
   void onServerBody(std::unique_ptr<folly::IOBuf> chain) noexcept;
+  void onServerTrailers(
+    std::unique_ptr<proxygen::HTTPHeaders> trailers) noexcept;
   void onServerEOM() noexcept;
   void onServerError(const proxygen::HTTPException& error) noexcept;
   void onServerEgressPaused() noexcept;
@@ -61,8 +68,25 @@ class ProxyHandler : public proxygen::RequestHandler,
 
  private:
 
-  void connectSuccess(proxygen::HTTPUpstreamSession* session) override;
-  void connectError(const folly::AsyncSocketException& ex) override;
+  // UpstreamPools::Callback
+  proxygen::HTTPTransaction::Handler* getUpstreamHandler() noexcept override {
+    return &serverHandler_;
+  }
+  void upstreamTransactionReady(proxygen::HTTPTransaction* txn) noexcept
+      override;
+  void upstreamConnectError(const folly::AsyncSocketException& ex) noexcept
+      override;
+
+  // CollapsedForwarder::Waiter
+  void onCollapsedHeaders(const proxygen::HTTPMessage& msg) noexcept
+      override;
+  void onCollapsedBody(std::unique_ptr<folly::IOBuf> chain) noexcept
+      override;
+  void onCollapsedTrailers(const proxygen::HTTPHeaders& trailers) noexcept
+      override;
+  void onCollapsedEOM() noexcept override;
+  void onCollapsedError() noexcept override;
+  void onCollapseRejected() noexcept override;
 
   class ServerTransactionHandler: public proxygen::HTTPTransactionHandler {
    public:
@@ -88,8 +112,8 @@ class ProxyHandler : public proxygen::RequestHandler,
     }
 
     void onTrailers(
-        std::unique_ptr<proxygen::HTTPHeaders> /*trailers*/) noexcept override {
-      // ignore for now
+        std::unique_ptr<proxygen::HTTPHeaders> trailers) noexcept override {
+      parent_.onServerTrailers(std::move(trailers));
     }
     void onEOM() noexcept override {
       parent_.onServerEOM();
@@ -125,13 +149,19 @@ class ProxyHandler : public proxygen::RequestHandler,
                 const folly::AsyncSocketException& ex) noexcept override;
 
   void abortDownstream();
+  void sendDownstreamTrailers(const proxygen::HTTPHeaders& trailers);
   bool checkForShutdown();
 
   ProxyStats* const stats_{nullptr};
-  proxygen::HTTPConnector connector_;
+  UpstreamPools* const upstreams_{nullptr};
+  CollapsedForwarder* const collapser_{nullptr};
   ServerTransactionHandler serverHandler_;
-  std::unique_ptr<SessionWrapper> session_;
   proxygen::HTTPTransaction* txn_{nullptr};
+  folly::SocketAddress upstreamAddr_;
+  bool waitingForUpstream_{false};
+  // Served from a collapsed flight rather than a transaction of our own
+  bool collapsed_{false};
+  bool collapsedHeadersSent_{false};
   bool clientTerminated_{false};
 
   std::unique_ptr<proxygen::HTTPMessage> request_;
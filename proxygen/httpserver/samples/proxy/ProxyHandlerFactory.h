@@ -0,0 +1,87 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/ThreadLocal.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+
+#include "CollapsedForwarder.h"
+#include "ProxyHandler.h"
+#include "ProxyStats.h"
+#include "UpstreamPools.h"
+
+namespace ProxyService {
+
+class ProxyHandlerFactory : public proxygen::RequestHandlerFactory {
+ public:
+  /**
+   * collapseVaryHeaders are the request headers identical GETs are also
+   * keyed on when collapsedForwarding is on.
+   */
+  ProxyHandlerFactory(UpstreamPools::Options options,
+                      std::chrono::milliseconds serverTimeout,
+                      bool collapsedForwarding = false,
+                      std::vector<std::string> collapseVaryHeaders = {})
+      : options_(std::move(options)),
+        serverTimeout_(serverTimeout),
+        collapsedForwarding_(collapsedForwarding),
+        collapseVaryHeaders_(std::move(collapseVaryHeaders)) {
+  }
+
+  void onServerStart(folly::EventBase* evb) noexcept override {
+    stats_.reset(new ProxyStats);
+    worker_->timer = folly::HHWheelTimer::newTimer(
+      evb,
+      std::chrono::milliseconds(folly::HHWheelTimer::DEFAULT_TICK_INTERVAL),
+      folly::AsyncTimeout::InternalEnum::NORMAL,
+      serverTimeout_);
+    worker_->upstreams =
+        std::make_unique<UpstreamPools>(worker_->timer.get(), options_);
+    if (collapsedForwarding_) {
+      worker_->collapser = std::make_unique<CollapsedForwarder>(
+          worker_->upstreams.get(), stats_.get(), collapseVaryHeaders_);
+    }
+  }
+
+  void onServerStop() noexcept override {
+    LOG(INFO) << "Worker proxied " << stats_->getRequestCount()
+              << " requests, collapsed " << stats_->getCollapsedFollowers()
+              << " of them into " << stats_->getCollapsedLeaders()
+              << " flights";
+    stats_.reset();
+    worker_->collapser.reset();
+    worker_->upstreams.reset();
+    worker_->timer.reset();
+  }
+
+  proxygen::RequestHandler* onRequest(proxygen::RequestHandler*,
+                                      proxygen::HTTPMessage*) noexcept
+      override {
+    return new ProxyHandler(stats_.get(),
+                            worker_->upstreams.get(),
+                            worker_->collapser.get());
+  }
+
+ private:
+  struct Worker {
+    folly::HHWheelTimer::UniquePtr timer;
+    std::unique_ptr<UpstreamPools> upstreams;
+    std::unique_ptr<CollapsedForwarder> collapser;
+  };
+  const UpstreamPools::Options options_;
+  const std::chrono::milliseconds serverTimeout_;
+  const bool collapsedForwarding_;
+  const std::vector<std::string> collapseVaryHeaders_;
+  folly::ThreadLocalPtr<ProxyStats> stats_;
+  folly::ThreadLocal<Worker> worker_;
+};
+
+}
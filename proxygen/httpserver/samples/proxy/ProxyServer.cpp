@@ -9,20 +9,17 @@
  */
 #include <folly/portability/GFlags.h>
 #include <folly/Memory.h>
+#include <folly/String.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <proxygen/httpserver/HTTPServer.h>
-#include <proxygen/httpserver/RequestHandlerFactory.h>
 
-#include "ProxyHandler.h"
-#include "ProxyStats.h"
+#include "LocalUpstream.h"
+#include "ProxyHandlerFactory.h"
 
 using namespace ProxyService;
 using namespace proxygen;
 
-using folly::EventBase;
-using folly::EventBaseManager;
 using folly::SocketAddress;
-using folly::HHWheelTimer;
 
 using Protocol = HTTPServer::Protocol;
 
@@ -33,34 +30,31 @@ DEFINE_int32(threads, 0, "Number of threads to listen on. Numbers <= 0 "
              "will use the number of cores on this machine.");
 DEFINE_int32(server_timeout, 60,
              "How long to wait for a server response (sec)");
-
-class ProxyHandlerFactory : public RequestHandlerFactory {
- public:
-  void onServerStart(folly::EventBase* evb) noexcept override {
-    stats_.reset(new ProxyStats);
-    timer_->timer = HHWheelTimer::newTimer(
-      evb,
-      std::chrono::milliseconds(HHWheelTimer::DEFAULT_TICK_INTERVAL),
-      folly::AsyncTimeout::InternalEnum::NORMAL,
-      std::chrono::seconds(FLAGS_server_timeout));
-  }
-
-  void onServerStop() noexcept override {
-    stats_.reset();
-    timer_->timer.reset();
-  }
-
-  RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
-    return new ProxyHandler(stats_.get(), timer_->timer.get());
-  }
-
- private:
-  struct TimerWrapper {
-    HHWheelTimer::UniquePtr timer;
-  };
-  folly::ThreadLocalPtr<ProxyStats> stats_;
-  folly::ThreadLocal<TimerWrapper> timer_;
-};
+DEFINE_string(upstreams, "",
+              "Comma separated host:port upstreams to send every request "
+              "to, picked by rendezvous hash of the URL.  When empty, "
+              "requests go to the host in their URL.");
+DEFINE_bool(upstream_h2, false,
+            "Speak HTTP/2 with prior knowledge to the --upstreams.  Hosts "
+            "named in request URLs always get HTTP/1.1.");
+DEFINE_int32(upstream_idle_sessions, 8,
+             "Idle sessions each worker keeps per upstream.  0 opens a "
+             "connection per request.");
+DEFINE_int32(upstream_idle_timeout, 60,
+             "How long pooled upstream sessions may stay idle (sec)");
+DEFINE_int32(local_upstream_port, 0,
+             "If set, also run a local stand-in upstream on this port, "
+             "answering every request with local_upstream_body_size bytes");
+DEFINE_int32(local_upstream_body_size, 1024,
+             "Response body size of the local stand-in upstream");
+DEFINE_bool(collapsed_forwarding, false,
+            "Send identical GETs in flight at the same time upstream once, "
+            "and share the response between them");
+DEFINE_string(collapse_vary_headers, "Accept-Encoding,Accept-Language",
+              "Comma separated request headers collapsed GETs must also "
+              "match on.  Responses that Vary on others are not shared.");
+
+DECLARE_int32(proxy_connect_timeout);
 
 int main(int argc, char* argv[]) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -77,13 +71,47 @@ int main(int argc, char* argv[]) {
     CHECK(FLAGS_threads > 0);
   }
 
+  // Arbitrary origins cannot be assumed to take a plaintext HTTP/2 preface
+  bool upstreamH2 = FLAGS_upstream_h2 && !FLAGS_upstreams.empty();
+
+  std::unique_ptr<ScopedHTTPServer> localUpstream;
+  if (FLAGS_local_upstream_port > 0) {
+    localUpstream = startLocalUpstream(
+        FLAGS_local_upstream_port,
+        upstreamH2 ? Protocol::HTTP2 : Protocol::HTTP,
+        FLAGS_local_upstream_body_size,
+        FLAGS_threads);
+  }
+
+  UpstreamPools::Options upstreamOptions;
+  std::vector<folly::StringPiece> upstreams;
+  folly::split(',', FLAGS_upstreams, upstreams, true);
+  for (auto upstream : upstreams) {
+    SocketAddress addr;
+    addr.setFromHostPort(upstream.str());
+    upstreamOptions.upstreams.push_back(addr);
+  }
+  upstreamOptions.h2 = upstreamH2;
+  upstreamOptions.maxIdleSessions = FLAGS_upstream_idle_sessions;
+  upstreamOptions.idleTimeout =
+      std::chrono::seconds(FLAGS_upstream_idle_timeout);
+  upstreamOptions.connectTimeout =
+      std::chrono::milliseconds(FLAGS_proxy_connect_timeout);
+
+  std::vector<std::string> collapseVaryHeaders;
+  folly::split(',', FLAGS_collapse_vary_headers, collapseVaryHeaders, true);
+
   HTTPServerOptions options;
   options.threads = static_cast<size_t>(FLAGS_threads);
   options.idleTimeout = std::chrono::milliseconds(60000);
   options.shutdownOn = {SIGINT, SIGTERM};
   options.enableContentCompression = false;
   options.handlerFactories = RequestHandlerChain()
-      .addThen<ProxyHandlerFactory>()
+      .addThen<ProxyHandlerFactory>(
+          std::move(upstreamOptions),
+          std::chrono::seconds(FLAGS_server_timeout),
+          FLAGS_collapsed_forwarding,
+          std::move(collapseVaryHeaders))
       .build();
   options.h2cEnabled = true;
   options.supportsConnect = true;
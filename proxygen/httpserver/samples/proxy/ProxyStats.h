@@ -36,8 +36,28 @@ class ProxyStats {
     return reqCount_;
   }
 
+  // Collapsed forwarding: requests that started a flight, and requests that
+  // joined one already in progress
+  virtual void recordCollapsedLeader() {
+    ++collapsedLeaders_;
+  }
+
+  virtual void recordCollapsedFollower() {
+    ++collapsedFollowers_;
+  }
+
+  virtual uint64_t getCollapsedLeaders() {
+    return collapsedLeaders_;
+  }
+
+  virtual uint64_t getCollapsedFollowers() {
+    return collapsedFollowers_;
+  }
+
  private:
   uint64_t reqCount_{0};
+  uint64_t collapsedLeaders_{0};
+  uint64_t collapsedFollowers_{0};
 };
 
 }
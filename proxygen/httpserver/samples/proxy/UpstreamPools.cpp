@@ -0,0 +1,185 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "UpstreamPools.h"
+
+#include <folly/io/async/EventBaseManager.h>
+#include <proxygen/lib/http/codec/HTTP2Constants.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+
+using namespace proxygen;
+
+namespace ProxyService {
+
+std::atomic<uint64_t> UpstreamPools::connectionsOpened_{0};
+
+UpstreamPools::UpstreamPools(folly::HHWheelTimer* timer, Options options)
+    : timer_(timer), options_(std::move(options)) {
+  if (!options_.upstreams.empty()) {
+    std::vector<std::pair<std::string, uint64_t>> weights;
+    for (const auto& addr : options_.upstreams) {
+      weights.emplace_back(addr.describe(), 1);
+    }
+    hash_.build(weights);
+  }
+}
+
+folly::Optional<folly::SocketAddress> UpstreamPools::selectUpstream(
+    uint64_t key) const {
+  if (options_.upstreams.empty()) {
+    return folly::none;
+  }
+  return options_.upstreams[hash_.get(key)];
+}
+
+void UpstreamPools::getTransaction(const folly::SocketAddress& addr,
+                                   Callback* cb) {
+  Endpoint endpoint(addr, false);
+  auto it = upstreams_.find(endpoint);
+  if (it == upstreams_.end()) {
+    it = upstreams_
+             .emplace(std::move(endpoint),
+                      std::make_unique<Upstream>(*this, addr))
+             .first;
+  }
+  it->second->getTransaction(cb);
+}
+
+void UpstreamPools::cancel(Callback* cb) {
+  for (auto& upstream : upstreams_) {
+    upstream.second->cancel(cb);
+  }
+}
+
+UpstreamPools::Connector::Connector(Upstream& upstream,
+                                    folly::HHWheelTimer* timer)
+    : upstream_(upstream), connector_{this, timer} {
+  if (upstream_.getOptions().h2) {
+    connector_.setPlaintextProtocol(http2::kProtocolString);
+  }
+}
+
+void UpstreamPools::Connector::connect() {
+  const folly::AsyncSocket::OptionMap opts{{{SOL_SOCKET, SO_REUSEADDR}, 1}};
+  connector_.connect(folly::EventBaseManager::get()->getEventBase(),
+                     upstream_.getAddress(),
+                     upstream_.getOptions().connectTimeout,
+                     opts);
+}
+
+void UpstreamPools::Connector::connectSuccess(HTTPUpstreamSession* session) {
+  upstream_.onConnectSuccess(this, session);
+}
+
+void UpstreamPools::Connector::connectError(
+    const folly::AsyncSocketException& ex) {
+  upstream_.onConnectError(this, ex);
+}
+
+UpstreamPools::Upstream::Upstream(UpstreamPools& parent,
+                                  const folly::SocketAddress& addr)
+    : parent_(parent),
+      addr_(addr),
+      pool_(nullptr,
+            parent.options_.maxIdleSessions,
+            parent.options_.idleTimeout) {
+}
+
+void UpstreamPools::Upstream::getTransaction(Callback* cb) {
+  if (getOptions().maxIdleSessions > 0) {
+    auto txn = pool_.getTransaction(cb->getUpstreamHandler());
+    if (txn) {
+      cb->upstreamTransactionReady(txn);
+      return;
+    }
+  }
+  waiters_.push_back(cb);
+  maybeConnect();
+}
+
+void UpstreamPools::Upstream::cancel(Callback* cb) {
+  waiters_.remove(cb);
+}
+
+void UpstreamPools::Upstream::maybeConnect() {
+  // One connection can carry every waiting request over HTTP/2, otherwise
+  // each needs its own
+  auto wanted = [this] {
+    if (getOptions().h2 && getOptions().maxIdleSessions > 0) {
+      return std::min<size_t>(waiters_.size(), 1);
+    }
+    return waiters_.size();
+  };
+  while (connecting_.size() < wanted()) {
+    connecting_.push_back(
+        std::make_unique<Connector>(*this, parent_.timer_));
+    connecting_.back()->connect();
+  }
+}
+
+void UpstreamPools::Upstream::finishConnect(Connector* connector) {
+  // Called from the connector's callback, which it returns from right away
+  connecting_.remove_if(
+      [connector](const std::unique_ptr<Connector>& c) {
+        return c.get() == connector;
+      });
+}
+
+void UpstreamPools::Upstream::onConnectSuccess(Connector* connector,
+                                               HTTPUpstreamSession* session) {
+  connectionsOpened_.fetch_add(1, std::memory_order_relaxed);
+  finishConnect(connector);
+  VLOG(4) << "Established " << *session;
+  if (getOptions().maxIdleSessions == 0) {
+    // Not pooling: the session serves the next waiter and closes after it
+    if (waiters_.empty()) {
+      session->drain();
+      return;
+    }
+    auto cb = waiters_.front();
+    waiters_.pop_front();
+    auto txn = session->newTransaction(cb->getUpstreamHandler());
+    session->drain();
+    cb->upstreamTransactionReady(txn);
+    return;
+  }
+  pool_.putSession(session);
+  serveWaiters();
+}
+
+void UpstreamPools::Upstream::onConnectError(
+    Connector* connector, const folly::AsyncSocketException& ex) {
+  finishConnect(connector);
+  LOG(ERROR) << "Failed to connect to " << addr_ << ": "
+             << folly::exceptionStr(ex);
+  // Fail as many waiters as there were connects for them
+  auto failed = waiters_.size() > connecting_.size()
+                    ? waiters_.size() - connecting_.size()
+                    : 0;
+  while (failed-- > 0 && !waiters_.empty()) {
+    auto cb = waiters_.back();
+    waiters_.pop_back();
+    cb->upstreamConnectError(ex);
+  }
+}
+
+void UpstreamPools::Upstream::serveWaiters() {
+  while (!waiters_.empty()) {
+    auto cb = waiters_.front();
+    auto txn = pool_.getTransaction(cb->getUpstreamHandler());
+    if (!txn) {
+      break;
+    }
+    waiters_.pop_front();
+    cb->upstreamTransactionReady(txn);
+  }
+  maybeConnect();
+}
+
+}
@@ -0,0 +1,152 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/http/HTTPConnector.h>
+#include <proxygen/lib/http/connpool/Endpoint.h>
+#include <proxygen/lib/http/connpool/SessionPool.h>
+#include <proxygen/lib/utils/RendezvousHash.h>
+
+#include <atomic>
+#include <list>
+#include <unordered_map>
+
+namespace ProxyService {
+
+/**
+ * One worker's connections to its upstreams: a SessionPool per upstream
+ * endpoint, and the connects in flight to grow them.  Requests for an
+ * upstream with no session able to take another transaction wait for the
+ * next connection to that upstream to come up.  HTTP/2 upstreams multiplex
+ * every request over a few connections, HTTP/1.1 ones get a connection per
+ * concurrent request, kept idle for reuse.
+ *
+ * Must be created and used in the worker's EventBase thread.
+ */
+class UpstreamPools {
+ public:
+  struct Options {
+    // Fixed upstreams requests are spread over, by rendezvous hash of their
+    // URL.  When empty, requests go to the host in their URL.
+    std::vector<folly::SocketAddress> upstreams;
+    // Speak HTTP/2 with prior knowledge rather than HTTP/1.1, only for
+    // upstreams known to accept it
+    bool h2{false};
+    // Idle sessions kept per upstream.  0 disables pooling: every request
+    // gets a new connection that is closed after its response.
+    uint32_t maxIdleSessions{8};
+    std::chrono::milliseconds idleTimeout{60000};
+    std::chrono::milliseconds connectTimeout{1000};
+  };
+
+  class Callback {
+   public:
+    virtual ~Callback() {
+    }
+    virtual proxygen::HTTPTransaction::Handler* getUpstreamHandler()
+        noexcept = 0;
+    virtual void upstreamTransactionReady(
+        proxygen::HTTPTransaction* txn) noexcept = 0;
+    virtual void upstreamConnectError(
+        const folly::AsyncSocketException& ex) noexcept = 0;
+  };
+
+  UpstreamPools(folly::HHWheelTimer* timer, Options options);
+
+  /**
+   * The configured upstream for a request with the given key, none if no
+   * upstreams are configured.
+   */
+  folly::Optional<folly::SocketAddress> selectUpstream(uint64_t key) const;
+
+  /**
+   * Open a transaction to addr for cb, on a pooled session if one can take
+   * it, or once a new connection is up.  cb may be called before this
+   * returns.
+   */
+  void getTransaction(const folly::SocketAddress& addr, Callback* cb);
+
+  /**
+   * Stop waiting for a transaction for cb
+   */
+  void cancel(Callback* cb);
+
+  /**
+   * Upstream connections opened by every worker in the process
+   */
+  static uint64_t getConnectionsOpened() {
+    return connectionsOpened_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  class Upstream;
+
+  class Connector : public proxygen::HTTPConnector::Callback {
+   public:
+    Connector(Upstream& upstream, folly::HHWheelTimer* timer);
+
+    void connect();
+
+   private:
+    void connectSuccess(proxygen::HTTPUpstreamSession* session) override;
+    void connectError(const folly::AsyncSocketException& ex) override;
+
+    Upstream& upstream_;
+    proxygen::HTTPConnector connector_;
+  };
+
+  class Upstream {
+   public:
+    Upstream(UpstreamPools& parent, const folly::SocketAddress& addr);
+
+    void getTransaction(Callback* cb);
+    void cancel(Callback* cb);
+
+    void onConnectSuccess(Connector* connector,
+                          proxygen::HTTPUpstreamSession* session);
+    void onConnectError(Connector* connector,
+                        const folly::AsyncSocketException& ex);
+
+    const folly::SocketAddress& getAddress() const {
+      return addr_;
+    }
+
+    const Options& getOptions() const {
+      return parent_.options_;
+    }
+
+   private:
+    void serveWaiters();
+    void maybeConnect();
+    void finishConnect(Connector* connector);
+
+    UpstreamPools& parent_;
+    folly::SocketAddress addr_;
+    proxygen::SessionPool pool_;
+    std::list<Callback*> waiters_;
+    std::list<std::unique_ptr<Connector>> connecting_;
+  };
+
+  folly::HHWheelTimer* timer_;
+  Options options_;
+  proxygen::RendezvousHash hash_;
+  std::unordered_map<proxygen::Endpoint,
+                     std::unique_ptr<Upstream>,
+                     proxygen::EndpointHash,
+                     proxygen::EndpointEqual>
+      upstreams_;
+
+  static std::atomic<uint64_t> connectionsOpened_;
+};
+
+}
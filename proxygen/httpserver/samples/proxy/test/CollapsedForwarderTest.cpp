@@ -0,0 +1,334 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/samples/proxy/CollapsedForwarder.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/samples/proxy/ProxyStats.h>
+#include <proxygen/lib/http/codec/test/TestUtils.h>
+
+using namespace ProxyService;
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+/**
+ * An origin the test answers by hand, with raw HTTP/1.1 written to each
+ * accepted connection
+ */
+class FakeOrigin : public folly::AsyncServerSocket::AcceptCallback {
+ public:
+  class Connection : public folly::AsyncTransportWrapper::ReadCallback {
+   public:
+    Connection(folly::EventBase* evb, folly::NetworkSocket fd)
+        : socket(folly::AsyncSocket::newSocket(evb, fd)) {
+      socket->setReadCB(this);
+    }
+
+    void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+      *bufReturn = buf_;
+      *lenReturn = sizeof(buf_);
+    }
+
+    void readDataAvailable(size_t len) noexcept override {
+      received.append(buf_, len);
+    }
+
+    void readEOF() noexcept override {
+    }
+
+    void readErr(const folly::AsyncSocketException&) noexcept override {
+    }
+
+    bool hasRequest() const {
+      return received.find("\r\n\r\n") != std::string::npos;
+    }
+
+    void respond(const std::string& data) {
+      socket->writeChain(nullptr, folly::IOBuf::copyBuffer(data));
+    }
+
+    folly::AsyncSocket::UniquePtr socket;
+    std::string received;
+
+   private:
+    char buf_[4096];
+  };
+
+  explicit FakeOrigin(folly::EventBase* evb) : evb_(evb) {
+    server_ = folly::AsyncServerSocket::newSocket(evb);
+    server_->bind(folly::SocketAddress("127.0.0.1", 0));
+    server_->listen(16);
+    server_->getAddress(&addr_);
+    server_->addAcceptCallback(this, evb);
+    server_->startAccepting();
+  }
+
+  ~FakeOrigin() override {
+    server_->stopAccepting();
+  }
+
+  void connectionAccepted(folly::NetworkSocket fd,
+                          const folly::SocketAddress&) noexcept override {
+    connections.push_back(std::make_unique<Connection>(evb_, fd));
+  }
+
+  void acceptError(const std::exception&) noexcept override {
+  }
+
+  const folly::SocketAddress& getAddress() const {
+    return addr_;
+  }
+
+  // Whether connection i is up and has sent its request
+  bool hasRequest(size_t i) const {
+    return connections.size() > i && connections[i]->hasRequest();
+  }
+
+  std::vector<std::unique_ptr<Connection>> connections;
+
+ private:
+  folly::EventBase* evb_;
+  std::shared_ptr<folly::AsyncServerSocket> server_;
+  folly::SocketAddress addr_;
+};
+
+class FakeWaiter : public CollapsedForwarder::Waiter {
+ public:
+  using Waiter::getFlight;
+
+  void onCollapsedHeaders(const HTTPMessage& msg) noexcept override {
+    statuses.push_back(msg.getStatusCode());
+  }
+
+  void onCollapsedBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    body += chain->moveToFbString().toStdString();
+  }
+
+  void onCollapsedTrailers(const HTTPHeaders& trailers) noexcept override {
+    checksum = trailers.getSingleOrEmpty("X-Checksum");
+  }
+
+  void onCollapsedEOM() noexcept override {
+    eom = true;
+  }
+
+  void onCollapsedError() noexcept override {
+    error = true;
+  }
+
+  void onCollapseRejected() noexcept override {
+    rejected = true;
+  }
+
+  std::vector<uint16_t> statuses;
+  std::string body;
+  std::string checksum;
+  bool eom{false};
+  bool error{false};
+  bool rejected{false};
+};
+
+}
+
+class CollapsedForwarderTest : public testing::Test {
+ public:
+  void SetUp() override {
+    // Upstream connects come from the thread's EventBase
+    evb_ = folly::EventBaseManager::get()->getEventBase();
+    timer_ = folly::HHWheelTimer::newTimer(
+        evb_,
+        std::chrono::milliseconds(folly::HHWheelTimer::DEFAULT_TICK_INTERVAL),
+        folly::AsyncTimeout::InternalEnum::INTERNAL,
+        std::chrono::milliseconds(1000));
+    origin_ = std::make_unique<FakeOrigin>(evb_);
+    pools_ = std::make_unique<UpstreamPools>(timer_.get(),
+                                             UpstreamPools::Options());
+    forwarder_ = std::make_unique<CollapsedForwarder>(
+        pools_.get(), &stats_, std::vector<std::string>());
+  }
+
+  void TearDown() override {
+    for (auto waiter : joined_) {
+      if (waiter->getFlight()) {
+        waiter->getFlight()->removeWaiter(waiter);
+      }
+    }
+    forwarder_.reset();
+    pools_.reset();
+    origin_.reset();
+    evb_->loopOnce(EVLOOP_NONBLOCK);
+  }
+
+ protected:
+  void join(FakeWaiter* waiter,
+            const HTTPMessage& request = getGetRequest("/asset")) {
+    joined_.push_back(waiter);
+    forwarder_->join(origin_->getAddress(), request, waiter);
+  }
+
+  template <typename F>
+  void loopUntil(F done) {
+    while (!done()) {
+      evb_->loopOnce();
+    }
+  }
+
+  folly::EventBase* evb_{nullptr};
+  folly::HHWheelTimer::UniquePtr timer_;
+  std::unique_ptr<FakeOrigin> origin_;
+  std::unique_ptr<UpstreamPools> pools_;
+  ProxyStats stats_;
+  std::unique_ptr<CollapsedForwarder> forwarder_;
+  std::vector<FakeWaiter*> joined_;
+};
+
+TEST_F(CollapsedForwarderTest, FanOut) {
+  FakeWaiter leader;
+  FakeWaiter follower;
+  auto saved = CollapsedForwarder::getOriginRequestsSaved();
+  join(&leader);
+  join(&follower);
+  EXPECT_EQ(stats_.getCollapsedLeaders(), 1);
+  EXPECT_EQ(stats_.getCollapsedFollowers(), 1);
+
+  loopUntil([&] { return origin_->hasRequest(0); });
+  origin_->connections[0]->respond(
+      "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello");
+  loopUntil([&] { return leader.eom && follower.eom; });
+
+  for (auto waiter : {&leader, &follower}) {
+    EXPECT_EQ(waiter->statuses, std::vector<uint16_t>({200}));
+    EXPECT_EQ(waiter->body, "hello");
+    EXPECT_FALSE(waiter->error);
+  }
+  EXPECT_EQ(origin_->connections.size(), 1);
+  EXPECT_EQ(CollapsedForwarder::getOriginRequestsSaved(), saved + 1);
+}
+
+TEST_F(CollapsedForwarderTest, FollowerAfterHeadersStartsOwnFlight) {
+  FakeWaiter leader;
+  FakeWaiter late;
+  join(&leader);
+  loopUntil([&] { return origin_->hasRequest(0); });
+  origin_->connections[0]->respond(
+      "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nhello");
+  loopUntil([&] { return leader.body == "hello"; });
+
+  // The first flight has its headers, so this one goes to the origin too
+  join(&late);
+  EXPECT_EQ(stats_.getCollapsedLeaders(), 2);
+  EXPECT_EQ(stats_.getCollapsedFollowers(), 0);
+  loopUntil([&] { return origin_->hasRequest(1); });
+  origin_->connections[1]->respond(
+      "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nnew");
+  origin_->connections[0]->respond("world");
+  loopUntil([&] { return leader.eom && late.eom; });
+
+  EXPECT_EQ(leader.body, "helloworld");
+  EXPECT_EQ(late.body, "new");
+}
+
+TEST_F(CollapsedForwarderTest, LeaderErrorReachesFollowers) {
+  FakeWaiter leader;
+  FakeWaiter follower;
+  join(&leader);
+  join(&follower);
+  loopUntil([&] { return origin_->hasRequest(0); });
+  origin_->connections[0]->respond(
+      "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nhello");
+  loopUntil([&] { return follower.body == "hello"; });
+
+  // The origin goes away mid body
+  origin_->connections[0]->socket->closeNow();
+  loopUntil([&] { return leader.error && follower.error; });
+
+  EXPECT_FALSE(leader.eom);
+  EXPECT_FALSE(follower.eom);
+  EXPECT_EQ(leader.getFlight(), nullptr);
+  EXPECT_EQ(follower.getFlight(), nullptr);
+}
+
+TEST_F(CollapsedForwarderTest, InformationalResponse) {
+  FakeWaiter leader;
+  FakeWaiter follower;
+  join(&leader);
+  loopUntil([&] { return origin_->hasRequest(0); });
+  origin_->connections[0]->respond(
+      "HTTP/1.1 103 Early Hints\r\nLink: </style.css>\r\n\r\n");
+  loopUntil([&] { return !leader.statuses.empty(); });
+
+  // Still waiting on the final response, so the flight takes followers
+  join(&follower);
+  EXPECT_EQ(stats_.getCollapsedFollowers(), 1);
+  origin_->connections[0]->respond(
+      "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+  loopUntil([&] { return leader.eom && follower.eom; });
+
+  EXPECT_EQ(leader.statuses, std::vector<uint16_t>({103, 200}));
+  EXPECT_EQ(follower.statuses, std::vector<uint16_t>({200}));
+  EXPECT_EQ(leader.body, "ok");
+  EXPECT_EQ(follower.body, "ok");
+}
+
+TEST_F(CollapsedForwarderTest, Trailers) {
+  FakeWaiter leader;
+  FakeWaiter follower;
+  join(&leader);
+  join(&follower);
+  // The follower's share is queued until it resumes
+  follower.getFlight()->pauseWaiter(&follower);
+  loopUntil([&] { return origin_->hasRequest(0); });
+  origin_->connections[0]->respond(
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "5\r\nhello\r\n0\r\nX-Checksum: abc\r\n\r\n");
+  loopUntil([&] { return leader.eom; });
+
+  EXPECT_EQ(leader.body, "hello");
+  EXPECT_EQ(leader.checksum, "abc");
+  EXPECT_TRUE(follower.body.empty());
+  EXPECT_TRUE(follower.checksum.empty());
+
+  follower.getFlight()->resumeWaiter(&follower);
+  EXPECT_EQ(follower.body, "hello");
+  EXPECT_EQ(follower.checksum, "abc");
+  EXPECT_TRUE(follower.eom);
+}
+
+TEST_F(CollapsedForwarderTest, ConditionalNotSharedWithUnconditional) {
+  FakeWaiter leader;
+  FakeWaiter follower;
+  auto conditional = getGetRequest("/asset");
+  conditional.getHeaders().set(HTTP_HEADER_IF_NONE_MATCH, "\"v1\"");
+  join(&leader, conditional);
+  // The follower wants the full response, not the leader's 304
+  join(&follower);
+  EXPECT_EQ(stats_.getCollapsedLeaders(), 2);
+  EXPECT_EQ(stats_.getCollapsedFollowers(), 0);
+
+  loopUntil([&] { return origin_->hasRequest(0) && origin_->hasRequest(1); });
+  for (auto& connection : origin_->connections) {
+    if (connection->received.find("If-None-Match") != std::string::npos) {
+      connection->respond("HTTP/1.1 304 Not Modified\r\nETag: \"v1\"\r\n\r\n");
+    } else {
+      connection->respond(
+          "HTTP/1.1 200 OK\r\nETag: \"v2\"\r\nContent-Length: 5\r\n\r\n"
+          "hello");
+    }
+  }
+  loopUntil([&] { return leader.eom && follower.eom; });
+
+  EXPECT_EQ(leader.statuses, std::vector<uint16_t>({304}));
+  EXPECT_TRUE(leader.body.empty());
+  EXPECT_EQ(follower.statuses, std::vector<uint16_t>({200}));
+  EXPECT_EQ(follower.body, "hello");
+}
@@ -0,0 +1,218 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/httpserver/samples/proxy/LocalUpstream.h>
+#include <proxygen/httpserver/samples/proxy/ProxyHandlerFactory.h>
+#include <proxygen/lib/http/HTTPConnector.h>
+#include <proxygen/lib/http/codec/HTTP2Constants.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+
+using namespace folly;
+using namespace proxygen;
+using namespace ProxyService;
+
+DEFINE_int32(threads, 4, "Worker threads of the proxy and of the upstream");
+DEFINE_int32(concurrency, 64, "Requests the client keeps outstanding");
+DEFINE_int32(body_size, 1024, "Response body size of the upstream");
+DEFINE_int32(hot_urls, 4, "Distinct URLs the HotURLs cases request");
+
+// Each iteration is one GET proxied over a single HTTP/2 client connection
+// to a local stand-in upstream, so iters/s is proxied requests/s.
+// upstream_conns is the number of connections the proxy opened to the
+// upstream for the whole run.  The HotURLs cases spread requests over only
+// hot_urls URLs, and origin_saved counts the requests collapsed forwarding
+// answered without going upstream.
+
+namespace {
+
+class Client : private HTTPConnector::Callback {
+ public:
+  // With urls of 0 every request is for a different URL
+  Client(const SocketAddress& proxy, uint32_t requests, uint32_t urls)
+      : proxy_(proxy),
+        requests_(requests),
+        urls_(urls),
+        timer_(HHWheelTimer::newTimer(&evb_)),
+        connector_(this, timer_.get()) {
+    connector_.setPlaintextProtocol(http2::kProtocolString);
+  }
+
+  // Returns the number of requests that failed
+  uint32_t run() {
+    connector_.connect(&evb_, proxy_, std::chrono::seconds(5));
+    evb_.loop();
+    return errors_;
+  }
+
+ private:
+  class ResponseHandler : public HTTPTransactionHandler {
+   public:
+    explicit ResponseHandler(Client& client) : client_(client) {
+    }
+
+    void setTransaction(HTTPTransaction* /*txn*/) noexcept override {
+    }
+    void detachTransaction() noexcept override {
+      delete this;
+    }
+    void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept
+        override {
+      ok_ = msg->getStatusCode() == 200;
+    }
+    void onBody(std::unique_ptr<folly::IOBuf> /*chain*/) noexcept override {
+    }
+    void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept
+        override {
+    }
+    void onEOM() noexcept override {
+      client_.onResponseDone(ok_);
+    }
+    void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+    }
+    void onError(const HTTPException& /*error*/) noexcept override {
+      client_.onResponseDone(false);
+    }
+    void onEgressPaused() noexcept override {
+    }
+    void onEgressResumed() noexcept override {
+    }
+
+   private:
+    Client& client_;
+    bool ok_{false};
+  };
+
+  void connectSuccess(HTTPUpstreamSession* session) override {
+    session_ = session;
+    for (int32_t i = 0; i < FLAGS_concurrency; i++) {
+      sendRequest();
+    }
+  }
+
+  void connectError(const folly::AsyncSocketException& ex) override {
+    LOG(FATAL) << "Failed to connect to the proxy: " << exceptionStr(ex);
+  }
+
+  void sendRequest() {
+    if (sent_ == requests_) {
+      return;
+    }
+    sent_++;
+    auto txn = session_->newTransaction(new ResponseHandler(*this));
+    CHECK(txn);
+    HTTPMessage req;
+    req.setMethod(HTTPMethod::GET);
+    req.setURL(folly::to<std::string>("/", urls_ ? sent_ % urls_ : sent_));
+    req.getHeaders().add(HTTP_HEADER_HOST, "localhost");
+    txn->sendHeaders(req);
+    txn->sendEOM();
+  }
+
+  void onResponseDone(bool ok) {
+    if (!ok) {
+      errors_++;
+    }
+    if (++done_ == requests_) {
+      session_->drain();
+    } else {
+      sendRequest();
+    }
+  }
+
+  EventBase evb_;
+  SocketAddress proxy_;
+  uint32_t requests_;
+  uint32_t urls_;
+  uint32_t sent_{0};
+  uint32_t done_{0};
+  uint32_t errors_{0};
+  HHWheelTimer::UniquePtr timer_;
+  HTTPConnector connector_;
+  HTTPUpstreamSession* session_{nullptr};
+};
+
+void proxiedRequests(UserCounters& counters,
+                     uint32_t iters,
+                     HTTPServer::Protocol upstreamProtocol,
+                     uint32_t maxIdleSessions,
+                     uint32_t urls = 0,
+                     bool collapse = false) {
+  std::unique_ptr<ScopedHTTPServer> upstream;
+  std::unique_ptr<ScopedHTTPServer> proxy;
+  uint64_t connsBefore = 0;
+  uint64_t savedBefore = 0;
+  BENCHMARK_SUSPEND {
+    upstream = startLocalUpstream(
+        0, upstreamProtocol, FLAGS_body_size, FLAGS_threads);
+
+    UpstreamPools::Options upstreamOptions;
+    upstreamOptions.upstreams.emplace_back("127.0.0.1", upstream->getPort());
+    upstreamOptions.h2 = upstreamProtocol == HTTPServer::Protocol::HTTP2;
+    upstreamOptions.maxIdleSessions = maxIdleSessions;
+    HTTPServerOptions options;
+    options.threads = FLAGS_threads;
+    options.handlerFactories =
+        RequestHandlerChain()
+            .addThen<ProxyHandlerFactory>(
+                std::move(upstreamOptions),
+                std::chrono::seconds(60),
+                collapse,
+                std::vector<std::string>{"Accept-Encoding"})
+            .build();
+    proxy = ScopedHTTPServer::start(
+        {SocketAddress("127.0.0.1", 0), HTTPServer::Protocol::HTTP2},
+        std::move(options));
+    connsBefore = UpstreamPools::getConnectionsOpened();
+    savedBefore = CollapsedForwarder::getOriginRequestsSaved();
+  }
+  Client client(SocketAddress("127.0.0.1", proxy->getPort()), iters, urls);
+  auto errors = client.run();
+  BENCHMARK_SUSPEND {
+    counters["upstream_conns"] =
+        int(UpstreamPools::getConnectionsOpened() - connsBefore);
+    counters["errors"] = int(errors);
+    counters["origin_saved"] =
+        int(CollapsedForwarder::getOriginRequestsSaved() - savedBefore);
+    proxy.reset();
+    upstream.reset();
+  }
+}
+}
+
+BENCHMARK_COUNTERS(ConnectionPerRequest, counters, iters) {
+  proxiedRequests(counters, iters, HTTPServer::Protocol::HTTP, 0);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(PooledHTTP11, counters, iters) {
+  proxiedRequests(counters, iters, HTTPServer::Protocol::HTTP, 8);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(PooledH2, counters, iters) {
+  proxiedRequests(counters, iters, HTTPServer::Protocol::HTTP2, 8);
+}
+
+BENCHMARK_COUNTERS(HotURLs, counters, iters) {
+  proxiedRequests(
+      counters, iters, HTTPServer::Protocol::HTTP2, 8, FLAGS_hot_urls);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(HotURLsCollapsed, counters, iters) {
+  proxiedRequests(
+      counters, iters, HTTPServer::Protocol::HTTP2, 8, FLAGS_hot_urls, true);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/httpserver/samples/proxy/UpstreamPools.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/test/HTTPSessionMocks.h>
+
+using namespace ProxyService;
+using namespace proxygen;
+using namespace testing;
+
+class FakeUpstreamCallback : public UpstreamPools::Callback {
+ public:
+  ~FakeUpstreamCallback() override {
+    if (txn) {
+      txn->sendAbort();
+    }
+  }
+
+  HTTPTransaction::Handler* getUpstreamHandler() noexcept override {
+    return &handler;
+  }
+
+  void upstreamTransactionReady(HTTPTransaction* t) noexcept override {
+    txn = t;
+  }
+
+  void upstreamConnectError(
+      const folly::AsyncSocketException& /*ex*/) noexcept override {
+    connectError = true;
+  }
+
+  NiceMock<MockHTTPHandler> handler;
+  HTTPTransaction* txn{nullptr};
+  bool connectError{false};
+};
+
+class UpstreamPoolsTest : public testing::Test {
+ public:
+  void SetUp() override {
+    // The pools connect from the thread's EventBase
+    evb_ = folly::EventBaseManager::get()->getEventBase();
+    timer_ = folly::HHWheelTimer::newTimer(
+        evb_,
+        std::chrono::milliseconds(folly::HHWheelTimer::DEFAULT_TICK_INTERVAL),
+        folly::AsyncTimeout::InternalEnum::INTERNAL,
+        std::chrono::milliseconds(1000));
+    // Never accepts, the kernel completes the handshakes into the backlog
+    server_ = folly::AsyncServerSocket::newSocket(evb_);
+    server_->bind(folly::SocketAddress("127.0.0.1", 0));
+    server_->listen(16);
+    server_->getAddress(&serverAddr_);
+    options_.upstreams.push_back(serverAddr_);
+  }
+
+  void TearDown() override {
+    callbacks_.clear();
+    pools_.reset();
+    server_.reset();
+    evb_->loopOnce(EVLOOP_NONBLOCK);
+  }
+
+ protected:
+  void makePools() {
+    pools_ = std::make_unique<UpstreamPools>(timer_.get(), options_);
+  }
+
+  FakeUpstreamCallback* getTransaction(const folly::SocketAddress& addr) {
+    callbacks_.push_back(std::make_unique<FakeUpstreamCallback>());
+    pools_->getTransaction(addr, callbacks_.back().get());
+    return callbacks_.back().get();
+  }
+
+  template <typename F>
+  void loopUntil(F done) {
+    while (!done()) {
+      evb_->loopOnce();
+    }
+  }
+
+  folly::EventBase* evb_{nullptr};
+  folly::HHWheelTimer::UniquePtr timer_;
+  std::shared_ptr<folly::AsyncServerSocket> server_;
+  folly::SocketAddress serverAddr_;
+  UpstreamPools::Options options_;
+  std::unique_ptr<UpstreamPools> pools_;
+  std::vector<std::unique_ptr<FakeUpstreamCallback>> callbacks_;
+};
+
+TEST_F(UpstreamPoolsTest, H2WaitersShareOneConnection) {
+  options_.h2 = true;
+  makePools();
+  auto opened = UpstreamPools::getConnectionsOpened();
+
+  auto cb1 = getTransaction(serverAddr_);
+  auto cb2 = getTransaction(serverAddr_);
+  auto cb3 = getTransaction(serverAddr_);
+  EXPECT_EQ(cb1->txn, nullptr);
+  loopUntil([&] { return cb1->txn && cb2->txn && cb3->txn; });
+
+  EXPECT_EQ(UpstreamPools::getConnectionsOpened(), opened + 1);
+  EXPECT_EQ(&cb1->txn->getTransport(), &cb3->txn->getTransport());
+
+  // Later requests go straight to the pooled session
+  auto cb4 = getTransaction(serverAddr_);
+  EXPECT_NE(cb4->txn, nullptr);
+  EXPECT_EQ(UpstreamPools::getConnectionsOpened(), opened + 1);
+}
+
+TEST_F(UpstreamPoolsTest, H1WaitersGetAConnectionEach) {
+  makePools();
+  auto opened = UpstreamPools::getConnectionsOpened();
+
+  auto cb1 = getTransaction(serverAddr_);
+  auto cb2 = getTransaction(serverAddr_);
+  loopUntil([&] { return cb1->txn && cb2->txn; });
+
+  EXPECT_EQ(UpstreamPools::getConnectionsOpened(), opened + 2);
+  EXPECT_NE(&cb1->txn->getTransport(), &cb2->txn->getTransport());
+}
+
+TEST_F(UpstreamPoolsTest, ConnectErrorFailsWaiters) {
+  makePools();
+  // Nothing listens on the port once the socket bound to it is closed
+  folly::SocketAddress closedAddr;
+  {
+    auto closed = folly::AsyncServerSocket::newSocket(evb_);
+    closed->bind(folly::SocketAddress("127.0.0.1", 0));
+    closed->getAddress(&closedAddr);
+  }
+  auto opened = UpstreamPools::getConnectionsOpened();
+
+  auto cb1 = getTransaction(closedAddr);
+  auto cb2 = getTransaction(closedAddr);
+  loopUntil([&] { return cb1->connectError && cb2->connectError; });
+
+  EXPECT_EQ(cb1->txn, nullptr);
+  EXPECT_EQ(cb2->txn, nullptr);
+  EXPECT_EQ(UpstreamPools::getConnectionsOpened(), opened);
+}
+
+TEST_F(UpstreamPoolsTest, CancelledWaiterIsNotServed) {
+  makePools();
+  auto opened = UpstreamPools::getConnectionsOpened();
+
+  auto cb1 = getTransaction(serverAddr_);
+  auto cb2 = getTransaction(serverAddr_);
+  // As ProxyHandler does when its client goes away mid connect
+  pools_->cancel(cb1);
+  loopUntil([&] {
+    return UpstreamPools::getConnectionsOpened() == opened + 2;
+  });
+
+  EXPECT_EQ(cb1->txn, nullptr);
+  EXPECT_FALSE(cb1->connectError);
+  EXPECT_NE(cb2->txn, nullptr);
+}
@@ -0,0 +1,181 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <boost/thread.hpp>
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/Sockets.h>
+#include <proxygen/httpserver/HTTPServer.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+
+using namespace folly;
+using namespace proxygen;
+
+DEFINE_int32(threads, 4, "Number of server worker threads");
+DEFINE_int32(clients, 8, "Number of client threads opening connections");
+
+// Each iteration is one TCP connection, so iters/s is accepts/s.  Accept
+// latency is measured from just before the client's connect() to the server
+// acceptor seeing the connection, which includes the time it waited in the
+// listen queue.
+
+namespace {
+
+// Indexed by the client's local port
+std::array<std::atomic<int64_t>, 65536> gConnectStartNs;
+std::array<std::atomic<int64_t>, 65536> gAcceptLatencyNs;
+std::atomic<uint64_t> gAccepted{0};
+
+int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class BenchServer {
+ public:
+  explicit BenchServer(bool perWorkerListeners) {
+    HTTPServerOptions options;
+    options.threads = FLAGS_threads;
+    options.listenBacklog = 4096;
+    options.perWorkerListeners = perWorkerListeners;
+    options.newConnectionFilter =
+        [](const folly::AsyncTransportWrapper* /* sock */,
+           const folly::SocketAddress* address,
+           const std::string& /* nextProtocolName */,
+           wangle::SecureTransportType /* secureTransportType */,
+           const wangle::TransportInfo& /* tinfo */) {
+          auto port = address->getPort();
+          gAcceptLatencyNs[port] = nowNs() - gConnectStartNs[port];
+          gAccepted++;
+        };
+    server_ = std::make_unique<HTTPServer>(std::move(options));
+    std::vector<HTTPServer::IPConfig> ips{
+      {folly::SocketAddress("127.0.0.1", 0), HTTPServer::Protocol::HTTP}};
+    server_->bind(ips);
+    thread_ = std::thread([this] {
+      server_->start([this] { barrier_.wait(); });
+    });
+    barrier_.wait();
+    folly::SocketAddress addr;
+    addr.setFromLocalAddress(
+        folly::NetworkSocket::fromFd(server_->getListenSocket()));
+    port_ = addr.getPort();
+  }
+
+  ~BenchServer() {
+    server_->stop();
+    thread_.join();
+  }
+
+  uint16_t getPort() const {
+    return port_;
+  }
+
+ private:
+  boost::barrier barrier_{2};
+  std::unique_ptr<HTTPServer> server_;
+  std::thread thread_;
+  uint16_t port_{0};
+};
+
+// Connect and immediately reset, recording the local port used
+void connectLoop(uint16_t serverPort, uint32_t count,
+                 std::vector<uint16_t>& ports) {
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(serverPort);
+  server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  for (uint32_t i = 0; i < count; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK_GE(fd, 0);
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK_EQ(0, bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)));
+    socklen_t len = sizeof(local);
+    CHECK_EQ(0, getsockname(fd, reinterpret_cast<sockaddr*>(&local), &len));
+    auto port = ntohs(local.sin_port);
+    gConnectStartNs[port] = nowNs();
+    if (connect(fd, reinterpret_cast<sockaddr*>(&server),
+                sizeof(server)) == 0) {
+      ports.push_back(port);
+    }
+    // RST instead of FIN so client ports do not pile up in TIME_WAIT
+    linger lin{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+    close(fd);
+  }
+}
+
+void acceptRate(UserCounters& counters, uint32_t iters,
+                bool perWorkerListeners) {
+  std::unique_ptr<BenchServer> server;
+  BENCHMARK_SUSPEND {
+    server = std::make_unique<BenchServer>(perWorkerListeners);
+    gAccepted = 0;
+  }
+  uint32_t numClients = FLAGS_clients;
+  std::vector<std::vector<uint16_t>> ports(numClients);
+  std::vector<std::thread> clients;
+  for (uint32_t c = 0; c < numClients; c++) {
+    auto count = iters / numClients + (c < iters % numClients ? 1 : 0);
+    clients.emplace_back([&, c, count] {
+      connectLoop(server->getPort(), count, ports[c]);
+    });
+  }
+  for (auto& client : clients) {
+    client.join();
+  }
+  size_t connected = 0;
+  for (auto& p : ports) {
+    connected += p.size();
+  }
+  // Wait for the server to drain its accept queues
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (gAccepted < connected &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+  BENCHMARK_SUSPEND {
+    std::vector<int64_t> latencies;
+    for (auto& p : ports) {
+      for (auto port : p) {
+        latencies.push_back(gAcceptLatencyNs[port]);
+      }
+    }
+    if (!latencies.empty()) {
+      std::sort(latencies.begin(), latencies.end());
+      counters["accept_p50_us"] = int(latencies[latencies.size() / 2] / 1000);
+      counters["accept_p99_us"] =
+          int(latencies[latencies.size() * 99 / 100] / 1000);
+    }
+    counters["not_accepted"] = int(connected - std::min<uint64_t>(
+        gAccepted, connected));
+    server.reset();
+  }
+}
+}
+
+BENCHMARK_COUNTERS(AcceptorThread, counters, iters) {
+  acceptRate(counters, iters, false);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(PerWorkerListeners, counters, iters) {
+  acceptRate(counters, iters, true);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
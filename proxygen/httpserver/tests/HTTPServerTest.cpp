@@ -14,11 +14,13 @@
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <folly/io/async/AsyncServerSocket.h>
 #include <folly/io/async/EventBaseManager.h>
+#include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 #include <folly/ssl/OpenSSLCertUtils.h>
 #include <proxygen/httpclient/samples/curl/CurlClient.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
 #include <proxygen/httpserver/ScopedHTTPServer.h>
+#include <proxygen/httpserver/WorkerThreadLayout.h>
 #include <proxygen/lib/http/HTTPConnector.h>
 #include <proxygen/lib/utils/TestUtils.h>
 #include <wangle/client/ssl/SSLSession.h>
@@ -721,6 +723,128 @@ TEST_F(ScopedServerTest, StartSSLWithInsecure) {
   EXPECT_EQ(200, resp->getStatusCode());
 }
 
+class PerWorkerListenerTest : public ScopedServerTest {
+ protected:
+  HTTPServerOptions createDefaultOpts() override {
+    auto options = ScopedServerTest::createDefaultOpts();
+    options.perWorkerListeners = true;
+    return options;
+  }
+};
+
+TEST_F(PerWorkerListenerTest, Start) {
+  auto server = createScopedServer();
+  // All workers share the ephemeral port the first one bound
+  EXPECT_NE(0, address_.getPort());
+  for (int i = 0; i < 8; i++) {
+    auto client = connectPlainText();
+    auto resp = client->getResponse();
+    ASSERT_NE(nullptr, resp);
+    EXPECT_EQ(200, resp->getStatusCode());
+  }
+}
+
+TEST(PerWorkerListener, SocketPerWorker) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.threads = 4;
+  options.perWorkerListeners = true;
+  options.handlerFactories =
+      RequestHandlerChain().addThen<TestHandlerFactory>().build();
+
+  auto server = std::make_unique<HTTPServer>(std::move(options));
+  auto st = std::make_unique<ServerThread>(server.get());
+  std::vector<HTTPServer::IPConfig> ips{cfg};
+  server->bind(ips);
+  EXPECT_TRUE(st->start());
+
+  EXPECT_EQ(4, server->getSockets().size());
+  EXPECT_NE(-1, server->getListenSocket());
+  EXPECT_NE(0, server->addresses()[0].address.getPort());
+
+  server->stopListening();
+  EXPECT_EQ(0, server->getSockets().size());
+  EXPECT_EQ(-1, server->getListenSocket());
+}
+
+TEST(PerWorkerListener, RejectsExistingSocket) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  HTTPServerOptions options;
+  options.perWorkerListeners = true;
+  options.useExistingSocket(
+      AsyncServerSocket::UniquePtr(new folly::AsyncServerSocket));
+
+  auto server = std::make_unique<HTTPServer>(std::move(options));
+  auto st = std::make_unique<ServerThread>(server.get());
+  std::vector<HTTPServer::IPConfig> ips{cfg};
+  server->bind(ips);
+  EXPECT_FALSE(st->start());
+}
+
+class InlineWorkerTest : public ScopedServerTest {
+ protected:
+  HTTPServerOptions createDefaultOpts() override {
+    auto options = ScopedServerTest::createDefaultOpts();
+    options.threads = 0;
+    return options;
+  }
+};
+
+TEST_F(InlineWorkerTest, Start) {
+  auto server = createScopedServer();
+  for (int i = 0; i < 4; i++) {
+    auto client = connectPlainText();
+    auto resp = client->getResponse();
+    ASSERT_NE(nullptr, resp);
+    EXPECT_EQ(200, resp->getStatusCode());
+  }
+}
+
+class PinnedWorkerTest : public ScopedServerTest {
+ protected:
+  HTTPServerOptions createDefaultOpts() override {
+    auto options = ScopedServerTest::createDefaultOpts();
+    options.pinWorkerThreads = true;
+    options.numaLocalArenas = true;
+    options.perWorkerListeners = true;
+    return options;
+  }
+};
+
+TEST_F(PinnedWorkerTest, Start) {
+  auto server = createScopedServer();
+  auto client = connectPlainText();
+  auto resp = client->getResponse();
+  ASSERT_NE(nullptr, resp);
+  EXPECT_EQ(200, resp->getStatusCode());
+}
+
+TEST(WorkerThreadLayout, ParseCpuList) {
+  EXPECT_THAT(WorkerThreadLayout::parseCpuList("0-3,8,10-11\n"),
+              ElementsAre(0, 1, 2, 3, 8, 10, 11));
+  EXPECT_THAT(WorkerThreadLayout::parseCpuList(""), ElementsAre());
+  EXPECT_THROW(WorkerThreadLayout::parseCpuList("3-1"),
+               std::invalid_argument);
+  EXPECT_THROW(WorkerThreadLayout::parseCpuList("a"), std::exception);
+}
+
+TEST(WorkerThreadLayout, MakeLayout) {
+  auto layout = WorkerThreadLayout::makeLayout(5, {2, 4});
+  ASSERT_EQ(5, layout.size());
+  std::vector<uint32_t> cpus;
+  for (auto& placement : layout) {
+    cpus.push_back(placement.cpu);
+  }
+  EXPECT_THAT(cpus, ElementsAre(2, 4, 2, 4, 2));
+
+  auto available = WorkerThreadLayout::getAvailableCpus();
+  for (size_t i = 1; i < available.size(); i++) {
+    EXPECT_LE(available[i - 1].numaNode, available[i].numaNode);
+  }
+}
+
 class ConnectionFilterTest : public ScopedServerTest {
  protected:
   HTTPServerOptions createDefaultOpts() override {
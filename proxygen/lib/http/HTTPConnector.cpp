@@ -16,6 +16,7 @@
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 #include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <proxygen/lib/utils/IoUringSocket.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 
 
@@ -66,7 +67,8 @@ void HTTPConnector::connect(
   DCHECK(!isBusy());
   transportInfo_ = wangle::TransportInfo();
   transportInfo_.secure = false;
-  auto sock = new AsyncSocket(eventBase);
+  auto sock = useIoUring_ ? new IoUringSocket(eventBase)
+                         : new AsyncSocket(eventBase);
   socket_.reset(sock);
   connectStart_ = getCurrentTime();
   sock->connect(this, connectAddr, timeoutMs.count(),
@@ -83,6 +83,14 @@ class HTTPConnector:
    */
   void setHTTPVersionOverride(bool enabled);
 
+  /**
+   * Plaintext connections use an IoUringSocket, which moves reads and writes
+   * to the EventBase's io_uring when the kernel supports it.
+   */
+  void setUseIoUring(bool enabled) {
+    useIoUring_ = enabled;
+  }
+
   /**
    * Begin the process of getting a plaintext connection to the server
    * specified by 'connectAddr'. This function immediately starts async
@@ -161,6 +169,7 @@ class HTTPConnector:
   std::string plaintextProtocol_;
   TimePoint connectStart_;
   std::unique_ptr<DefaultHTTPCodecFactory> httpCodecFactory_;
+  bool useIoUring_{false};
 };
 
 }
@@ -84,6 +84,17 @@ void HTTPHeaders::addFromCodec(const char* str, size_t len, string&& value) {
       folly::rtrimWhitespace(std::move(value)).toString());
 }
 
+void HTTPHeaders::addFromCodec(HTTPHeaderCode code,
+                               folly::StringPiece name,
+                               folly::StringPiece value) {
+  DCHECK(code != HTTP_HEADER_NONE);
+  codes_.push_back(code);
+  headerNames_.push_back((code == HTTP_HEADER_OTHER)
+      ? new string(name.data(), name.size())
+      : HTTPCommonHeaders::getPointerToHeaderName(code));
+  headerValues_.emplace_back(value.data(), value.size());
+}
+
 bool HTTPHeaders::exists(folly::StringPiece name) const {
   const HTTPHeaderCode code = HTTPCommonHeaders::hash(name.data(),
                                                       name.size());
@@ -113,6 +113,14 @@ class HTTPHeaders {
 
   void addFromCodec(const char* str, size_t len, std::string&& value);
 
+  /**
+   * Add a header whose code the codec already knows, without hashing name.
+   * name is only used when code is HTTP_HEADER_OTHER.
+   */
+  void addFromCodec(HTTPHeaderCode code,
+                    folly::StringPiece name,
+                    folly::StringPiece value);
+
   /**
    * For the header 'name', set its value to the single header 'value',
    * removing any other instances of this header.
@@ -21,6 +21,7 @@
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/HTTPHeaders.h>
 #include <proxygen/lib/http/HTTPMethod.h>
+#include <proxygen/lib/utils/FreeList.h>
 #include <proxygen/lib/utils/ParseURL.h>
 #include <proxygen/lib/utils/Time.h>
 #include <string>
@@ -36,7 +37,7 @@ namespace proxygen {
  *
  * All header names stored in this class are case-insensitive.
  */
-class HTTPMessage {
+class HTTPMessage : public FreeListAllocated<HTTPMessage> {
  public:
 
   enum WebSocketUpgrade {
@@ -59,9 +59,14 @@ void FlowControlFilter::setReceiveWindowSize(folly::IOBufQueue& writeBuf,
     VLOG(2) << "Failed setting conn-level recv window capacity to " << capacity;
     return;
   }
+  // Ack the bytes processed since the last update along with the growth,
+  // they would otherwise never be returned to the window
+  if (toAck_ > 0) {
+    CHECK(recvWindow_.free(toAck_));
+  }
   toAck_ += delta;
   if (toAck_ > 0) {
-    call_->generateWindowUpdate(writeBuf, 0, delta);
+    call_->generateWindowUpdate(writeBuf, 0, toAck_);
     toAck_ = 0;
   }
 }
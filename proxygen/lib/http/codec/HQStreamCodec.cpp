@@ -201,10 +201,11 @@ ParseResult HQStreamCodec::parsePushPromise(Cursor& cursor,
   return res;
 }
 
-void HQStreamCodec::onHeader(const folly::fbstring& name,
+void HQStreamCodec::onHeader(const HPACKHeaderName& name,
                              const folly::fbstring& value) {
   if (decodeInfo_.onHeader(name, value)) {
-    if (name == "user-agent" && userAgent_.empty()) {
+    if (name.getHeaderCode() == HTTP_HEADER_USER_AGENT &&
+        userAgent_.empty()) {
       userAgent_ = value.toStdString();
     }
   } else {
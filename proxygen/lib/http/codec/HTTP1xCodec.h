@@ -18,7 +18,9 @@
 
 namespace proxygen {
 
-class HTTP1xCodec : public HTTPCodec {
+class HTTP1xCodec
+    : public HTTPCodec,
+      public FreeListAllocated<HTTP1xCodec> {
  public:
   explicit HTTP1xCodec(TransportDirection direction,
                        bool forceUpstream1_1 = false);
@@ -599,10 +599,11 @@ folly::Optional<ErrorCode> HTTP2Codec::parseHeadersCheckConcurrentStreams(
   return folly::Optional<ErrorCode>();
 }
 
-void HTTP2Codec::onHeader(const folly::fbstring& name,
+void HTTP2Codec::onHeader(const HPACKHeaderName& name,
                           const folly::fbstring& value) {
   if (decodeInfo_.onHeader(name, value)) {
-    if (name == "user-agent" && userAgent_.empty()) {
+    if (name.getHeaderCode() == HTTP_HEADER_USER_AGENT &&
+        userAgent_.empty()) {
       userAgent_ = value.toStdString();
     }
   } else {
@@ -1285,7 +1286,8 @@ size_t HTTP2Codec::generateBody(folly::IOBufQueue& writeBuf,
                                    stream,
                                    padding,
                                    false,
-                                   reuseIOBufHeadroomForData_));
+                                   reuseIOBufHeadroomForData_,
+                                   dataFrameCoalesceThreshold_));
   }
 
   return written + generateHeaderCallbackWrapper(
@@ -1296,7 +1298,8 @@ size_t HTTP2Codec::generateBody(folly::IOBufQueue& writeBuf,
                                        stream,
                                        padding,
                                        eom,
-                                       reuseIOBufHeadroomForData_));
+                                       reuseIOBufHeadroomForData_,
+                                       dataFrameCoalesceThreshold_));
 }
 
 size_t HTTP2Codec::generateChunkHeader(folly::IOBufQueue& /*writeBuf*/,
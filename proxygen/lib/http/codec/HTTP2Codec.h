@@ -26,9 +26,10 @@ namespace proxygen {
  * An implementation of the framing layer for HTTP/2. Instances of this
  * class must not be used from multiple threads concurrently.
  */
-class HTTP2Codec: public HTTPParallelCodec, HPACK::StreamingCallback {
+class HTTP2Codec: public HTTPParallelCodec, HPACK::StreamingCallback,
+                  public FreeListAllocated<HTTP2Codec> {
 public:
-  void onHeader(const folly::fbstring& name,
+  void onHeader(const HPACKHeaderName& name,
                 const folly::fbstring& value) override;
   void onHeadersComplete(HTTPHeaderSize decodedSize, bool acknowledge) override;
   void onDecodeError(HPACK::DecodeError decodeError) override;
@@ -168,6 +169,13 @@ public:
     reuseIOBufHeadroomForData_ = enabled;
   }
 
+  // DATA frames with at most this many body bytes are copied in after their
+  // frame header rather than chained, so streams of small body chunks produce
+  // a few large buffers instead of many tiny ones.  0 (default) disables.
+  void setDataFrameCoalesceThreshold(uint32_t threshold) {
+    dataFrameCoalesceThreshold_ = threshold;
+  }
+
   void setHeaderIndexingStrategy(const HeaderIndexingStrategy* indexingStrat) {
     headerCodec_.setHeaderIndexingStrategy(indexingStrat);
   }
@@ -284,6 +292,7 @@ public:
   std::vector<StreamID> virtualPriorityNodes_;
   folly::Optional<uint32_t> pendingTableMaxSize_;
   bool reuseIOBufHeadroomForData_{true};
+  uint32_t dataFrameCoalesceThreshold_{0};
 
   // True if last parsed HEADERS frame was trailers.
   // Reset only when HEADERS frame is parsed, thus
@@ -29,6 +29,10 @@ static const uint64_t kZeroPad[32] = {0};
 
 static const bool kStrictPadding = true;
 
+// Buffer size allocated when coalescing small DATA frames.  Sized to stay in
+// a single allocation class while holding many small frames.
+const size_t kDataCoalesceAllocationSize = 4000;
+
 static_assert(sizeof(kZeroPad) == 256, "bad zero padding");
 
 void writePriorityBody(QueueAppender& appender,
@@ -613,13 +617,36 @@ writeData(IOBufQueue& queue,
           uint32_t stream,
           folly::Optional<uint8_t> padding,
           bool endStream,
-          bool reuseIOBufHeadroom) noexcept {
+          bool reuseIOBufHeadroom,
+          uint32_t coalesceThreshold) noexcept {
   DCHECK_NE(0, stream);
   uint8_t flags = 0;
   if (endStream) {
     flags |= END_STREAM;
   }
   const uint64_t dataLen = data ? data->computeChainDataLength() : 0;
+  if (dataLen > 0 && dataLen <= coalesceThreshold) {
+    // Make sure the header, body and padding all fit in the current tail
+    // buffer, allocating one big enough for several more small frames if not.
+    const size_t frameBytes = kFrameHeaderSize + dataLen +
+      (padding ? *padding + 1 : 0);
+    queue.preallocate(frameBytes,
+                      std::max(frameBytes, kDataCoalesceAllocationSize));
+    const auto frameLen = writeFrameHeader(queue,
+                                           dataLen,
+                                           FrameType::DATA,
+                                           flags,
+                                           stream,
+                                           padding,
+                                           folly::none,
+                                           nullptr,
+                                           false);
+    for (const auto& range : *data) {
+      queue.append(range.data(), range.size());
+    }
+    writePadding(queue, padding);
+    return kFrameHeaderSize + frameLen;
+  }
   // Caller must not exceed peer setting for MAX_FRAME_SIZE
   // TODO: look into using headroom from data to hold the frame header
   const auto frameLen = writeFrameHeader(queue,
@@ -395,6 +395,10 @@ parseCertificate(
  * @param endStream True iff this frame ends the stream.
  * @param reuseIOBufHeadroom If HTTP2Framer should reuse headroom in data if
  *                           headroom is enough for frame header
+ * @param coalesceThreshold If data is no longer than this, copy it into the
+ *                          tail of writeBuf right after the frame header
+ *                          instead of chaining it.  Runs of small frames then
+ *                          share one buffer (and one iovec).  0 disables.
  * @return The number of bytes written to writeBuf.
  */
 size_t
@@ -403,7 +407,8 @@ writeData(folly::IOBufQueue& writeBuf,
           uint32_t stream,
           folly::Optional<uint8_t> padding,
           bool endStream,
-          bool reuseIOBufHeadroom) noexcept;
+          bool reuseIOBufHeadroom,
+          uint32_t coalesceThreshold = 0) noexcept;
 
 /**
  * Generate an entire HEADERS frame, including the common frame header. The
@@ -13,17 +13,20 @@ using std::string;
 
 namespace proxygen {
 
-bool HeaderDecodeInfo::onHeader(const folly::fbstring& name,
+bool HeaderDecodeInfo::onHeader(const HPACKHeaderName& name,
                                 const folly::fbstring& value) {
   // Refuse decoding other headers if an error is already found
   if (decodeError != HPACK::DecodeError::NONE
       || parsingError != "") {
-    VLOG(4) << "Ignoring header=" << name << " value=" << value <<
+    VLOG(4) << "Ignoring header=" << name.get() << " value=" << value <<
       " due to parser error=" << parsingError;
     return true;
   }
-  VLOG(5) << "Processing header=" << name << " value=" << value;
-  folly::StringPiece nameSp(name);
+  VLOG(5) << "Processing header=" << name.get() << " value=" << value;
+  // Names decoded from a table entry or matching a common header already
+  // carry their code; only other names need to be validated and copied
+  HTTPHeaderCode headerCode = name.getHeaderCode();
+  folly::StringPiece nameSp(name.get());
   folly::StringPiece valueSp(value);
 
   if (nameSp.startsWith(':')) {
@@ -33,32 +36,32 @@ bool HeaderDecodeInfo::onHeader(const folly::fbstring& name,
       return false;
     }
     if (isRequest_) {
-      if (nameSp == headers::kMethod) {
-        if (!verifier.setMethod(valueSp)) {
+      bool ok = true;
+      switch (headerCode) {
+        case HTTP_HEADER_COLON_METHOD:
+          ok = verifier.setMethod(valueSp);
+          break;
+        case HTTP_HEADER_COLON_SCHEME:
+          ok = verifier.setScheme(valueSp);
+          break;
+        case HTTP_HEADER_COLON_AUTHORITY:
+          ok = verifier.setAuthority(valueSp);
+          break;
+        case HTTP_HEADER_COLON_PATH:
+          ok = verifier.setPath(valueSp);
+          break;
+        case HTTP_HEADER_COLON_PROTOCOL:
+          ok = verifier.setUpgradeProtocol(valueSp);
+          break;
+        default:
+          parsingError = folly::to<string>("Invalid req header name=", nameSp);
           return false;
-        }
-      } else if (nameSp == headers::kScheme) {
-        if (!verifier.setScheme(valueSp)) {
-          return false;
-        }
-      } else if (nameSp == headers::kAuthority) {
-        if (!verifier.setAuthority(valueSp)) {
-          return false;
-        }
-      } else if (nameSp == headers::kPath) {
-        if (!verifier.setPath(valueSp)) {
-          return false;
-        }
-      } else if (nameSp == headers::kProtocol) {
-        if (!verifier.setUpgradeProtocol(valueSp)) {
-          return false;
-        }
-      } else {
-        parsingError = folly::to<string>("Invalid req header name=", nameSp);
+      }
+      if (!ok) {
         return false;
       }
     } else {
-      if (nameSp == headers::kStatus) {
+      if (headerCode == HTTP_HEADER_COLON_STATUS) {
         if (hasStatus_) {
           parsingError = string("Duplicate status");
           return false;
@@ -81,11 +84,11 @@ bool HeaderDecodeInfo::onHeader(const folly::fbstring& name,
     }
   } else {
     regularHeaderSeen_ = true;
-    if (nameSp == "connection") {
+    if (headerCode == HTTP_HEADER_CONNECTION) {
       parsingError = string("HTTP/2 Message with Connection header");
       return false;
     }
-    if (nameSp == "content-length") {
+    if (headerCode == HTTP_HEADER_CONTENT_LENGTH) {
       uint32_t cl = 0;
       folly::tryTo<uint32_t>(valueSp).then(
           [&cl](uint32_t num) { cl = num; });
@@ -95,7 +98,8 @@ bool HeaderDecodeInfo::onHeader(const folly::fbstring& name,
       }
       contentLength_ = cl;
     }
-    bool nameOk = CodecUtil::validateHeaderName(nameSp);
+    bool nameOk = headerCode != HTTP_HEADER_OTHER ||
+      CodecUtil::validateHeaderName(nameSp);
     bool valueOk = CodecUtil::validateHeaderValue(valueSp, CodecUtil::STRICT);
     if (!nameOk || !valueOk) {
       parsingError = folly::to<string>("Bad header value: name=",
@@ -103,7 +107,7 @@ bool HeaderDecodeInfo::onHeader(const folly::fbstring& name,
       return false;
     }
     // Add the (name, value) pair to headers
-    msg->getHeaders().add(nameSp, valueSp);
+    msg->getHeaders().addFromCodec(headerCode, nameSp, valueSp);
   }
   return true;
 }
@@ -39,6 +39,14 @@ namespace compress {
   }
   return converted;
 }
+
+uint32_t uncompressedSize(const vector<Header>& headers) {
+  uint32_t size = 0;
+  for (const auto& h : headers) {
+    size += h.name->size() + h.value->size() + 2;
+  }
+  return size;
+}
 }
 
 HPACKCodec::HPACKCodec(TransportDirection /*direction*/)
@@ -46,9 +54,8 @@ HPACKCodec::HPACKCodec(TransportDirection /*direction*/)
       decoder_(HPACK::kTableSize, maxUncompressed_) {}
 
 unique_ptr<IOBuf> HPACKCodec::encode(vector<Header>& headers) noexcept {
-  auto prepared = compress::prepareHeaders(headers);
-  encodedSize_.uncompressed = prepared.second;
-  auto buf = encoder_.encode(prepared.first, encodeHeadroom_);
+  encodedSize_.uncompressed = compress::uncompressedSize(headers);
+  auto buf = encoder_.encode(headers, encodeHeadroom_);
   recordCompressedSize(buf.get());
   return buf;
 }
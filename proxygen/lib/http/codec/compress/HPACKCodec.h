@@ -30,6 +30,9 @@ class HPACKHeader;
 namespace compress {
 std::pair<std::vector<HPACKHeader>, uint32_t> prepareHeaders(
     std::vector<Header>& headers);
+
+// The size of headers as name/value pairs, as prepareHeaders computes it
+uint32_t uncompressedSize(const std::vector<Header>& headers);
 }
 
 /*
@@ -20,13 +20,29 @@ HPACKEncoder::encode(const vector<HPACKHeader>& headers, uint32_t headroom) {
   }
   handlePendingContextUpdate(streamBuffer_, table_.capacity());
   for (const auto& header : headers) {
-    encodeHeader(header);
+    encodeHeader(header.name, header.value);
   }
   return streamBuffer_.release();
 }
 
-bool HPACKEncoder::encodeAsLiteral(const HPACKHeader& header, bool indexing) {
-  if (header.bytes() > table_.capacity()) {
+std::unique_ptr<folly::IOBuf>
+HPACKEncoder::encode(const vector<compress::Header>& headers,
+                     uint32_t headroom) {
+  if (headroom) {
+    streamBuffer_.addHeadroom(headroom);
+  }
+  handlePendingContextUpdate(streamBuffer_, table_.capacity());
+  for (const auto& header : headers) {
+    encodeHeader(getName(header), *header.value);
+  }
+  return streamBuffer_.release();
+}
+
+bool HPACKEncoder::encodeAsLiteral(const HPACKHeaderName& name,
+                                   folly::StringPiece value,
+                                   bool indexing) {
+  if (HPACKHeader::kMinLength + name.size() + value.size() >
+      table_.capacity()) {
     // May want to investigate further whether or not this is wanted.
     // Flushing the table on a large header frees up some memory,
     // however, there will be no compression due to an empty table, and
@@ -37,15 +53,17 @@ bool HPACKEncoder::encodeAsLiteral(const HPACKHeader& header, bool indexing) {
   HPACK::Instruction instruction = (indexing) ?
     HPACK::LITERAL_INC_INDEX : HPACK::LITERAL;
 
-  encodeLiteral(header, nameIndex(header.name), instruction);
+  encodeLiteral(name, value, nameIndex(name), instruction);
   // indexed ones need to get added to the header table
   if (indexing) {
-    CHECK(table_.add(header.copy()));
+    CHECK(table_.add(
+      HPACKHeader(name, folly::fbstring(value.data(), value.size()))));
   }
   return true;
 }
 
-void HPACKEncoder::encodeLiteral(const HPACKHeader& header,
+void HPACKEncoder::encodeLiteral(const HPACKHeaderName& name,
+                                 folly::StringPiece value,
                                  uint32_t nameIndex,
                                  const HPACK::Instruction& instruction) {
   // name
@@ -54,10 +72,10 @@ void HPACKEncoder::encodeLiteral(const HPACKHeader& header,
     streamBuffer_.encodeInteger(nameIndex, instruction);
   } else {
     streamBuffer_.encodeInteger(0, instruction);
-    streamBuffer_.encodeLiteral(header.name.get());
+    streamBuffer_.encodeLiteral(name.get());
   }
   // value
-  streamBuffer_.encodeLiteral(header.value);
+  streamBuffer_.encodeLiteral(value);
 }
 
 void HPACKEncoder::encodeAsIndex(uint32_t index) {
@@ -65,10 +83,11 @@ void HPACKEncoder::encodeAsIndex(uint32_t index) {
   streamBuffer_.encodeInteger(index, HPACK::INDEX_REF);
 }
 
-void HPACKEncoder::encodeHeader(const HPACKHeader& header) {
+void HPACKEncoder::encodeHeader(const HPACKHeaderName& name,
+                                folly::StringPiece value) {
   // First determine whether the header is defined as indexable using the
   // set strategy if applicable, else assume it is indexable
-  bool indexable = !indexingStrat_ || indexingStrat_->indexHeader(header);
+  bool indexable = !indexingStrat_ || indexingStrat_->indexHeader(name, value);
 
   // If the header was not defined as indexable, its a reasonable assumption
   // that it does not appear in either the static or dynamic table and should
@@ -78,14 +97,14 @@ void HPACKEncoder::encodeHeader(const HPACKHeader& header) {
   // as an override so we assume this is desired if such a case occurs
   uint32_t index = 0;
   if (indexable) {
-    index = getIndex(header);
+    index = getIndex(name, value);
   }
 
   // Finally encode the header as determined above
   if (index) {
     encodeAsIndex(index);
   } else {
-    encodeAsLiteral(header, indexable);
+    encodeAsLiteral(name, value, indexable);
   }
 }
 
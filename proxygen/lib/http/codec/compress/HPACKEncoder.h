@@ -32,6 +32,14 @@ class HPACKEncoder : public HPACKEncoderBase, public HPACKContext {
     const std::vector<HPACKHeader>& headers,
     uint32_t headroom = 0);
 
+  /**
+   * Encode headers in place, without first converting them to HPACKHeaders.
+   * Values are only copied when inserted into the dynamic table.
+   */
+  std::unique_ptr<folly::IOBuf> encode(
+    const std::vector<compress::Header>& headers,
+    uint32_t headroom = 0);
+
   void setHeaderTableSize(uint32_t size) {
     HPACKEncoderBase::setHeaderTableSize(table_, size);
   }
@@ -39,11 +47,14 @@ class HPACKEncoder : public HPACKEncoderBase, public HPACKContext {
  private:
   void encodeAsIndex(uint32_t index);
 
-  void encodeHeader(const HPACKHeader& header);
+  void encodeHeader(const HPACKHeaderName& name, folly::StringPiece value);
 
-  bool encodeAsLiteral(const HPACKHeader& header, bool indexing);
+  bool encodeAsLiteral(const HPACKHeaderName& name,
+                       folly::StringPiece value,
+                       bool indexing);
 
-  void encodeLiteral(const HPACKHeader& header,
+  void encodeLiteral(const HPACKHeaderName& name,
+                     folly::StringPiece value,
                      uint32_t nameIndex,
                      const HPACK::Instruction& instruction);
 };
@@ -11,6 +11,7 @@
 
 #include <proxygen/lib/http/codec/compress/HPACKContext.h>
 #include <proxygen/lib/http/codec/compress/HPACKEncodeBuffer.h>
+#include <proxygen/lib/http/codec/compress/Header.h>
 #include <proxygen/lib/http/codec/compress/HeaderIndexingStrategy.h>
 
 namespace proxygen {
@@ -52,6 +53,17 @@ class HPACKEncoderBase {
   uint32_t handlePendingContextUpdate(HPACKEncodeBuffer& buf,
                                       uint32_t tableCapacity);
 
+  /**
+   * The lowercase name of header.  Common headers map straight from their
+   * code to the lowercase table; only other names are copied.
+   */
+  static HPACKHeaderName getName(const compress::Header& header) {
+    if (header.code == HTTP_HEADER_OTHER || header.code == HTTP_HEADER_NONE) {
+      return HPACKHeaderName(*header.name);
+    }
+    return HPACKHeaderName(header.code);
+  }
+
   const HeaderIndexingStrategy* indexingStrat_;
   HPACKEncodeBuffer streamBuffer_;
   bool pendingContextUpdate_{false};
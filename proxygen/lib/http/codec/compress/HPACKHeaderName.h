@@ -17,6 +17,7 @@
 #include <boost/variant.hpp>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
 #include <folly/Range.h>
+#include <glog/logging.h>
 
 namespace proxygen {
 
@@ -33,6 +34,15 @@ class HPACKHeaderName {
   explicit HPACKHeaderName(folly::StringPiece name) {
     storeAddress(name);
   }
+  /*
+   * Name of a common header, without hashing or allocating
+   */
+  explicit HPACKHeaderName(HTTPHeaderCode headerCode) {
+    DCHECK(headerCode != HTTPHeaderCode::HTTP_HEADER_NONE &&
+           headerCode != HTTPHeaderCode::HTTP_HEADER_OTHER);
+    address_ = HTTPCommonHeaders::getPointerToHeaderName(
+      headerCode, TABLE_LOWERCASE);
+  }
   HPACKHeaderName(const HPACKHeaderName& headerName) {
     copyAddress(headerName);
   }
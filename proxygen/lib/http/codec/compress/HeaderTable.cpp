@@ -64,8 +64,13 @@ uint32_t HeaderTable::getIndex(const HPACKHeader& header) const {
   return getIndexImpl(header.name, header.value, false);
 }
 
+uint32_t HeaderTable::getIndex(const HPACKHeaderName& name,
+                               folly::StringPiece value) const {
+  return getIndexImpl(name, value, false);
+}
+
 uint32_t HeaderTable::getIndexImpl(const HPACKHeaderName& headerName,
-                                   const folly::fbstring& value,
+                                   folly::StringPiece value,
                                    bool nameOnly) const {
   auto it = names_.find(headerName);
   if (it == names_.end()) {
@@ -74,7 +79,7 @@ uint32_t HeaderTable::getIndexImpl(const HPACKHeaderName& headerName,
   for (auto indexIt = it->second.rbegin(); indexIt != it->second.rend();
        ++indexIt) {
     auto i = *indexIt;
-    if (nameOnly || table_[i].value == value) {
+    if (nameOnly || folly::StringPiece(table_[i].value) == value) {
       return toExternal(i);
     }
   }
@@ -86,8 +91,7 @@ bool HeaderTable::hasName(const HPACKHeaderName& headerName) {
 }
 
 uint32_t HeaderTable::nameIndex(const HPACKHeaderName& headerName) const {
-  folly::fbstring value;
-  return getIndexImpl(headerName, value, true /* name only */);
+  return getIndexImpl(headerName, folly::StringPiece(), true /* name only */);
 }
 
 const HPACKHeader& HeaderTable::getHeader(uint32_t index) const {
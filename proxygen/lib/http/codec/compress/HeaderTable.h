@@ -49,6 +49,8 @@ class HeaderTable {
    * @return 0 in case the header is not found
    */
   uint32_t getIndex(const HPACKHeader& header) const;
+  uint32_t getIndex(const HPACKHeaderName& name,
+                    folly::StringPiece value) const;
 
   /**
    * Get the table entry at the given external index.
@@ -199,7 +201,7 @@ class HeaderTable {
    * Shared implementation for getIndex and nameIndex
    */
   uint32_t getIndexImpl(const HPACKHeaderName& header,
-                        const folly::fbstring& value,
+                        folly::StringPiece value,
                         bool nameOnly) const;
 };
 
@@ -12,7 +12,7 @@
 #include <algorithm>
 #include <folly/String.h>
 #include <folly/io/Cursor.h>
-#include <proxygen/lib/http/codec/compress/HPACKCodec.h> // for prepareHeaders
+#include <proxygen/lib/http/codec/compress/HPACKCodec.h> // for uncompressedSize
 #include <proxygen/lib/http/codec/compress/HPACKHeader.h>
 #include <iosfwd>
 
@@ -51,9 +51,8 @@ QPACKEncoder::EncodeResult QPACKCodec::encode(
     vector<Header>& headers,
     uint64_t streamId,
     uint32_t maxEncoderStreamBytes) noexcept {
-  auto prepared = compress::prepareHeaders(headers);
-  encodedSize_.uncompressed = prepared.second;
-  auto res = encoder_.encode(prepared.first, encodeHeadroom_, streamId,
+  encodedSize_.uncompressed = compress::uncompressedSize(headers);
+  auto res = encoder_.encode(headers, encodeHeadroom_, streamId,
                              maxEncoderStreamBytes);
   recordCompressedSize(res);
   return res;
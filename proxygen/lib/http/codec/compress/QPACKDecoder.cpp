@@ -10,6 +10,8 @@
 #include <proxygen/lib/http/codec/compress/QPACKDecoder.h>
 #include <proxygen/lib/http/codec/compress/HPACKEncodeBuffer.h>
 
+#include <algorithm>
+
 using folly::IOBuf;
 using folly::io::Cursor;
 using std::unique_ptr;
@@ -17,6 +19,7 @@ using proxygen::HPACK::DecodeError;
 
 namespace {
 const uint32_t kGrowth = 100;
+const uint32_t kInitialQueueCapacity = 16;
 }
 
 namespace proxygen {
@@ -383,13 +386,17 @@ std::unique_ptr<folly::IOBuf> QPACKDecoder::encodeHeaderAck(
 std::unique_ptr<folly::IOBuf> QPACKDecoder::encodeCancelStream(
     uint64_t streamId) {
   // Remove this stream from the queue
-  auto it = queue_.begin();
-  while (it != queue_.end()) {
-    if (it->second.streamID == streamId) {
-      it = queue_.erase(it);
-    } else {
-      it++;
+  auto it = std::remove_if(queue_.begin(), queue_.end(),
+                           [streamId] (const PendingBlock& pending) {
+                             return pending.streamID == streamId;
+                           });
+  if (it != queue_.end()) {
+    for (auto cur = it; cur != queue_.end(); ++cur) {
+      DCHECK_LE(cur->length, queuedBytes_);
+      queuedBytes_ -= cur->length;
     }
+    queue_.erase(it, queue_.end());
+    std::make_heap(queue_.begin(), queue_.end(), PendingBlockCompare());
   }
   HPACKEncodeBuffer ackEncoder(kGrowth, false);
   ackEncoder.encodeInteger(streamId, HPACK::Q_CANCEL_STREAM);
@@ -406,18 +413,20 @@ void QPACKDecoder::enqueueHeaderBlock(
   HPACK::StreamingCallback* streamingCb) {
   // TDOO: this queue is currently unbounded and has no timeouts
   CHECK_GT(requiredInsertCount, table_.getInsertCount());
-  queue_.emplace(
-    std::piecewise_construct,
-    std::forward_as_tuple(requiredInsertCount),
-    std::forward_as_tuple(streamID, baseIndex, length, consumed,
-                          std::move(block), streamingCb));
+  if (queue_.capacity() == 0) {
+    // One allocation up front for the common case; maxBlocking_ bounds size
+    queue_.reserve(std::min(maxBlocking_, kInitialQueueCapacity));
+  }
+  queue_.emplace_back(requiredInsertCount, nextBlockSeq_++, streamID,
+                      baseIndex, length, consumed, std::move(block),
+                      streamingCb);
+  std::push_heap(queue_.begin(), queue_.end(), PendingBlockCompare());
   holBlockCount_++;
   VLOG(5) << "queued block=" << requiredInsertCount << " len=" << length;
   queuedBytes_ += length;
 }
 
-bool QPACKDecoder::decodeBlock(uint32_t requiredInsertCount,
-                               const PendingBlock& pending) {
+bool QPACKDecoder::decodeBlock(const PendingBlock& pending) {
   if (pending.length > 0) {
     VLOG(5) << "decodeBlock len=" << pending.length;
     folly::io::Cursor cursor(pending.block.get());
@@ -426,7 +435,7 @@ bool QPACKDecoder::decodeBlock(uint32_t requiredInsertCount,
     queuedBytes_ -= pending.length;
     baseIndex_ = pending.baseIndex;
     folly::DestructorCheck::Safety safety(*this);
-    decodeStreamingImpl(requiredInsertCount, pending.consumed, dbuf,
+    decodeStreamingImpl(pending.requiredInsertCount, pending.consumed, dbuf,
                         pending.cb);
     // The callback way destroy this, if so stop queue processing
     if (safety.destroyed()) {
@@ -437,16 +446,17 @@ bool QPACKDecoder::decodeBlock(uint32_t requiredInsertCount,
 }
 
 void QPACKDecoder::drainQueue() {
-  auto it = queue_.begin();
-  while (!queue_.empty() && it->first <= table_.getInsertCount() &&
+  // The front of the heap is the low watermark: if it isn't ready, nothing is,
+  // so an encoder stream instruction that unblocks nobody costs O(1).
+  while (!queue_.empty() &&
+         queue_.front().requiredInsertCount <= table_.getInsertCount() &&
          !hasError()) {
-    auto id = it->first;
-    PendingBlock block = std::move(it->second);
-    queue_.erase(it);
-    if (decodeBlock(id, block)) {
+    std::pop_heap(queue_.begin(), queue_.end(), PendingBlockCompare());
+    PendingBlock block = std::move(queue_.back());
+    queue_.pop_back();
+    if (decodeBlock(block)) {
       return;
     }
-    it = queue_.begin();
   }
 }
 
@@ -16,7 +16,7 @@
 #include <proxygen/lib/http/codec/compress/HPACKDecodeBuffer.h>
 #include <proxygen/lib/http/codec/compress/QPACKContext.h>
 #include <folly/io/async/DestructorCheck.h>
-#include <map>
+#include <vector>
 
 namespace proxygen {
 
@@ -52,6 +52,10 @@ class QPACKDecoder : public HPACKDecoderBase,
     return queuedBytes_;
   }
 
+  uint32_t getQueuedBlocks() const {
+    return queue_.size();
+  }
+
   void setMaxBlocking(uint32_t maxBlocking) {
     maxBlocking_ = maxBlocking;
   }
@@ -105,13 +109,16 @@ class QPACKDecoder : public HPACKDecoderBase,
 
   struct PendingBlock {
     PendingBlock(
-        uint64_t sid,
+        uint32_t ric, uint64_t s, uint64_t sid,
         uint32_t bi, uint32_t l, uint32_t cons,
         std::unique_ptr<folly::IOBuf> b,
         HPACK::StreamingCallback* c)
-        : streamID(sid), baseIndex(bi), length(l), consumed(cons),
-          block(std::move(b)), cb(c)
+        : requiredInsertCount(ric), seq(s), streamID(sid), baseIndex(bi),
+          length(l), consumed(cons), block(std::move(b)), cb(c)
       {}
+    uint32_t requiredInsertCount;
+    // Arrival order, so blocks unblocked by the same insert are decoded FIFO
+    uint64_t seq;
     uint64_t streamID;
     uint32_t baseIndex;
     uint32_t length;
@@ -120,9 +127,19 @@ class QPACKDecoder : public HPACKDecoderBase,
     HPACK::StreamingCallback* cb;
   };
 
+  // Orders queue_ as a min-heap on (requiredInsertCount, seq)
+  struct PendingBlockCompare {
+    bool operator()(const PendingBlock& a, const PendingBlock& b) const {
+      if (a.requiredInsertCount != b.requiredInsertCount) {
+        return a.requiredInsertCount > b.requiredInsertCount;
+      }
+      return a.seq > b.seq;
+    }
+  };
+
   // Returns true if this object was destroyed by its callback.  Callers
   // should check the result and immediately return.
-  bool decodeBlock(uint32_t requiredInsertCount, const PendingBlock& pending);
+  bool decodeBlock(const PendingBlock& pending);
 
   void drainQueue();
 
@@ -132,7 +149,12 @@ class QPACKDecoder : public HPACKDecoderBase,
   uint32_t holBlockCount_{0};
   uint32_t pendingEncoderBytes_{0};
   uint64_t queuedBytes_{0};
-  std::multimap<uint32_t, PendingBlock> queue_;
+  uint64_t nextBlockSeq_{0};
+  // Blocked header blocks, kept as a heap so the block with the smallest
+  // requiredInsertCount is always at the front.  drainQueue only has to look
+  // at the front to know whether anything is ready, and a blocked stream costs
+  // a vector slot rather than a tree node.
+  std::vector<PendingBlock> queue_;
 
   // This holds the state of a partially decoded literal insert on the control
   // stream
@@ -28,17 +28,32 @@ QPACKEncoder::encode(const vector<HPACKHeader>& headers,
                      uint32_t headroom,
                      uint64_t streamId,
                      uint32_t maxEncoderStreamBytes) {
+  startEncode(headroom, maxEncoderStreamBytes);
+  return encodeQ(headers, streamId);
+}
+
+QPACKEncoder::EncodeResult
+QPACKEncoder::encode(const vector<compress::Header>& headers,
+                     uint32_t headroom,
+                     uint64_t streamId,
+                     uint32_t maxEncoderStreamBytes) {
+  startEncode(headroom, maxEncoderStreamBytes);
+  return encodeQ(headers, streamId);
+}
+
+void QPACKEncoder::startEncode(uint32_t headroom,
+                               uint32_t maxEncoderStreamBytes) {
   if (headroom) {
     streamBuffer_.addHeadroom(headroom);
   }
   maxEncoderStreamBytes_ = maxEncoderStreamBytes;
   maxEncoderStreamBytes_ -=
     handlePendingContextUpdate(controlBuffer_, table_.capacity());
-  return encodeQ(headers, streamId);
 }
 
+template <typename HeaderList>
 QPACKEncoder::EncodeResult
-QPACKEncoder::encodeQ(const vector<HPACKHeader>& headers, uint64_t streamId) {
+QPACKEncoder::encodeQ(const HeaderList& headers, uint64_t streamId) {
   OutstandingBlock outstandingBlock;
   // curOutstanding_ points to a local stack variable, it's mostly for
   // convenience so other methods invoked from here can access it.
@@ -91,9 +106,9 @@ QPACKEncoder::encodeQ(const vector<HPACKHeader>& headers, uint64_t streamId) {
 }
 
 void QPACKEncoder::encodeHeaderQ(
-  const HPACKHeader& header, uint32_t baseIndex,
+  const HPACKHeaderName& name, folly::StringPiece value, uint32_t baseIndex,
   uint32_t* requiredInsertCount) {
-  uint32_t index = getStaticTable().getIndex(header);
+  uint32_t index = getStaticTable().getIndex(name, value);
   if (index > 0) {
     // static reference
     streamBuffer_.encodeInteger(index - 1,
@@ -102,9 +117,9 @@ void QPACKEncoder::encodeHeaderQ(
     return;
   }
 
-  bool indexable = shouldIndex(header);
+  bool indexable = shouldIndex(name, value);
   if (indexable) {
-    index = table_.getIndex(header, allowVulnerable());
+    index = table_.getIndex(name, value, allowVulnerable());
     if (index == QPACKHeaderTable::UNACKED) {
       index = 0;
       indexable = false;
@@ -123,14 +138,15 @@ void QPACKEncoder::encodeHeaderQ(
     uint32_t absoluteNameIndex = 0;
     bool isStaticName = false;
     std::tie(isStaticName, nameIndex, absoluteNameIndex) =
-      getNameIndexQ(header.name);
+      getNameIndexQ(name);
 
     // Now check if we should emit an insertion on the control stream
     // Don't try to index if we're out of encoder flow control
     indexable &= maxEncoderStreamBytes_ > 0;
-    if (indexable && table_.canIndex(header)) {
-      encodeInsertQ(header, isStaticName, nameIndex);
-      CHECK(table_.add(header.copy()));
+    if (indexable && table_.canIndex(name, value)) {
+      encodeInsertQ(name, value, isStaticName, nameIndex);
+      CHECK(table_.add(
+        HPACKHeader(name, folly::fbstring(value.data(), value.size()))));
       if (allowVulnerable() && lastEntryAvailable()) {
         index = table_.getInsertCount();
       } else {
@@ -148,8 +164,8 @@ void QPACKEncoder::encodeHeaderQ(
     if (index == 0) {
       // Couldn't insert it: table full, not indexable, or table contains
       // vulnerable reference.  Encode a literal on the request stream.
-      encodeStreamLiteralQ(header, isStaticName, nameIndex, absoluteNameIndex,
-                           baseIndex, requiredInsertCount);
+      encodeStreamLiteralQ(name, value, isStaticName, nameIndex,
+                           absoluteNameIndex, baseIndex, requiredInsertCount);
       return;
     }
   }
@@ -164,9 +180,11 @@ void QPACKEncoder::encodeHeaderQ(
   }
 }
 
-bool QPACKEncoder::shouldIndex(const HPACKHeader& header) const {
-  return (header.bytes() <= table_.capacity()) &&
-    (!indexingStrat_ || indexingStrat_->indexHeader(header)) &&
+bool QPACKEncoder::shouldIndex(const HPACKHeaderName& name,
+                               folly::StringPiece value) const {
+  return (HPACKHeader::kMinLength + name.size() + value.size() <=
+          table_.capacity()) &&
+    (!indexingStrat_ || indexingStrat_->indexHeader(name, value)) &&
     dynamicReferenceAllowed();
 }
 
@@ -215,7 +233,8 @@ std::tuple<bool, uint32_t, uint32_t> QPACKEncoder::getNameIndexQ(
 }
 
 void QPACKEncoder::encodeStreamLiteralQ(
-  const HPACKHeader& header, bool isStaticName, uint32_t nameIndex,
+  const HPACKHeaderName& name, folly::StringPiece value,
+  bool isStaticName, uint32_t nameIndex,
   uint32_t absoluteNameIndex, uint32_t baseIndex,
   uint32_t* requiredInsertCount) {
   if (absoluteNameIndex > 0) {
@@ -224,13 +243,15 @@ void QPACKEncoder::encodeStreamLiteralQ(
     trackReference(absoluteNameIndex, requiredInsertCount);
   }
   if (absoluteNameIndex > baseIndex) {
-    encodeLiteralQ(header,
+    encodeLiteralQ(name,
+                   value,
                    false, /* not static */
                    true, /* post base */
                    absoluteNameIndex - baseIndex,
                    HPACK::Q_LITERAL_NAME_REF_POST);
   } else {
-    encodeLiteralQ(header,
+    encodeLiteralQ(name,
+                   value,
                    isStaticName,
                    false, /* not post base */
                    isStaticName ? nameIndex : baseIndex - absoluteNameIndex + 1,
@@ -261,31 +282,34 @@ void QPACKEncoder::encodeDuplicate(uint32_t index) {
     controlBuffer_.encodeInteger(index - 1, HPACK::Q_DUPLICATE);
 }
 
-void QPACKEncoder::encodeInsertQ(const HPACKHeader& header,
+void QPACKEncoder::encodeInsertQ(const HPACKHeaderName& name,
+                                 folly::StringPiece value,
                                  bool isStaticName,
                                  uint32_t nameIndex) {
   auto encoded = encodeLiteralQHelper(
-      controlBuffer_, header, isStaticName, nameIndex,
+      controlBuffer_, name, value, isStaticName, nameIndex,
       HPACK::Q_INSERT_NAME_REF_STATIC, HPACK::Q_INSERT_NAME_REF,
       HPACK::Q_INSERT_NO_NAME_REF);
   maxEncoderStreamBytes_ -= encoded;
 }
 
-void QPACKEncoder::encodeLiteralQ(const HPACKHeader& header,
+void QPACKEncoder::encodeLiteralQ(const HPACKHeaderName& name,
+                                  folly::StringPiece value,
                                   bool isStaticName,
                                   bool postBase,
                                   uint32_t nameIndex,
                                   const HPACK::Instruction& idxInstr) {
   DCHECK(!isStaticName || !postBase);
   encodeLiteralQHelper(
-      streamBuffer_, header, isStaticName, nameIndex,
+      streamBuffer_, name, value, isStaticName, nameIndex,
       HPACK::Q_LITERAL_STATIC, idxInstr,
       HPACK::Q_LITERAL);
 }
 
 uint32_t QPACKEncoder::encodeLiteralQHelper(
     HPACKEncodeBuffer& buffer,
-    const HPACKHeader& header,
+    const HPACKHeaderName& name,
+    folly::StringPiece value,
     bool isStaticName,
     uint32_t nameIndex,
     uint8_t staticFlag,
@@ -304,10 +328,10 @@ uint32_t QPACKEncoder::encodeLiteralQHelper(
     encoded += buffer.encodeInteger(nameIndex, byte, idxInstr.prefixLength);
   } else {
     encoded += buffer.encodeLiteral(litInstr.code, litInstr.prefixLength,
-                                    header.name.get());
+                                    name.get());
   }
   // value
-  encoded += buffer.encodeLiteral(header.value);
+  encoded += buffer.encodeLiteral(value);
   return encoded;
 }
 
@@ -52,6 +52,14 @@ class QPACKEncoder : public HPACKEncoderBase, public QPACKContext {
     uint64_t streamId,
     uint32_t maxEncoderStreamBytes=std::numeric_limits<uint32_t>::max());
 
+  // Encodes headers in place, without first converting them to HPACKHeaders.
+  // Values are only copied when inserted into the dynamic table.
+  EncodeResult encode(
+    const std::vector<compress::Header>& headers,
+    uint32_t headroom,
+    uint64_t streamId,
+    uint32_t maxEncoderStreamBytes=std::numeric_limits<uint32_t>::max());
+
   HPACK::DecodeError decodeDecoderStream(
       std::unique_ptr<folly::IOBuf> buf);
 
@@ -99,7 +107,8 @@ class QPACKEncoder : public HPACKEncoderBase, public QPACKContext {
     return numVulnerable_ < maxVulnerable_;
   }
 
-  bool shouldIndex(const HPACKHeader& header) const;
+  bool shouldIndex(const HPACKHeaderName& name,
+                   folly::StringPiece value) const;
 
   bool dynamicReferenceAllowed() const;
 
@@ -107,32 +116,50 @@ class QPACKEncoder : public HPACKEncoderBase, public QPACKContext {
 
   std::pair<bool, uint32_t> maybeDuplicate(uint32_t relativeIndex);
 
+  void startEncode(uint32_t headroom, uint32_t maxEncoderStreamBytes);
+
+  template <typename HeaderList>
   QPACKEncoder::EncodeResult
-  encodeQ(const std::vector<HPACKHeader>& headers, uint64_t streamId);
+  encodeQ(const HeaderList& headers, uint64_t streamId);
 
   std::tuple<bool, uint32_t, uint32_t> getNameIndexQ(
     const HPACKHeaderName& headerName);
 
   void encodeStreamLiteralQ(
-    const HPACKHeader& header, bool isStaticName, uint32_t nameIndex,
+    const HPACKHeaderName& name, folly::StringPiece value,
+    bool isStaticName, uint32_t nameIndex,
     uint32_t absoluteNameIndex, uint32_t baseIndex,
     uint32_t* requiredInsertCount);
 
   void encodeHeaderQ(const HPACKHeader& header, uint32_t baseIndex,
-                     uint32_t* requiredInsertCount);
+                     uint32_t* requiredInsertCount) {
+    encodeHeaderQ(header.name, header.value, baseIndex, requiredInsertCount);
+  }
+
+  void encodeHeaderQ(const compress::Header& header, uint32_t baseIndex,
+                     uint32_t* requiredInsertCount) {
+    encodeHeaderQ(getName(header), *header.value, baseIndex,
+                  requiredInsertCount);
+  }
+
+  void encodeHeaderQ(const HPACKHeaderName& name, folly::StringPiece value,
+                     uint32_t baseIndex, uint32_t* requiredInsertCount);
 
-  void encodeInsertQ(const HPACKHeader& header,
+  void encodeInsertQ(const HPACKHeaderName& name,
+                     folly::StringPiece value,
                      bool isStaticName,
                      uint32_t nameIndex);
 
-  void encodeLiteralQ(const HPACKHeader& header,
+  void encodeLiteralQ(const HPACKHeaderName& name,
+                      folly::StringPiece value,
                       bool isStaticName,
                       bool postBase,
                       uint32_t nameIndex,
                       const HPACK::Instruction& idxInstr);
 
   uint32_t encodeLiteralQHelper(HPACKEncodeBuffer& buffer,
-                                const HPACKHeader& header,
+                                const HPACKHeaderName& name,
+                                folly::StringPiece value,
                                 bool isStaticName,
                                 uint32_t nameIndex,
                                 uint8_t staticFlag,
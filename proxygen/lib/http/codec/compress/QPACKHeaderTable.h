@@ -53,9 +53,13 @@ class QPACKHeaderTable : public HeaderTable {
    * in the number of entries
    */
   bool canIndex(const HPACKHeader& header) {
-    auto totalBytes = bytes_ + header.bytes();
+    return canIndex(header.name, header.value);
+  }
+  bool canIndex(const HPACKHeaderName& name, folly::StringPiece value) {
+    uint32_t headerBytes = HPACKHeader::kMinLength + name.size() + value.size();
+    auto totalBytes = bytes_ + headerBytes;
     // Don't index headers that would immediately be drained
-    return ((header.bytes() <= (capacity_ - minFree_)) &&
+    return ((headerBytes <= (capacity_ - minFree_)) &&
             (totalBytes <= capacity_ || canEvict(totalBytes - capacity_)));
   }
 
@@ -99,6 +103,9 @@ class QPACKHeaderTable : public HeaderTable {
    */
   uint32_t getIndex(const HPACKHeader& header,
                     bool allowVulnerable = true) const;
+  uint32_t getIndex(const HPACKHeaderName& name,
+                    folly::StringPiece value,
+                    bool allowVulnerable = true) const;
 
   /**
    * Get the table entry at the given external index.  If base is 0,
@@ -180,7 +187,7 @@ class QPACKHeaderTable : public HeaderTable {
    * Shared implementation for getIndex and nameIndex
    */
   uint32_t getIndexImpl(const HPACKHeaderName& header,
-                        const folly::fbstring& value,
+                        folly::StringPiece value,
                         bool nameOnly,
                         bool allowVulnerable=true) const;
 
@@ -33,7 +33,7 @@ const std::string kTestDir = getContainingDirectory(__FILE__).str();
 
 namespace proxygen { namespace compress {
 
-bool CompressionSimulator::readInputFromFileAndSchedule(
+std::vector<HTTPMessage> CompressionSimulator::readInputFromFile(
     const string& filename) {
   unique_ptr<HTTPArchive> har;
   try {
@@ -41,8 +41,8 @@ bool CompressionSimulator::readInputFromFileAndSchedule(
   } catch (const std::exception& ex) {
     LOG(ERROR) << folly::exceptionStr(ex);
   }
-  if (!har || har->requests.size() == 0) {
-    return false;
+  if (!har) {
+    return {};
   }
   // Sort by start time (har ordered by finish time?)
   std::sort(har->requests.begin(),
@@ -50,10 +50,22 @@ bool CompressionSimulator::readInputFromFileAndSchedule(
             [](const HTTPMessage& a, const HTTPMessage& b) {
               return a.getStartTime() < b.getStartTime();
             });
-  TimePoint last = har->requests[0].getStartTime();
+  return std::move(har->requests);
+}
+
+bool CompressionSimulator::readInputFromFileAndSchedule(
+    const string& filename) {
+  return scheduleRequests(readInputFromFile(filename));
+}
+
+bool CompressionSimulator::scheduleRequests(vector<HTTPMessage> requests) {
+  if (requests.size() == 0) {
+    return false;
+  }
+  TimePoint last = requests[0].getStartTime();
   std::chrono::milliseconds cumulativeDelay(0);
   uint16_t index = 0;
-  for (HTTPMessage& msg : har->requests) {
+  for (HTTPMessage& msg : requests) {
     auto delayFromPrevious = millisecondsBetween(msg.getStartTime(), last);
     // If there was a quiescent gap in the HAR of at least some value, shrink
     // it so the test doesn't last forever
@@ -79,11 +91,7 @@ void CompressionSimulator::run() {
 #endif
 
   LOG(INFO) << "Starting run";
-  eventBase_.loop();
-  uint32_t holBlockCount = 0;
-  for (auto& scheme : domains_) {
-    holBlockCount += scheme.second->getHolBlockCount();
-  }
+  simulate();
   LOG(INFO) << "Complete"
             << "\nStats:"
                "\nSeed: "
@@ -91,13 +99,31 @@ void CompressionSimulator::run() {
             << "\nAllowed OOO: " << stats_.allowedOOO
             << "\nPackets: " << stats_.packets
             << "\nPacket Losses: " << stats_.packetLosses
-            << "\nHOL Block Count: " << holBlockCount
+            << "\nHOL Block Count: " << stats_.holBlockCount
             << "\nHOL Delay (ms): " << stats_.holDelay.count()
             << "\nMax Queue Buffer Bytes: " << stats_.maxQueueBufferBytes
             << "\nUncompressed Bytes: " << stats_.uncompressed
             << "\nCompressed Bytes: " << stats_.compressed
             << "\nCompression Ratio: "
-            << int(100 - double(100 * stats_.compressed) / stats_.uncompressed);
+            << int(100 - double(100 * stats_.compressed) / stats_.uncompressed)
+            << "\nEncode ns/header: " << nsPerHeader(stats_.encodeTime)
+            << "\nDecode ns/header: " << nsPerHeader(stats_.decodeTime);
+}
+
+uint64_t CompressionSimulator::nsPerHeader(
+    std::chrono::nanoseconds elapsed) const {
+  if (stats_.headers == 0) {
+    return 0;
+  }
+  return elapsed.count() / stats_.headers;
+}
+
+void CompressionSimulator::simulate() {
+  eventBase_.loop();
+  stats_.holBlockCount = 0;
+  for (auto& scheme : domains_) {
+    stats_.holBlockCount += scheme.second->getHolBlockCount();
+  }
 }
 
 void CompressionSimulator::flushRequests(CompressionScheme* scheme) {
@@ -292,7 +318,11 @@ std::pair<FrameFlags, unique_ptr<IOBuf>> CompressionSimulator::encode(
       requests_[index], cookies);
 
   auto before = stats_.uncompressed;
+  stats_.requests++;
+  stats_.headers += allHeaders.size();
+  auto start = std::chrono::steady_clock::now();
   auto res = scheme->encode(newPacket, std::move(allHeaders), stats_);
+  stats_.encodeTime += std::chrono::steady_clock::now() - start;
   VLOG(1) << "Encoded request=" << index << " for host="
           << requests_[index].getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST)
           << " orig size=" << (stats_.uncompressed - before)
@@ -307,7 +337,10 @@ void CompressionSimulator::decode(CompressionScheme* scheme,
                                   FrameFlags flags,
                                   unique_ptr<IOBuf> encodedReq,
                                   SimStreamingCallback& cb) {
+  // Includes any previously blocked blocks this one unblocks
+  auto start = std::chrono::steady_clock::now();
   scheme->decode(flags, std::move(encodedReq), stats_, cb);
+  stats_.decodeTime += std::chrono::steady_clock::now() - start;
 }
 
 void CompressionSimulator::decodePacket(
@@ -348,7 +381,10 @@ void CompressionSimulator::sendAck(CompressionScheme* scheme,
 
 void CompressionSimulator::recvAck(CompressionScheme* scheme,
                                    unique_ptr<CompressionScheme::Ack> ack) {
+  // Processing acks is encoder work
+  auto start = std::chrono::steady_clock::now();
   scheme->recvAck(std::move(ack));
+  stats_.encodeTime += std::chrono::steady_clock::now() - start;
 }
 
 std::chrono::milliseconds CompressionSimulator::deliveryDelay() {
@@ -25,8 +25,23 @@ class CompressionSimulator {
   explicit CompressionSimulator(SimParams p) : params_(p) {
   }
 
+  // Load a HAR file relative to this directory, sorted by start time.
+  // Returns an empty vector on failure.
+  static std::vector<proxygen::HTTPMessage> readInputFromFile(
+      const std::string& filename);
+
   bool readInputFromFileAndSchedule(const std::string& filename);
+  // Schedule an already loaded and sorted set of requests
+  bool scheduleRequests(std::vector<proxygen::HTTPMessage> requests);
+
+  // Run the simulation and log a summary of the results
   void run();
+  // Run the simulation without logging, results are in getStats()
+  void simulate();
+
+  const SimStats& getStats() const {
+    return stats_;
+  }
 
   // Called from CompressionScheme::runLoopCallback
   void flushSchemePackets(CompressionScheme* scheme);
@@ -53,6 +68,8 @@ class CompressionSimulator {
   void recvAck(CompressionScheme* scheme,
                std::unique_ptr<CompressionScheme::Ack> ack);
 
+  uint64_t nsPerHeader(std::chrono::nanoseconds elapsed) const;
+
   std::chrono::milliseconds deliveryDelay();
   std::chrono::milliseconds rtt();
   std::chrono::milliseconds one_half_rtt();
@@ -9,11 +9,25 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 
 namespace proxygen { namespace compress {
 enum class SchemeType { QPACK, QMIN, HPACK };
 
+inline const char* getSchemeTypeString(SchemeType type) {
+  switch (type) {
+    case SchemeType::QPACK:
+      return "qpack";
+    case SchemeType::QMIN:
+      return "qmin";
+    case SchemeType::HPACK:
+      return "hpack";
+  }
+  return "unknown";
+}
+
 // Metadata about encoded blocks.  In a real stack, these might be
 // conveyed via HTTP frame (HEADERS or PUSH_PROMISE) flags.
 struct FrameFlags {
@@ -47,5 +61,28 @@ struct SimStats {
   uint64_t uncompressed{0};
   uint64_t compressed{0};
   uint64_t packets{0};
+  uint64_t holBlockCount{0};
+  // CPU cost, measured around the scheme's encode/recvAck and decode calls
+  uint64_t requests{0};
+  uint64_t headers{0};
+  std::chrono::nanoseconds encodeTime{0};
+  std::chrono::nanoseconds decodeTime{0};
+
+  SimStats& operator+=(const SimStats& other) {
+    allowedOOO += other.allowedOOO;
+    packetLosses += other.packetLosses;
+    maxQueueBufferBytes =
+        std::max(maxQueueBufferBytes, other.maxQueueBufferBytes);
+    holDelay += other.holDelay;
+    uncompressed += other.uncompressed;
+    compressed += other.compressed;
+    packets += other.packets;
+    holBlockCount += other.holBlockCount;
+    requests += other.requests;
+    headers += other.headers;
+    encodeTime += other.encodeTime;
+    decodeTime += other.decodeTime;
+    return *this;
+  }
 };
 }} // namespace proxygen::compress
@@ -7,17 +7,22 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <folly/FileUtil.h>
+#include <folly/String.h>
 #include <folly/init/Init.h>
+#include <folly/json.h>
 #include <folly/portability/GFlags.h>
 
 #include "proxygen/lib/http/codec/compress/experimental/simulator/CompressionSimulator.h"
+#include "proxygen/lib/http/codec/compress/experimental/simulator/ReplayBenchmark.h"
 #include <proxygen/lib/http/codec/compress/HPACKEncoder.h>
 #include <proxygen/lib/http/codec/compress/HPACKHeader.h>
 
 DEFINE_string(input, "", "File containing requests");
 DEFINE_string(scheme,
               "qpack",
-              "Scheme: <qpack|qmin|hpack>");
+              "Scheme: <qpack|qmin|hpack>, or a comma separated list to "
+              "compare several in replay mode");
 
 DEFINE_int32(rtt, 100, "Simulated RTT");
 DEFINE_double(lossp, 0.0, "Loss Probability");
@@ -33,9 +38,83 @@ DEFINE_bool(same_packet_compression,
             true,
             "Allow QPACK to compress across "
             "headers the same packet");
+DEFINE_int32(connections, 1,
+             "Replay the input over this many simulated connections");
+DEFINE_int32(threads, 0,
+             "Threads to spread connections over in replay mode, "
+             "0 for one per core");
+DEFINE_string(json_output, "",
+              "Write replay results as JSON to this file, - for stdout");
 
 using namespace proxygen::compress;
 
+namespace {
+
+bool parseScheme(const std::string& name, SchemeType& t) {
+  if (name == "qpack") {
+    t = SchemeType::QPACK;
+  } else if (name == "qmin") {
+    t = SchemeType::QMIN;
+  } else if (name == "hpack") {
+    t = SchemeType::HPACK;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Replay the input over many connections per scheme and report CPU and
+// compression results, optionally as JSON for regression tracking.
+int runReplayMode(const std::vector<SchemeType>& schemes,
+                  const SimParams& baseParams) {
+  auto requests = CompressionSimulator::readInputFromFile(FLAGS_input);
+  if (requests.empty()) {
+    return 1;
+  }
+  folly::dynamic results = folly::dynamic::array;
+  for (auto t : schemes) {
+#ifndef HAVE_REAL_QMIN
+    if (t == SchemeType::QMIN) {
+      LOG(INFO) << "QMIN not available";
+      continue;
+    }
+#endif
+    SimParams p = baseParams;
+    p.type = t;
+    auto result = runReplay(p, requests, uint32_t(FLAGS_connections),
+                            uint32_t(FLAGS_threads));
+    LOG(INFO) << getSchemeTypeString(t)
+              << ": connections=" << result.connections
+              << " threads=" << result.threads
+              << " requests=" << result.stats.requests
+              << " headers=" << result.stats.headers
+              << " encode ns/header=" << result.encodeNsPerHeader()
+              << " decode ns/header=" << result.decodeNsPerHeader()
+              << " compressed bytes/header="
+              << result.compressedBytesPerHeader()
+              << " wall time ms="
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                result.wallTime).count();
+    results.push_back(result.toDynamic());
+  }
+  if (!FLAGS_json_output.empty()) {
+    folly::dynamic output = folly::dynamic::object
+      ("input", FLAGS_input)
+      ("seed", baseParams.seed)
+      ("results", std::move(results));
+    auto json = folly::toPrettyJson(output);
+    if (FLAGS_json_output == "-") {
+      std::cout << json << std::endl;
+    } else if (!folly::writeFile(json, FLAGS_json_output.c_str())) {
+      LOG(ERROR) << "Failed to write " << FLAGS_json_output;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+}
+
 int main(int argc, char* argv[]) {
   folly::init(&argc, &argv, true);
   if (FLAGS_same_packet_compression) {
@@ -47,19 +126,28 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  SchemeType t = SchemeType::QPACK;
-  if (FLAGS_scheme == "qpack") {
+  std::vector<std::string> schemeNames;
+  folly::split(',', FLAGS_scheme, schemeNames, true);
+  std::vector<SchemeType> schemes;
+  for (const auto& name : schemeNames) {
+    SchemeType t;
+    if (!parseScheme(name, t)) {
+      LOG(ERROR) << "Unsupported scheme=" << name;
+      return 1;
+    }
+    schemes.push_back(t);
+  }
+  if (schemes.empty()) {
+    LOG(ERROR) << "Unsupported scheme";
+    return 1;
+  }
+  SchemeType t = schemes.front();
+  if (t == SchemeType::QPACK) {
     LOG(INFO) << "Using QPACK";
-    t = SchemeType::QPACK;
-  } else if (FLAGS_scheme == "qmin") {
+  } else if (t == SchemeType::QMIN) {
     LOG(INFO) << "Using QMIN";
-    t = SchemeType::QMIN;
-  } else if (FLAGS_scheme == "hpack") {
-    LOG(INFO) << "Using HPACK with table size=" << FLAGS_table_size;
-    t = SchemeType::HPACK;
   } else {
-    LOG(ERROR) << "Unsupported scheme";
-    return 1;
+    LOG(INFO) << "Using HPACK with table size=" << FLAGS_table_size;
   }
 
   if (FLAGS_seed == 0) {
@@ -77,6 +165,11 @@ int main(int argc, char* argv[]) {
               FLAGS_same_packet_compression,
               uint32_t(FLAGS_table_size),
               uint32_t(FLAGS_max_blocking)};
+  if (FLAGS_connections > 1 || schemes.size() > 1 ||
+      !FLAGS_json_output.empty()) {
+    return runReplayMode(schemes, p);
+  }
+
   CompressionSimulator sim(p);
   if (sim.readInputFromFileAndSchedule(FLAGS_input)) {
     sim.run();
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <assert.h>
+#include <atomic>
 #include <folly/String.h>
 #include <proxygen/lib/http/codec/compress/HPACKCodec.h>
 #include <proxygen/lib/http/codec/compress/HPACKQueue.h>
@@ -104,7 +105,7 @@ static void qmin_dec_destroy(struct qmin_dec * /*dec*/) {
 }
 #endif
 
-static unsigned s_seq;
+static std::atomic<unsigned> s_seq{0};
 
 TAILQ_HEAD(stream_chunks_head, stream_chunk);
 
@@ -401,7 +402,7 @@ class QMINScheme : public CompressionScheme {
       decoded_size += name_len + val_len;
       std::string name{outbuf, name_len};
       std::string value{outbuf + name_len, val_len};
-      callback.onHeader(name, value);
+      callback.onHeader(HPACKHeaderName(name), value);
     }
 
     if (0 != qmin_dec_stream_done(qms_dec, stream_id)) {
@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "proxygen/lib/http/codec/compress/experimental/simulator/ReplayBenchmark.h"
+#include "proxygen/lib/http/codec/compress/experimental/simulator/CompressionSimulator.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using namespace folly;
+
+namespace proxygen { namespace compress {
+
+uint64_t ReplayResult::encodeNsPerHeader() const {
+  return stats.headers ? stats.encodeTime.count() / stats.headers : 0;
+}
+
+uint64_t ReplayResult::decodeNsPerHeader() const {
+  return stats.headers ? stats.decodeTime.count() / stats.headers : 0;
+}
+
+double ReplayResult::compressedBytesPerHeader() const {
+  return stats.headers ? double(stats.compressed) / stats.headers : 0;
+}
+
+double ReplayResult::uncompressedBytesPerHeader() const {
+  return stats.headers ? double(stats.uncompressed) / stats.headers : 0;
+}
+
+dynamic ReplayResult::toDynamic() const {
+  return dynamic::object
+    ("scheme", getSchemeTypeString(type))
+    ("connections", connections)
+    ("threads", threads)
+    ("wall_time_ms",
+     std::chrono::duration_cast<std::chrono::milliseconds>(wallTime).count())
+    ("requests", stats.requests)
+    ("headers", stats.headers)
+    ("uncompressed_bytes", stats.uncompressed)
+    ("compressed_bytes", stats.compressed)
+    ("compression_ratio",
+     stats.uncompressed ?
+     1.0 - double(stats.compressed) / stats.uncompressed : 0.0)
+    ("uncompressed_bytes_per_header", uncompressedBytesPerHeader())
+    ("compressed_bytes_per_header", compressedBytesPerHeader())
+    ("encode_ns_per_header", encodeNsPerHeader())
+    ("decode_ns_per_header", decodeNsPerHeader())
+    ("packets", stats.packets)
+    ("packet_losses", stats.packetLosses)
+    ("allowed_ooo", stats.allowedOOO)
+    ("hol_block_count", stats.holBlockCount)
+    ("hol_delay_ms", stats.holDelay.count())
+    ("max_queue_buffer_bytes", stats.maxQueueBufferBytes);
+}
+
+ReplayResult runReplay(const SimParams& params,
+                       const vector<HTTPMessage>& requests,
+                       uint32_t connections,
+                       uint32_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::min(threads, connections);
+
+  ReplayResult result;
+  result.type = params.type;
+  result.connections = connections;
+  result.threads = threads;
+
+  std::atomic<uint32_t> nextConnection{0};
+  std::mutex statsMutex;
+  auto worker = [&] {
+    SimStats local;
+    while (true) {
+      auto conn = nextConnection.fetch_add(1);
+      if (conn >= connections) {
+        break;
+      }
+      SimParams connParams = params;
+      connParams.seed = params.seed + conn;
+      CompressionSimulator sim(connParams);
+      if (!sim.scheduleRequests(requests)) {
+        continue;
+      }
+      sim.simulate();
+      local += sim.getStats();
+      VLOG(2) << "Finished connection=" << conn;
+    }
+    std::lock_guard<std::mutex> g(statsMutex);
+    result.stats += local;
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  vector<std::thread> workers;
+  workers.reserve(threads);
+  for (uint32_t i = 0; i < threads; i++) {
+    workers.emplace_back(worker);
+  }
+  for (auto& t : workers) {
+    t.join();
+  }
+  result.wallTime = std::chrono::steady_clock::now() - start;
+  return result;
+}
+
+}} // namespace proxygen::compress
@@ -0,0 +1,48 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "proxygen/lib/http/codec/compress/experimental/simulator/CompressionTypes.h"
+
+#include <chrono>
+#include <folly/dynamic.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <vector>
+
+namespace proxygen { namespace compress {
+
+struct ReplayResult {
+  SchemeType type;
+  uint32_t connections{0};
+  uint32_t threads{0};
+  std::chrono::nanoseconds wallTime{0};
+  // Sum over all connections
+  SimStats stats;
+
+  uint64_t encodeNsPerHeader() const;
+  uint64_t decodeNsPerHeader() const;
+  double compressedBytesPerHeader() const;
+  double uncompressedBytesPerHeader() const;
+
+  folly::dynamic toDynamic() const;
+};
+
+/**
+ * Replays the same trace over `connections` independent simulated
+ * connections, each with its own CompressionSimulator and EventBase, spread
+ * across `threads` threads (0 means one per core).  Connection i uses seed
+ * params.seed + i so loss and delay differ between connections.
+ */
+ReplayResult runReplay(const SimParams& params,
+                       const std::vector<proxygen::HTTPMessage>& requests,
+                       uint32_t connections,
+                       uint32_t threads);
+
+}} // namespace proxygen::compress
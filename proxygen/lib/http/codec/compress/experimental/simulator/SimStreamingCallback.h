@@ -32,26 +32,33 @@ class SimStreamingCallback : public HPACK::StreamingCallback {
     std::swap(headersCompleteCb, goner.headersCompleteCb);
   }
 
-  void onHeader(const folly::fbstring& name,
+  void onHeader(const HPACKHeaderName& name,
                 const folly::fbstring& value) override {
-    if (name[0] == ':' && !isPublic) {
-      if (name == headers::kMethod) {
-        msg.setMethod(value);
-      } else if (name == headers::kScheme) {
-        if (value == headers::kHttps) {
-          msg.setSecure(true);
-        }
-      } else if (name == headers::kAuthority) {
-        msg.getHeaders().add(HTTP_HEADER_HOST, value.toStdString());
-      } else if (name == headers::kPath) {
-        msg.setURL(value.toStdString());
-      } else if (name == headers::kStatus) {
-        msg.setStatusCode(folly::to<uint16_t>(value.toStdString()));
-      } else {
-        DCHECK(false) << "Bad header name=" << name << " value=" << value;
+    if (name.get()[0] == ':' && !isPublic) {
+      switch (name.getHeaderCode()) {
+        case HTTP_HEADER_COLON_METHOD:
+          msg.setMethod(value);
+          break;
+        case HTTP_HEADER_COLON_SCHEME:
+          if (value == headers::kHttps) {
+            msg.setSecure(true);
+          }
+          break;
+        case HTTP_HEADER_COLON_AUTHORITY:
+          msg.getHeaders().add(HTTP_HEADER_HOST, value.toStdString());
+          break;
+        case HTTP_HEADER_COLON_PATH:
+          msg.setURL(value.toStdString());
+          break;
+        case HTTP_HEADER_COLON_STATUS:
+          msg.setStatusCode(folly::to<uint16_t>(value.toStdString()));
+          break;
+        default:
+          DCHECK(false) << "Bad header name=" << name.get()
+                        << " value=" << value;
       }
     } else {
-      msg.getHeaders().add(name.toStdString(), value.toStdString());
+      msg.getHeaders().addFromCodec(name.getHeaderCode(), name.get(), value);
     }
   }
 
@@ -7,10 +7,16 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <proxygen/lib/http/codec/CodecUtil.h>
+#include <proxygen/lib/http/codec/HeaderDecodeInfo.h>
+#include <proxygen/lib/http/codec/compress/HPACKCodec.h>
+#include <proxygen/lib/http/codec/compress/QPACKCodec.h>
+#include <proxygen/lib/http/codec/compress/test/HTTPArchive.h>
 #include <proxygen/lib/http/codec/compress/test/TestUtil.h>
 #include <proxygen/lib/http/codec/compress/test/TestStreamingCallback.h>
 #include <folly/Benchmark.h>
 #include <folly/Range.h>
+#include <folly/portability/GFlags.h>
 
 #include <algorithm>
 
@@ -19,6 +25,10 @@ using namespace folly;
 using namespace proxygen;
 using proxygen::HPACKHeader;
 
+DEFINE_string(har, "",
+              "HAR file whose requests the decode benchmarks replay; by default "
+              "they decode a single browser request");
+
 unique_ptr<IOBuf> encode(vector<HPACKHeader>& headers, HPACKEncoder& encoder) {
   return encoder.encode(headers);
 }
@@ -53,8 +63,30 @@ vector<HPACKHeader> getHeaders() {
   return headers;
 }
 
+// The same request as getHeaders, as the HTTP/2 and HTTP/3 codecs get it
+HTTPMessage getMessage() {
+  HTTPMessage msg;
+  msg.setMethod(HTTPMethod::GET);
+  msg.setURL("/graphql");
+  msg.setSecure(true);
+  auto& h = msg.getHeaders();
+  h.set(HTTP_HEADER_HOST, "www.facebook.com");
+  h.set(
+    HTTP_HEADER_USER_AGENT,
+    "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_12_6) AppleWebKit/537.36 "
+    "(KHTML, like Gecko) Chrome/60.0.3100.0 Safari/537.36");
+  h.set(HTTP_HEADER_ACCEPT_ENCODING, "gzip, deflate, br");
+  h.set(HTTP_HEADER_ACCEPT_LANGUAGE, "en-US,en;q=0.8");
+  h.set(
+    HTTP_HEADER_ACCEPT,
+    "text/html,application/xhtml+xml,application/xml;q=0.9,image/"
+    "webp,image/apng,*/*;q=0.8");
+  return msg;
+}
+
 namespace {
 static vector<HPACKHeader> headers = getHeaders();
+static HTTPMessage message = getMessage();
 }
 
 void encodeBench(int reencodes, int iters) {
@@ -78,6 +110,108 @@ void encodeDecodeBench(int reencodes, int iters) {
   }
 }
 
+// HTTPMessage to wire, as HTTP2Codec and HQStreamCodec encode headers.
+// Prepared converts the message to HPACKHeaders first, Direct encodes from
+// the message's headers in place.
+void messageEncodeBench(bool qpack, bool direct, int reencodes, int iters) {
+  for (int i = 0; i < iters; i++) {
+    HPACKEncoder hpackEncoder(true);
+    QPACKEncoder qpackEncoder(true, HPACK::kTableSize);
+    HPACKCodec hpackCodec(TransportDirection::UPSTREAM);
+    QPACKCodec qpackCodec;
+    qpackCodec.setEncoderHeaderTableSize(HPACK::kTableSize);
+    for (int j = 0; j <= reencodes; j++) {
+      vector<string> temps;
+      auto allHeaders =
+        CodecUtil::prepareMessageForCompression(message, temps);
+      if (direct && qpack) {
+        folly::doNotOptimizeAway(qpackCodec.encode(allHeaders, j + 1));
+      } else if (direct) {
+        folly::doNotOptimizeAway(hpackCodec.encode(allHeaders));
+      } else {
+        auto prepared = compress::prepareHeaders(allHeaders);
+        if (qpack) {
+          folly::doNotOptimizeAway(
+            qpackEncoder.encode(prepared.first, 0, j + 1));
+        } else {
+          folly::doNotOptimizeAway(hpackEncoder.encode(prepared.first));
+        }
+      }
+    }
+  }
+}
+
+// Decodes header blocks into HTTPMessages the way HTTP2Codec does.  With
+// rehash set every decoded name is looked up again by string, as happened
+// before the header codes were passed along with the names.
+class MessageCallback : public HPACK::StreamingCallback {
+ public:
+  explicit MessageCallback(bool rehash) : rehash_(rehash) {}
+
+  void start() {
+    decodeInfo_.init(true, false);
+  }
+
+  void onHeader(const HPACKHeaderName& name,
+                const folly::fbstring& value) override {
+    if (rehash_) {
+      CHECK(decodeInfo_.onHeader(HPACKHeaderName(name.get()), value));
+    } else {
+      CHECK(decodeInfo_.onHeader(name, value));
+    }
+  }
+
+  void onHeadersComplete(HTTPHeaderSize decodedSize,
+                         bool /*acknowledge*/) override {
+    decodeInfo_.onHeadersComplete(decodedSize);
+    CHECK(decodeInfo_.parsingError.empty()) << decodeInfo_.parsingError;
+    folly::doNotOptimizeAway(decodeInfo_.msg);
+    decodeInfo_.msg.reset();
+  }
+
+  void onDecodeError(HPACK::DecodeError decodeError) override {
+    LOG(FATAL) << "Decode error " << decodeError;
+  }
+
+ private:
+  HeaderDecodeInfo decodeInfo_;
+  bool rehash_;
+};
+
+// The requests of the HAR file, or getMessage, as one connection's worth of
+// HPACK header blocks
+vector<unique_ptr<IOBuf>> getRequestBlocks() {
+  vector<HTTPMessage> requests;
+  if (!FLAGS_har.empty()) {
+    auto har = HTTPArchive::fromFile(FLAGS_har);
+    CHECK(har) << "Could not read " << FLAGS_har;
+    requests = std::move(har->requests);
+  } else {
+    requests.push_back(message);
+  }
+  HPACKCodec encoder(TransportDirection::UPSTREAM);
+  vector<unique_ptr<IOBuf>> blocks;
+  for (const auto& request : requests) {
+    vector<string> temps;
+    auto allHeaders = CodecUtil::prepareMessageForCompression(request, temps);
+    blocks.push_back(encoder.encode(allHeaders));
+  }
+  return blocks;
+}
+
+void decodeToMessageBench(bool rehash, int iters) {
+  static vector<unique_ptr<IOBuf>> blocks = getRequestBlocks();
+  for (int i = 0; i < iters; i++) {
+    HPACKCodec decoder(TransportDirection::DOWNSTREAM);
+    MessageCallback cb(rehash);
+    for (const auto& block : blocks) {
+      cb.start();
+      folly::io::Cursor c(block.get());
+      decoder.decodeStreaming(c, c.totalLength(), &cb);
+    }
+  }
+}
+
 BENCHMARK(Encode, iters) {
   encodeBench(0, iters);
 }
@@ -102,6 +236,34 @@ BENCHMARK(EncodeDecode2, iters) {
   encodeDecodeBench(2, iters);
 }
 
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(MessageEncodeHPACKPrepared2, iters) {
+  messageEncodeBench(false, false, 2, iters);
+}
+
+BENCHMARK_RELATIVE(MessageEncodeHPACKDirect2, iters) {
+  messageEncodeBench(false, true, 2, iters);
+}
+
+BENCHMARK(MessageEncodeQPACKPrepared2, iters) {
+  messageEncodeBench(true, false, 2, iters);
+}
+
+BENCHMARK_RELATIVE(MessageEncodeQPACKDirect2, iters) {
+  messageEncodeBench(true, true, 2, iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(DecodeToMessageRehash, iters) {
+  decodeToMessageBench(true, iters);
+}
+
+BENCHMARK_RELATIVE(DecodeToMessage, iters) {
+  decodeToMessageBench(false, iters);
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
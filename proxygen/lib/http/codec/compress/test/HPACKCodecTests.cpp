@@ -295,6 +295,28 @@ TEST_F(HPACKCodecTests, DefaultHeaderIndexingStrategy) {
     testCodec.getCompressionInfo().egressHeadersStored_, headersIndexableSize);
 }
 
+TEST_F(HPACKCodecTests, DirectEncodeMatchesPrepared) {
+  vector<vector<string>> strings = {
+    {"Content-Length", "80"},
+    {"X-FB-Debug", "bleah"},
+    {":path", "/some/random/file.jpg"},
+    {"x-fb-debug", "bleah"}
+  };
+  vector<Header> headers = basicHeaders();
+  vector<Header> extra = headersFromArray(strings);
+  headers.insert(headers.end(), extra.begin(), extra.end());
+
+  HPACKEncoder direct(true);
+  HPACKEncoder prepared(true);
+  // The second round references the entries the first one inserted
+  for (int i = 0; i < 2; i++) {
+    auto directBuf = direct.encode(headers);
+    auto preparedBuf = prepared.encode(prepareHeaders(headers).first);
+    EXPECT_TRUE(IOBufEqualTo()(directBuf, preparedBuf));
+  }
+  EXPECT_EQ(direct.getHeadersStored(), prepared.getHeadersStored());
+}
+
 
 class HPACKQueueTests : public testing::TestWithParam<int> {
  public:
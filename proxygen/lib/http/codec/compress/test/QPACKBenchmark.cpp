@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/codec/compress/QPACKDecoder.h>
+#include <proxygen/lib/http/codec/compress/QPACKEncoder.h>
+#include <proxygen/lib/http/codec/compress/test/TestStreamingCallback.h>
+#include <proxygen/lib/test/AllocationCounter.h>
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+
+using namespace std;
+using namespace folly;
+using namespace proxygen;
+
+namespace {
+
+struct Flight {
+  std::vector<std::unique_ptr<IOBuf>> control;
+  std::vector<std::unique_ptr<IOBuf>> streams;
+};
+
+// Encode `numStreams` requests which each insert one new entry, so that every
+// request stream blocks on its own insert when delivered ahead of the encoder
+// stream.
+Flight makeFlight(uint32_t numStreams) {
+  QPACKEncoder encoder(false, 64 * 1024);
+  encoder.setMaxVulnerable(numStreams);
+  encoder.setMaxNumOutstandingBlocks(numStreams);
+  Flight flight;
+  for (uint32_t i = 0; i < numStreams; i++) {
+    vector<HPACKHeader> req;
+    req.emplace_back(":method", "GET");
+    req.emplace_back(":path", folly::to<string>("/segment/", i));
+    req.emplace_back("x-request-id", folly::to<string>(i * 7919));
+    auto res = encoder.encode(req, 0, i);
+    CHECK(res.control);
+    flight.control.emplace_back(std::move(res.control));
+    flight.streams.emplace_back(std::move(res.stream));
+  }
+  return flight;
+}
+
+// Queue every request stream, then deliver the encoder stream in bursts of
+// `burst` instructions.  When `reverse` is set the request streams arrive in
+// the opposite order from their inserts, which is the worst case for a FIFO.
+void blockedDecode(UserCounters& counters, uint32_t iters,
+                   uint32_t numStreams, uint32_t burst, bool reverse) {
+  uint64_t allocs = 0;
+  uint64_t blocks = 0;
+  for (uint32_t iter = 0; iter < iters; iter++) {
+    Flight flight;
+    std::vector<TestStreamingCallback> cbs;
+    BENCHMARK_SUSPEND {
+      flight = makeFlight(numStreams);
+      cbs.resize(numStreams);
+    }
+    QPACKDecoder decoder(64 * 1024);
+    decoder.setMaxBlocking(numStreams);
+    auto before = getAllocationCount();
+    for (uint32_t i = 0; i < numStreams; i++) {
+      auto id = reverse ? numStreams - i - 1 : i;
+      auto len = flight.streams[id]->computeChainDataLength();
+      decoder.decodeStreaming(id, std::move(flight.streams[id]), len,
+                              &cbs[id]);
+    }
+    IOBufQueue control{IOBufQueue::cacheChainLength()};
+    for (uint32_t i = 0; i < numStreams; i++) {
+      control.append(std::move(flight.control[i]));
+      if ((i + 1) % burst == 0 || i + 1 == numStreams) {
+        decoder.decodeEncoderStream(control.move());
+      }
+    }
+    allocs += getAllocationCount() - before;
+    blocks += numStreams;
+    BENCHMARK_SUSPEND {
+      CHECK_EQ(decoder.getQueuedBlocks(), 0);
+      for (auto& cb: cbs) {
+        CHECK(!cb.hasError());
+      }
+    }
+  }
+  if (blocks > 0) {
+    counters["allocs_per_100_blocks"] = int(allocs * 100 / blocks);
+  }
+}
+}
+
+BENCHMARK_COUNTERS(Blocked100Burst1, counters, iters) {
+  blockedDecode(counters, iters, 100, 1, false);
+}
+
+BENCHMARK_COUNTERS(Blocked100Burst10, counters, iters) {
+  blockedDecode(counters, iters, 100, 10, false);
+}
+
+BENCHMARK_COUNTERS(Blocked500Burst1, counters, iters) {
+  blockedDecode(counters, iters, 500, 1, false);
+}
+
+BENCHMARK_COUNTERS(Blocked500Burst50, counters, iters) {
+  blockedDecode(counters, iters, 500, 50, false);
+}
+
+BENCHMARK_COUNTERS(Blocked500Burst1Reverse, counters, iters) {
+  blockedDecode(counters, iters, 500, 1, true);
+}
+
+BENCHMARK_COUNTERS(Blocked500Burst50Reverse, counters, iters) {
+  blockedDecode(counters, iters, 500, 50, true);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -12,6 +12,7 @@
 #include <folly/io/IOBuf.h>
 #include <glog/logging.h>
 #include <folly/portability/GTest.h>
+#include <proxygen/lib/http/codec/compress/HPACKCodec.h>
 #include <proxygen/lib/http/codec/compress/Header.h>
 #include <proxygen/lib/http/codec/compress/HeaderCodec.h>
 #include <proxygen/lib/http/codec/compress/QPACKCodec.h>
@@ -234,3 +235,25 @@ TEST_F(QPACKTests, HeaderCodecStats) {
   EXPECT_EQ(stats.encodedBytesUncompr, 0);
   client.setStats(nullptr);
 }
+
+TEST(QPACKEncoderTest, DirectEncodeMatchesPrepared) {
+  vector<vector<string>> strings = {
+    {"Content-Length", "80"},
+    {"X-FB-Debug", "bleah"},
+    {"x-fb-debug", "bleah"}
+  };
+  vector<Header> headers = basicHeaders();
+  vector<Header> extra = headersFromArray(strings);
+  headers.insert(headers.end(), extra.begin(), extra.end());
+
+  QPACKEncoder direct(true, 4096);
+  QPACKEncoder prepared(true, 4096);
+  for (uint64_t streamId = 1; streamId <= 2; streamId++) {
+    auto directRes = direct.encode(headers, 0, streamId);
+    auto preparedRes =
+      prepared.encode(prepareHeaders(headers).first, 0, streamId);
+    EXPECT_TRUE(IOBufEqualTo()(directRes.control, preparedRes.control));
+    EXPECT_TRUE(IOBufEqualTo()(directRes.stream, preparedRes.stream));
+  }
+  EXPECT_EQ(direct.getHeadersStored(), prepared.getHeadersStored());
+}
@@ -536,6 +536,49 @@ TEST(QPACKContextTests, TestDecodeQueue) {
   verifyDecode(decoder, std::move(result1), req1);
 }
 
+TEST(QPACKContextTests, TestDecodeQueueOrder) {
+  QPACKEncoder encoder(false, 4096);
+  QPACKDecoder decoder(4096);
+
+  // Each request inserts a new entry and blocks on it
+  std::vector<QPACKEncoder::EncodeResult> results;
+  std::vector<vector<HPACKHeader>> reqs(3);
+  for (auto i = 0; i < 3; i++) {
+    reqs[i].emplace_back("x-stream", folly::to<string>(i));
+    results.emplace_back(encoder.encode(reqs[i], 0, i));
+  }
+
+  std::vector<TestStreamingCallback> cbs(3);
+  std::vector<int> completed;
+  for (auto i = 0; i < 3; i++) {
+    cbs[i].headersCompleteCb = [&completed, i] {
+      completed.push_back(i);
+    };
+  }
+  // Queue out of order, then cancel the middle one
+  for (auto i: {2, 0, 1}) {
+    auto length = results[i].stream->computeChainDataLength();
+    decoder.decodeStreaming(i, std::move(results[i].stream), length, &cbs[i]);
+  }
+  EXPECT_EQ(decoder.getQueuedBlocks(), 3);
+  decoder.encodeCancelStream(1);
+  EXPECT_EQ(decoder.getQueuedBlocks(), 2);
+
+  EXPECT_EQ(decoder.decodeEncoderStream(std::move(results[0].control)),
+            HPACK::DecodeError::NONE);
+  EXPECT_EQ(completed, std::vector<int>({0}));
+  EXPECT_EQ(decoder.decodeEncoderStream(std::move(results[1].control)),
+            HPACK::DecodeError::NONE);
+  EXPECT_EQ(completed, std::vector<int>({0}));
+  EXPECT_EQ(decoder.decodeEncoderStream(std::move(results[2].control)),
+            HPACK::DecodeError::NONE);
+  EXPECT_EQ(completed, std::vector<int>({0, 2}));
+  EXPECT_EQ(*cbs[2].hpackHeaders(), reqs[2]);
+  EXPECT_EQ(decoder.getQueuedBlocks(), 0);
+  EXPECT_EQ(decoder.getQueuedBytes(), 0);
+  EXPECT_EQ(decoder.getHolBlockCount(), 3);
+}
+
 TEST(QPACKContextTests, TestDecodeQueueDelete) {
   // This test deletes the decoder from a callback while there are items in
   // the queue
@@ -151,6 +151,23 @@ TEST_F(DefaultFlowControl, SendUpdate) {
   filter_->ingressBytesProcessed(writeBuf_, 1);
 }
 
+TEST_F(DefaultFlowControl, GrowAcksProcessed) {
+  // Growing the window mid-stream also acks what was processed so far
+  InSequence enforceSequence;
+  EXPECT_CALL(callback_, onBody(_, _, _))
+    .WillRepeatedly(Return());
+
+  callbackStart_->onBody(1, makeBuf(kInitialCapacity), 0);
+  filter_->ingressBytesProcessed(writeBuf_, 100);
+
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, kInitialCapacity + 100));
+  filter_->setReceiveWindowSize(writeBuf_, 2 * kInitialCapacity);
+
+  // The whole grown window is available again, less the unprocessed bytes
+  callbackStart_->onBody(1, makeBuf(kInitialCapacity + 100), 0);
+  ASSERT_TRUE(chain_->isReusable());
+}
+
 TEST_F(BigWindow, RecvTooMuch) {
   // Constructing the filter with a large capacity causes a WINDOW_UPDATE
   // for stream zero to be generated
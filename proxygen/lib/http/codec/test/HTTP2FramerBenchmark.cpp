@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/http/codec/HTTP2Framer.h>
+
+#include <limits.h>
+
+using namespace folly;
+using namespace proxygen;
+
+namespace {
+
+const size_t kBytesPerMB = 1024 * 1024;
+// Linux caps a single writev at IOV_MAX iovecs
+const size_t kIovMax = IOV_MAX;
+
+// Frame 1MB of body as chunkSize DATA frames on one stream, the way a
+// streaming response would, then count the iovecs a writev of the resulting
+// chain would need.
+void frameData(UserCounters& counters,
+               uint32_t iters,
+               size_t chunkSize,
+               uint32_t coalesceThreshold) {
+  std::unique_ptr<IOBuf> chunk;
+  BENCHMARK_SUSPEND {
+    chunk = IOBuf::create(chunkSize);
+    memset(chunk->writableData(), 'a', chunkSize);
+    chunk->append(chunkSize);
+  }
+  size_t iovecs = 0;
+  size_t syscalls = 0;
+  for (uint32_t i = 0; i < iters; i++) {
+    IOBufQueue writeBuf{IOBufQueue::cacheChainLength()};
+    for (size_t written = 0; written < kBytesPerMB; written += chunkSize) {
+      // Body chunks typically come from the application as separate buffers
+      http2::writeData(writeBuf, chunk->clone(), 1, http2::kNoPadding,
+                       false, true, coalesceThreshold);
+    }
+    BENCHMARK_SUSPEND {
+      auto elements = writeBuf.front()->countChainElements();
+      iovecs += elements;
+      syscalls += (elements + kIovMax - 1) / kIovMax;
+    }
+  }
+  if (iters > 0) {
+    counters["iovecs_per_MB"] = int(iovecs / iters);
+    counters["writev_per_MB"] = int(syscalls / iters);
+  }
+}
+}
+
+BENCHMARK_COUNTERS(Chained64, counters, iters) {
+  frameData(counters, iters, 64, 0);
+}
+
+BENCHMARK_COUNTERS(Coalesced64, counters, iters) {
+  frameData(counters, iters, 64, 1024);
+}
+
+BENCHMARK_COUNTERS(Chained256, counters, iters) {
+  frameData(counters, iters, 256, 0);
+}
+
+BENCHMARK_COUNTERS(Coalesced256, counters, iters) {
+  frameData(counters, iters, 256, 1024);
+}
+
+BENCHMARK_COUNTERS(Chained1024, counters, iters) {
+  frameData(counters, iters, 1024, 0);
+}
+
+BENCHMARK_COUNTERS(Coalesced1024, counters, iters) {
+  frameData(counters, iters, 1024, 1024);
+}
+
+BENCHMARK_COUNTERS(Chained4096, counters, iters) {
+  frameData(counters, iters, 4096, 0);
+}
+
+BENCHMARK_COUNTERS(Coalesced4096, counters, iters) {
+  frameData(counters, iters, 4096, 1024);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -182,6 +182,33 @@ TEST_F(HTTP2FramerTest, UseHeadroomOptimization) {
   EXPECT_LT(queueNode->headroom(), headRoomSize);
 }
 
+TEST_F(HTTP2FramerTest, CoalesceSmallData) {
+  queue_.move();
+  std::vector<std::unique_ptr<IOBuf>> bodies;
+  for (auto len : {10, 20, 30}) {
+    bodies.emplace_back(makeBuf(len));
+    writeData(queue_, bodies.back()->clone(), 1,
+              (len == 20) ? Padding(5) : kNoPadding, len == 30, true,
+              100 /* coalesceThreshold */);
+  }
+  // A body over the threshold is still chained
+  bodies.emplace_back(makeBuf(200));
+  writeData(queue_, bodies.back()->clone(), 1, kNoPadding, false, true, 100);
+  EXPECT_EQ(queue_.front()->countChainElements(), 2);
+
+  Cursor cursor(queue_.front());
+  for (auto& body : bodies) {
+    FrameHeader outHeader;
+    std::unique_ptr<IOBuf> outBuf;
+    uint16_t padding = 0;
+    ASSERT_EQ(parseFrameHeader(cursor, outHeader), ErrorCode::NO_ERROR);
+    ASSERT_EQ(parseData(cursor, outHeader, outBuf, padding),
+              ErrorCode::NO_ERROR);
+    EXPECT_EQ(outBuf->moveToFbString(), body->moveToFbString());
+  }
+  EXPECT_TRUE(cursor.isAtEnd());
+}
+
 TEST_F(HTTP2FramerTest, BadStreamId) {
   // We should crash on DBG builds if the stream id > 2^31 - 1
   EXPECT_DEATH_NO_CORE(writeRstStream(queue_,
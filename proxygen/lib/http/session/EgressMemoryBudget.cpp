@@ -0,0 +1,206 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/EgressMemoryBudget.h>
+
+#include <folly/ScopeGuard.h>
+#include <folly/io/async/EventBase.h>
+#include <proxygen/lib/http/session/HTTPSessionBase.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace proxygen {
+
+uint64_t EgressMemoryBudget::workerLimit_{0};
+uint64_t EgressMemoryBudget::processLimit_{0};
+std::atomic<uint64_t> EgressMemoryBudget::processBufferedBytes_{0};
+std::mutex EgressMemoryBudget::waitingMutex_;
+std::unordered_map<EgressMemoryBudget*, folly::EventBase*>
+    EgressMemoryBudget::waitingBudgets_;
+std::atomic<size_t> EgressMemoryBudget::waitingBudgetCount_{0};
+
+EgressMemoryBudget::~EgressMemoryBudget() {
+  std::lock_guard<std::mutex> lock(waitingMutex_);
+  waitingBudgets_.erase(this);
+  waitingBudgetCount_ = waitingBudgets_.size();
+}
+
+void EgressMemoryBudget::setLimits(uint64_t workerLimit,
+                                   uint64_t processLimit) {
+  workerLimit_ = workerLimit;
+  processLimit_ = processLimit;
+  VLOG(3) << "egress memory budget worker=" << workerLimit
+          << " process=" << processLimit;
+}
+
+EgressMemoryBudget* EgressMemoryBudget::get() {
+  if (workerLimit_ == 0 && processLimit_ == 0) {
+    return nullptr;
+  }
+  static thread_local EgressMemoryBudget budget;
+  return &budget;
+}
+
+void EgressMemoryBudget::addBufferedBytes(int64_t delta) {
+  DCHECK(delta >= 0 || uint64_t(-delta) <= bufferedBytes_);
+  bufferedBytes_ += delta;
+  processBufferedBytes_.fetch_add(delta, std::memory_order_relaxed);
+}
+
+bool EgressMemoryBudget::overBudget() const {
+  return (workerLimit_ > 0 && bufferedBytes_ > workerLimit_) ||
+    (processLimit_ > 0 && getProcessBufferedBytes() > processLimit_);
+}
+
+bool EgressMemoryBudget::belowResumeThreshold() const {
+  return (workerLimit_ == 0 ||
+          bufferedBytes_ <= workerLimit_ * kResumePercent / 100) &&
+    processBelowResumeThreshold();
+}
+
+bool EgressMemoryBudget::processBelowResumeThreshold() {
+  return processLimit_ == 0 ||
+    getProcessBufferedBytes() <= processLimit_ * kResumePercent / 100;
+}
+
+HTTPSessionBase* EgressMemoryBudget::findLargestUnpaused() const {
+  HTTPSessionBase* largest = nullptr;
+  uint64_t largestBytes = 0;
+  for (auto session : sessions_) {
+    auto bytes = session->getPendingWriteSize();
+    if (bytes > largestBytes && paused_.count(session) == 0) {
+      largest = session;
+      largestBytes = bytes;
+    }
+  }
+  return largest;
+}
+
+bool EgressMemoryBudget::onBufferedBytesChanged(HTTPSessionBase& session,
+                                                int64_t delta,
+                                                bool paused) {
+  sessions_.insert(&session);
+  if (auto evb = session.getEventBase()) {
+    evb_ = evb;
+  }
+  addBufferedBytes(delta);
+  if (delta < 0) {
+    wakeWaiting();
+  }
+  if (inRebalance_) {
+    // Another session's resume caused this; the outer call rebalances
+    return paused;
+  }
+
+  if (delta > 0 && overBudget()) {
+    auto largest = findLargestUnpaused();
+    if (largest) {
+      VLOG(3) << "Egress memory budget exceeded worker=" << bufferedBytes_
+              << " process=" << getProcessBufferedBytes()
+              << ", pausing session with "
+              << largest->getPendingWriteSize() << " bytes buffered";
+      paused_.insert(largest);
+      pauseCount_++;
+      updateWaiting();
+      if (largest == &session) {
+        return true;
+      }
+      inRebalance_ = true;
+      SCOPE_EXIT {
+        inRebalance_ = false;
+      };
+      largest->setEgressBudgetPaused(true);
+    }
+  } else if (delta < 0 && !paused_.empty() && belowResumeThreshold()) {
+    resumeAll(&session);
+    return false;
+  }
+  return paused;
+}
+
+void EgressMemoryBudget::resumeAll(HTTPSessionBase* current) {
+  VLOG(3) << "Egress memory budget below threshold worker=" << bufferedBytes_
+          << " process=" << getProcessBufferedBytes() << ", resuming "
+          << paused_.size() << " sessions";
+  // Resume the smallest sessions first.  Resuming runs handler callbacks,
+  // which may buffer more or destroy sessions, so work from a snapshot.
+  std::vector<HTTPSessionBase*> toResume(paused_.begin(), paused_.end());
+  paused_.clear();
+  updateWaiting();
+  std::sort(toResume.begin(), toResume.end(),
+            [] (HTTPSessionBase* a, HTTPSessionBase* b) {
+              return a->getPendingWriteSize() < b->getPendingWriteSize();
+            });
+  inRebalance_ = true;
+  SCOPE_EXIT {
+    inRebalance_ = false;
+  };
+  for (auto session : toResume) {
+    if (session != current && sessions_.count(session) > 0) {
+      session->setEgressBudgetPaused(false);
+    }
+  }
+}
+
+void EgressMemoryBudget::removeSession(HTTPSessionBase& session,
+                                       uint64_t bufferedBytes) {
+  if (sessions_.erase(&session) == 0) {
+    return;
+  }
+  paused_.erase(&session);
+  addBufferedBytes(-int64_t(bufferedBytes));
+  wakeWaiting();
+  // The session may have been what kept this worker over the threshold
+  checkResume();
+}
+
+void EgressMemoryBudget::checkResume() {
+  if (!inRebalance_ && !paused_.empty() && belowResumeThreshold()) {
+    resumeAll(nullptr);
+    return;
+  }
+  updateWaiting();
+}
+
+void EgressMemoryBudget::updateWaiting() {
+  if (processLimit_ == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(waitingMutex_);
+  if (paused_.empty() || !evb_) {
+    waitingBudgets_.erase(this);
+  } else {
+    waitingBudgets_[this] = evb_;
+  }
+  waitingBudgetCount_ = waitingBudgets_.size();
+}
+
+void EgressMemoryBudget::wakeWaiting() {
+  if (processLimit_ == 0 ||
+      waitingBudgetCount_ == 0 ||
+      !processBelowResumeThreshold()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(waitingMutex_);
+  for (auto it = waitingBudgets_.begin(); it != waitingBudgets_.end();) {
+    auto budget = it->first;
+    if (budget == this) {
+      ++it;
+      continue;
+    }
+    // A waiting budget has paused sessions, so its EventBase is alive, and
+    // the budget lives as long as its thread
+    it->second->runInEventBaseThread([budget] { budget->checkResume(); });
+    it = waitingBudgets_.erase(it);
+  }
+  waitingBudgetCount_ = waitingBudgets_.size();
+}
+
+} // namespace proxygen
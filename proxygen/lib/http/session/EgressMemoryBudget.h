@@ -0,0 +1,153 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace folly {
+class EventBase;
+}
+
+namespace proxygen {
+
+class HTTPSessionBase;
+
+/**
+ * Caps the egress bytes buffered by all sessions on a worker thread, and by
+ * all sessions in the process, on top of each session's own write buffer
+ * limit.  A handful of slow readers with many streams each can otherwise pin
+ * writeBufLimit_ bytes per session plus whatever their transactions buffer.
+ *
+ * Sessions report every change in their buffered egress through
+ * onBufferedBytesChanged.  While the worker or process is over budget, each
+ * increase pauses the unpaused session with the most buffered bytes.  Paused
+ * sessions are resumed once usage drops below kResumePercent of the limits.
+ * Usage can drop on another worker, or when a session goes away, so workers
+ * with paused sessions are woken through their EventBase whenever the
+ * process drains below the threshold, and removing a session rechecks too.
+ *
+ * There is one budget per thread.  Limits are process-wide and should be set
+ * before any sessions are created; a limit of 0 means unlimited, and with
+ * both limits at 0 get() returns nullptr and sessions skip the accounting.
+ */
+class EgressMemoryBudget {
+ public:
+  ~EgressMemoryBudget();
+
+  static void setLimits(uint64_t workerLimit, uint64_t processLimit);
+
+  static uint64_t getWorkerLimit() {
+    return workerLimit_;
+  }
+
+  static uint64_t getProcessLimit() {
+    return processLimit_;
+  }
+
+  /**
+   * Returns the budget for the calling thread, or nullptr if no limits are
+   * configured.
+   */
+  static EgressMemoryBudget* get();
+
+  /**
+   * Egress bytes buffered by every session in the process.
+   */
+  static uint64_t getProcessBufferedBytes() {
+    return processBufferedBytes_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Account for a change in session's buffered egress.  May pause or resume
+   * other sessions on this thread.  Returns whether session itself should be
+   * paused by the budget; the caller applies that state.
+   */
+  bool onBufferedBytesChanged(HTTPSessionBase& session,
+                              int64_t delta,
+                              bool paused);
+
+  /**
+   * Forget a session that is going away, along with its buffered bytes.
+   */
+  void removeSession(HTTPSessionBase& session, uint64_t bufferedBytes);
+
+  /** Gauges for this worker */
+  uint64_t getBufferedBytes() const {
+    return bufferedBytes_;
+  }
+
+  size_t getPausedSessionCount() const {
+    return paused_.size();
+  }
+
+  size_t getSessionCount() const {
+    return sessions_.size();
+  }
+
+  /** Number of times this budget has paused a session */
+  uint64_t getPauseCount() const {
+    return pauseCount_;
+  }
+
+  static const uint32_t kResumePercent = 75;
+
+ private:
+  void addBufferedBytes(int64_t delta);
+  bool overBudget() const;
+  bool belowResumeThreshold() const;
+  static bool processBelowResumeThreshold();
+  HTTPSessionBase* findLargestUnpaused() const;
+  void resumeAll(HTTPSessionBase* current);
+
+  /**
+   * Resume the paused sessions if usage has dropped enough.  Called when a
+   * session goes away, and on this worker's EventBase when another worker
+   * drains the process below the threshold.
+   */
+  void checkResume();
+
+  /**
+   * Register this worker to be woken while it has paused sessions, and
+   * unregister it once it has none.
+   */
+  void updateWaiting();
+
+  /**
+   * Wake every other waiting worker after the process dropped below the
+   * threshold.  Each is unregistered; checkResume() registers it again if it
+   * still has paused sessions.
+   */
+  void wakeWaiting();
+
+  std::unordered_set<HTTPSessionBase*> sessions_;
+  std::unordered_set<HTTPSessionBase*> paused_;
+  uint64_t bufferedBytes_{0};
+  uint64_t pauseCount_{0};
+  bool inRebalance_{false};
+  // The EventBase of this worker's sessions
+  folly::EventBase* evb_{nullptr};
+
+  static uint64_t workerLimit_;
+  static uint64_t processLimit_;
+  static std::atomic<uint64_t> processBufferedBytes_;
+
+  // Workers with paused sessions and their EventBases, while there is a
+  // process limit
+  static std::mutex waitingMutex_;
+  static std::unordered_map<EgressMemoryBudget*, folly::EventBase*>
+      waitingBudgets_;
+  static std::atomic<size_t> waitingBudgetCount_;
+};
+
+} // namespace proxygen
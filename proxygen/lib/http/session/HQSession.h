@@ -1458,6 +1458,10 @@ class HQSession
       return false;
     }
 
+    HTTPEventQueue::Pool* getIngressEventQueuePool() noexcept override {
+      return &session_.ingressEventQueuePool_;
+    }
+
     const folly::AsyncTransportWrapper* getUnderlyingTransport() const
         noexcept override {
       VLOG(4) << __func__ << " txn=" << txn_;
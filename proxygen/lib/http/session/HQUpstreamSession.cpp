@@ -122,6 +122,7 @@ void HQUpstreamSession::attachThreadLocals(folly::EventBase* eventBase,
   // TODO: deal with control streams in h2q
   VLOG(4) << __func__ << " sess=" << *this;
   txnEgressQueue_.attachThreadLocals(timeout);
+  attachEgressBudget();
   setController(controller);
   setSessionStats(stats);
   if (sock_) {
@@ -146,6 +147,7 @@ void HQUpstreamSession::detachThreadLocals(bool) {
   }
 
   txnEgressQueue_.detachThreadLocals();
+  detachEgressBudget();
   setController(nullptr);
   setSessionStats(nullptr);
   // The codec filters *shouldn't* be accessible while the socket is detached,
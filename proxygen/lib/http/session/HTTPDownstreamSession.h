@@ -10,12 +10,15 @@
 #pragma once
 
 #include <proxygen/lib/http/session/HTTPSession.h>
+#include <proxygen/lib/utils/FreeList.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
 
 namespace proxygen {
 
 class HTTPSessionStats;
-class HTTPDownstreamSession final : public HTTPSession {
+class HTTPDownstreamSession final
+    : public HTTPSession,
+      public FreeListAllocated<HTTPDownstreamSession> {
  public:
   /**
    * @param sock       An open socket on which any applicable TLS handshaking
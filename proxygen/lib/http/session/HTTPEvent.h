@@ -116,6 +116,21 @@ class HTTPEvent {
     return std::move(body_);
   }
 
+  /**
+   * Whether a BODY event still holds its body, ie getBody was not called
+   */
+  bool hasBody() const {
+    return body_ != nullptr;
+  }
+
+  /**
+   * Append more body to a BODY event that still holds its body
+   */
+  void appendBody(std::unique_ptr<folly::IOBuf> body) {
+    CHECK(event_ == Type::BODY && body_);
+    body_->prependChain(std::move(body));
+  }
+
   std::unique_ptr<HTTPException> getError() {
     return std::move(error_);
   }
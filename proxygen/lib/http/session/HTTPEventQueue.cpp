@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/HTTPEventQueue.h>
+
+namespace proxygen {
+
+void HTTPEventQueue::emplaceBody(HTTPCodec::StreamID streamID,
+                                 std::unique_ptr<folly::IOBuf> chain) {
+  if (size_ > 0) {
+    auto& last = *slots_[index(size_ - 1)];
+    if (last.getEvent() == HTTPEvent::Type::BODY && last.hasBody()) {
+      last.appendBody(std::move(chain));
+      return;
+    }
+  }
+  emplace(streamID, HTTPEvent::Type::BODY, std::move(chain));
+}
+
+void HTTPEventQueue::clear() {
+  while (size_ > 0) {
+    pop();
+  }
+  head_ = 0;
+}
+
+void HTTPEventQueue::grow() {
+  std::vector<folly::Optional<HTTPEvent>> slots(
+      slots_.empty() ? kInitialCapacity : slots_.size() * 2);
+  for (size_t i = 0; i < size_; i++) {
+    slots[i] = std::move(slots_[index(i)]);
+  }
+  slots_ = std::move(slots);
+  head_ = 0;
+}
+
+std::unique_ptr<HTTPEventQueue> HTTPEventQueue::Pool::acquire() {
+  if (free_.empty()) {
+    return std::make_unique<HTTPEventQueue>();
+  }
+  auto queue = std::move(free_.back());
+  free_.pop_back();
+  return queue;
+}
+
+void HTTPEventQueue::Pool::release(std::unique_ptr<HTTPEventQueue> queue) {
+  queue->clear();
+  if (free_.size() < kMaxPooledQueues &&
+      queue->capacity() <= kMaxPooledCapacity) {
+    free_.push_back(std::move(queue));
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,121 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Optional.h>
+#include <proxygen/lib/http/session/HTTPEvent.h>
+
+#include <memory>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * FIFO of HTTPEvents in a ring buffer that only grows, used to defer ingress
+ * while a transaction is paused.
+ *
+ * Consecutive BODY events are coalesced into a single event whose body is the
+ * IOBuf chain of all of them, so a paused upload holds one event no matter
+ * how many DATA frames arrive, and is replayed with a single onBody.
+ *
+ * Queues are recycled through a Pool so a session's transactions reuse the
+ * same rings as they are paused and resumed.
+ */
+class HTTPEventQueue {
+ public:
+  HTTPEventQueue() = default;
+  HTTPEventQueue(const HTTPEventQueue&) = delete;
+  HTTPEventQueue& operator=(const HTTPEventQueue&) = delete;
+
+  template <typename... Args>
+  void emplace(Args&&... args) {
+    if (size_ == slots_.size()) {
+      grow();
+    }
+    slots_[index(size_)].emplace(std::forward<Args>(args)...);
+    size_++;
+  }
+
+  /**
+   * Queue a BODY event, or append chain to the last event if that is a BODY
+   * whose body has not been taken yet.
+   */
+  void emplaceBody(HTTPCodec::StreamID streamID,
+                   std::unique_ptr<folly::IOBuf> chain);
+
+  HTTPEvent& front() {
+    DCHECK(size_ > 0);
+    return *slots_[head_];
+  }
+
+  void pop() {
+    DCHECK(size_ > 0);
+    slots_[head_].clear();
+    head_ = index(1);
+    size_--;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  size_t capacity() const {
+    return slots_.size();
+  }
+
+  /**
+   * Drop all events, keeping the ring
+   */
+  void clear();
+
+  /**
+   * Free list of queues.  Not thread safe, one per session.
+   */
+  class Pool {
+   public:
+    std::unique_ptr<HTTPEventQueue> acquire();
+
+    /**
+     * Clears queue and keeps it for the next acquire, unless the pool is
+     * full or the ring grew too large to keep around.
+     */
+    void release(std::unique_ptr<HTTPEventQueue> queue);
+
+    size_t size() const {
+      return free_.size();
+    }
+
+    static const size_t kMaxPooledQueues = 16;
+    static const size_t kMaxPooledCapacity = 64;
+
+   private:
+    std::vector<std::unique_ptr<HTTPEventQueue>> free_;
+  };
+
+  static const size_t kInitialCapacity = 4;
+
+ private:
+  size_t index(size_t offset) const {
+    // capacity is always a power of 2
+    return (head_ + offset) & (slots_.size() - 1);
+  }
+
+  void grow();
+
+  std::vector<folly::Optional<HTTPEvent>> slots_;
+  size_t head_{0};
+  size_t size_{0};
+};
+
+} // namespace proxygen
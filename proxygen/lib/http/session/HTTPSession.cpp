@@ -300,6 +300,7 @@ void HTTPSession::startNow() {
   if (connFlowControl_) {
     connFlowControl_->setReceiveWindowSize(writeBuf_,
                                            receiveSessionWindowSize_);
+    maybeStartWindowAutotuning();
   }
   // For HTTP/2 if we are currently draining it means we got notified to
   // shutdown before we sent a SETTINGS frame, so we defer sending a GOAWAY
@@ -346,6 +347,40 @@ void HTTPSession::setFlowControl(size_t initialReceiveWindow,
   }
 }
 
+void HTTPSession::setReceiveWindowAutotuning(
+    uint32_t maxReceiveSessionWindowSize,
+    uint32_t maxReceiveStreamWindowSize) {
+  CHECK(!started_);
+  maxReceiveSessionWindowSize_ = maxReceiveSessionWindowSize;
+  maxReceiveStreamWindowSize_ = maxReceiveStreamWindowSize;
+}
+
+void HTTPSession::maybeStartWindowAutotuning() {
+  if (!connFlowControl_ || maxReceiveSessionWindowSize_ == 0 ||
+      !codec_->supportsStreamFlowControl()) {
+    return;
+  }
+  windowAutotuner_ = std::make_unique<ReceiveWindowAutotuner>(
+      receiveSessionWindowSize_,
+      receiveStreamWindowSize_,
+      maxReceiveSessionWindowSize_,
+      maxReceiveStreamWindowSize_);
+}
+
+void HTTPSession::applyAutotunedWindows() {
+  receiveSessionWindowSize_ = windowAutotuner_->getSessionWindow();
+  HTTPSessionBase::setReadBufferLimit(receiveSessionWindowSize_);
+  connFlowControl_->setReceiveWindowSize(writeBuf_,
+                                         receiveSessionWindowSize_);
+  if (receiveStreamWindowSize_ != windowAutotuner_->getStreamWindow()) {
+    receiveStreamWindowSize_ = windowAutotuner_->getStreamWindow();
+    for (auto& it : transactions_) {
+      it.second.setReceiveWindow(receiveStreamWindowSize_);
+    }
+  }
+  scheduleWrite();
+}
+
 void HTTPSession::setEgressSettings(const SettingsList& inSettings) {
   VLOG_IF(4, started_) << "Must flush egress settings to peer";
   HTTPSettings* settings = codec_->getEgressSettings();
@@ -740,8 +775,10 @@ void HTTPSession::onMessageBegin(HTTPCodec::StreamID streamID,
   }
 
   if (!codec_->supportsParallelRequests() && getPipelineStreamCount() > 1) {
-    // The previous transaction hasn't completed yet. Pause reads until
-    // it completes; this requires pausing both transactions.
+    // The previous transaction hasn't completed yet.  Defer this one's
+    // ingress until it does, and keep parsing pipelined requests up to
+    // maxPipelinedRequests_.  Past that pause reads until the previous
+    // ones complete; this requires pausing all the transactions.
 
     // HTTP/1.1 pipeline is detected, and which is incompactible with
     // ByteEventTracker. Drain all the ByteEvents
@@ -754,6 +791,12 @@ void HTTPSession::onMessageBegin(HTTPCodec::StreamID streamID,
       return;
     }
 
+    if (getPipelineStreamCount() <= maxPipelinedRequests_) {
+      VLOG(4) << *this << " deferring pipelined streamID=" << streamID;
+      txn->pauseIngress();
+      return;
+    }
+
     // There must be at least two transactions (we just checked). The previous
     // txns haven't completed yet. Pause reads until they complete
     DCHECK_GE(transactions_.size(), 2);
@@ -930,6 +973,12 @@ void HTTPSession::onBody(HTTPCodec::StreamID streamID,
   // The codec's parser detected part of the ingress message's
   // entity-body.
   uint64_t length = chain->computeChainDataLength();
+  if (windowAutotuner_) {
+    windowAutotuner_->onBytesReceived(length + padding);
+    if (windowAutotuner_->shouldSendPing() && sendPing() > 0) {
+      windowAutotuner_->onPingSent(getCurrentTime());
+    }
+  }
   HTTPTransaction* txn = findTransaction(streamID);
   if (!txn) {
     if (connFlowControl_ &&
@@ -1254,6 +1303,12 @@ void HTTPSession::onPingReply(uint64_t uniqueID) {
   if (infoCallback_) {
     infoCallback_->onPingReplyReceived();
   }
+  // The codec picks the ping ids, so this may be the reply to an application
+  // ping sent after the autotuner's.  That only shortens the sample.
+  if (windowAutotuner_ &&
+      windowAutotuner_->onPingReply(getCurrentTime())) {
+    applyAutotunedWindows();
+  }
 }
 
 void HTTPSession::onWindowUpdate(HTTPCodec::StreamID streamID,
@@ -1441,6 +1496,7 @@ bool HTTPSession::onNativeProtocolUpgradeImpl(
   if (connFlowControl_) {
     connFlowControl_->setReceiveWindowSize(writeBuf_,
                                            receiveSessionWindowSize_);
+    maybeStartWindowAutotuning();
     scheduleWrite();
   }
 
@@ -1848,18 +1904,30 @@ bool HTTPSession::maybeResumePausedPipelinedTransaction(size_t oldStreamCount,
                                                         uint32_t txnSeqn) {
   if (!codec_->supportsParallelRequests() && !transactions_.empty() &&
       getPipelineStreamCount() < oldStreamCount &&
-      getPipelineStreamCount() == 1) {
-    auto& nextTxn = transactions_.rbegin()->second;
-    DCHECK_EQ(nextTxn.getSequenceNumber(), txnSeqn + 1);
-    DCHECK(!nextTxn.isIngressComplete());
-    DCHECK(nextTxn.isIngressPaused());
-    VLOG(4) << "Resuming paused pipelined txn " << nextTxn;
-    nextTxn.resumeIngress();
+      getPipelineStreamCount() >= 1) {
+    // The next request in the pipeline is now at its head
+    auto nextTxn = findTransactionBySequenceNumber(txnSeqn + 1);
+    if (!nextTxn || !nextTxn->isIngressPaused()) {
+      return false;
+    }
+    DCHECK(!nextTxn->isIngressComplete());
+    VLOG(4) << "Resuming paused pipelined txn " << *nextTxn;
+    nextTxn->resumeIngress();
     return true;
   }
   return false;
 }
 
+HTTPTransaction* HTTPSession::findTransactionBySequenceNumber(uint32_t seqNo) {
+  // Only used for serial codecs, which have few transactions at a time
+  for (auto& it : transactions_) {
+    if (it.second.getSequenceNumber() == seqNo) {
+      return &it.second;
+    }
+  }
+  return nullptr;
+}
+
 void HTTPSession::detach(HTTPTransaction* txn) noexcept {
   DestructorGuard guard(this);
   HTTPCodec::StreamID streamID = txn->getID();
@@ -2016,6 +2084,7 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(
   // We always tack on at least one body packet to the current write buf
   // This ensures that a short HTTPS response will go out in a single SSL record
   while (!txnEgressQueue_.empty()) {
+    auto lengthBefore = writeBuf_.chainLength();
     uint32_t toSend = kWriteReadyMax;
     if (connFlowControl_) {
       if (connFlowControl_->getAvailableSend() == 0) {
@@ -2065,9 +2134,15 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(
     nextEgressResults_.clear();
     // it can be empty because of HTTPTransaction rate limiting.  We should
     // change rate limiting to clearPendingEgress while waiting.
-    if (!writeBuf_.empty()) {
+    if (!writeBuf_.empty() &&
+        (codec_->supportsParallelRequests() || maxPipelinedRequests_ <= 1 ||
+         writeBuf_.chainLength() == lengthBefore ||
+         writeBuf_.chainLength() >= kWriteReadyMax)) {
       break;
     }
+    // With requests pipelined ahead, finishing a response resumes the next
+    // one, whose handler may have queued its response already.  Keep going
+    // so the responses ready in this loop share one write.
   }
   *timestampTx = false;
   *timestampAck = false;
@@ -27,7 +27,9 @@
 #include <proxygen/lib/http/session/HTTPEvent.h>
 #include <proxygen/lib/http/session/HTTPSessionBase.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/http/session/ReceiveWindowAutotuner.h>
 #include <proxygen/lib/http/session/SecondaryAuthManagerBase.h>
+#include <proxygen/lib/utils/FreeList.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
 #include <queue>
 #include <set>
@@ -41,6 +43,7 @@ class HTTPSessionStats;
 #define PROXYGEN_HTTP_SESSION_USES_BASE 1
 constexpr uint32_t kDefaultMaxConcurrentOutgoingStreamsRemote = 100000;
 constexpr uint32_t kDefaultMaxConcurrentIncomingStreams = 100;
+constexpr uint32_t kDefaultMaxPipelinedRequests = 1;
 
 // These constants define the rate at which we limit certain events.
 constexpr uint32_t kDefaultMaxControlMsgsPerInterval = 50000;
@@ -116,6 +119,22 @@ class HTTPSession
                       size_t receiveStreamWindowSize,
                       size_t receiveSessionWindowSize) override;
 
+  /**
+   * Grow the receive windows set by setFlowControl towards the measured
+   * bandwidth-delay product of the connection, up to these sizes.  Only
+   * applies to codecs with connection level flow control.  See
+   * ReceiveWindowAutotuner.
+   *
+   * @param maxReceiveSessionWindowSize  largest per-session receive window
+   * @param maxReceiveStreamWindowSize   largest per-stream receive window
+   */
+  void setReceiveWindowAutotuning(uint32_t maxReceiveSessionWindowSize,
+                                  uint32_t maxReceiveStreamWindowSize);
+
+  const ReceiveWindowAutotuner* getReceiveWindowAutotuner() const {
+    return windowAutotuner_.get();
+  }
+
   /**
    * Set outgoing settings for this session
    */
@@ -154,6 +173,18 @@ class HTTPSession
    */
   void setEgressBytesLimit(uint64_t bytesLimit);
 
+  /**
+   * For codecs without parallel requests (HTTP/1.x), the number of
+   * pipelined requests to parse ahead of the one being responded to.  Their
+   * ingress is deferred until the responses before them are complete, and
+   * responses that become ready together are sent in one write.  Reads are
+   * paused once this many requests are waiting.  The default of 1 pauses
+   * reads as soon as a second request arrives.
+   */
+  void setMaxPipelinedRequests(uint32_t num) {
+    maxPipelinedRequests_ = std::max<uint32_t>(num, 1);
+  }
+
   /**
    * Start reading from the transport and send any introductory messages
    * to the remote side. This function must be called once per session to
@@ -729,7 +760,14 @@ class HTTPSession
   /** Chain of ingress IOBufs */
   folly::IOBufQueue readBuf_{folly::IOBufQueue::cacheChainLength()};
 
-  std::map<HTTPCodec::StreamID, HTTPTransaction> transactions_;
+  // Transactions are allocated in place in the map nodes, which are
+  // recycled through a per-thread free list
+  std::map<HTTPCodec::StreamID,
+           HTTPTransaction,
+           std::less<HTTPCodec::StreamID>,
+           FreeListAllocator<std::pair<const HTTPCodec::StreamID,
+                                       HTTPTransaction>>>
+      transactions_;
 
   /** Count of transactions awaiting input */
   uint32_t liveTransactions_{0};
@@ -802,6 +840,17 @@ class HTTPSession
 
   http2::PriorityUpdate getMessagePriority(const HTTPMessage* msg);
 
+  /**
+   * Create windowAutotuner_ if autotuning was configured, once the starting
+   * windows are known.
+   */
+  void maybeStartWindowAutotuning();
+
+  /**
+   * Apply windowAutotuner_'s windows to the session and its transactions.
+   */
+  void applyAutotunedWindows();
+
   bool isConnWindowFull() const {
     return connFlowControl_ && connFlowControl_->getAvailableSend() == 0;
   }
@@ -861,6 +910,10 @@ class HTTPSession
     return !waitingForReplaySafety_.empty();
   }
 
+  HTTPEventQueue::Pool* getIngressEventQueuePool() noexcept override {
+    return &ingressEventQueuePool_;
+  }
+
   /**
    * Callback from the transport to this HTTPSession to signal when the
    * transport has become replay safe.
@@ -877,6 +930,8 @@ class HTTPSession
   bool maybeResumePausedPipelinedTransaction(size_t oldStreamCount,
                                              uint32_t txnSeqn);
 
+  HTTPTransaction* findTransactionBySequenceNumber(uint32_t seqNo);
+
   void incrementOutgoingStreams();
 
   // returns true if the threshold has been exceeded
@@ -981,6 +1036,9 @@ class HTTPSession
    */
   uint32_t maxConcurrentIncomingStreams_{kDefaultMaxConcurrentIncomingStreams};
 
+  // Pipelined requests parsed ahead, see setMaxPipelinedRequests
+  uint32_t maxPipelinedRequests_{kDefaultMaxPipelinedRequests};
+
   /**
    * The number concurrent transactions initiated by this session
    */
@@ -1049,6 +1107,11 @@ class HTTPSession
   size_t receiveStreamWindowSize_{0};
   size_t receiveSessionWindowSize_{0};
 
+  // Receive window autotuning, 0 when disabled
+  uint32_t maxReceiveSessionWindowSize_{0};
+  uint32_t maxReceiveStreamWindowSize_{0};
+  std::unique_ptr<ReceiveWindowAutotuner> windowAutotuner_;
+
   class ShutdownTransportCallback : public folly::EventBase::LoopCallback {
    public:
     explicit ShutdownTransportCallback(HTTPSession* session)
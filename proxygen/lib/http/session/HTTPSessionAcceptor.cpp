@@ -12,6 +12,8 @@
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/session/HTTPDefaultSessionCodecFactory.h>
 #include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
+#include <proxygen/lib/utils/KernelTLSSocket.h>
+#include <wangle/ssl/SSLContextManager.h>
 
 using folly::AsyncSocket;
 using folly::SocketAddress;
@@ -42,6 +44,18 @@ HTTPSessionAcceptor::HTTPSessionAcceptor(
 HTTPSessionAcceptor::~HTTPSessionAcceptor() {
 }
 
+void HTTPSessionAcceptor::enableKernelTLS() {
+  if (!accConfig_.useKernelTLS || !getSSLContextManager()) {
+    return;
+  }
+  // Connections are created on the default context and keep its options when
+  // SNI switches them to another one
+  auto ctx = getSSLContextManager()->getDefaultSSLCtx();
+  if (ctx) {
+    KernelTLSSocket::enable(*ctx);
+  }
+}
+
 const HTTPErrorPage* HTTPSessionAcceptor::getErrorPage(
     const SocketAddress& addr) const {
   const HTTPErrorPage* errorPage = nullptr;
@@ -63,11 +77,18 @@ void HTTPSessionAcceptor::onNewConnection(
     wangle::SecureTransportType,
     const wangle::TransportInfo& tinfo) {
 
+  // we assume if security protocol isn't empty, then it's TLS
+  bool secure = !sock->getSecurityProtocol().empty();
+  if (secure && accConfig_.useKernelTLS) {
+    auto offloaded = KernelTLSSocket::offload(*sock, accConfig_.useIoUring);
+    if (offloaded) {
+      VLOG(4) << "Moved TLS connection to kTLS for peer " << *peerAddress;
+      sock = std::move(offloaded);
+    }
+  }
+
   unique_ptr<HTTPCodec> codec = codecFactory_->getCodec(
-      nextProtocol,
-      TransportDirection::DOWNSTREAM,
-      // we assume if security protocol isn't empty, then it's TLS
-      !sock->getSecurityProtocol().empty());
+      nextProtocol, TransportDirection::DOWNSTREAM, secure);
 
   if (!codec) {
     VLOG(2) << "codecFactory_ failed to provide codec";
@@ -110,6 +131,9 @@ void HTTPSessionAcceptor::onNewConnection(
     session->setMaxConcurrentIncomingStreams(
         accConfig_.maxConcurrentIncomingStreams);
   }
+  if (accConfig_.maxPipelinedRequests) {
+    session->setMaxPipelinedRequests(accConfig_.maxPipelinedRequests);
+  }
   session->setEgressSettings(accConfig_.egressSettings);
 
   // set HTTP2 priorities flag on session object
@@ -120,6 +144,11 @@ void HTTPSessionAcceptor::onNewConnection(
   session->setFlowControl(accConfig_.initialReceiveWindow,
                           accConfig_.receiveStreamWindowSize,
                           accConfig_.receiveSessionWindowSize);
+  if (accConfig_.maxReceiveSessionWindowSize > 0) {
+    session->setReceiveWindowAutotuning(
+        accConfig_.maxReceiveSessionWindowSize,
+        accConfig_.maxReceiveStreamWindowSize);
+  }
   if (accConfig_.writeBufferLimit > 0) {
     session->setWriteBufferLimit(accConfig_.writeBufferLimit);
   }
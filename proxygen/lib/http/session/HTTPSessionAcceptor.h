@@ -16,6 +16,7 @@
 #include <proxygen/lib/http/session/HTTPErrorPage.h>
 #include <proxygen/lib/http/session/SimpleController.h>
 #include <proxygen/lib/services/HTTPAcceptor.h>
+#include <proxygen/lib/utils/IoUringSocket.h>
 
 namespace proxygen {
 
@@ -109,6 +110,20 @@ class HTTPSessionAcceptor
     return accConfig_.HTTP2PrioritiesEnabled;
   }
 
+  void init(folly::AsyncServerSocket* serverSocket,
+            folly::EventBase* eventBase,
+            wangle::SSLStats* stats = nullptr) override {
+    HTTPAcceptor::init(serverSocket, eventBase, stats);
+    enableKernelTLS();
+  }
+
+  /**
+   * Have handshakes put their keys into the kernel when useKernelTLS is set.
+   * Run on the acceptor's thread once its SSL contexts are built, and again
+   * whenever they are reset, before any connection uses them.
+   */
+  void enableKernelTLS();
+
  protected:
   /**
    * This function is invoked when a new session is created to get the
@@ -135,6 +150,10 @@ class HTTPSessionAcceptor
 
   folly::AsyncSocket::UniquePtr makeNewAsyncSocket(folly::EventBase* base,
                                                    int fd) override {
+    if (accConfig_.useIoUring) {
+      return folly::AsyncSocket::UniquePtr(
+          new IoUringSocket(base, folly::NetworkSocket::fromFd(fd)));
+    }
     return folly::AsyncSocket::UniquePtr(
         new folly::AsyncSocket(base, folly::NetworkSocket::fromFd(fd)));
   }
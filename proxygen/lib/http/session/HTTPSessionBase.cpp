@@ -8,6 +8,7 @@
  *
  */
 #include <proxygen/lib/http/session/HTTPSessionBase.h>
+#include <proxygen/lib/http/session/EgressMemoryBudget.h>
 
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/session/ByteEventTracker.h>
@@ -44,6 +45,7 @@ HTTPSessionBase::HTTPSessionBase(const SocketAddress& localAddr,
       h2PrioritiesEnabled_(true),
       inResume_(false),
       pendingPause_(false),
+      egressBudgetPaused_(false),
       exHeadersEnabled_(false) {
 
   // If we receive IPv4-mapped IPv6 addresses, convert them to IPv4.
@@ -53,6 +55,12 @@ HTTPSessionBase::HTTPSessionBase(const SocketAddress& localAddr,
   setController(controller);
 }
 
+HTTPSessionBase::~HTTPSessionBase() {
+  if (egressBudget_) {
+    egressBudget_->removeSession(*this, pendingWriteSize_);
+  }
+}
+
 void HTTPSessionBase::runDestroyCallbacks() {
   if (infoCallback_) {
     infoCallback_->onDestroy(*this);
@@ -140,6 +148,46 @@ void HTTPSessionBase::updateWriteBufSize(int64_t delta) {
   DCHECK(delta >= 0 || uint64_t(-delta) <= pendingWriteSize_);
   pendingWriteSize_ += delta;
 
+  int64_t budgetDelta = delta;
+  if (!egressBudget_ && delta > 0) {
+    egressBudget_ = EgressMemoryBudget::get();
+    // Account for anything buffered before the budget was configured
+    budgetDelta = pendingWriteSize_;
+  }
+  if (egressBudget_ && budgetDelta != 0) {
+    egressBudgetPaused_ = egressBudget_->onBufferedBytesChanged(
+      *this, budgetDelta, egressBudgetPaused_);
+  }
+  onEgressLimitChanged(wasExceeded);
+}
+
+void HTTPSessionBase::setEgressBudgetPaused(bool paused) {
+  if (egressBudgetPaused_ == paused) {
+    return;
+  }
+  bool wasExceeded = egressLimitExceeded();
+  egressBudgetPaused_ = paused;
+  onEgressLimitChanged(wasExceeded);
+}
+
+void HTTPSessionBase::detachEgressBudget() {
+  if (egressBudget_) {
+    egressBudget_->removeSession(*this, pendingWriteSize_);
+    egressBudget_ = nullptr;
+  }
+  setEgressBudgetPaused(false);
+}
+
+void HTTPSessionBase::attachEgressBudget() {
+  DCHECK(!egressBudget_);
+  egressBudget_ = EgressMemoryBudget::get();
+  if (egressBudget_ && pendingWriteSize_ > 0) {
+    setEgressBudgetPaused(egressBudget_->onBufferedBytesChanged(
+      *this, pendingWriteSize_, egressBudgetPaused_));
+  }
+}
+
+void HTTPSessionBase::onEgressLimitChanged(bool wasExceeded) {
   if (egressLimitExceeded() && !wasExceeded) {
     // Exceeded limit. Pause reading on the incoming stream.
     if (inResume_) {
@@ -19,6 +19,7 @@
 #include <wangle/acceptor/TransportInfo.h>
 
 namespace proxygen {
+class EgressMemoryBudget;
 class HTTPSessionController;
 class HTTPSessionStats;
 class HTTPTransaction;
@@ -111,8 +112,7 @@ class HTTPSessionBase : public wangle::ManagedConnection {
                   const WheelTimerInstance& timeout,
                   HTTPCodec::StreamID rootNodeId);
 
-  virtual ~HTTPSessionBase() {
-  }
+  virtual ~HTTPSessionBase();
 
   /**
    * Set the read buffer limit to be used for all new HTTPSessionBase objects.
@@ -281,6 +281,23 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     readBufLimit_ = limit;
   }
 
+  /**
+   * Egress bytes buffered by this session's transactions and transport.
+   */
+  uint64_t getPendingWriteSize() const {
+    return pendingWriteSize_;
+  }
+
+  /**
+   * Pause or resume egress on behalf of the EgressMemoryBudget.  Egress is
+   * paused while either this or the session's own write buffer limit says so.
+   */
+  void setEgressBudgetPaused(bool paused);
+
+  bool isEgressBudgetPaused() const {
+    return egressBudgetPaused_;
+  }
+
   /**
    * Start reading from the transport and send any introductory messages
    * to the remote side. This function must be called once per session to
@@ -481,6 +498,20 @@ class HTTPSessionBase : public wangle::ManagedConnection {
 
   void updatePendingWrites();
 
+  /**
+   * Pause or resume transactions after the result of egressLimitExceeded()
+   * may have changed from wasExceeded.
+   */
+  void onEgressLimitChanged(bool wasExceeded);
+
+  /**
+   * Leave the egress memory budget of the thread the session is detaching
+   * from, and join that of the thread it is attached to.  Budgets are per
+   * thread, so a session must not account against another thread's.
+   */
+  void detachEgressBudget();
+  void attachEgressBudget();
+
   virtual void pauseTransactions() = 0;
 
   void resumeTransactions();
@@ -619,7 +650,7 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   bool egressLimitExceeded() const {
     // Changed to >
-    return pendingWriteSize_ > writeBufLimit_;
+    return pendingWriteSize_ > writeBufLimit_ || egressBudgetPaused_;
   }
 
   /**
@@ -673,6 +704,17 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   int64_t pendingWriteSizeDelta_{0};
 
+  /**
+   * The budget of the thread this session buffers egress on, if any.
+   */
+  EgressMemoryBudget* egressBudget_{nullptr};
+
+  /**
+   * Queues for transactions to defer ingress into while paused, shared by
+   * all of this session's transactions.
+   */
+  HTTPEventQueue::Pool ingressEventQueuePool_;
+
   /**
    * Bytes of ingress data read from the socket, but not yet sent to a
    * transaction.
@@ -683,6 +725,7 @@ class HTTPSessionBase : public wangle::ManagedConnection {
   bool h2PrioritiesEnabled_ : 1;
   bool inResume_ : 1;
   bool pendingPause_ : 1;
+  bool egressBudgetPaused_ : 1;
 
   /**
    * Indicates whether Ex Headers is supported in HTTPSession
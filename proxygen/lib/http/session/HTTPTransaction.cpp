@@ -143,6 +143,7 @@ HTTPTransaction::~HTTPTransaction() {
   // TODO: handle the case where the priority node hangs out longer than
   // the transaction
   egressQueue_.removeTransaction(queueHandle_);
+  releaseDeferredIngress();
 }
 
 void HTTPTransaction::reset(bool useFlowControl,
@@ -276,7 +277,7 @@ void HTTPTransaction::onIngressBody(unique_ptr<IOBuf> chain, uint16_t padding) {
   }
   if (mustQueueIngress()) {
     checkCreateDeferredIngress();
-    deferredIngress_->emplace(id_, HTTPEvent::Type::BODY, std::move(chain));
+    deferredIngress_->emplaceBody(id_, std::move(chain));
     VLOG(4) << "Queued ingress event of type " << HTTPEvent::Type::BODY
             << " size=" << len << " " << *this;
   } else {
@@ -505,7 +506,7 @@ void HTTPTransaction::updateReadTimeout() {
 void HTTPTransaction::markIngressComplete() {
   VLOG(4) << "Marking ingress complete on " << *this;
   ingressState_ = HTTPTransactionIngressSM::State::ReceivingDone;
-  deferredIngress_.reset();
+  releaseDeferredIngress();
   cancelTimeout();
 }
 
@@ -745,6 +746,7 @@ void HTTPTransaction::onLastEgressHeaderByteAcked() {
   FOLLY_SCOPED_TRACE_SECTION("HTTPTransaction - onLastEgressHeaderByteAcked");
   egressHeadersDelivered_ = true;
   DestructorGuard g(this);
+  scheduleEgressDeadline();
   if (transportCallback_) {
     transportCallback_->lastEgressHeaderByteAcked();
   }
@@ -753,6 +755,8 @@ void HTTPTransaction::onLastEgressHeaderByteAcked() {
 void HTTPTransaction::onEgressBodyBytesAcked(uint64_t bodyOffset) {
   FOLLY_SCOPED_TRACE_SECTION("HTTPTransaction - onEgressBodyBytesAcked");
   DestructorGuard g(this);
+  // bodyOffset is that of the last byte delivered
+  onEgressBodyDeliveryResolved(bodyOffset + 1);
   if (transportCallback_) {
     transportCallback_->bodyBytesDelivered(bodyOffset);
   }
@@ -761,6 +765,9 @@ void HTTPTransaction::onEgressBodyBytesAcked(uint64_t bodyOffset) {
 void HTTPTransaction::onEgressBodyDeliveryCanceled(uint64_t bodyOffset) {
   FOLLY_SCOPED_TRACE_SECTION("HTTPTransaction - onEgressBodyDeliveryCanceled");
   DestructorGuard g(this);
+  // Body up to and including bodyOffset will not be delivered, whether it was
+  // skipped or the stream was reset; there is no point skipping it again
+  onEgressBodyDeliveryResolved(bodyOffset + 1);
   if (transportCallback_) {
     transportCallback_->bodyBytesDeliveryCancelled(bodyOffset);
   }
@@ -894,16 +901,9 @@ void HTTPTransaction::sendBody(std::unique_ptr<folly::IOBuf> body) {
           << "Sent body longer than chunk header ";
     }
     deferredEgressBody_.append(std::move(body));
-    if (enableBodyLastByteDeliveryTracking_) {
-      auto res = transport_.trackEgressBodyDelivery(*actualResponseLength_);
-      if (res.hasError()) {
-        HTTPException ex(HTTPException::Direction::INGRESS_AND_EGRESS,
-          folly::to<std::string>("Failed to arm body bytes tracking: "
-                                 , res.error()));
-        ex.setProxygenError(kErrorUnknown);
-        onError(ex);
-        return;
-      }
+    if (enableBodyLastByteDeliveryTracking_ &&
+        !trackEgressBodyDelivery(*actualResponseLength_)) {
+      return;
     }
     if (isEnqueued()) {
       transport_.notifyEgressBodyBuffered(bodyLen);
@@ -912,6 +912,56 @@ void HTTPTransaction::sendBody(std::unique_ptr<folly::IOBuf> body) {
   notifyTransportPendingEgress();
 }
 
+folly::Expected<folly::Unit, ErrorCode>
+HTTPTransaction::sendBodyWithDeadline(std::unique_ptr<folly::IOBuf> body,
+                                      TimePoint deadline) {
+  if (!partiallyReliable_) {
+    LOG(ERROR) << __func__
+               << ": not permitted on non-partially reliable transaction.";
+    return folly::makeUnexpected(ErrorCode::PROTOCOL_ERROR);
+  }
+
+  DestructorGuard guard(this);
+  bool empty = !body || body->computeChainDataLength() == 0;
+  sendBody(std::move(body));
+  if (isEgressComplete()) {
+    // sendBody() failed the transaction
+    return folly::makeUnexpected(ErrorCode::INTERNAL_ERROR);
+  }
+  if (empty) {
+    return folly::unit;
+  }
+
+  // The deadline is enforced once this body's last byte is acked, or skipped
+  uint64_t bodyOffset = *actualResponseLength_;
+  if (!enableBodyLastByteDeliveryTracking_ &&
+      !trackEgressBodyDelivery(bodyOffset)) {
+    return folly::makeUnexpected(ErrorCode::INTERNAL_ERROR);
+  }
+
+  if (!egressDeadlines_.empty()) {
+    deadline = std::max(deadline, egressDeadlines_.back().deadline);
+  }
+  egressDeadlines_.push_back({bodyOffset, deadline});
+  if (egressDeadlines_.size() == 1) {
+    scheduleEgressDeadline();
+  }
+  return folly::unit;
+}
+
+bool HTTPTransaction::trackEgressBodyDelivery(uint64_t bodyOffset) {
+  auto res = transport_.trackEgressBodyDelivery(bodyOffset);
+  if (res.hasError()) {
+    HTTPException ex(HTTPException::Direction::INGRESS_AND_EGRESS,
+      folly::to<std::string>("Failed to arm body bytes tracking: "
+                             , res.error()));
+    ex.setProxygenError(kErrorUnknown);
+    onError(ex);
+    return false;
+  }
+  return true;
+}
+
 bool HTTPTransaction::onWriteReady(const uint32_t maxEgress, double ratio) {
   DestructorGuard g(this);
   DCHECK(isEnqueued());
@@ -1055,6 +1105,60 @@ void HTTPTransaction::rateLimitTimeoutExpired() {
   notifyTransportPendingEgress();
 }
 
+void HTTPTransaction::onEgressBodyDeliveryResolved(uint64_t bodyOffset) {
+  egressBodyResolvedOffset_ = std::max(egressBodyResolvedOffset_, bodyOffset);
+  if (egressDeadlines_.empty() ||
+      egressDeadlines_.front().bodyOffset > bodyOffset) {
+    return;
+  }
+  while (!egressDeadlines_.empty() &&
+         egressDeadlines_.front().bodyOffset <= bodyOffset) {
+    egressDeadlines_.pop_front();
+  }
+  scheduleEgressDeadline();
+}
+
+void HTTPTransaction::scheduleEgressDeadline() {
+  egressDeadlineCallback_.cancelTimeout();
+  // Skipping is not possible before the headers are delivered;
+  // onLastEgressHeaderByteAcked() comes back here
+  if (egressDeadlines_.empty() || !timer_ || !egressHeadersDelivered_) {
+    return;
+  }
+  auto delay = millisecondsBetween(egressDeadlines_.front().deadline,
+                                   getCurrentTime());
+  timer_->scheduleTimeout(&egressDeadlineCallback_,
+                          std::max(delay, std::chrono::milliseconds(0)));
+}
+
+void HTTPTransaction::egressDeadlineExpired() {
+  DestructorGuard g(this);
+  auto now = getCurrentTime();
+  folly::Optional<uint64_t> skipOffset;
+  while (!egressDeadlines_.empty() &&
+         egressDeadlines_.front().deadline <= now) {
+    skipOffset = egressDeadlines_.front().bodyOffset;
+    egressDeadlines_.pop_front();
+  }
+
+  if (skipOffset && *skipOffset > egressBodyResolvedOffset_) {
+    uint64_t skipped = *skipOffset - egressBodyResolvedOffset_;
+    VLOG(4) << "skipping " << skipped << " body bytes past their deadline on "
+            << *this;
+    auto res = skipBodyTo(*skipOffset);
+    if (res.hasError()) {
+      LOG(ERROR) << __func__ << ": failed to skip expired body to offset "
+                 << *skipOffset << ": " << getErrorCodeString(res.error());
+      return;
+    }
+    egressBodyBytesSkipped_ += skipped;
+    if (stats_) {
+      stats_->recordEgressBodyBytesSkipped(skipped);
+    }
+  }
+  scheduleEgressDeadline();
+}
+
 size_t HTTPTransaction::sendEOMNow() {
   VLOG(4) << "egress EOM on " << *this;
   // TODO: with ByteEvent refactor, we will have to delay changing this
@@ -1246,7 +1350,13 @@ HTTPTransaction::skipBodyTo(uint64_t nextBodyOffset) {
   if (nextBodyOffset > actualResponseLength_.value()) {
     actualResponseLength_ = nextBodyOffset;
   }
-  return transport_.skipBodyTo(this, nextBodyOffset);
+  auto res = transport_.skipBodyTo(this, nextBodyOffset);
+  if (res.hasValue()) {
+    // Not to be counted again when a deadline passes
+    egressBodyResolvedOffset_ =
+        std::max(egressBodyResolvedOffset_, nextBodyOffset);
+  }
+  return res;
 }
 
 folly::Expected<folly::Optional<uint64_t>, ErrorCode>
@@ -1360,6 +1470,9 @@ void HTTPTransaction::resumeIngress() {
       deferredIngress_->pop();
     }
   }
+  if (deferredIngress_ && deferredIngress_->empty()) {
+    releaseDeferredIngress();
+  }
   updateReadTimeout();
   inResume_ = false;
 }
@@ -1468,8 +1581,18 @@ bool HTTPTransaction::mustQueueIngress() const {
 
 void HTTPTransaction::checkCreateDeferredIngress() {
   if (!deferredIngress_) {
-    deferredIngress_ = std::make_unique<std::queue<HTTPEvent>>();
+    deferredIngressPool_ = transport_.getIngressEventQueuePool();
+    deferredIngress_ = deferredIngressPool_
+                           ? deferredIngressPool_->acquire()
+                           : std::make_unique<HTTPEventQueue>();
+  }
+}
+
+void HTTPTransaction::releaseDeferredIngress() {
+  if (deferredIngress_ && deferredIngressPool_) {
+    deferredIngressPool_->release(std::move(deferredIngress_));
   }
+  deferredIngress_.reset();
 }
 
 bool HTTPTransaction::onPushedTransaction(HTTPTransaction* pushTxn) {
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <climits>
+#include <deque>
 #include <folly/Optional.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/async/AsyncTransport.h>
@@ -24,7 +25,7 @@
 #include <proxygen/lib/http/codec/HTTPCodec.h>
 #include <proxygen/lib/http/session/ByteEvents.h>
 #include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
-#include <proxygen/lib/http/session/HTTPEvent.h>
+#include <proxygen/lib/http/session/HTTPEventQueue.h>
 #include <proxygen/lib/http/session/HTTPTransactionEgressSM.h>
 #include <proxygen/lib/http/session/HTTPTransactionIngressSM.h>
 #include <proxygen/lib/utils/Time.h>
@@ -480,6 +481,15 @@ class HTTPTransaction
 
     virtual bool needToBlockForReplaySafety() const = 0;
 
+    /**
+     * Pool to recycle the queues transactions defer ingress into while
+     * paused, or nullptr to allocate one per transaction.  The pool must
+     * outlive the transport's transactions.
+     */
+    virtual HTTPEventQueue::Pool* getIngressEventQueuePool() noexcept {
+      return nullptr;
+    }
+
     virtual const folly::AsyncTransportWrapper* getUnderlyingTransport() const
         noexcept = 0;
 
@@ -985,6 +995,30 @@ class HTTPTransaction
    */
   virtual void sendBody(std::unique_ptr<folly::IOBuf> body);
 
+  /**
+   * Send body that is of no use to the peer after deadline, such as a segment
+   * of live media, on a partially reliable transaction. If the body has not
+   * been delivered by then, the transaction skips past it with skipBodyTo():
+   * what is still buffered is dropped and the transport stops retransmitting
+   * the rest, so a lost packet costs the peer this body rather than a stall
+   * behind its retransmission. Skipping also gives up on any earlier body not
+   * yet delivered, so a deadline earlier than the previous one is raised to
+   * it.
+   *
+   * Fails without sending anything on a transaction that is not partially
+   * reliable.
+   */
+  folly::Expected<folly::Unit, ErrorCode> sendBodyWithDeadline(
+      std::unique_ptr<folly::IOBuf> body, TimePoint deadline);
+
+  /**
+   * @return the body bytes sendBodyWithDeadline() gave up on because their
+   * deadline passed before they were delivered
+   */
+  uint64_t getEgressBodyBytesSkipped() const {
+    return egressBodyBytesSkipped_;
+  }
+
   /**
    * Write any protocol framing required for the subsequent call(s)
    * to sendBody(). This method does not actually write the message out on
@@ -1523,6 +1557,11 @@ class HTTPTransaction
    */
   void checkCreateDeferredIngress();
 
+  /**
+   * Return deferredIngress_ to the pool it came from, if any.
+   */
+  void releaseDeferredIngress();
+
   /**
    * Implementation of sending an abort for this transaction.
    */
@@ -1601,6 +1640,18 @@ class HTTPTransaction
 
   void trimDeferredEgressBody(uint64_t bodyOffset);
 
+  /**
+   * Arms body delivery tracking up to bodyOffset, failing the transaction
+   * if the transport cannot.
+   */
+  bool trackEgressBodyDelivery(uint64_t bodyOffset);
+
+  void onEgressBodyDeliveryResolved(uint64_t bodyOffset);
+
+  void scheduleEgressDeadline();
+
+  void egressDeadlineExpired();
+
   class RateLimitCallback : public folly::HHWheelTimer::Callback {
    public:
     explicit RateLimitCallback(HTTPTransaction& txn) : txn_(txn) {
@@ -1619,11 +1670,39 @@ class HTTPTransaction
 
   RateLimitCallback rateLimitCallback_{*this};
 
+  class EgressDeadlineCallback : public folly::HHWheelTimer::Callback {
+   public:
+    explicit EgressDeadlineCallback(HTTPTransaction& txn) : txn_(txn) {
+    }
+
+    void timeoutExpired() noexcept override {
+      txn_.egressDeadlineExpired();
+    }
+    void callbackCanceled() noexcept override {
+      // no op
+    }
+
+   private:
+    HTTPTransaction& txn_;
+  };
+
+  EgressDeadlineCallback egressDeadlineCallback_{*this};
+
+  struct EgressDeadline {
+    // End of the body sent with this deadline
+    uint64_t bodyOffset;
+    TimePoint deadline;
+  };
+
+  // Undelivered body sent with sendBodyWithDeadline(), in body order
+  std::deque<EgressDeadline> egressDeadlines_;
+
   /**
    * Queue to hold any events that we receive from the Transaction
    * while the ingress is supposed to be paused.
    */
-  std::unique_ptr<std::queue<HTTPEvent>> deferredIngress_;
+  std::unique_ptr<HTTPEventQueue> deferredIngress_;
+  HTTPEventQueue::Pool* deferredIngressPool_{nullptr};
 
   uint32_t maxDeferredIngress_{0};
 
@@ -1793,6 +1872,11 @@ class HTTPTransaction
   // Keeps track for body offset processed so far.
   // Includes skipped bytes for partially reliable transactions.
   uint64_t ingressBodyOffset_{0};
+
+  // Egress body offset below which everything was delivered or skipped.
+  uint64_t egressBodyResolvedOffset_{0};
+
+  uint64_t egressBodyBytesSkipped_{0};
 };
 
 /**
@@ -158,6 +158,7 @@ void HTTPUpstreamSession::attachThreadLocals(
     HeaderCodec::Stats* headerCodecStats,
     HTTPSessionController* controller) {
   txnEgressQueue_.attachThreadLocals(timeout);
+  attachEgressBudget();
   timeout_ = timeout;
   setController(controller);
   setSessionStats(stats);
@@ -192,6 +193,7 @@ void HTTPUpstreamSession::detachThreadLocals(bool detachSSLContext) {
     sock_->detachEventBase();
   }
   txnEgressQueue_.detachThreadLocals();
+  detachEgressBudget();
   setController(nullptr);
   setSessionStats(nullptr);
   // The codec filters *shouldn't* be accessible while the socket is detached,
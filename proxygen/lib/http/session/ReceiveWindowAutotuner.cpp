@@ -0,0 +1,110 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/http/session/ReceiveWindowAutotuner.h>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace proxygen {
+
+uint64_t ReceiveWindowAutotuner::processLimit_{0};
+std::atomic<uint64_t> ReceiveWindowAutotuner::processGrantedBytes_{0};
+
+void ReceiveWindowAutotuner::setProcessLimit(uint64_t limit) {
+  processLimit_ = limit;
+  VLOG(3) << "receive window autotuning process limit=" << limit;
+}
+
+ReceiveWindowAutotuner::ReceiveWindowAutotuner(uint32_t sessionWindow,
+                                               uint32_t streamWindow,
+                                               uint32_t maxSessionWindow,
+                                               uint32_t maxStreamWindow)
+    : sessionWindow_(sessionWindow),
+      streamWindow_(streamWindow),
+      maxSessionWindow_(std::max(sessionWindow, maxSessionWindow)),
+      maxStreamWindow_(std::max(streamWindow, maxStreamWindow)) {
+}
+
+ReceiveWindowAutotuner::~ReceiveWindowAutotuner() {
+  if (grantedBytes_ > 0) {
+    processGrantedBytes_.fetch_sub(grantedBytes_, std::memory_order_relaxed);
+  }
+}
+
+void ReceiveWindowAutotuner::onPingSent(TimePoint now) {
+  DCHECK(!pingOutstanding_);
+  pingOutstanding_ = true;
+  pingSentTime_ = now;
+  bytesAtPing_ = bytesReceived_;
+}
+
+uint32_t ReceiveWindowAutotuner::reserveGrowth(uint32_t current,
+                                               uint32_t target) {
+  uint64_t granted = processGrantedBytes_.load(std::memory_order_relaxed);
+  uint64_t delta;
+  do {
+    delta = target - current;
+    if (processLimit_ > 0) {
+      if (granted >= processLimit_) {
+        return current;
+      }
+      delta = std::min(delta, processLimit_ - granted);
+    }
+  } while (!processGrantedBytes_.compare_exchange_weak(
+      granted, granted + delta, std::memory_order_relaxed));
+  grantedBytes_ += delta;
+  return current + delta;
+}
+
+bool ReceiveWindowAutotuner::onPingReply(TimePoint now) {
+  if (!pingOutstanding_) {
+    return false;
+  }
+  pingOutstanding_ = false;
+  lastRtt_ = std::max(
+    std::chrono::duration_cast<std::chrono::microseconds>(now - pingSentTime_),
+    std::chrono::microseconds(1));
+  uint64_t sample = bytesReceived_ - bytesAtPing_;
+  double bandwidth = double(sample) * 1000000 / lastRtt_.count();
+  VLOG(4) << "BDP sample=" << sample << " rtt=" << lastRtt_.count()
+          << "us bandwidth=" << bandwidth << " max=" << maxBandwidth_;
+  if (bandwidth <= maxBandwidth_) {
+    // More window did not buy more throughput, the bottleneck is elsewhere
+    return false;
+  }
+  maxBandwidth_ = bandwidth;
+
+  uint64_t target = std::min<uint64_t>(sample * 2,
+                                       std::numeric_limits<int32_t>::max());
+  bool grew = false;
+  if (sample * 100 >= uint64_t(sessionWindow_) * kGrowthThresholdPercent &&
+      target > sessionWindow_ && sessionWindow_ < maxSessionWindow_) {
+    auto window = reserveGrowth(
+      sessionWindow_, std::min<uint64_t>(target, maxSessionWindow_));
+    grew = window > sessionWindow_;
+    sessionWindow_ = window;
+  }
+  // A stream can never use more than the session window
+  auto streamTarget = std::min<uint64_t>(
+    {target, maxStreamWindow_, sessionWindow_});
+  if (sample * 100 >= uint64_t(streamWindow_) * kGrowthThresholdPercent &&
+      streamTarget > streamWindow_) {
+    auto window = reserveGrowth(streamWindow_, streamTarget);
+    grew = grew || window > streamWindow_;
+    streamWindow_ = window;
+  }
+  VLOG_IF(3, grew) << "Autotuned receive windows to session="
+                   << sessionWindow_ << " stream=" << streamWindow_;
+  return grew;
+}
+
+} // namespace proxygen
@@ -0,0 +1,136 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/utils/Time.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace proxygen {
+
+/**
+ * Grows a session's receive windows towards the bandwidth-delay product of
+ * its connection.
+ *
+ * While body bytes are arriving the session keeps one PING in flight.  The
+ * bytes received between sending that PING and receiving its reply are one
+ * BDP sample, and the sample divided by the round trip time is a bandwidth
+ * sample.  When a sample fills most of the session window and the bandwidth
+ * is still going up, the window is the bottleneck, so the session and stream
+ * windows are raised to twice the sample.
+ *
+ * Growth is bounded by the per-session maximums, and the growth of all
+ * sessions together (above their configured starting windows) by a process
+ * wide limit.  Session and stream window growth both count against it; the
+ * stream window once per session, since together a session's streams cannot
+ * hold more than the session window.  Windows never shrink; the bytes a
+ * session was granted are returned to the process when it is destroyed.
+ */
+class ReceiveWindowAutotuner {
+ public:
+  /**
+   * Bound the total growth of all sessions in the process, 0 means
+   * unlimited.  Should be set before any sessions are created.
+   */
+  static void setProcessLimit(uint64_t limit);
+
+  static uint64_t getProcessLimit() {
+    return processLimit_;
+  }
+
+  /**
+   * Bytes of window growth currently granted to all sessions
+   */
+  static uint64_t getProcessGrantedBytes() {
+    return processGrantedBytes_.load(std::memory_order_relaxed);
+  }
+
+  ReceiveWindowAutotuner(uint32_t sessionWindow,
+                         uint32_t streamWindow,
+                         uint32_t maxSessionWindow,
+                         uint32_t maxStreamWindow);
+  ~ReceiveWindowAutotuner();
+
+  ReceiveWindowAutotuner(const ReceiveWindowAutotuner&) = delete;
+  ReceiveWindowAutotuner& operator=(const ReceiveWindowAutotuner&) = delete;
+
+  /**
+   * Account for body bytes received on the session
+   */
+  void onBytesReceived(uint64_t bytes) {
+    bytesReceived_ += bytes;
+  }
+
+  /**
+   * Whether the session should send a PING now to take a sample
+   */
+  bool shouldSendPing() const {
+    return !pingOutstanding_ && !isSaturated();
+  }
+
+  void onPingSent(TimePoint now);
+
+  /**
+   * Take the sample started by the last onPingSent.  Returns true if the
+   * session or stream window grew; the caller applies the new sizes.
+   */
+  bool onPingReply(TimePoint now);
+
+  bool isPingOutstanding() const {
+    return pingOutstanding_;
+  }
+
+  uint32_t getSessionWindow() const {
+    return sessionWindow_;
+  }
+
+  uint32_t getStreamWindow() const {
+    return streamWindow_;
+  }
+
+  /** Bytes per second of the largest bandwidth sample */
+  double getMaxBandwidth() const {
+    return maxBandwidth_;
+  }
+
+  std::chrono::microseconds getLastRtt() const {
+    return lastRtt_;
+  }
+
+  bool isSaturated() const {
+    return sessionWindow_ >= maxSessionWindow_ &&
+      streamWindow_ >= maxStreamWindow_;
+  }
+
+  // Grow once a sample fills this fraction of the session window
+  static const uint32_t kGrowthThresholdPercent = 66;
+
+ private:
+  uint32_t reserveGrowth(uint32_t current, uint32_t target);
+
+  uint32_t sessionWindow_;
+  uint32_t streamWindow_;
+  const uint32_t maxSessionWindow_;
+  const uint32_t maxStreamWindow_;
+  uint64_t grantedBytes_{0};
+  uint64_t bytesReceived_{0};
+  uint64_t bytesAtPing_{0};
+  TimePoint pingSentTime_;
+  std::chrono::microseconds lastRtt_{0};
+  double maxBandwidth_{0};
+  bool pingOutstanding_{false};
+
+  static uint64_t processLimit_;
+  static std::atomic<uint64_t> processGrantedBytes_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,48 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
+#include <proxygen/lib/http/session/HTTPSessionController.h>
+
+namespace proxygen {
+
+/**
+ * Answers every request with an empty 200, for benchmarks that measure the
+ * session rather than a handler.
+ */
+class DirectResponseController : public HTTPSessionController {
+ public:
+  HTTPTransactionHandler* getRequestHandler(HTTPTransaction& /*txn*/,
+                                            HTTPMessage* /*msg*/) override {
+    return new HTTPDirectResponseHandler(200, "OK");
+  }
+
+  HTTPTransactionHandler* getParseErrorHandler(
+      HTTPTransaction* /*txn*/,
+      const HTTPException& /*error*/,
+      const folly::SocketAddress& /*localAddress*/) override {
+    return nullptr;
+  }
+
+  HTTPTransactionHandler* getTransactionTimeoutHandler(
+      HTTPTransaction* /*txn*/,
+      const folly::SocketAddress& /*localAddress*/) override {
+    return nullptr;
+  }
+
+  void attachSession(HTTPSessionBase* /*session*/) override {
+  }
+
+  void detachSession(const HTTPSessionBase* /*session*/) override {
+  }
+};
+
+} // namespace proxygen
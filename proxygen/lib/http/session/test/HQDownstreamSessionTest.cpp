@@ -3042,6 +3042,95 @@ TEST_P(HQDownstreamSessionTestHQPRDeliveryAck, TestBodyDeliveryAckWithSkips) {
   hqSession_->closeWhenIdle();
 }
 
+TEST_P(HQDownstreamSessionTestHQPRDeliveryAck, TestBodyDeadlineSkipsLoss) {
+  const uint64_t kSegmentSize = 100;
+  const uint64_t kNumSegments = 4;
+  const milliseconds kRetransmitDelay(1000);
+
+  // Sends live media segments, the first and third of which are lost, and
+  // returns how long the last one takes to be delivered
+  auto sendSegments = [&](bool withDeadlines) {
+    auto req = getGetRequest();
+    req.setPartiallyReliable();
+    auto streamId = sendRequest(req);
+    auto handler = addSimpleStrictPrHandler();
+    handler->expectHeaders();
+
+    TestTransportCallback transportCallback;
+    handler->expectEOM([&]() {
+      handler->txn_->setTransportCallback(&transportCallback);
+      handler->sendPrHeaders(200, kSegmentSize * kNumSegments);
+      if (!withDeadlines) {
+        auto res = handler->txn_->setBodyLastByteDeliveryTrackingEnabled(true);
+        EXPECT_FALSE(res.hasError());
+      }
+    });
+    flushRequestsAndLoop();
+    EXPECT_TRUE(transportCallback.lastEgressHeadersByteDelivered_);
+
+    // The body is sent unframed, right after the headers
+    auto bodyStart = socketDriver_->streams_[streamId].writeOffset;
+    socketDriver_->loseStreamData(streamId, bodyStart, kRetransmitDelay);
+    socketDriver_->loseStreamData(
+        streamId, bodyStart + 2 * kSegmentSize, kRetransmitDelay);
+    auto start = getCurrentTime();
+    for (uint64_t i = 0; i < kNumSegments; i++) {
+      if (withDeadlines) {
+        // A segment every 100ms
+        auto res = handler->txn_->sendBodyWithDeadline(
+            makeBuf(kSegmentSize), start + milliseconds(100 * (i + 1)));
+        EXPECT_FALSE(res.hasError());
+      } else {
+        handler->txn_->sendBody(makeBuf(kSegmentSize));
+      }
+    }
+    while (transportCallback.bodyBytesDeliveredOffset_ <
+           kSegmentSize * kNumSegments - 1) {
+      eventBase_.loopOnce();
+    }
+    auto latency = millisecondsSince(start);
+    EXPECT_EQ(handler->txn_->getEgressBodyBytesSkipped(),
+              withDeadlines ? 2 * kSegmentSize : 0);
+    if (withDeadlines) {
+      // The transport canceled the skipped segments' delivery
+      EXPECT_EQ(transportCallback.numBodyBytesCanceledCalls_, 2);
+      EXPECT_EQ(transportCallback.bodyBytesCanceledOffset_,
+                3 * kSegmentSize - 1);
+    }
+
+    handler->sendEOM();
+    handler->expectDetachTransaction();
+    flushRequestsAndLoop();
+    return latency;
+  };
+
+  // Reliably, every segment waits for the first one's retransmission
+  EXPECT_GE(sendSegments(false), kRetransmitDelay);
+  // With deadlines only the lost segments are given up on, each once it is
+  // due
+  EXPECT_LT(sendSegments(true), kRetransmitDelay / 2);
+
+  hqSession_->closeWhenIdle();
+}
+
+TEST_P(HQDownstreamSessionTestHQPRDeliveryAck, TestBodyDeadlineNotPr) {
+  sendRequest();
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] {
+    handler->sendHeaders(200, 100);
+    auto res = handler->txn_->sendBodyWithDeadline(makeBuf(100),
+                                                   getCurrentTime());
+    EXPECT_TRUE(res.hasError());
+    EXPECT_EQ(res.error(), ErrorCode::PROTOCOL_ERROR);
+    handler->sendBody(100);
+    handler->sendEOM();
+  });
+  handler->expectDetachTransaction();
+  flushRequestsAndLoop();
+  hqSession_->closeWhenIdle();
+}
+
 TEST_P(HQDownstreamSessionTestHQPRDeliveryAck, TestBodyDeliveryErr) {
   auto req = getGetRequest();
   req.setPartiallyReliable();
@@ -7,20 +7,26 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <map>
 #include <string>
 #include <vector>
 
 #include <folly/Conv.h>
 #include <folly/Range.h>
+#include <folly/ScopeGuard.h>
 #include <folly/futures/Promise.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventBaseManager.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
 #include <folly/io/async/TimeoutManager.h>
 #include <folly/io/async/test/MockAsyncTransport.h>
 #include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
 #include <proxygen/lib/http/codec/HTTPCodecFactory.h>
 #include <proxygen/lib/http/codec/test/TestUtils.h>
+#include <proxygen/lib/http/session/EgressMemoryBudget.h>
 #include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
 #include <proxygen/lib/http/session/HTTPDownstreamSession.h>
 #include <proxygen/lib/http/session/HTTPSession.h>
@@ -30,8 +36,13 @@
 #include <proxygen/lib/http/session/test/MockByteEventTracker.h>
 #include <proxygen/lib/http/session/test/TestUtils.h>
 #include <proxygen/lib/test/TestAsyncTransport.h>
+#include <proxygen/lib/utils/IoUringSocket.h>
 #include <wangle/acceptor/ConnectionManager.h>
 
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 using namespace folly::io;
 using namespace wangle;
 using namespace folly;
@@ -1025,6 +1036,68 @@ TEST(HTTPDownstreamTest, ByteEventsDrained) {
   evb.loop();
 }
 
+TEST(HTTPDownstreamTest, IoUringSocketTransport) {
+  // A request and its response through an IoUringSocket, on the ring when
+  // the kernel supports it and on AsyncSocket's own path otherwise
+  EventBase evb;
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  SCOPE_EXIT {
+    ::close(fds[1]);
+  };
+  IoUringSocket::UniquePtr socket(
+      new IoUringSocket(&evb, folly::NetworkSocket::fromFd(fds[0])));
+  auto ioUringSocket = socket.get();
+
+  NiceMock<MockController> mockController;
+  NiceMock<MockHTTPHandler> handler;
+  EXPECT_CALL(mockController, getRequestHandler(_, _))
+      .WillOnce(Return(&handler));
+  handler.expectTransaction();
+  handler.expectHeaders();
+  handler.expectEOM([&handler] { handler.sendReplyWithBody(200, 100); });
+  bool detached = false;
+  handler.expectDetachTransaction([&detached] { detached = true; });
+
+  auto transactionTimeouts = makeInternalTimeoutSet(&evb);
+  auto session = new HTTPDownstreamSession(
+      transactionTimeouts.get(),
+      std::move(socket),
+      localAddr,
+      peerAddr,
+      &mockController,
+      std::make_unique<HTTP1xCodec>(TransportDirection::DOWNSTREAM),
+      mockTransportInfo,
+      nullptr);
+  session->startNow();
+
+  std::string request("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  ASSERT_EQ(::write(fds[1], request.data(), request.size()),
+            ssize_t(request.size()));
+  std::string response;
+  auto complete = [&response] {
+    auto headersEnd = response.find("\r\n\r\n");
+    return headersEnd != std::string::npos &&
+           response.size() >= headersEnd + 4 + 100;
+  };
+  while (!detached || !complete()) {
+    evb.loopOnce(EVLOOP_NONBLOCK);
+    pollfd pfd{fds[1], POLLIN, 0};
+    if (::poll(&pfd, 1, 10) > 0) {
+      char buf[4096];
+      auto n = ::read(fds[1], buf, sizeof(buf));
+      ASSERT_GT(n, 0);
+      response.append(buf, size_t(n));
+    }
+  }
+
+  EXPECT_EQ(response.find("HTTP/1.1 200"), 0);
+  EXPECT_EQ(ioUringSocket->usingIoUring(),
+            IoUringContext::get(&evb) != nullptr);
+  session->dropConnection();
+  evb.loop();
+}
+
 TEST_F(HTTPDownstreamSessionTest, HttpWithAckTiming) {
   // This is to test cases where holding a byte event to a finished HTTP/1.1
   // transaction does not masquerade as HTTP pipelining.
@@ -1138,6 +1211,67 @@ TEST_F(HTTPDownstreamSessionTest, HttpWithAckTimingPipeline) {
   gracefulShutdown();
 }
 
+TEST_F(HTTPDownstreamSessionTest, PipelinedResponsesShareWrite) {
+  // Requests 2 and 3 are parsed while 1 is outstanding.  When 1 finishes,
+  // they run in turn and all three responses go out in the same write.
+  httpSession_->setMaxPipelinedRequests(3);
+  InSequence enforceOrder;
+
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM();
+  auto handler2 = addSimpleStrictHandler();
+  auto handler3 = addSimpleStrictHandler();
+  handler2->expectHeaders();
+  handler2->expectEOM([&handler2] { handler2->sendReplyWithBody(200, 100); });
+  handler3->expectHeaders();
+  handler3->expectEOM([&handler3] { handler3->sendReplyWithBody(200, 100); });
+  handler1->expectDetachTransaction();
+  handler2->expectDetachTransaction();
+  handler3->expectDetachTransaction();
+
+  sendRequest();
+  sendRequest();
+  sendRequest();
+  flushRequestsAndLoop();
+  auto writes = transport_->getWriteEvents()->size();
+  handler1->sendReplyWithBody(200, 100);
+  eventBase_.loop();
+  EXPECT_EQ(transport_->getWriteEvents()->size(), writes + 1);
+  expectResponses(3);
+  gracefulShutdown();
+}
+
+TEST_F(HTTPDownstreamSessionTest, SerialResponsesWrittenSeparately) {
+  // By default the next request is only parsed once the previous response
+  // is out, and every response goes in its own write as before pipelining.
+  InSequence enforceOrder;
+
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM();
+  handler1->expectDetachTransaction();
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders();
+  handler2->expectEOM([&handler2] { handler2->sendReplyWithBody(200, 100); });
+  handler2->expectDetachTransaction();
+  auto handler3 = addSimpleStrictHandler();
+  handler3->expectHeaders();
+  handler3->expectEOM([&handler3] { handler3->sendReplyWithBody(200, 100); });
+  handler3->expectDetachTransaction();
+
+  sendRequest();
+  sendRequest();
+  sendRequest();
+  flushRequestsAndLoop();
+  auto writes = transport_->getWriteEvents()->size();
+  handler1->sendReplyWithBody(200, 100);
+  eventBase_.loop();
+  EXPECT_EQ(transport_->getWriteEvents()->size(), writes + 3);
+  expectResponses(3);
+  gracefulShutdown();
+}
+
 /*
  * The sequence of streams are generated in the following order:
  * - [client --> server] regular request 1st stream (getGetRequest())
@@ -2463,6 +2597,325 @@ TEST_F(SPDY3DownstreamSessionTest, SpdyTimeout) {
   cleanup();
 }
 
+// Verifies that a slow reader is paused by the worker egress budget even
+// when it is under its own session write buffer limit
+TEST_F(HTTPDownstreamSessionTest, EgressMemoryBudget) {
+  EgressMemoryBudget::setLimits(1000, 0);
+  SCOPE_EXIT {
+    EgressMemoryBudget::setLimits(0, 0);
+  };
+  auto budget = EgressMemoryBudget::get();
+  auto pauses = budget->getPauseCount();
+  sendRequest();
+
+  InSequence handlerSequence;
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([this] { transport_->pauseWrites(); });
+  handler->expectEOM([&] {
+    handler->sendHeaders(200, 2000);
+    handler->sendBody(2000);
+  });
+  handler->expectEgressPaused([&] {
+    EXPECT_GT(budget->getBufferedBytes(), 1000);
+    EXPECT_LT(httpSession_->getPendingWriteSize(),
+              httpSession_->getWriteBufferLimit());
+    EXPECT_EQ(budget->getPausedSessionCount(), 1);
+    EXPECT_TRUE(httpSession_->isEgressBudgetPaused());
+    resumeWritesInLoop();
+  });
+  handler->expectEgressResumed([&] {
+    EXPECT_EQ(budget->getPausedSessionCount(), 0);
+    handler->txn_->sendEOM();
+  });
+  handler->expectDetachTransaction();
+
+  flushRequestsAndLoop();
+  EXPECT_EQ(budget->getPauseCount(), pauses + 1);
+
+  cleanup();
+  EXPECT_EQ(budget->getBufferedBytes(), 0);
+}
+
+// Verifies that slow readers sharing a worker budget pause the one with the
+// most buffered first, even when another one pushed the worker over, and
+// that it resumes once the budget drains
+TEST_F(HTTPDownstreamSessionTest, EgressMemoryBudgetSharedBySessions) {
+  EgressMemoryBudget::setLimits(1000, 0);
+  SCOPE_EXIT {
+    EgressMemoryBudget::setLimits(0, 0);
+  };
+  auto budget = EgressMemoryBudget::get();
+  auto pauses = budget->getPauseCount();
+
+  std::map<std::string, StrictMock<MockHTTPHandler>> handlers;
+  EXPECT_CALL(mockController_, getRequestHandler(_, _))
+      .Times(3)
+      .WillRepeatedly(Invoke([&](HTTPTransaction&, HTTPMessage* msg) {
+        return &handlers[msg->getURL()];
+      }));
+  std::map<std::string, TestAsyncTransport*> transports;
+  std::vector<HTTPDownstreamSession*> sessions;
+  size_t requests = 0;
+  size_t detached = 0;
+  for (auto url : {"/large", "/small", "/medium"}) {
+    auto& handler = handlers[url];
+    EXPECT_CALL(handler, setTransaction(_))
+        .WillOnce(SaveArg<0>(&handler.txn_));
+    handler.expectHeaders();
+    handler.expectEOM([&] { requests++; });
+    handler.expectDetachTransaction([&] { detached++; });
+
+    auto transport = new TestAsyncTransport(&eventBase_);
+    transports[url] = transport;
+    sessions.push_back(new HTTPDownstreamSession(
+        transactionTimeouts_.get(),
+        AsyncTransportWrapper::UniquePtr(transport),
+        localAddr,
+        peerAddr,
+        &mockController_,
+        makeServerCodec<HTTP1xCodec>(HTTP1xCodecPair::version),
+        mockTransportInfo,
+        nullptr));
+    sessions.back()->startNow();
+    transport->pauseWrites();
+    transport->addReadEvent(
+        folly::to<std::string>("GET ", url, " HTTP/1.1\r\n\r\n").c_str(),
+        milliseconds(0));
+    transport->startReadEvents();
+  }
+  while (requests < 3) {
+    eventBase_.loopOnce();
+  }
+
+  auto& large = handlers["/large"];
+  large.expectEgressPaused([&] {
+    EXPECT_EQ(budget->getPausedSessionCount(), 1);
+    eventBase_.runInLoop([&] { transports["/large"]->resumeWrites(); });
+  });
+  large.expectEgressResumed([&] {
+    EXPECT_EQ(budget->getPausedSessionCount(), 0);
+    EXPECT_LE(budget->getBufferedBytes(),
+              1000 * EgressMemoryBudget::kResumePercent / 100);
+    large.txn_->sendEOM();
+    transports["/small"]->resumeWrites();
+    transports["/medium"]->resumeWrites();
+  });
+
+  // The worker stays under budget until the last body, which pauses the
+  // largest reader rather than the one sending it
+  for (auto reply : std::vector<std::pair<std::string, uint32_t>>{
+           {"/large", 700}, {"/small", 50}, {"/medium", 300}}) {
+    auto& handler = handlers[reply.first];
+    handler.sendHeaders(200, reply.second);
+    handler.sendBody(reply.second);
+    if (reply.first != "/large") {
+      handler.txn_->sendEOM();
+    }
+  }
+  EXPECT_GT(budget->getBufferedBytes(), 1000);
+  EXPECT_TRUE(sessions[0]->isEgressBudgetPaused());
+  EXPECT_FALSE(sessions[1]->isEgressBudgetPaused());
+  EXPECT_FALSE(sessions[2]->isEgressBudgetPaused());
+  EXPECT_EQ(budget->getPauseCount(), pauses + 1);
+
+  while (detached < 3) {
+    eventBase_.loopOnce();
+  }
+  EXPECT_FALSE(sessions[0]->isEgressBudgetPaused());
+  EXPECT_EQ(budget->getPauseCount(), pauses + 1);
+
+  EXPECT_CALL(mockController_, detachSession(_)).Times(3);
+  for (auto session : sessions) {
+    session->dropConnection();
+  }
+  cleanup();
+  EXPECT_EQ(budget->getBufferedBytes(), 0);
+}
+
+// Verifies that a paused session that has drained is resumed once the
+// session keeping the worker over budget goes away
+TEST_F(HTTPDownstreamSessionTest, EgressMemoryBudgetResumeOnClose) {
+  EgressMemoryBudget::setLimits(1000, 0);
+  SCOPE_EXIT {
+    EgressMemoryBudget::setLimits(0, 0);
+  };
+  auto budget = EgressMemoryBudget::get();
+
+  std::map<std::string, StrictMock<MockHTTPHandler>> handlers;
+  EXPECT_CALL(mockController_, getRequestHandler(_, _))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](HTTPTransaction&, HTTPMessage* msg) {
+        return &handlers[msg->getURL()];
+      }));
+  std::map<std::string, TestAsyncTransport*> transports;
+  std::map<std::string, HTTPDownstreamSession*> sessions;
+  size_t requests = 0;
+  for (auto url : {"/drained", "/closed"}) {
+    auto& handler = handlers[url];
+    EXPECT_CALL(handler, setTransaction(_))
+        .WillOnce(SaveArg<0>(&handler.txn_));
+    handler.expectHeaders();
+    handler.expectEOM([&] { requests++; });
+    handler.expectEgressPaused();
+
+    auto transport = new TestAsyncTransport(&eventBase_);
+    transports[url] = transport;
+    sessions[url] = new HTTPDownstreamSession(
+        transactionTimeouts_.get(),
+        AsyncTransportWrapper::UniquePtr(transport),
+        localAddr,
+        peerAddr,
+        &mockController_,
+        makeServerCodec<HTTP1xCodec>(HTTP1xCodecPair::version),
+        mockTransportInfo,
+        nullptr);
+    sessions[url]->startNow();
+    transport->pauseWrites();
+    transport->addReadEvent(
+        folly::to<std::string>("GET ", url, " HTTP/1.1\r\n\r\n").c_str(),
+        milliseconds(0));
+    transport->startReadEvents();
+  }
+  while (requests < 2) {
+    eventBase_.loopOnce();
+  }
+
+  // The first reply is the largest when the second takes the worker over,
+  // and the second is paused once it has grown past it
+  auto& drained = handlers["/drained"];
+  auto& closed = handlers["/closed"];
+  drained.sendHeaders(200, 800);
+  drained.sendBody(800);
+  closed.sendHeaders(200, 900);
+  closed.sendBody(300);
+  EXPECT_TRUE(sessions["/drained"]->isEgressBudgetPaused());
+  closed.sendBody(600);
+  EXPECT_TRUE(sessions["/closed"]->isEgressBudgetPaused());
+  EXPECT_EQ(budget->getPausedSessionCount(), 2);
+
+  // What the second one buffers keeps the worker over the resume threshold
+  transports["/drained"]->resumeWrites();
+  while (sessions["/drained"]->getPendingWriteSize() > 0) {
+    eventBase_.loopOnce();
+  }
+  EXPECT_GT(budget->getBufferedBytes(),
+            1000 * EgressMemoryBudget::kResumePercent / 100);
+  EXPECT_TRUE(sessions["/drained"]->isEgressBudgetPaused());
+
+  size_t detached = 0;
+  closed.expectError();
+  closed.expectDetachTransaction([&] { detached++; });
+  drained.expectEgressResumed([&] { drained.txn_->sendEOM(); });
+  drained.expectDetachTransaction([&] { detached++; });
+  EXPECT_CALL(mockController_, detachSession(_)).Times(2);
+  sessions["/closed"]->dropConnection();
+  while (detached < 2) {
+    eventBase_.loopOnce();
+  }
+  EXPECT_FALSE(sessions["/drained"]->isEgressBudgetPaused());
+  EXPECT_EQ(budget->getPausedSessionCount(), 0);
+
+  sessions["/drained"]->dropConnection();
+  cleanup();
+  EXPECT_EQ(budget->getBufferedBytes(), 0);
+}
+
+// Verifies that a session paused by the process budget is resumed when
+// another worker drains, though its own worker has nothing left buffered
+TEST_F(HTTPDownstreamSessionTest, EgressMemoryBudgetProcessWide) {
+  EgressMemoryBudget::setLimits(0, 1000);
+  SCOPE_EXIT {
+    EgressMemoryBudget::setLimits(0, 0);
+  };
+  auto budget = EgressMemoryBudget::get();
+
+  // A slow reader on another worker buffers most of the process limit
+  folly::ScopedEventBaseThread worker;
+  auto workerEvb = worker.getEventBase();
+  NiceMock<MockController> workerController;
+  StrictMock<MockHTTPHandler> workerHandler;
+  folly::HHWheelTimer::UniquePtr workerTimeouts;
+  TestAsyncTransport* workerTransport = nullptr;
+  HTTPDownstreamSession* workerSession = nullptr;
+  folly::Baton<> workerReplied;
+  folly::Baton<> workerDetached;
+  EXPECT_CALL(workerController, getRequestHandler(_, _))
+      .WillOnce(Return(&workerHandler));
+  EXPECT_CALL(workerHandler, setTransaction(_))
+      .WillOnce(SaveArg<0>(&workerHandler.txn_));
+  workerHandler.expectHeaders();
+  workerHandler.expectEOM([&] {
+    workerHandler.sendHeaders(200, 900);
+    workerHandler.sendBody(900);
+    workerReplied.post();
+  });
+  workerHandler.expectDetachTransaction([&] { workerDetached.post(); });
+  workerEvb->runInEventBaseThreadAndWait([&] {
+    workerTimeouts = makeTimeoutSet(workerEvb);
+    workerTransport = new TestAsyncTransport(workerEvb);
+    workerSession = new HTTPDownstreamSession(
+        workerTimeouts.get(),
+        AsyncTransportWrapper::UniquePtr(workerTransport),
+        localAddr,
+        peerAddr,
+        &workerController,
+        makeServerCodec<HTTP1xCodec>(HTTP1xCodecPair::version),
+        mockTransportInfo,
+        nullptr);
+    workerSession->startNow();
+    workerTransport->pauseWrites();
+    workerTransport->addReadEvent("GET /worker HTTP/1.1\r\n\r\n",
+                                  milliseconds(0));
+    workerTransport->startReadEvents();
+  });
+  workerReplied.wait();
+
+  // This worker's reply takes the process over and is paused, and stays
+  // paused after draining completely
+  sendRequest();
+  InSequence handlerSequence;
+  auto handler = addSimpleStrictHandler();
+  bool resumed = false;
+  handler->expectHeaders([this] { transport_->pauseWrites(); });
+  handler->expectEOM([&] {
+    handler->sendHeaders(200, 300);
+    handler->sendBody(300);
+  });
+  handler->expectEgressPaused([&] { resumeWritesInLoop(); });
+  handler->expectEgressResumed([&] {
+    resumed = true;
+    handler->txn_->sendEOM();
+  });
+  handler->expectDetachTransaction();
+  flushRequests();
+  while (!httpSession_->isEgressBudgetPaused() ||
+         httpSession_->getPendingWriteSize() > 0) {
+    eventBase_.loopOnce();
+  }
+  EXPECT_EQ(budget->getBufferedBytes(), 0);
+  EXPECT_EQ(budget->getPausedSessionCount(), 1);
+  EXPECT_FALSE(resumed);
+
+  // The other worker draining wakes this one
+  workerEvb->runInEventBaseThread([&] {
+    workerTransport->resumeWrites();
+    workerHandler.txn_->sendEOM();
+  });
+  while (!resumed) {
+    eventBase_.loopOnce();
+  }
+  EXPECT_EQ(budget->getPausedSessionCount(), 0);
+
+  workerDetached.wait();
+  workerEvb->runInEventBaseThreadAndWait([&] {
+    workerSession->dropConnection();
+    workerTimeouts.reset();
+  });
+  eventBase_.loop();
+  cleanup();
+  EXPECT_EQ(EgressMemoryBudget::getProcessBufferedBytes(), 0);
+}
+
 // Verifies that the read timer is running while a transaction is blocked
 // on a window update
 TEST_F(SPDY3DownstreamSessionTest, SpdyTimeoutWin) {
@@ -2855,6 +3308,60 @@ TEST_F(SPDY3DownstreamSessionTest, NewTxnEgressPaused) {
   cleanup();
 }
 
+namespace {
+class HTTP2DownstreamSessionAutotuneTest
+    : public HTTPDownstreamTest<HTTP2CodecPair> {
+ public:
+  HTTP2DownstreamSessionAutotuneTest()
+      : HTTPDownstreamTest<HTTP2CodecPair>({-1, -1, -1}, false) {
+    httpSession_->setReceiveWindowAutotuning(1 << 20, 1 << 20);
+    httpSession_->startNow();
+  }
+};
+} // namespace
+
+// Verifies that a round trip filling the windows grows both, and that the
+// peer is granted the growth through WINDOW_UPDATE frames
+TEST_F(HTTP2DownstreamSessionAutotuneTest, WindowsGrow) {
+  const uint32_t kWindow = clientCodec_->getDefaultWindowSize();
+  auto streamID = sendRequest(getPostRequest(kWindow), false);
+  clientCodec_->generateBody(
+      requests_, streamID, makeBuf(kWindow), HTTPCodec::NoPadding, false);
+  transport_->addReadEvent(requests_, milliseconds(0));
+  // The reply to the ping the session sent with the first body bytes
+  clientCodec_->generatePingReply(requests_, 0);
+  transport_->addReadEvent(requests_, milliseconds(10));
+  clientCodec_->generateEOM(requests_, streamID);
+  transport_->addReadEvent(requests_, milliseconds(10));
+  transport_->startReadEvents();
+
+  InSequence handlerSequence;
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  EXPECT_CALL(*handler, onBodyWithOffset(_, _)).Times(AtLeast(1));
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  eventBase_.loop();
+
+  auto tuner = httpSession_->getReceiveWindowAutotuner();
+  ASSERT_NE(tuner, nullptr);
+  EXPECT_GT(tuner->getSessionWindow(), kWindow);
+  EXPECT_GT(tuner->getStreamWindow(), kWindow);
+
+  std::map<HTTPCodec::StreamID, uint64_t> credit;
+  EXPECT_CALL(callbacks_, onWindowUpdate(_, _))
+      .WillRepeatedly(Invoke([&](HTTPCodec::StreamID id, uint32_t delta) {
+        credit[id] += delta;
+      }));
+  parseOutput(*clientCodec_);
+  // Every body byte was credited back, plus the growth, so the peer may
+  // now have the grown windows in flight
+  EXPECT_EQ(credit[0], tuner->getSessionWindow());
+  EXPECT_EQ(credit[streamID], tuner->getStreamWindow());
+
+  cleanup();
+}
+
 TEST_F(HTTP2DownstreamSessionTest, ZeroDeltaWindowUpdate) {
   // generateHeader() will create a session and a transaction
   auto streamID = sendHeader();
@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/http/session/HTTPEventQueue.h>
+#include <proxygen/lib/test/AllocationCounter.h>
+
+#include <queue>
+
+using namespace folly;
+using namespace proxygen;
+
+// Each iteration is one 1MB upload stream arriving in 16KB DATA frames,
+// while the handler pauses ingress for every kFramesPerPause frames and then
+// resumes.  The allocs_per_MB counter is heap allocations per MB made by the
+// deferred ingress queue; the frames themselves are allocated outside the
+// measured section.
+
+namespace {
+
+const size_t kFrameSize = 16 * 1024;
+const size_t kFramesPerMB = (1 << 20) / kFrameSize;
+const size_t kFramesPerPause = 8;
+
+std::vector<std::unique_ptr<IOBuf>> makeFrames() {
+  std::vector<std::unique_ptr<IOBuf>> frames;
+  frames.reserve(kFramesPerMB);
+  for (size_t i = 0; i < kFramesPerMB; i++) {
+    auto buf = IOBuf::create(kFrameSize);
+    buf->append(kFrameSize);
+    frames.push_back(std::move(buf));
+  }
+  return frames;
+}
+
+void deliverBody(std::unique_ptr<IOBuf> body) {
+  doNotOptimizeAway(body->computeChainDataLength());
+}
+
+// HTTPTransaction's deferred ingress before HTTPEventQueue: a lazily
+// allocated std::queue, replayed one event at a time
+void dequeUpload(std::vector<std::unique_ptr<IOBuf>>& frames) {
+  std::unique_ptr<std::queue<HTTPEvent>> deferred;
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (!deferred) {
+      deferred = std::make_unique<std::queue<HTTPEvent>>();
+    }
+    deferred->emplace(1, HTTPEvent::Type::BODY, std::move(frames[i]));
+    if ((i + 1) % kFramesPerPause == 0) {
+      while (!deferred->empty()) {
+        deliverBody(deferred->front().getBody());
+        deferred->pop();
+      }
+    }
+  }
+}
+
+void ringUpload(std::vector<std::unique_ptr<IOBuf>>& frames,
+                HTTPEventQueue::Pool& pool) {
+  std::unique_ptr<HTTPEventQueue> deferred;
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (!deferred) {
+      deferred = pool.acquire();
+    }
+    deferred->emplaceBody(1, std::move(frames[i]));
+    if ((i + 1) % kFramesPerPause == 0) {
+      while (!deferred->empty()) {
+        deliverBody(deferred->front().getBody());
+        deferred->pop();
+      }
+      pool.release(std::move(deferred));
+    }
+  }
+  if (deferred) {
+    pool.release(std::move(deferred));
+  }
+}
+
+template <typename F>
+void runUploads(UserCounters& counters, uint32_t iters, F upload) {
+  size_t allocs = 0;
+  for (uint32_t i = 0; i < iters; i++) {
+    std::vector<std::unique_ptr<IOBuf>> frames;
+    BENCHMARK_SUSPEND {
+      frames = makeFrames();
+    }
+    auto before = getAllocationCount();
+    upload(frames);
+    allocs += getAllocationCount() - before;
+    BENCHMARK_SUSPEND {
+      frames.clear();
+    }
+  }
+  if (iters > 0) {
+    counters["allocs_per_MB"] = int(allocs / iters);
+  }
+}
+}
+
+BENCHMARK_COUNTERS(DequePausedUpload, counters, iters) {
+  runUploads(counters, iters, dequeUpload);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(RingPausedUpload, counters, iters) {
+  HTTPEventQueue::Pool pool;
+  runUploads(counters, iters, [&pool](std::vector<std::unique_ptr<IOBuf>>& f) {
+    ringUpload(f, pool);
+  });
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/HTTPEventQueue.h>
+
+using namespace proxygen;
+using folly::IOBuf;
+
+namespace {
+
+std::unique_ptr<IOBuf> makeBody(size_t len) {
+  auto buf = IOBuf::create(len);
+  memset(buf->writableData(), 'a', len);
+  buf->append(len);
+  return buf;
+}
+
+}
+
+TEST(HTTPEventQueueTest, CoalescesBody) {
+  HTTPEventQueue queue;
+  queue.emplace(1, HTTPEvent::Type::HEADERS_COMPLETE,
+                std::make_unique<HTTPMessage>());
+  for (int i = 0; i < 10; i++) {
+    queue.emplaceBody(1, makeBody(100));
+  }
+  queue.emplace(1, HTTPEvent::Type::CHUNK_COMPLETE);
+  queue.emplaceBody(1, makeBody(50));
+  queue.emplace(1, HTTPEvent::Type::MESSAGE_COMPLETE);
+  EXPECT_EQ(queue.size(), 5);
+
+  EXPECT_EQ(queue.front().getEvent(), HTTPEvent::Type::HEADERS_COMPLETE);
+  queue.pop();
+  EXPECT_EQ(queue.front().getEvent(), HTTPEvent::Type::BODY);
+  auto body = queue.front().getBody();
+  EXPECT_EQ(body->computeChainDataLength(), 1000);
+  EXPECT_EQ(body->countChainElements(), 10);
+  queue.pop();
+  EXPECT_EQ(queue.front().getEvent(), HTTPEvent::Type::CHUNK_COMPLETE);
+  queue.pop();
+  EXPECT_EQ(queue.front().getBody()->computeChainDataLength(), 50);
+  queue.pop();
+  EXPECT_EQ(queue.front().getEvent(), HTTPEvent::Type::MESSAGE_COMPLETE);
+  queue.pop();
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(HTTPEventQueueTest, NoCoalesceIntoTakenBody) {
+  HTTPEventQueue queue;
+  queue.emplaceBody(1, makeBody(10));
+  // Being replayed
+  auto body = queue.front().getBody();
+  queue.emplaceBody(1, makeBody(20));
+  EXPECT_EQ(queue.size(), 2);
+  queue.pop();
+  EXPECT_EQ(queue.front().getBody()->computeChainDataLength(), 20);
+}
+
+TEST(HTTPEventQueueTest, WrapAndGrow) {
+  HTTPEventQueue queue;
+  size_t pushed = 0;
+  size_t popped = 0;
+  // Keep the ring partially full while it wraps around, then grow it
+  for (int round = 0; round < 3; round++) {
+    for (size_t i = 0; i < HTTPEventQueue::kInitialCapacity - 1; i++) {
+      queue.emplace(1, HTTPEvent::Type::CHUNK_HEADER, pushed++);
+    }
+    while (queue.size() > 1) {
+      EXPECT_EQ(queue.front().getChunkLength(), popped++);
+      queue.pop();
+    }
+  }
+  EXPECT_EQ(queue.capacity(), HTTPEventQueue::kInitialCapacity);
+  for (size_t i = 0; i < 3 * HTTPEventQueue::kInitialCapacity; i++) {
+    queue.emplace(1, HTTPEvent::Type::CHUNK_HEADER, pushed++);
+  }
+  EXPECT_EQ(queue.capacity(), 4 * HTTPEventQueue::kInitialCapacity);
+  while (!queue.empty()) {
+    EXPECT_EQ(queue.front().getChunkLength(), popped++);
+    queue.pop();
+  }
+  EXPECT_EQ(popped, pushed);
+}
+
+TEST(HTTPEventQueueTest, Pool) {
+  HTTPEventQueue::Pool pool;
+  auto queue = pool.acquire();
+  auto raw = queue.get();
+  queue->emplaceBody(1, makeBody(10));
+  pool.release(std::move(queue));
+  EXPECT_EQ(pool.size(), 1);
+
+  queue = pool.acquire();
+  EXPECT_EQ(queue.get(), raw);
+  EXPECT_TRUE(queue->empty());
+  EXPECT_EQ(pool.size(), 0);
+
+  // Rings that grew too large are not kept
+  for (size_t i = 0; i <= HTTPEventQueue::Pool::kMaxPooledCapacity; i++) {
+    queue->emplace(1, HTTPEvent::Type::CHUNK_COMPLETE);
+  }
+  pool.release(std::move(queue));
+  EXPECT_EQ(pool.size(), 0);
+}
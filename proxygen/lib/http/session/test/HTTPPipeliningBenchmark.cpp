@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/session/HTTPDownstreamSession.h>
+#include <proxygen/lib/http/session/test/DirectResponseController.h>
+#include <proxygen/lib/http/session/test/TestUtils.h>
+#include <proxygen/lib/test/TestAsyncTransport.h>
+
+using namespace folly;
+using namespace proxygen;
+
+// Each iteration is one GET request.  Clients pipeline kPipelineDepth
+// requests per read, and every request is answered with an empty 200 whose
+// EOM goes through the egress queue, as a handler streaming its response
+// does.  writes_per_1000_req is the number of writes the session made on the
+// transport per 1000 requests, i.e. write syscalls on a real socket.
+
+namespace {
+
+const size_t kPipelineDepth = 16;
+
+void runPipeline(UserCounters& counters,
+                 uint32_t iters,
+                 uint32_t maxPipelinedRequests) {
+  EventBase evb;
+  DirectResponseController controller;
+  TestAsyncTransport* transport{nullptr};
+  HTTPSession* session{nullptr};
+  auto timeouts = makeTimeoutSet(&evb);
+  BENCHMARK_SUSPEND {
+    transport = new TestAsyncTransport(&evb);
+    session = new HTTPDownstreamSession(
+        timeouts.get(),
+        AsyncTransportWrapper::UniquePtr(transport),
+        localAddr,
+        peerAddr,
+        &controller,
+        std::make_unique<HTTP1xCodec>(TransportDirection::DOWNSTREAM),
+        mockTransportInfo,
+        nullptr);
+    session->setMaxPipelinedRequests(maxPipelinedRequests);
+    session->startNow();
+
+    const std::string request("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    for (uint32_t sent = 0; sent < iters; sent += kPipelineDepth) {
+      std::string batch;
+      for (size_t i = 0; i < kPipelineDepth && sent + i < iters; i++) {
+        batch += request;
+      }
+      transport->addMovableReadEvent(IOBuf::copyBuffer(batch));
+    }
+    transport->startReadEvents();
+  }
+  evb.loop();
+  BENCHMARK_SUSPEND {
+    if (iters > 0) {
+      counters["writes_per_1000_req"] =
+          int(transport->getWriteEvents()->size() * 1000 / iters);
+    }
+    session->dropConnection();
+    evb.loop();
+  }
+}
+}
+
+BENCHMARK_COUNTERS(PipelineOneAtATime, counters, iters) {
+  runPipeline(counters, iters, 1);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(PipelineBatched, counters, iters) {
+  runPipeline(counters, iters, kPipelineDepth);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
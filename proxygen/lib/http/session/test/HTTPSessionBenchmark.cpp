@@ -0,0 +1,523 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/GMock.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/codec/HTTP2Codec.h>
+#include <proxygen/lib/http/session/HQDownstreamSession.h>
+#include <proxygen/lib/http/session/HTTPDownstreamSession.h>
+#include <proxygen/lib/http/session/HTTPSessionController.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <proxygen/lib/http/session/test/MockQuicSocketDriver.h>
+#include <proxygen/lib/http/session/test/TestUtils.h>
+#include <proxygen/lib/test/AllocationCounter.h>
+#include <proxygen/lib/test/TestAsyncTransport.h>
+
+using namespace folly;
+using namespace proxygen;
+
+DEFINE_int32(small_body_size, 100, "Response body size of small requests");
+DEFINE_int32(large_body_size, 1 << 20, "Response body size of large requests");
+DEFINE_int32(concurrent_streams, 100, "Requests per read for multiplexed "
+             "workloads");
+
+// End to end session benchmarks, without sockets: HTTPDownstreamSession and
+// HTTPUpstreamSession run over TestAsyncTransport, HQDownstreamSession over
+// MockQuicSocketDriver, and the peer's side is generated up front with a
+// codec.  Each iteration is one request and its whole response, so the time
+// reported is ns per request.  Requests arrive in reads of one, or of
+// concurrent_streams for the multiplexed workloads, and the event loop runs
+// after every read.  allocs_per_req is global allocator calls per request;
+// for HQ it includes those of the mock socket.
+
+namespace {
+
+const size_t kChunkSize = 16 * 1024;
+const uint32_t kMaxWindow = (1u << 31) - 1;
+
+// Answers every request with a 200 and a body of bodySize bytes, sent in
+// kChunkSize pieces
+class BodyHandler : public HTTPTransactionHandler {
+ public:
+  BodyHandler(const IOBuf& chunk, size_t bodySize)
+      : chunk_(chunk), bodySize_(bodySize) {
+  }
+
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+
+  void detachTransaction() noexcept override {
+    delete this;
+  }
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> /*msg*/) noexcept
+      override {
+  }
+
+  void onBody(std::unique_ptr<IOBuf> /*chain*/) noexcept override {
+  }
+
+  void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept
+      override {
+  }
+
+  void onEOM() noexcept override {
+    HTTPMessage resp;
+    resp.setHTTPVersion(1, 1);
+    resp.setStatusCode(200);
+    resp.setStatusMessage("OK");
+    resp.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                          folly::to<std::string>(bodySize_));
+    txn_->sendHeaders(resp);
+    for (size_t sent = 0; sent < bodySize_; sent += chunk_.length()) {
+      auto piece = chunk_.clone();
+      if (bodySize_ - sent < piece->length()) {
+        piece->trimEnd(piece->length() - (bodySize_ - sent));
+      }
+      txn_->sendBody(std::move(piece));
+    }
+    txn_->sendEOM();
+  }
+
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+  }
+
+  void onError(const HTTPException& /*error*/) noexcept override {
+  }
+
+  void onEgressPaused() noexcept override {
+  }
+
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  HTTPTransaction* txn_{nullptr};
+  const IOBuf& chunk_;
+  const size_t bodySize_;
+};
+
+class BodyController : public HTTPSessionController {
+ public:
+  explicit BodyController(size_t bodySize)
+      : chunk_(IOBuf::copyBuffer(std::string(kChunkSize, 'a'))),
+        bodySize_(bodySize) {
+  }
+
+  HTTPTransactionHandler* getRequestHandler(HTTPTransaction& /*txn*/,
+                                            HTTPMessage* /*msg*/) override {
+    return new BodyHandler(*chunk_, bodySize_);
+  }
+
+  HTTPTransactionHandler* getParseErrorHandler(
+      HTTPTransaction* /*txn*/,
+      const HTTPException& /*error*/,
+      const folly::SocketAddress& /*localAddress*/) override {
+    return nullptr;
+  }
+
+  HTTPTransactionHandler* getTransactionTimeoutHandler(
+      HTTPTransaction* /*txn*/,
+      const folly::SocketAddress& /*localAddress*/) override {
+    return nullptr;
+  }
+
+  void attachSession(HTTPSessionBase* /*session*/) override {
+  }
+
+  void detachSession(const HTTPSessionBase* /*session*/) override {
+  }
+
+ private:
+  std::unique_ptr<IOBuf> chunk_;
+  const size_t bodySize_;
+};
+
+// Counts the responses of an upstream session
+class CountingHandler : public HTTPTransactionHandler {
+ public:
+  void setTransaction(HTTPTransaction* /*txn*/) noexcept override {
+  }
+
+  void detachTransaction() noexcept override {
+  }
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> /*msg*/) noexcept
+      override {
+  }
+
+  void onBody(std::unique_ptr<IOBuf> /*chain*/) noexcept override {
+  }
+
+  void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept
+      override {
+  }
+
+  void onEOM() noexcept override {
+    responses++;
+  }
+
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+  }
+
+  void onError(const HTTPException& /*error*/) noexcept override {
+    errors++;
+  }
+
+  void onEgressPaused() noexcept override {
+  }
+
+  void onEgressResumed() noexcept override {
+  }
+
+  size_t responses{0};
+  size_t errors{0};
+};
+
+struct Workload {
+  CodecProtocol protocol;
+  size_t bodySize;
+  // Requests in each read
+  size_t streamsPerRead;
+  // Give each request an HTTP/2 priority, building a dependency tree out of
+  // the streams of each read
+  bool priorities;
+};
+
+std::unique_ptr<HTTPCodec> makeCodec(CodecProtocol protocol,
+                                     TransportDirection direction) {
+  if (protocol == CodecProtocol::HTTP_2) {
+    return std::make_unique<HTTP2Codec>(direction);
+  }
+  return std::make_unique<HTTP1xCodec>(direction);
+}
+
+HTTPMessage makeRequest() {
+  HTTPMessage req;
+  req.setMethod(HTTPMethod::GET);
+  req.setURL("/");
+  req.setHTTPVersion(1, 1);
+  req.getHeaders().set(HTTP_HEADER_HOST, "localhost");
+  return req;
+}
+
+// Everything the client sends, one buffer per read
+std::vector<std::unique_ptr<IOBuf>> makeRequestReads(const Workload& work,
+                                                     uint32_t requests) {
+  std::vector<std::unique_ptr<IOBuf>> reads;
+  if (work.protocol != CodecProtocol::HTTP_2) {
+    const std::string request("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    for (uint32_t sent = 0; sent < requests; sent += work.streamsPerRead) {
+      std::string read;
+      for (size_t i = 0; i < work.streamsPerRead && sent + i < requests; i++) {
+        read += request;
+      }
+      reads.push_back(IOBuf::copyBuffer(read));
+    }
+    return reads;
+  }
+
+  HTTP2Codec client(TransportDirection::UPSTREAM);
+  client.getEgressSettings()->setSetting(SettingsId::INITIAL_WINDOW_SIZE,
+                                         kMaxWindow);
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  client.generateConnectionPreface(queue);
+  auto req = makeRequest();
+  std::vector<HTTPCodec::StreamID> ids;
+  for (uint32_t sent = 0; sent < requests; sent += work.streamsPerRead) {
+    size_t count = std::min<size_t>(work.streamsPerRead, requests - sent);
+    if (work.bodySize > 0) {
+      // Credit the connection for the responses to this read
+      client.generateWindowUpdate(queue, 0, count * work.bodySize);
+    }
+    ids.clear();
+    for (size_t i = 0; i < count; i++) {
+      auto id = client.createStream();
+      if (work.priorities) {
+        // A tree where each stream depends on one of the earlier ones, with
+        // some exclusive insertions and varying weights
+        auto parent = ids.empty() ? 0 : ids[i / 2];
+        req.setHTTP2Priority(
+            std::make_tuple(parent, i % 5 == 0, uint8_t((i * 37) % 256)));
+      }
+      ids.push_back(id);
+      client.generateHeader(queue, id, req, true /* eom */);
+    }
+    reads.push_back(queue.move());
+  }
+  return reads;
+}
+
+// Everything the server sends, one buffer per read
+std::vector<std::unique_ptr<IOBuf>> makeResponseReads(const Workload& work,
+                                                      uint32_t responses) {
+  std::vector<std::unique_ptr<IOBuf>> reads;
+  auto body = std::string(work.bodySize, 'a');
+  if (work.protocol != CodecProtocol::HTTP_2) {
+    auto response = folly::to<std::string>("HTTP/1.1 200 OK\r\n",
+                                           "Content-Length: ",
+                                           work.bodySize,
+                                           "\r\n\r\n",
+                                           body);
+    for (uint32_t sent = 0; sent < responses; sent += work.streamsPerRead) {
+      std::string read;
+      for (size_t i = 0; i < work.streamsPerRead && sent + i < responses;
+           i++) {
+        read += response;
+      }
+      reads.push_back(IOBuf::copyBuffer(read));
+    }
+    return reads;
+  }
+
+  HTTP2Codec server(TransportDirection::DOWNSTREAM);
+  server.getEgressSettings()->setSetting(SettingsId::MAX_CONCURRENT_STREAMS,
+                                         work.streamsPerRead);
+  IOBufQueue queue{IOBufQueue::cacheChainLength()};
+  server.generateSettings(queue);
+  HTTPMessage resp;
+  resp.setStatusCode(200);
+  resp.setStatusMessage("OK");
+  resp.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                        folly::to<std::string>(work.bodySize));
+  // Stream ids as the session's codec hands them out
+  HTTP2Codec client(TransportDirection::UPSTREAM);
+  for (uint32_t sent = 0; sent < responses; sent += work.streamsPerRead) {
+    for (size_t i = 0; i < work.streamsPerRead && sent + i < responses; i++) {
+      auto id = client.createStream();
+      server.generateHeader(queue, id, resp, work.bodySize == 0);
+      if (work.bodySize > 0) {
+        server.generateBody(queue,
+                            id,
+                            IOBuf::copyBuffer(body),
+                            HTTPCodec::NoPadding,
+                            true /* eom */);
+      }
+    }
+    reads.push_back(queue.move());
+  }
+  return reads;
+}
+
+void runDownstream(UserCounters& counters,
+                   uint32_t iters,
+                   const Workload& work) {
+  EventBase evb;
+  BodyController controller(work.bodySize);
+  auto timeouts = makeTimeoutSet(&evb);
+  TestAsyncTransport* transport{nullptr};
+  HTTPDownstreamSession* session{nullptr};
+  std::vector<std::unique_ptr<IOBuf>> reads;
+  BENCHMARK_SUSPEND {
+    transport = new TestAsyncTransport(&evb);
+    session = new HTTPDownstreamSession(
+        timeouts.get(),
+        AsyncTransportWrapper::UniquePtr(transport),
+        localAddr,
+        peerAddr,
+        &controller,
+        makeCodec(work.protocol, TransportDirection::DOWNSTREAM),
+        mockTransportInfo,
+        nullptr);
+    session->setEgressSettings(
+        {{SettingsId::MAX_CONCURRENT_STREAMS,
+          uint32_t(std::max(FLAGS_concurrent_streams, 100))}});
+    session->startNow();
+    transport->startReadEvents();
+    reads = makeRequestReads(work, iters);
+  }
+  size_t allocs = 0;
+  for (auto& read : reads) {
+    auto before = getAllocationCount();
+    transport->addMovableReadEvent(std::move(read));
+    evb.loop();
+    allocs += getAllocationCount() - before;
+    // The transport keeps a copy of everything written
+    transport->getWriteEvents()->clear();
+  }
+  BENCHMARK_SUSPEND {
+    if (iters > 0) {
+      counters["allocs_per_req"] = int(allocs / iters);
+    }
+    session->dropConnection();
+    evb.loop();
+  }
+}
+
+void runUpstream(UserCounters& counters,
+                 uint32_t iters,
+                 const Workload& work) {
+  EventBase evb;
+  auto timeouts = makeTimeoutSet(&evb);
+  CountingHandler handler;
+  TestAsyncTransport* transport{nullptr};
+  HTTPUpstreamSession* session{nullptr};
+  // The server's side of each read
+  std::vector<std::unique_ptr<IOBuf>> reads;
+  BENCHMARK_SUSPEND {
+    transport = new TestAsyncTransport(&evb);
+    session = new HTTPUpstreamSession(
+        timeouts.get(),
+        AsyncTransportWrapper::UniquePtr(transport),
+        localAddr,
+        peerAddr,
+        makeCodec(work.protocol, TransportDirection::UPSTREAM),
+        mockTransportInfo,
+        nullptr);
+    session->startNow();
+    transport->startReadEvents();
+
+    reads = makeResponseReads(work, iters);
+  }
+  size_t allocs = 0;
+  auto req = makeRequest();
+  for (uint32_t sent = 0, read = 0; sent < iters;
+       sent += work.streamsPerRead, read++) {
+    auto before = getAllocationCount();
+    for (size_t i = 0; i < work.streamsPerRead && sent + i < iters; i++) {
+      auto txn = session->newTransaction(&handler);
+      CHECK(txn);
+      txn->sendHeadersWithEOM(req);
+    }
+    transport->addMovableReadEvent(std::move(reads[read]));
+    evb.loop();
+    allocs += getAllocationCount() - before;
+    transport->getWriteEvents()->clear();
+  }
+  BENCHMARK_SUSPEND {
+    CHECK_EQ(handler.responses, iters);
+    if (iters > 0) {
+      counters["allocs_per_req"] = int(allocs / iters);
+    }
+    session->dropConnection();
+    evb.loop();
+  }
+}
+
+// HTTP/1.1 over QUIC (h1q-fb, the mock socket's ALPN), which needs no
+// control streams
+void runHQDownstream(UserCounters& counters,
+                     uint32_t iters,
+                     size_t streamsPerRead) {
+  EventBase evb;
+  BodyController controller(FLAGS_small_body_size);
+  HQDownstreamSession* session{nullptr};
+  std::unique_ptr<quic::MockQuicSocketDriver> driver;
+  BENCHMARK_SUSPEND {
+    session = new HQDownstreamSession(
+        std::chrono::milliseconds(5000), &controller, mockTransportInfo,
+        nullptr);
+    driver = std::make_unique<quic::MockQuicSocketDriver>(
+        &evb,
+        *session,
+        session->getDispatcher(),
+        session->getDispatcher(),
+        quic::MockQuicSocketDriver::TransportEnum::SERVER);
+    EXPECT_CALL(*driver->getSocket(), getLocalAddress())
+        .WillRepeatedly(testing::ReturnRef(localAddr));
+    EXPECT_CALL(*driver->getSocket(), getPeerAddress())
+        .WillRepeatedly(testing::ReturnRef(peerAddr));
+    session->setSocket(driver->getSocket());
+    session->onTransportReady();
+    evb.loop();
+  }
+  const std::string request("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  size_t allocs = 0;
+  quic::StreamId id = 0;
+  for (uint32_t sent = 0; sent < iters; sent += streamsPerRead) {
+    auto before = getAllocationCount();
+    for (size_t i = 0; i < streamsPerRead && sent + i < iters; i++) {
+      driver->addReadEvent(id, IOBuf::copyBuffer(request));
+      driver->addReadEOF(id);
+      // Client initiated bidirectional streams
+      id += 4;
+    }
+    evb.loop();
+    allocs += getAllocationCount() - before;
+  }
+  BENCHMARK_SUSPEND {
+    if (iters > 0) {
+      counters["allocs_per_req"] = int(allocs / iters);
+    }
+    session->dropConnection();
+    evb.loop();
+    driver.reset();
+  }
+}
+
+Workload small(CodecProtocol protocol, size_t streamsPerRead = 1) {
+  return Workload{protocol, size_t(FLAGS_small_body_size), streamsPerRead,
+                  false};
+}
+}
+
+BENCHMARK_COUNTERS(H1DownstreamSmall, counters, iters) {
+  runDownstream(counters, iters, small(CodecProtocol::HTTP_1_1));
+}
+
+BENCHMARK_COUNTERS_RELATIVE(H2DownstreamSmall, counters, iters) {
+  runDownstream(counters, iters, small(CodecProtocol::HTTP_2));
+}
+
+BENCHMARK_COUNTERS_RELATIVE(H2DownstreamConcurrent, counters, iters) {
+  runDownstream(
+      counters, iters, small(CodecProtocol::HTTP_2, FLAGS_concurrent_streams));
+}
+
+BENCHMARK_COUNTERS_RELATIVE(H2DownstreamPriorityTree, counters, iters) {
+  auto work = small(CodecProtocol::HTTP_2, FLAGS_concurrent_streams);
+  work.priorities = true;
+  runDownstream(counters, iters, work);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(HQDownstreamSmall, counters, iters) {
+  runHQDownstream(counters, iters, 1);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS(H1DownstreamLargeBody, counters, iters) {
+  runDownstream(counters,
+                iters,
+                Workload{CodecProtocol::HTTP_1_1,
+                         size_t(FLAGS_large_body_size), 1, false});
+}
+
+BENCHMARK_COUNTERS_RELATIVE(H2DownstreamLargeBody, counters, iters) {
+  runDownstream(counters,
+                iters,
+                Workload{CodecProtocol::HTTP_2,
+                         size_t(FLAGS_large_body_size), 1, false});
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS(H1UpstreamSmall, counters, iters) {
+  runUpstream(counters, iters, small(CodecProtocol::HTTP_1_1));
+}
+
+BENCHMARK_COUNTERS_RELATIVE(H2UpstreamSmall, counters, iters) {
+  runUpstream(counters, iters, small(CodecProtocol::HTTP_2));
+}
+
+BENCHMARK_COUNTERS_RELATIVE(H2UpstreamConcurrent, counters, iters) {
+  runUpstream(
+      counters, iters, small(CodecProtocol::HTTP_2, FLAGS_concurrent_streams));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleMock(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
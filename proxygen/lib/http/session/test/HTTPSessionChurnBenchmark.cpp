@@ -0,0 +1,80 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/session/HTTPDownstreamSession.h>
+#include <proxygen/lib/http/session/test/DirectResponseController.h>
+#include <proxygen/lib/http/session/test/TestUtils.h>
+#include <proxygen/lib/test/AllocationCounter.h>
+#include <proxygen/lib/test/TestAsyncTransport.h>
+#include <proxygen/lib/utils/FreeList.h>
+
+using namespace folly;
+using namespace proxygen;
+
+// Each iteration is one short lived connection: a session and codec are
+// created, one GET is answered with an empty 200, and the client closes.
+// allocs_per_req is global allocator calls per request, so with recycling
+// the sessions, codecs, messages and transactions come off the per-thread
+// free lists.
+
+namespace {
+
+void runConnections(UserCounters& counters,
+                    uint32_t iters,
+                    size_t maxFreeBlocks) {
+  EventBase evb;
+  DirectResponseController controller;
+  auto timeouts = makeTimeoutSet(&evb);
+  const std::string request("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  FreeLists::setMaxFreeBlocks(maxFreeBlocks);
+  size_t allocs = 0;
+  for (uint32_t i = 0; i < iters; i++) {
+    auto before = getAllocationCount();
+    auto transport = new TestAsyncTransport(&evb);
+    auto session = new HTTPDownstreamSession(
+        timeouts.get(),
+        AsyncTransportWrapper::UniquePtr(transport),
+        localAddr,
+        peerAddr,
+        &controller,
+        std::make_unique<HTTP1xCodec>(TransportDirection::DOWNSTREAM),
+        mockTransportInfo,
+        nullptr);
+    session->startNow();
+    transport->addReadEvent(request.data(), request.size(),
+                            std::chrono::milliseconds(0));
+    transport->addReadEOF(std::chrono::milliseconds(0));
+    transport->startReadEvents();
+    evb.loop();
+    allocs += getAllocationCount() - before;
+  }
+  FreeLists::setMaxFreeBlocks(FreeLists::kDefaultMaxFreeBlocks);
+  if (iters > 0) {
+    counters["allocs_per_req"] = int(allocs / iters);
+  }
+}
+}
+
+BENCHMARK_COUNTERS(ConnectionChurnNoRecycling, counters, iters) {
+  runConnections(counters, iters, 0);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(ConnectionChurnRecycling, counters, iters) {
+  runConnections(counters, iters, FreeLists::kDefaultMaxFreeBlocks);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
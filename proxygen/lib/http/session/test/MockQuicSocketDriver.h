@@ -13,6 +13,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <quic/api/test/MockQuicSocket.h>
+#include <set>
 #include <unordered_map>
 
 namespace quic {
@@ -67,6 +68,9 @@ class MockQuicSocketDriver : public folly::EventBase::LoopCallback {
     uint64_t flowControlWindow{65536};
     bool isControl{false};
     uint64_t lastSkipOffset{0};
+    // Offsets of bytes that are lost: delivery of the first of them and of
+    // everything after waits for its retransmission, or for a skip past it
+    std::set<uint64_t> lostOffsets;
   };
   bool partiallyReliableTransport_{false};
 
@@ -508,6 +512,14 @@ class MockQuicSocketDriver : public folly::EventBase::LoopCallback {
               if (streamOffset > it->second.writeOffset) {
                 it->second.writeOffset = streamOffset;
               }
+
+              // The expired data is not retransmitted anymore, and what
+              // was not delivered of it never will be
+              auto& lostOffsets = it->second.lostOffsets;
+              lostOffsets.erase(lostOffsets.begin(),
+                                lostOffsets.lower_bound(streamOffset));
+              cancelDeliveryCallbacks(id, it->second, streamOffset);
+              ackDelivered(it->second, id);
               return folly::makeExpected<LocalErrorCode>(streamOffset);
             }));
 
@@ -757,6 +769,10 @@ class MockQuicSocketDriver : public folly::EventBase::LoopCallback {
       stream.writeState = CLOSED;
     }
 
+    ackDelivered(stream, id);
+  }
+
+  void ackDelivered(StreamState& stream, StreamId id) {
     // delay delivery callbacks 50ms
     eventBase_->runAfterDelay(
         [&stream, id, deleted = deleted_] {
@@ -764,7 +780,10 @@ class MockQuicSocketDriver : public folly::EventBase::LoopCallback {
             return;
           }
           while (!stream.deliveryCallbacks.empty() &&
-                 stream.deliveryCallbacks.front().first <= stream.writeOffset) {
+                 stream.deliveryCallbacks.front().first <= stream.writeOffset &&
+                 (stream.lostOffsets.empty() ||
+                  stream.deliveryCallbacks.front().first <
+                      *stream.lostOffsets.begin())) {
             stream.deliveryCallbacks.front().second->onDeliveryAck(
                 id,
                 stream.deliveryCallbacks.front().first,
@@ -775,6 +794,41 @@ class MockQuicSocketDriver : public folly::EventBase::LoopCallback {
         50);
   }
 
+  // Loses the packet carrying the byte at streamOffset, which is only
+  // retransmitted retransmitDelay later
+  void loseStreamData(StreamId id,
+                      uint64_t streamOffset,
+                      std::chrono::milliseconds retransmitDelay) {
+    auto& stream = streams_[id];
+    stream.lostOffsets.insert(streamOffset);
+    eventBase_->runAfterDelay(
+        [this, &stream, id, streamOffset, deleted = deleted_] {
+          if (*deleted || stream.lostOffsets.erase(streamOffset) == 0) {
+            return;
+          }
+          ackDelivered(stream, id);
+        },
+        retransmitDelay.count());
+  }
+
+  // Cancels, from the loop, the delivery callbacks for offsets below
+  // streamOffset that are still outstanding
+  void cancelDeliveryCallbacks(StreamId id,
+                               StreamState& stream,
+                               uint64_t streamOffset) {
+    eventBase_->runInLoop([&stream, id, streamOffset, deleted = deleted_] {
+      if (*deleted) {
+        return;
+      }
+      while (!stream.deliveryCallbacks.empty() &&
+             stream.deliveryCallbacks.front().first < streamOffset) {
+        auto cb = stream.deliveryCallbacks.front();
+        stream.deliveryCallbacks.pop_front();
+        cb.second->onCanceled(id, cb.first);
+      }
+    });
+  }
+
   void flushWrites(StreamId id = kConnectionStreamId) {
     auto& connState = streams_[kConnectionStreamId];
     for (auto& it : streams_) {
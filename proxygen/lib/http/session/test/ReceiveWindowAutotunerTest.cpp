@@ -0,0 +1,136 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/ScopeGuard.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/ReceiveWindowAutotuner.h>
+
+using namespace proxygen;
+using std::chrono::milliseconds;
+
+namespace {
+
+// One ping round trip of rtt during which `bytes` arrived
+bool sample(ReceiveWindowAutotuner& tuner,
+            TimePoint& now,
+            uint64_t bytes,
+            milliseconds rtt = milliseconds(100)) {
+  EXPECT_TRUE(tuner.shouldSendPing());
+  tuner.onPingSent(now);
+  EXPECT_FALSE(tuner.shouldSendPing());
+  tuner.onBytesReceived(bytes);
+  now += rtt;
+  return tuner.onPingReply(now);
+}
+
+}
+
+TEST(ReceiveWindowAutotunerTest, GrowsWhenWindowLimited) {
+  ReceiveWindowAutotuner tuner(65536, 65536, 1 << 24, 1 << 22);
+  TimePoint now = getCurrentTime();
+
+  // Filled the whole window in one round trip: double it
+  EXPECT_TRUE(sample(tuner, now, 65536));
+  EXPECT_EQ(tuner.getSessionWindow(), 131072);
+  EXPECT_EQ(tuner.getStreamWindow(), 131072);
+  EXPECT_EQ(tuner.getLastRtt(), milliseconds(100));
+
+  EXPECT_TRUE(sample(tuner, now, 131072));
+  EXPECT_EQ(tuner.getSessionWindow(), 262144);
+  EXPECT_EQ(tuner.getStreamWindow(), 262144);
+}
+
+TEST(ReceiveWindowAutotunerTest, NoGrowthWhenNotWindowLimited) {
+  ReceiveWindowAutotuner tuner(65536, 65536, 1 << 24, 1 << 22);
+  TimePoint now = getCurrentTime();
+
+  // Only a third of the window was used per round trip
+  EXPECT_FALSE(sample(tuner, now, 20000));
+  EXPECT_EQ(tuner.getSessionWindow(), 65536);
+  EXPECT_EQ(tuner.getStreamWindow(), 65536);
+}
+
+TEST(ReceiveWindowAutotunerTest, NoGrowthWithoutMoreBandwidth) {
+  ReceiveWindowAutotuner tuner(65536, 65536, 1 << 24, 1 << 22);
+  TimePoint now = getCurrentTime();
+
+  EXPECT_TRUE(sample(tuner, now, 65536));
+  // The same bytes over a longer round trip is less bandwidth, the bigger
+  // window did not help
+  EXPECT_FALSE(sample(tuner, now, 131072, milliseconds(200)));
+  EXPECT_EQ(tuner.getSessionWindow(), 131072);
+}
+
+TEST(ReceiveWindowAutotunerTest, PerSessionMaximums) {
+  ReceiveWindowAutotuner tuner(65536, 65536, 100000, 80000);
+  TimePoint now = getCurrentTime();
+
+  EXPECT_TRUE(sample(tuner, now, 65536));
+  EXPECT_EQ(tuner.getSessionWindow(), 100000);
+  EXPECT_EQ(tuner.getStreamWindow(), 80000);
+  EXPECT_TRUE(tuner.isSaturated());
+  // No more sampling once both windows are at their maximums
+  EXPECT_FALSE(tuner.shouldSendPing());
+}
+
+TEST(ReceiveWindowAutotunerTest, ProcessLimit) {
+  auto granted = ReceiveWindowAutotuner::getProcessGrantedBytes();
+  ReceiveWindowAutotuner::setProcessLimit(granted + 300000);
+  SCOPE_EXIT {
+    ReceiveWindowAutotuner::setProcessLimit(0);
+  };
+  TimePoint now = getCurrentTime();
+  {
+    ReceiveWindowAutotuner first(65536, 65536, 1 << 24, 1 << 24);
+    ReceiveWindowAutotuner second(65536, 65536, 1 << 24, 1 << 24);
+
+    // Session and stream window growth both count
+    EXPECT_TRUE(sample(first, now, 65536));
+    EXPECT_EQ(first.getSessionWindow(), 131072);
+    EXPECT_EQ(first.getStreamWindow(), 131072);
+    EXPECT_TRUE(sample(second, now, 65536));
+    EXPECT_EQ(second.getSessionWindow(), 131072);
+    EXPECT_EQ(ReceiveWindowAutotuner::getProcessGrantedBytes(),
+              granted + 4 * 65536);
+
+    // Only what is left under the limit, to the session window first
+    EXPECT_TRUE(sample(first, now, 131072));
+    EXPECT_EQ(first.getSessionWindow(), 131072 + 300000 - 4 * 65536);
+    EXPECT_EQ(first.getStreamWindow(), 131072);
+    EXPECT_EQ(ReceiveWindowAutotuner::getProcessGrantedBytes(),
+              granted + 300000);
+  }
+  // Growth is returned when sessions go away
+  EXPECT_EQ(ReceiveWindowAutotuner::getProcessGrantedBytes(), granted);
+}
+
+TEST(ReceiveWindowAutotunerTest, StreamWindowProcessLimit) {
+  auto granted = ReceiveWindowAutotuner::getProcessGrantedBytes();
+  ReceiveWindowAutotuner::setProcessLimit(granted + 100000);
+  SCOPE_EXIT {
+    ReceiveWindowAutotuner::setProcessLimit(0);
+  };
+  TimePoint now = getCurrentTime();
+  // The session window starts large, only the stream window grows
+  ReceiveWindowAutotuner tuner(1 << 20, 65536, 1 << 20, 1 << 24);
+
+  EXPECT_TRUE(sample(tuner, now, 1 << 20));
+  EXPECT_EQ(tuner.getStreamWindow(), 65536 + 100000);
+  EXPECT_EQ(ReceiveWindowAutotuner::getProcessGrantedBytes(),
+            granted + 100000);
+}
+
+TEST(ReceiveWindowAutotunerTest, StreamWindowBoundedBySession) {
+  ReceiveWindowAutotuner tuner(65536, 65536, 65536, 1 << 24);
+  TimePoint now = getCurrentTime();
+
+  // The session window cannot grow, so neither can its streams
+  EXPECT_FALSE(sample(tuner, now, 65536));
+  EXPECT_EQ(tuner.getStreamWindow(), 65536);
+}
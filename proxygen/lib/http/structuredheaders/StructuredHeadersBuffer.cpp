@@ -10,7 +10,7 @@
 
 #include "StructuredHeadersBuffer.h"
 
-#include <boost/lexical_cast.hpp>
+#include <folly/Conv.h>
 #include <glog/logging.h>
 
 #include "StructuredHeadersUtilities.h"// @manual=:utils
@@ -21,6 +21,20 @@ using namespace StructuredHeaders;
 
 DecodeError StructuredHeadersBuffer::parseItem(StructuredHeaderItem& result) {
 
+  std::string arena;
+  StructuredHeaderItemView view;
+  auto err = parseItem(view, arena);
+  if (err != DecodeError::OK) {
+    return err;
+  }
+
+  result = view.toItem();
+  return DecodeError::OK;
+}
+
+DecodeError StructuredHeadersBuffer::parseItem(StructuredHeaderItemView& result,
+  std::string& arena) {
+
   removeOptionalWhitespace();
 
   if (isEmpty()) {
@@ -28,9 +42,9 @@ DecodeError StructuredHeadersBuffer::parseItem(StructuredHeaderItem& result) {
   } else {
     char firstCharacter = peek();
     if (firstCharacter == '"') {
-      return parseString(result);
+      return parseString(result, arena);
     } else if (firstCharacter == '*') {
-      return parseBinaryContent(result);
+      return parseBinaryContent(result, arena);
     } else if (std::isdigit(firstCharacter) || firstCharacter == '-') {
       return parseNumber(result);
     } else {
@@ -39,11 +53,12 @@ DecodeError StructuredHeadersBuffer::parseItem(StructuredHeaderItem& result) {
   }
 }
 
-DecodeError StructuredHeadersBuffer::parseNumber(StructuredHeaderItem& result) {
+DecodeError StructuredHeadersBuffer::parseNumber(
+  StructuredHeaderItemView& result) {
   auto type = StructuredHeaderItem::Type::INT64;
 
   bool positive = true;
-  std::string input;
+  auto begin = content_.begin();
 
   if (isEmpty()) {
     return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
@@ -52,7 +67,6 @@ DecodeError StructuredHeadersBuffer::parseNumber(StructuredHeaderItem& result) {
   if (peek() == '-') {
     advanceCursor();
     positive = false;
-    input.push_back('-');
   }
 
   if (isEmpty()) {
@@ -66,17 +80,15 @@ DecodeError StructuredHeadersBuffer::parseNumber(StructuredHeaderItem& result) {
   while (!isEmpty()) {
     char current = peek();
     if (std::isdigit(current)) {
-      input.push_back(current);
       advanceCursor();
     } else if (type == StructuredHeaderItem::Type::INT64 && current == '.') {
       type = StructuredHeaderItem::Type::DOUBLE;
-      input.push_back(current);
       advanceCursor();
     } else {
       break;
     }
 
-    int numDigits = input.length() - (positive ? 0 : 1);
+    int numDigits = (content_.begin() - begin) - (positive ? 0 : 1);
     if (type == StructuredHeaderItem::Type::INT64 &&
        numDigits > StructuredHeaders::kMaxValidIntegerLength) {
       return handleDecodeError(DecodeError::VALUE_TOO_LONG);
@@ -86,21 +98,30 @@ DecodeError StructuredHeadersBuffer::parseNumber(StructuredHeaderItem& result) {
     }
   }
 
+  folly::StringPiece input(begin, content_.begin());
   if (type == StructuredHeaderItem::Type::INT64) {
-    return parseInteger(input, result);
+    auto value = folly::tryTo<int64_t>(input);
+    if (!value.hasValue()) {
+      return handleDecodeError(DecodeError::UNPARSEABLE_NUMERIC_TYPE);
+    }
+    result.integer = *value;
   } else if (input.back() == '.') {
     return handleDecodeError(DecodeError::INVALID_CHARACTER);
   } else {
-    return parseFloat(input, result);
+    auto value = folly::tryTo<double>(input);
+    if (!value.hasValue()) {
+      return handleDecodeError(DecodeError::UNPARSEABLE_NUMERIC_TYPE);
+    }
+    result.number = *value;
   }
+  result.tag = type;
 
   return DecodeError::OK;
 }
 
 DecodeError StructuredHeadersBuffer::parseBinaryContent(
-  StructuredHeaderItem& result) {
+  StructuredHeaderItemView& result, std::string& arena) {
 
-  std::string outputString;
   if (isEmpty()) {
     return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
   }
@@ -110,29 +131,29 @@ DecodeError StructuredHeadersBuffer::parseBinaryContent(
   }
 
   advanceCursor();
+  auto begin = content_.begin();
 
   while (!isEmpty()) {
     char current = peek();
-    advanceCursor();
     if (current == '*') {
-      if (!isValidEncodedBinaryContent(
-         outputString)) {
-        return handleDecodeError(DecodeError::UNDECODEABLE_BINARY_CONTENT);
-      }
+      folly::StringPiece encoded(begin, content_.begin());
+      advanceCursor();
 
-      std::string decodedContent = decodeBase64(outputString);
-      if (encodeBase64(decodedContent) != outputString) {
+      auto decodedBegin = arena.size();
+      if (!appendDecodedBase64(encoded, arena)) {
+        arena.resize(decodedBegin);
         return handleDecodeError(DecodeError::UNDECODEABLE_BINARY_CONTENT);
       }
 
-      result.value = std::move(decodedContent);
+      result.string = folly::StringPiece(arena).subpiece(decodedBegin);
       result.tag = StructuredHeaderItem::Type::BINARYCONTENT;
       return DecodeError::OK;
     } else if (!isValidEncodedBinaryContentChar(
         current)) {
+      advanceCursor();
       return handleDecodeError(DecodeError::INVALID_CHARACTER);
     } else {
-      outputString.push_back(current);
+      advanceCursor();
     }
   }
 
@@ -142,14 +163,14 @@ DecodeError StructuredHeadersBuffer::parseBinaryContent(
 DecodeError StructuredHeadersBuffer::parseIdentifier(
   StructuredHeaderItem& result) {
 
-  std::string outputString;
+  folly::StringPiece identifier;
 
-  auto err = parseIdentifier(outputString);
+  auto err = parseIdentifier(identifier);
   if (err != DecodeError::OK) {
     return err;
   }
 
-  result.value = outputString;
+  result.value = identifier.str();
   result.tag = StructuredHeaderItem::Type::IDENTIFIER;
 
   return DecodeError::OK;
@@ -158,54 +179,39 @@ DecodeError StructuredHeadersBuffer::parseIdentifier(
 DecodeError StructuredHeadersBuffer::parseIdentifier(
   std::string& result) {
 
-  if (isEmpty()) {
-    return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
-  }
-
-  if (!isLcAlpha(peek())) {
-    return handleDecodeError(DecodeError::INVALID_CHARACTER);
-  }
+  folly::StringPiece identifier;
 
-  while (!isEmpty()) {
-    char current = peek();
-    if (!isValidIdentifierChar(current)) {
-      break;
-    } else {
-      advanceCursor();
-      result.push_back(current);
-    }
+  auto err = parseIdentifier(identifier);
+  if (err != DecodeError::OK) {
+    return err;
   }
 
+  result.append(identifier.begin(), identifier.end());
   return DecodeError::OK;
 }
 
-DecodeError StructuredHeadersBuffer::parseInteger(const std::string& input,
-  StructuredHeaderItem& result) {
+DecodeError StructuredHeadersBuffer::parseIdentifier(
+  folly::StringPiece& result) {
 
-  try {
-    result.value = boost::lexical_cast<int64_t>(input);
-    result.tag = StructuredHeaderItem::Type::INT64;
-  } catch (boost::bad_lexical_cast &) {
-    return handleDecodeError(DecodeError::UNPARSEABLE_NUMERIC_TYPE);
+  if (isEmpty()) {
+    return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
   }
-  return DecodeError::OK;
-}
 
-DecodeError StructuredHeadersBuffer::parseFloat(const std::string& input,
-  StructuredHeaderItem& result) {
+  if (!isLcAlpha(peek())) {
+    return handleDecodeError(DecodeError::INVALID_CHARACTER);
+  }
 
-  try {
-    result.value = boost::lexical_cast<double>(input);
-    result.tag = StructuredHeaderItem::Type::DOUBLE;
-  } catch (boost::bad_lexical_cast &) {
-    return handleDecodeError(DecodeError::UNPARSEABLE_NUMERIC_TYPE);
+  auto begin = content_.begin();
+  while (!isEmpty() && isValidIdentifierChar(peek())) {
+    advanceCursor();
   }
+  result = folly::StringPiece(begin, content_.begin());
+
   return DecodeError::OK;
 }
 
-DecodeError StructuredHeadersBuffer::parseString(StructuredHeaderItem& result) {
-
-  std::string outputString;
+DecodeError StructuredHeadersBuffer::parseString(
+  StructuredHeaderItemView& result, std::string& arena) {
 
   if (isEmpty()) {
     return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
@@ -217,48 +223,68 @@ DecodeError StructuredHeadersBuffer::parseString(StructuredHeaderItem& result) {
 
   advanceCursor();
 
+  // Strings without escapes are returned in place; from the first escape on
+  // the unescaped string is built in arena
+  auto begin = content_.begin();
+  auto unescapedBegin = arena.size();
+  bool escaped = false;
+
   while (!isEmpty()) {
     char current = peek();
     if (current == '\\') {
+      if (!escaped) {
+        arena.append(begin, content_.begin());
+        escaped = true;
+      }
       advanceCursor();
       if (isEmpty()) {
+        arena.resize(unescapedBegin);
         return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
       } else {
         char nextChar = peek();
         advanceCursor();
         if (nextChar != '"' && nextChar != '\\') {
+          arena.resize(unescapedBegin);
           return handleDecodeError(DecodeError::INVALID_CHARACTER);
         }
-        outputString.push_back(nextChar);
+        arena.push_back(nextChar);
       }
     } else if (current == '"') {
+      if (escaped) {
+        result.string = folly::StringPiece(arena).subpiece(unescapedBegin);
+      } else {
+        result.string = folly::StringPiece(begin, content_.begin());
+      }
       advanceCursor();
-      result.value = outputString;
       result.tag = StructuredHeaderItem::Type::STRING;
       return DecodeError::OK;
     } else if (!isValidStringChar(current)) {
+      arena.resize(unescapedBegin);
       return handleDecodeError(DecodeError::INVALID_CHARACTER);
     } else {
       advanceCursor();
-      outputString.push_back(current);
+      if (escaped) {
+        arena.push_back(current);
+      }
     }
   }
 
+  arena.resize(unescapedBegin);
   return handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
 }
 
 DecodeError StructuredHeadersBuffer::removeOptionalWhitespace() {
-  while (peek() == ' ' || peek() == '\t') {
+  while (!isEmpty() && (peek() == ' ' || peek() == '\t')) {
     advanceCursor();
   }
   return DecodeError::OK;
 }
 
-DecodeError StructuredHeadersBuffer::removeSymbol(const std::string& symbol,
+DecodeError StructuredHeadersBuffer::removeSymbol(folly::StringPiece symbol,
   bool strict) {
 
   if (content_.startsWith(symbol)) {
-    content_.advance(symbol.length());
+    content_.advance(symbol.size());
     return DecodeError::OK;
   } else {
     if (strict) {
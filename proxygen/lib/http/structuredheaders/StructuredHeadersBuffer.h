@@ -20,7 +20,7 @@ using namespace StructuredHeaders;
 class StructuredHeadersBuffer {
 public:
 
-  explicit StructuredHeadersBuffer(const std::string& s) :
+  explicit StructuredHeadersBuffer(folly::StringPiece s) :
     content_(s),
     originalContent_(s) {}
 
@@ -34,29 +34,40 @@ public:
 
   StructuredHeaders::DecodeError parseIdentifier(std::string& result);
 
+  StructuredHeaders::DecodeError parseIdentifier(folly::StringPiece& result);
+
   StructuredHeaders::DecodeError parseItem(StructuredHeaderItem& result);
 
-  DecodeError removeSymbol(const std::string& symbol, bool strict);
+  /*
+   * Like parseItem() above, but without copying: result refers to the buffer,
+   * or for strings with escapes and binary content, to what this appends to
+   * arena. Views into arena stay valid as long as it is not reallocated,
+   * which reserving remaining() up front guarantees for the whole buffer.
+   */
+  StructuredHeaders::DecodeError parseItem(StructuredHeaderItemView& result,
+    std::string& arena);
+
+  DecodeError removeSymbol(folly::StringPiece symbol, bool strict);
 
   DecodeError removeOptionalWhitespace();
 
   bool isEmpty();
 
+  size_t remaining() const {
+    return content_.size();
+  }
+
   DecodeError handleDecodeError(const DecodeError& err);
 
 private:
 
-  DecodeError parseBinaryContent(StructuredHeaderItem& result);
-
-  DecodeError parseNumber(StructuredHeaderItem& result);
-
-  DecodeError parseString(StructuredHeaderItem& result);
+  DecodeError parseBinaryContent(StructuredHeaderItemView& result,
+    std::string& arena);
 
-  DecodeError parseInteger(const std::string& input,
-    StructuredHeaderItem& result);
+  DecodeError parseNumber(StructuredHeaderItemView& result);
 
-  DecodeError parseFloat(const std::string& input,
-    StructuredHeaderItem& result);
+  DecodeError parseString(StructuredHeaderItemView& result,
+    std::string& arena);
 
   char peek();
 
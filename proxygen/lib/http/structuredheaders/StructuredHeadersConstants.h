@@ -13,7 +13,8 @@
 #include <map>
 #include <vector>
 #include <boost/variant.hpp>
-#include <vector>
+#include <folly/Range.h>
+#include <folly/small_vector.h>
 
 namespace proxygen {
 
@@ -62,6 +63,53 @@ using ParameterisedList =
 
 using Dictionary = std::unordered_map<std::string, StructuredHeaderItem>;
 
+/*
+ * Non-owning counterparts of the types above, filled in by the decoder
+ * without allocating. string refers to the header itself, or to the arena
+ * passed to the decoder for strings with escapes and for binary content.
+ */
+struct StructuredHeaderItemView {
+  StructuredHeaderItem toItem() const {
+    StructuredHeaderItem item;
+    item.tag = tag;
+    if (tag == StructuredHeaderItem::Type::INT64) {
+      item.value = integer;
+    } else if (tag == StructuredHeaderItem::Type::DOUBLE) {
+      item.value = number;
+    } else if (tag != StructuredHeaderItem::Type::NONE) {
+      item.value = string.str();
+    }
+    return item;
+  }
+
+  StructuredHeaderItem::Type tag{StructuredHeaderItem::Type::NONE};
+  int64_t integer{0};
+  double number{0};
+  folly::StringPiece string;
+};
+
+using StructuredHeaderMemberView =
+  std::pair<folly::StringPiece, StructuredHeaderItemView>;
+
+using StructuredHeaderItemListView =
+  folly::small_vector<StructuredHeaderItemView, 8>;
+
+// In header order, keys are unique
+using DictionaryView = folly::small_vector<StructuredHeaderMemberView, 8>;
+
+/* the parameters of identifier are parameters[parametersBegin, parametersEnd)
+ * of the list it is in */
+struct ParameterisedIdentifierView {
+  folly::StringPiece identifier;
+  uint32_t parametersBegin{0};
+  uint32_t parametersEnd{0};
+};
+
+struct ParameterisedListView {
+  folly::small_vector<ParameterisedIdentifierView, 4> identifiers;
+  DictionaryView parameters;
+};
+
 enum class DecodeError : uint8_t {
   OK = 0,
   VALUE_TOO_LONG = 1,
@@ -27,10 +27,69 @@ DecodeError StructuredHeadersDecoder::decodeItem(
 DecodeError StructuredHeadersDecoder::decodeList(
    std::vector<StructuredHeaderItem>& result) {
 
+  std::string arena;
+  StructuredHeaderItemListView items;
+  auto err = decodeList(items, arena);
+  for (const auto& item : items) {
+    result.push_back(item.toItem());
+  }
+  return err;
+}
+
+DecodeError StructuredHeadersDecoder::decodeDictionary(Dictionary& result) {
+
+  std::string arena;
+  DictionaryView members;
+  auto err = decodeDictionary(members, arena);
+  for (const auto& member : members) {
+    result[member.first.str()] = member.second.toItem();
+  }
+  return err;
+}
+
+DecodeError StructuredHeadersDecoder::decodeParameterisedList(
+  ParameterisedList& result) {
+
+  std::string arena;
+  ParameterisedListView list;
+  auto err = decodeParameterisedList(list, arena);
+  for (const auto& identifier : list.identifiers) {
+    ParameterisedIdentifier primaryIdentifier;
+    primaryIdentifier.identifier = identifier.identifier.str();
+    for (auto i = identifier.parametersBegin; i < identifier.parametersEnd;
+         i++) {
+      const auto& parameter = list.parameters[i];
+      primaryIdentifier.parameterMap[parameter.first.str()] =
+        parameter.second.toItem();
+    }
+    result.emplace_back(std::move(primaryIdentifier));
+  }
+  return err;
+}
+
+DecodeError StructuredHeadersDecoder::decodeItem(
+  StructuredHeaderItemView& result, std::string& arena) {
+
+  prepareArena(arena);
+  result = StructuredHeaderItemView();
+  auto err = buf_.parseItem(result, arena);
+  if (err != DecodeError::OK) {
+    return err;
+  }
+  return buf_.isEmpty() ?
+    DecodeError::OK : buf_.handleDecodeError(DecodeError::INVALID_CHARACTER);
+}
+
+DecodeError StructuredHeadersDecoder::decodeList(
+  StructuredHeaderItemListView& result, std::string& arena) {
+
+  prepareArena(arena);
+  result.clear();
+
   while (!buf_.isEmpty()) {
 
-    StructuredHeaderItem item;
-    auto err = buf_.parseItem(item);
+    StructuredHeaderItemView item;
+    auto err = buf_.parseItem(item, arena);
     if (err != DecodeError::OK) {
       return err;
     }
@@ -58,16 +117,24 @@ DecodeError StructuredHeadersDecoder::decodeList(
   return buf_.handleDecodeError(DecodeError::UNEXPECTED_END_OF_BUFFER);
 }
 
-DecodeError StructuredHeadersDecoder::decodeDictionary(Dictionary& result) {
-  return decodeMap(result, MapType::DICTIONARY);
+DecodeError StructuredHeadersDecoder::decodeDictionary(
+  DictionaryView& result, std::string& arena) {
+
+  prepareArena(arena);
+  result.clear();
+  return decodeMap(result, 0, MapType::DICTIONARY, arena);
 }
 
 DecodeError StructuredHeadersDecoder::decodeParameterisedList(
-  ParameterisedList& result) {
+  ParameterisedListView& result, std::string& arena) {
+
+  prepareArena(arena);
+  result.identifiers.clear();
+  result.parameters.clear();
 
   while (!buf_.isEmpty()) {
 
-    ParameterisedIdentifier primaryIdentifier;
+    ParameterisedIdentifierView primaryIdentifier;
 
     auto err = buf_.parseIdentifier(primaryIdentifier.identifier);
     if (err != DecodeError::OK) {
@@ -76,12 +143,15 @@ DecodeError StructuredHeadersDecoder::decodeParameterisedList(
 
     buf_.removeOptionalWhitespace();
 
-    err = decodeMap(primaryIdentifier.parameterMap, MapType::PARAMETERISED_MAP);
+    primaryIdentifier.parametersBegin = result.parameters.size();
+    err = decodeMap(result.parameters, primaryIdentifier.parametersBegin,
+      MapType::PARAMETERISED_MAP, arena);
     if (err != DecodeError::OK) {
       return err;
     }
+    primaryIdentifier.parametersEnd = result.parameters.size();
 
-    result.emplace_back(primaryIdentifier);
+    result.identifiers.push_back(primaryIdentifier);
 
     buf_.removeOptionalWhitespace();
 
@@ -102,10 +172,11 @@ DecodeError StructuredHeadersDecoder::decodeParameterisedList(
 }
 
 DecodeError StructuredHeadersDecoder::decodeMap(
-  std::unordered_map<std::string, StructuredHeaderItem>& result,
-  MapType mapType) {
+  DictionaryView& result, size_t firstMember, MapType mapType,
+  std::string& arena) {
 
-  std::string delimiter = (mapType == MapType::PARAMETERISED_MAP) ? ";" : ",";
+  folly::StringPiece delimiter =
+    (mapType == MapType::PARAMETERISED_MAP) ? ";" : ",";
 
   buf_.removeOptionalWhitespace();
 
@@ -118,14 +189,18 @@ DecodeError StructuredHeadersDecoder::decodeMap(
 
     buf_.removeOptionalWhitespace();
 
-    std::string thisKey;
+    folly::StringPiece thisKey;
     auto err = buf_.parseIdentifier(thisKey);
     if (err != DecodeError::OK) {
       return err;
     }
 
-    if (result.find(thisKey) != result.end()) {
-      return buf_.handleDecodeError(DecodeError::DUPLICATE_KEY);
+    // Headers carry a handful of members, fewer than it takes hashing to
+    // beat comparing them all
+    for (auto i = firstMember; i < result.size(); i++) {
+      if (result[i].first == thisKey) {
+        return buf_.handleDecodeError(DecodeError::DUPLICATE_KEY);
+      }
     }
 
     err = buf_.removeSymbol("=", mapType == MapType::DICTIONARY);
@@ -133,18 +208,16 @@ DecodeError StructuredHeadersDecoder::decodeMap(
       if (mapType == MapType::DICTIONARY) {
         return err;
       } else {
-        StructuredHeaderItem value;
-        value.tag = StructuredHeaderItem::Type::NONE;
-        result[thisKey] = value;
+        result.emplace_back(thisKey, StructuredHeaderItemView());
       }
     } else {
-      StructuredHeaderItem value;
-      err = buf_.parseItem(value);
+      StructuredHeaderItemView value;
+      err = buf_.parseItem(value, arena);
       if (err != DecodeError::OK) {
         return err;
       }
 
-      result[thisKey] = value;
+      result.emplace_back(thisKey, value);
     }
 
     buf_.removeOptionalWhitespace();
@@ -167,4 +240,11 @@ DecodeError StructuredHeadersDecoder::decodeMap(
 
 }
 
+void StructuredHeadersDecoder::prepareArena(std::string& arena) {
+  // What parsing adds is never longer than the text it came from, so views
+  // into arena are not moved by a reallocation part way through
+  arena.clear();
+  arena.reserve(buf_.remaining());
+}
+
 }
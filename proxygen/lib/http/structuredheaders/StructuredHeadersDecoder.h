@@ -18,7 +18,7 @@ namespace proxygen {
 class StructuredHeadersDecoder {
 public:
 
-  explicit StructuredHeadersDecoder(const std::string& s): buf_(s) {}
+  explicit StructuredHeadersDecoder(folly::StringPiece s): buf_(s) {}
 
   StructuredHeaders::DecodeError decodeItem(StructuredHeaderItem& result);
 
@@ -30,15 +30,34 @@ public:
   StructuredHeaders::DecodeError
     decodeParameterisedList(ParameterisedList& result);
 
+  /*
+   * The same, decoding into views of the header that stay valid while it
+   * and arena do. result and arena are overwritten; reusing them across
+   * headers makes decoding allocation free once they have grown to fit.
+   */
+  StructuredHeaders::DecodeError decodeItem(StructuredHeaderItemView& result,
+    std::string& arena);
+
+  StructuredHeaders::DecodeError
+    decodeList(StructuredHeaderItemListView& result, std::string& arena);
+
+  StructuredHeaders::DecodeError
+    decodeDictionary(DictionaryView& result, std::string& arena);
+
+  StructuredHeaders::DecodeError
+    decodeParameterisedList(ParameterisedListView& result, std::string& arena);
+
 private:
   enum class MapType {
     DICTIONARY = 0,
     PARAMETERISED_MAP = 1
   };
 
-  StructuredHeaders::DecodeError decodeMap(
-    std::unordered_map<std::string, StructuredHeaderItem>& result,
-    MapType mapType);
+  // Appends to result, whose members from firstMember on are this map's
+  StructuredHeaders::DecodeError decodeMap(DictionaryView& result,
+    size_t firstMember, MapType mapType, std::string& arena);
+
+  void prepareArena(std::string& arena);
 
   StructuredHeadersBuffer buf_;
 };
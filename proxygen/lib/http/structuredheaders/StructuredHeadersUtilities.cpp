@@ -13,6 +13,9 @@
 
 #include "proxygen/lib/utils/Base64.h"
 
+#include <algorithm>
+#include <iterator>
+
 namespace proxygen {
 namespace StructuredHeaders {
 
@@ -119,6 +122,59 @@ std::string decodeBase64(
   return Base64::decode(encoded, padding);
 }
 
+namespace {
+
+// 0-63 for the characters of the base64 alphabet, 64 for any other
+struct Base64DecodeTable {
+  Base64DecodeTable() {
+    static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::fill(std::begin(values), std::end(values), 64);
+    for (uint8_t i = 0; i < 64; i++) {
+      values[uint8_t(kAlphabet[i])] = i;
+    }
+  }
+
+  uint8_t values[256];
+};
+
+}
+
+bool appendDecodedBase64(folly::StringPiece encoded, std::string& output) {
+  static const Base64DecodeTable table;
+
+  if (encoded.size() % 4 != 0) {
+    return false;
+  }
+  size_t padding = 0;
+  while (padding < encoded.size() && padding < 3 &&
+         encoded[encoded.size() - 1 - padding] == '=') {
+    ++padding;
+  }
+  if (padding > 2) {
+    return false;
+  }
+
+  size_t end = encoded.size() - padding;
+  uint32_t bits = 0;
+  uint8_t numBits = 0;
+  for (size_t i = 0; i < end; i++) {
+    uint8_t value = table.values[uint8_t(encoded[i])];
+    if (value == 64) {
+      return false;
+    }
+    bits = (bits << 6) | value;
+    numBits += 6;
+    if (numBits >= 8) {
+      numBits -= 8;
+      output.push_back(char((bits >> numBits) & 0xFF));
+    }
+  }
+  // Anything left over is what a padded final group does not carry, and
+  // encodes to zero
+  return (bits & ((1u << numBits) - 1)) == 0;
+}
+
 std::string encodeBase64(const std::string& input) {
   return Base64::encode(folly::ByteRange(
                             reinterpret_cast<const uint8_t*>(input.c_str()),
@@ -8,6 +8,7 @@
  *
  */
 #include <string>
+#include <folly/Range.h>
 #include "StructuredHeadersConstants.h"
 
 #pragma once
@@ -33,6 +34,13 @@ bool itemTypeMatchesContent(const StructuredHeaderItem& input);
 
 std::string decodeBase64(const std::string& encoded);
 
+/*
+ * Appends the bytes encoded to output, returning false (with output in an
+ * unspecified state past its original size) unless encoded is base64 in the
+ * form encodeBase64() produces: padded, with the unused bits zero.
+ */
+bool appendDecodedBase64(folly::StringPiece encoded, std::string& output);
+
 std::string encodeBase64(const std::string& input);
 
 }
@@ -0,0 +1,100 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/http/structuredheaders/StructuredHeadersDecoder.h>
+
+using namespace folly;
+using namespace proxygen;
+
+// Compares decoding into the owning containers with decoding into views,
+// where the arena and result are reused across headers as a codec would.
+
+namespace {
+
+const std::string kDictionary =
+  "en=\"Applepie\", da=*w4ZibGV0w6ZydGU=*, priority=3, weight=0.25, "
+  "origin=\"https://www.example.com\", note=\"a \\\"quoted\\\" word\"";
+
+const std::string kList =
+  "\"gzip\", \"br\", 1, 2, 3.5, *ZnJ1aXQ=*, \"deflate\", 42";
+
+const std::string kParameterisedList =
+  "abc_123;a=1;b=2;cdef_456, ghi;q=\"9\";r=*bWF4IGlzIGF3ZXNvbWU=*, "
+  "jkl;w=0.5;x, mno";
+
+}
+
+BENCHMARK(DictionaryOwning, iters) {
+  for (size_t i = 0; i < iters; i++) {
+    Dictionary result;
+    StructuredHeadersDecoder decoder(kDictionary);
+    decoder.decodeDictionary(result);
+    doNotOptimizeAway(result);
+  }
+}
+
+BENCHMARK_RELATIVE(DictionaryView, iters) {
+  std::string arena;
+  DictionaryView result;
+  for (size_t i = 0; i < iters; i++) {
+    StructuredHeadersDecoder decoder(kDictionary);
+    decoder.decodeDictionary(result, arena);
+    doNotOptimizeAway(result);
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(ListOwning, iters) {
+  for (size_t i = 0; i < iters; i++) {
+    std::vector<StructuredHeaderItem> result;
+    StructuredHeadersDecoder decoder(kList);
+    decoder.decodeList(result);
+    doNotOptimizeAway(result);
+  }
+}
+
+BENCHMARK_RELATIVE(ListView, iters) {
+  std::string arena;
+  StructuredHeaderItemListView result;
+  for (size_t i = 0; i < iters; i++) {
+    StructuredHeadersDecoder decoder(kList);
+    decoder.decodeList(result, arena);
+    doNotOptimizeAway(result);
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(ParameterisedListOwning, iters) {
+  for (size_t i = 0; i < iters; i++) {
+    ParameterisedList result;
+    StructuredHeadersDecoder decoder(kParameterisedList);
+    decoder.decodeParameterisedList(result);
+    doNotOptimizeAway(result);
+  }
+}
+
+BENCHMARK_RELATIVE(ParameterisedListView, iters) {
+  std::string arena;
+  ParameterisedListView result;
+  for (size_t i = 0; i < iters; i++) {
+    StructuredHeadersDecoder decoder(kParameterisedList);
+    decoder.decodeParameterisedList(result, arena);
+    doNotOptimizeAway(result);
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -222,4 +222,117 @@ TEST_F(StructuredHeadersDecoderTest, TestParamListNullValues) {
   EXPECT_EQ(pl[1].parameterMap["burger"].tag, StructuredHeaderItem::Type::NONE);
 }
 
+TEST_F(StructuredHeadersDecoderTest, TestItemView) {
+  std::string input = "\"say \\\"hi\\\"\"";
+  StructuredHeadersDecoder shd(input);
+
+  std::string arena;
+  StructuredHeaderItemView item;
+  EXPECT_EQ(shd.decodeItem(item, arena), DecodeError::OK);
+  EXPECT_EQ(item.tag, StructuredHeaderItem::Type::STRING);
+  EXPECT_EQ(item.string, "say \"hi\"");
+}
+
+TEST_F(StructuredHeadersDecoderTest, TestListView) {
+  std::string input = "\"cookies\", 3.1415, -74657, *ZWdncw==*, \"a\\\\b\"";
+  StructuredHeadersDecoder shd(input);
+
+  std::string arena;
+  StructuredHeaderItemListView v;
+  EXPECT_EQ(shd.decodeList(v, arena), DecodeError::OK);
+  EXPECT_EQ(v.size(), 5);
+
+  EXPECT_EQ(v[0].tag, StructuredHeaderItem::Type::STRING);
+  EXPECT_EQ(v[1].tag, StructuredHeaderItem::Type::DOUBLE);
+  EXPECT_EQ(v[2].tag, StructuredHeaderItem::Type::INT64);
+  EXPECT_EQ(v[3].tag, StructuredHeaderItem::Type::BINARYCONTENT);
+  EXPECT_EQ(v[4].tag, StructuredHeaderItem::Type::STRING);
+
+  // Without escapes, strings are not copied
+  EXPECT_EQ(v[0].string, "cookies");
+  EXPECT_EQ(v[0].string.begin(), input.data() + 1);
+  EXPECT_EQ(v[1].number, 3.1415);
+  EXPECT_EQ(v[2].integer, -74657);
+  EXPECT_EQ(v[3].string, "eggs");
+  EXPECT_EQ(v[4].string, "a\\b");
+  EXPECT_EQ(arena, "eggsa\\b");
+}
+
+TEST_F(StructuredHeadersDecoderTest, TestDictionaryView) {
+  std::string input = "en=\"Applepie\", da=*w4ZibGV0w6ZydGU=*, n=-0.5";
+  StructuredHeadersDecoder shd(input);
+
+  std::string arena;
+  DictionaryView d;
+  EXPECT_EQ(shd.decodeDictionary(d, arena), DecodeError::OK);
+  EXPECT_EQ(d.size(), 3);
+
+  EXPECT_EQ(d[0].first, "en");
+  EXPECT_EQ(d[0].second.tag, StructuredHeaderItem::Type::STRING);
+  EXPECT_EQ(d[0].second.string, "Applepie");
+  EXPECT_EQ(d[1].first, "da");
+  EXPECT_EQ(d[1].second.tag, StructuredHeaderItem::Type::BINARYCONTENT);
+  EXPECT_EQ(d[1].second.string, "\xc3\x86" "blet\xc3\xa6rte");
+  EXPECT_EQ(d[2].first, "n");
+  EXPECT_EQ(d[2].second.tag, StructuredHeaderItem::Type::DOUBLE);
+  EXPECT_EQ(d[2].second.number, -0.5);
+}
+
+TEST_F(StructuredHeadersDecoderTest, TestDictionaryViewDuplicateKey) {
+  std::string input = "a=1, b=2, a=3";
+  StructuredHeadersDecoder shd(input);
+
+  std::string arena;
+  DictionaryView d;
+  EXPECT_EQ(shd.decodeDictionary(d, arena), DecodeError::DUPLICATE_KEY);
+}
+
+TEST_F(StructuredHeadersDecoderTest, TestParamListView) {
+  std::string input = "abc;a=1;b=*bWF4*, def, ghi;a;q=\"9\"";
+  StructuredHeadersDecoder shd(input);
+
+  std::string arena;
+  ParameterisedListView pl;
+  EXPECT_EQ(shd.decodeParameterisedList(pl, arena), DecodeError::OK);
+  EXPECT_EQ(pl.identifiers.size(), 3);
+  EXPECT_EQ(pl.parameters.size(), 4);
+
+  EXPECT_EQ(pl.identifiers[0].identifier, "abc");
+  EXPECT_EQ(pl.identifiers[0].parametersBegin, 0);
+  EXPECT_EQ(pl.identifiers[0].parametersEnd, 2);
+  EXPECT_EQ(pl.parameters[0].first, "a");
+  EXPECT_EQ(pl.parameters[0].second.integer, 1);
+  EXPECT_EQ(pl.parameters[1].first, "b");
+  EXPECT_EQ(pl.parameters[1].second.string, "max");
+
+  EXPECT_EQ(pl.identifiers[1].identifier, "def");
+  EXPECT_EQ(pl.identifiers[1].parametersBegin, 2);
+  EXPECT_EQ(pl.identifiers[1].parametersEnd, 2);
+
+  // Keys only need to be unique within an identifier's parameters
+  EXPECT_EQ(pl.identifiers[2].identifier, "ghi");
+  EXPECT_EQ(pl.identifiers[2].parametersBegin, 2);
+  EXPECT_EQ(pl.identifiers[2].parametersEnd, 4);
+  EXPECT_EQ(pl.parameters[2].first, "a");
+  EXPECT_EQ(pl.parameters[2].second.tag, StructuredHeaderItem::Type::NONE);
+  EXPECT_EQ(pl.parameters[3].first, "q");
+  EXPECT_EQ(pl.parameters[3].second.string, "9");
+}
+
+TEST_F(StructuredHeadersDecoderTest, TestViewReuse) {
+  std::string arena;
+  StructuredHeaderItemListView v;
+
+  std::string input1 = "*ZnJ1aXQ=*, 1, 2";
+  StructuredHeadersDecoder shd1(input1);
+  EXPECT_EQ(shd1.decodeList(v, arena), DecodeError::OK);
+  EXPECT_EQ(v.size(), 3);
+
+  std::string input2 = "*dG9tYXRv*";
+  StructuredHeadersDecoder shd2(input2);
+  EXPECT_EQ(shd2.decodeList(v, arena), DecodeError::OK);
+  EXPECT_EQ(v.size(), 1);
+  EXPECT_EQ(v[0].string, "tomato");
+}
+
 }
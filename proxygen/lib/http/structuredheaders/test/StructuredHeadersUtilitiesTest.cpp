@@ -130,6 +130,27 @@ TEST_F(StructuredHeadersUtilitiesTest, Test_DecodeBinaryContent) {
   EXPECT_EQ(decodeBase64(input3), "eggs");
 }
 
+TEST_F(StructuredHeadersUtilitiesTest, Test_AppendDecodedBinaryContent) {
+  std::string output = "x";
+  EXPECT_TRUE(appendDecodedBase64("ZnJ1aXQ=", output));
+  EXPECT_TRUE(appendDecodedBase64("dG9tYXRv", output));
+  EXPECT_TRUE(appendDecodedBase64("ZWdncw==", output));
+  EXPECT_TRUE(appendDecodedBase64("", output));
+  EXPECT_EQ(output, "xfruittomatoeggs");
+}
+
+TEST_F(StructuredHeadersUtilitiesTest, Test_AppendDecodedBinaryContentBad) {
+  std::string output;
+  EXPECT_FALSE(appendDecodedBase64("ZnJ1aXQ", output));
+  EXPECT_FALSE(appendDecodedBase64("ZnJ1aX==", output));
+  EXPECT_FALSE(appendDecodedBase64("Zn=1aXQ=", output));
+  EXPECT_FALSE(appendDecodedBase64("ZnJ1a!Q=", output));
+  EXPECT_FALSE(appendDecodedBase64("Z===", output));
+  // Nonzero bits past the end of the data
+  EXPECT_FALSE(appendDecodedBase64("ZnJ1aXR=", output));
+  EXPECT_FALSE(appendDecodedBase64("ZWdncx==", output));
+}
+
 TEST_F(StructuredHeadersUtilitiesTest, Test_EncodeBinaryContent) {
   std::string input1 = "fruit";
   std::string input2 = "tomato";
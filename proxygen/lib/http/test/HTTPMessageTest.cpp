@@ -403,6 +403,25 @@ TEST(HTTPHeaders, AddStringPiece) {
   EXPECT_EQ("value", headers.getSingleOrEmpty("name"));
 }
 
+TEST(HTTPHeaders, AddFromCodecWithCode) {
+  HTTPHeaders headers;
+  headers.addFromCodec(HTTP_HEADER_CONTENT_TYPE, "content-type", "text/html");
+  headers.addFromCodec(HTTP_HEADER_OTHER, "x-custom", "value ");
+  EXPECT_EQ("text/html", headers.getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE));
+  // Values are stored as decoded
+  EXPECT_EQ("value ", headers.getSingleOrEmpty("x-custom"));
+  headers.forEachWithCode([](HTTPHeaderCode code,
+                             const std::string& name,
+                             const std::string& /*value*/) {
+    if (code == HTTP_HEADER_CONTENT_TYPE) {
+      EXPECT_EQ("Content-Type", name);
+    } else {
+      EXPECT_EQ(HTTP_HEADER_OTHER, code);
+      EXPECT_EQ("x-custom", name);
+    }
+  });
+}
+
 TEST(HTTPHeaders, InitializerList) {
   HTTPHeaders hdrs;
 
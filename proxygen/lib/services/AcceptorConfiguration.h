@@ -75,6 +75,12 @@ struct AcceptorConfiguration : public wangle::ServerSocketConfig {
    */
   uint32_t maxConcurrentIncomingStreams{0};
 
+  /**
+   * The number of pipelined HTTP/1.x requests to parse ahead of the one
+   * being responded to.  0 means use the HTTPSession default.
+   */
+  uint32_t maxPipelinedRequests{0};
+
   /**
    * Flow control parameters.
    *
@@ -90,12 +96,34 @@ struct AcceptorConfiguration : public wangle::ServerSocketConfig {
   size_t receiveStreamWindowSize{65536};
   size_t receiveSessionWindowSize{65536};
 
+  /**
+   * Receive window autotuning.  When non-zero, sessions with connection level
+   * flow control grow their windows from the sizes above towards the
+   * connection's bandwidth-delay product, up to these sizes.  See
+   * ReceiveWindowAutotuner.
+   */
+  uint32_t maxReceiveSessionWindowSize{0};
+  uint32_t maxReceiveStreamWindowSize{0};
+
   /**
    * These parameters control how many bytes HTTPSession's will buffer in user
    * space before applying backpressure to handlers.  -1 means use the
    * built-in HTTPSession default (64kb)
    */
   int64_t writeBufferLimit{-1};
+
+  /**
+   * Move plaintext connections' reads and writes to an io_uring per worker
+   * thread when the kernel supports it.  See IoUringSocket.
+   */
+  bool useIoUring{false};
+
+  /**
+   * Hand TLS connections' record encryption to the kernel after the
+   * handshake, continuing on a plain socket when it can take both
+   * directions.  See KernelTLSSocket.
+   */
+  bool useKernelTLS{false};
 };
 
 } // proxygen
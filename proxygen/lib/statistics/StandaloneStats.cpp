@@ -0,0 +1,112 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/statistics/StandaloneStats.h>
+
+namespace proxygen {
+
+namespace {
+
+// Idle times up to 5 minutes, in seconds
+const int64_t kIdleTimeBucketWidth = 1;
+const int64_t kIdleTimeMax = 300;
+
+}
+
+StandaloneHTTPSessionStats::StandaloneHTTPSessionStats(
+    const std::string& prefix, StatsRegistry& registry)
+    : transactionOpened_(
+          registry.getTimeseries(prefix + ".transaction_opened")),
+      transactionClosed_(
+          registry.getTimeseries(prefix + ".transaction_closed")),
+      transactionsServed_(
+          registry.getTimeseries(prefix + ".transactions_served")),
+      sessionReused_(registry.getTimeseries(prefix + ".session_reused")),
+      sessionIdleTime_(registry.getHistogram(prefix + ".session_idle_time",
+                                             kIdleTimeBucketWidth,
+                                             0,
+                                             kIdleTimeMax)),
+      transactionStalled_(
+          registry.getTimeseries(prefix + ".transaction_stalled")),
+      sessionStalled_(registry.getTimeseries(prefix + ".session_stalled")),
+      egressBodyBytesSkipped_(
+          registry.getTimeseries(prefix + ".egress_body_bytes_skipped")),
+      presendIOSplit_(registry.getTimeseries(prefix + ".presend_io_split")),
+      presendExceedLimit_(
+          registry.getTimeseries(prefix + ".presend_exceed_limit")),
+      ttlbaExceedLimit_(
+          registry.getTimeseries(prefix + ".ttlba_exceed_limit")),
+      ttlbaNotFound_(registry.getTimeseries(prefix + ".ttlba_not_found")),
+      ttlbaReceived_(registry.getTimeseries(prefix + ".ttlba_received")),
+      ttlbaTimeout_(registry.getTimeseries(prefix + ".ttlba_timeout")),
+      ttlbaTracked_(registry.getTimeseries(prefix + ".ttlba_tracked")),
+      ttbtxExceedLimit_(
+          registry.getTimeseries(prefix + ".ttbtx_exceed_limit")),
+      ttbtxReceived_(registry.getTimeseries(prefix + ".ttbtx_received")),
+      ttbtxTimeout_(registry.getTimeseries(prefix + ".ttbtx_timeout")),
+      ttbtxNotFound_(registry.getTimeseries(prefix + ".ttbtx_not_found")),
+      ttbtxTracked_(registry.getTimeseries(prefix + ".ttbtx_tracked")) {
+}
+
+StandaloneHeaderCodecStats::TypeStats::TypeStats(StatsRegistry& registry,
+                                                 const std::string& prefix)
+    : encodes(registry.getTimeseries(prefix + ".encodes")),
+      encodedCompressed(
+          registry.getTimeseries(prefix + ".encoded_bytes_compressed")),
+      encodedUncompressed(
+          registry.getTimeseries(prefix + ".encoded_bytes_uncompressed")),
+      decodes(registry.getTimeseries(prefix + ".decodes")),
+      decodedCompressed(
+          registry.getTimeseries(prefix + ".decoded_bytes_compressed")),
+      decodedUncompressed(
+          registry.getTimeseries(prefix + ".decoded_bytes_uncompressed")),
+      decodeErrors(registry.getTimeseries(prefix + ".decode_errors")),
+      decodeTooLarge(registry.getTimeseries(prefix + ".decode_too_large")) {
+}
+
+StandaloneHeaderCodecStats::StandaloneHeaderCodecStats(
+    const std::string& prefix, StatsRegistry& registry) {
+  types_.reserve(3);
+  types_.emplace_back(registry, prefix + ".gzip");
+  types_.emplace_back(registry, prefix + ".hpack");
+  types_.emplace_back(registry, prefix + ".qpack");
+}
+
+StandaloneHeaderCodecStats::TypeStats&
+StandaloneHeaderCodecStats::getTypeStats(HeaderCodec::Type type) {
+  auto index = static_cast<size_t>(type);
+  CHECK_LT(index, types_.size());
+  return types_[index];
+}
+
+void StandaloneHeaderCodecStats::recordEncode(HeaderCodec::Type type,
+                                              HTTPHeaderSize& size) {
+  auto& stats = getTypeStats(type);
+  stats.encodes.add();
+  stats.encodedCompressed.add(size.compressed);
+  stats.encodedUncompressed.add(size.uncompressed);
+}
+
+void StandaloneHeaderCodecStats::recordDecode(HeaderCodec::Type type,
+                                              HTTPHeaderSize& size) {
+  auto& stats = getTypeStats(type);
+  stats.decodes.add();
+  stats.decodedCompressed.add(size.compressed);
+  stats.decodedUncompressed.add(size.uncompressed);
+}
+
+void StandaloneHeaderCodecStats::recordDecodeError(HeaderCodec::Type type) {
+  getTypeStats(type).decodeErrors.add();
+}
+
+void StandaloneHeaderCodecStats::recordDecodeTooLarge(HeaderCodec::Type type) {
+  getTypeStats(type).decodeTooLarge.add();
+}
+
+}
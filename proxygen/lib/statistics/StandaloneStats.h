@@ -0,0 +1,150 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/http/codec/compress/HeaderCodec.h>
+#include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/statistics/StatsRegistry.h>
+
+namespace proxygen {
+
+/**
+ * HTTPSessionStats (and TTLBAStats) backed by a StatsRegistry.  Every event
+ * is a timeseries named "<prefix>.<event>".  One instance can be shared by
+ * all the sessions of all threads.
+ */
+class StandaloneHTTPSessionStats : public HTTPSessionStats {
+ public:
+  explicit StandaloneHTTPSessionStats(
+      const std::string& prefix,
+      StatsRegistry& registry = StatsRegistry::getDefault());
+
+  void recordTransactionOpened() noexcept override {
+    transactionOpened_.add();
+  }
+  void recordTransactionClosed() noexcept override {
+    transactionClosed_.add();
+  }
+  void recordTransactionsServed(uint64_t num) noexcept override {
+    transactionsServed_.add(num);
+  }
+  void recordSessionReused() noexcept override {
+    sessionReused_.add();
+  }
+  void recordSessionIdleTime(std::chrono::seconds idle) noexcept override {
+    sessionIdleTime_.add(idle.count());
+  }
+  void recordTransactionStalled() noexcept override {
+    transactionStalled_.add();
+  }
+  void recordSessionStalled() noexcept override {
+    sessionStalled_.add();
+  }
+  void recordEgressBodyBytesSkipped(uint64_t bytes) noexcept override {
+    egressBodyBytesSkipped_.add(bytes);
+  }
+
+  void recordPresendIOSplit() noexcept override {
+    presendIOSplit_.add();
+  }
+  void recordPresendExceedLimit() noexcept override {
+    presendExceedLimit_.add();
+  }
+  void recordTTLBAExceedLimit() noexcept override {
+    ttlbaExceedLimit_.add();
+  }
+  void recordTTLBANotFound() noexcept override {
+    ttlbaNotFound_.add();
+  }
+  void recordTTLBAReceived() noexcept override {
+    ttlbaReceived_.add();
+  }
+  void recordTTLBATimeout() noexcept override {
+    ttlbaTimeout_.add();
+  }
+  void recordTTLBATracked() noexcept override {
+    ttlbaTracked_.add();
+  }
+  void recordTTBTXExceedLimit() noexcept override {
+    ttbtxExceedLimit_.add();
+  }
+  void recordTTBTXReceived() noexcept override {
+    ttbtxReceived_.add();
+  }
+  void recordTTBTXTimeout() noexcept override {
+    ttbtxTimeout_.add();
+  }
+  void recordTTBTXNotFound() noexcept override {
+    ttbtxNotFound_.add();
+  }
+  void recordTTBTXTracked() noexcept override {
+    ttbtxTracked_.add();
+  }
+
+ private:
+  StatTimeseries& transactionOpened_;
+  StatTimeseries& transactionClosed_;
+  StatTimeseries& transactionsServed_;
+  StatTimeseries& sessionReused_;
+  StatHistogram& sessionIdleTime_;
+  StatTimeseries& transactionStalled_;
+  StatTimeseries& sessionStalled_;
+  StatTimeseries& egressBodyBytesSkipped_;
+  StatTimeseries& presendIOSplit_;
+  StatTimeseries& presendExceedLimit_;
+  StatTimeseries& ttlbaExceedLimit_;
+  StatTimeseries& ttlbaNotFound_;
+  StatTimeseries& ttlbaReceived_;
+  StatTimeseries& ttlbaTimeout_;
+  StatTimeseries& ttlbaTracked_;
+  StatTimeseries& ttbtxExceedLimit_;
+  StatTimeseries& ttbtxReceived_;
+  StatTimeseries& ttbtxTimeout_;
+  StatTimeseries& ttbtxNotFound_;
+  StatTimeseries& ttbtxTracked_;
+};
+
+/**
+ * HeaderCodec::Stats backed by a StatsRegistry, with stats named
+ * "<prefix>.<gzip|hpack|qpack>.<event>".  Encoded and decoded sizes are
+ * timeseries of bytes.
+ */
+class StandaloneHeaderCodecStats : public HeaderCodec::Stats {
+ public:
+  explicit StandaloneHeaderCodecStats(
+      const std::string& prefix,
+      StatsRegistry& registry = StatsRegistry::getDefault());
+
+  void recordEncode(HeaderCodec::Type type, HTTPHeaderSize& size) override;
+  void recordDecode(HeaderCodec::Type type, HTTPHeaderSize& size) override;
+  void recordDecodeError(HeaderCodec::Type type) override;
+  void recordDecodeTooLarge(HeaderCodec::Type type) override;
+
+ private:
+  struct TypeStats {
+    TypeStats(StatsRegistry& registry, const std::string& prefix);
+
+    StatTimeseries& encodes;
+    StatTimeseries& encodedCompressed;
+    StatTimeseries& encodedUncompressed;
+    StatTimeseries& decodes;
+    StatTimeseries& decodedCompressed;
+    StatTimeseries& decodedUncompressed;
+    StatTimeseries& decodeErrors;
+    StatTimeseries& decodeTooLarge;
+  };
+
+  TypeStats& getTypeStats(HeaderCodec::Type type);
+
+  // Indexed by HeaderCodec::Type
+  std::vector<TypeStats> types_;
+};
+
+}
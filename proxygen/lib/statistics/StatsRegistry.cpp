@@ -0,0 +1,303 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/statistics/StatsRegistry.h>
+
+#include <folly/Conv.h>
+#include <folly/Indestructible.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+
+namespace proxygen {
+
+namespace {
+
+const auto kRelaxed = std::memory_order_relaxed;
+
+// Single writer increment, see StatCounter::Shard::add
+inline void localAdd(std::atomic<int64_t>& value, int64_t delta) {
+  value.store(value.load(kRelaxed) + delta, kRelaxed);
+}
+
+size_t getNumBuckets(int64_t bucketWidth, int64_t min, int64_t max) {
+  CHECK_GT(bucketWidth, 0);
+  CHECK_LT(min, max);
+  // Plus the underflow and overflow buckets
+  return (max - min + bucketWidth - 1) / bucketWidth + 2;
+}
+
+}
+
+StatCounter::StatCounter(std::string name)
+    : name_(std::move(name)),
+      shards_([this] { return new Shard(*this); }) {
+}
+
+StatCounter::Shard::~Shard() {
+  parent_.retired_.fetch_add(value.load(kRelaxed), kRelaxed);
+}
+
+int64_t StatCounter::get() const {
+  int64_t total = retired_.load(kRelaxed);
+  for (const auto& shard : shards_.accessAllThreads()) {
+    total += shard.value.load(kRelaxed);
+  }
+  return total;
+}
+
+StatTimeseries::StatTimeseries(std::string name)
+    : name_(std::move(name)),
+      shards_([this] { return new Shard(*this); }) {
+}
+
+StatTimeseries::Shard::~Shard() {
+  // Only the all-time totals outlive the thread
+  parent_.retiredSum_.fetch_add(sum.load(kRelaxed), kRelaxed);
+  parent_.retiredCount_.fetch_add(count.load(kRelaxed), kRelaxed);
+}
+
+int64_t StatTimeseries::nowSeconds() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void StatTimeseries::add(int64_t value) {
+  auto& shard = *shards_;
+  auto now = nowSeconds();
+  auto& bucket = shard.buckets[now % kNumBuckets];
+  if (bucket.second.load(kRelaxed) != now) {
+    bucket.sum.store(0, kRelaxed);
+    bucket.count.store(0, kRelaxed);
+    bucket.second.store(now, kRelaxed);
+  }
+  localAdd(bucket.sum, value);
+  localAdd(bucket.count, 1);
+  localAdd(shard.sum, value);
+  localAdd(shard.count, 1);
+}
+
+void StatTimeseries::getWindow(uint32_t seconds,
+                               int64_t* sum,
+                               int64_t* count) const {
+  seconds = std::min<uint32_t>(std::max<uint32_t>(seconds, 1), kNumBuckets);
+  auto oldest = nowSeconds() - seconds;
+  *sum = 0;
+  *count = 0;
+  for (const auto& shard : shards_.accessAllThreads()) {
+    for (const auto& bucket : shard.buckets) {
+      if (bucket.second.load(kRelaxed) > oldest) {
+        *sum += bucket.sum.load(kRelaxed);
+        *count += bucket.count.load(kRelaxed);
+      }
+    }
+  }
+}
+
+int64_t StatTimeseries::getSum(uint32_t seconds) const {
+  int64_t sum;
+  int64_t count;
+  getWindow(seconds, &sum, &count);
+  return sum;
+}
+
+int64_t StatTimeseries::getCount(uint32_t seconds) const {
+  int64_t sum;
+  int64_t count;
+  getWindow(seconds, &sum, &count);
+  return count;
+}
+
+double StatTimeseries::getRate(uint32_t seconds) const {
+  seconds = std::min<uint32_t>(std::max<uint32_t>(seconds, 1), kNumBuckets);
+  return double(getSum(seconds)) / seconds;
+}
+
+int64_t StatTimeseries::getAllTimeSum() const {
+  int64_t total = retiredSum_.load(kRelaxed);
+  for (const auto& shard : shards_.accessAllThreads()) {
+    total += shard.sum.load(kRelaxed);
+  }
+  return total;
+}
+
+int64_t StatTimeseries::getAllTimeCount() const {
+  int64_t total = retiredCount_.load(kRelaxed);
+  for (const auto& shard : shards_.accessAllThreads()) {
+    total += shard.count.load(kRelaxed);
+  }
+  return total;
+}
+
+StatHistogram::StatHistogram(std::string name,
+                             int64_t bucketWidth,
+                             int64_t min,
+                             int64_t max)
+    : name_(std::move(name)),
+      bucketWidth_(bucketWidth),
+      min_(min),
+      max_(max),
+      numBuckets_(getNumBuckets(bucketWidth, min, max)),
+      shards_([this] { return new Shard(*this, numBuckets_); }) {
+  retired_.buckets.resize(numBuckets_);
+}
+
+StatHistogram::Shard::~Shard() {
+  std::lock_guard<std::mutex> g(parent_.retiredMutex_);
+  auto& retired = parent_.retired_;
+  retired.sum += sum.load(kRelaxed);
+  retired.count += count.load(kRelaxed);
+  for (size_t i = 0; i < buckets.size(); i++) {
+    retired.buckets[i] += buckets[i].load(kRelaxed);
+  }
+}
+
+size_t StatHistogram::getBucket(int64_t value) const {
+  if (value < min_) {
+    return 0;
+  }
+  if (value >= max_) {
+    return numBuckets_ - 1;
+  }
+  return (value - min_) / bucketWidth_ + 1;
+}
+
+void StatHistogram::add(int64_t value) {
+  auto& shard = *shards_;
+  localAdd(shard.buckets[getBucket(value)], 1);
+  localAdd(shard.sum, value);
+  localAdd(shard.count, 1);
+}
+
+StatHistogram::Snapshot StatHistogram::getSnapshot() const {
+  Snapshot snapshot;
+  {
+    std::lock_guard<std::mutex> g(retiredMutex_);
+    snapshot = retired_;
+  }
+  for (const auto& shard : shards_.accessAllThreads()) {
+    snapshot.sum += shard.sum.load(kRelaxed);
+    snapshot.count += shard.count.load(kRelaxed);
+    for (size_t i = 0; i < numBuckets_; i++) {
+      snapshot.buckets[i] += shard.buckets[i].load(kRelaxed);
+    }
+  }
+  return snapshot;
+}
+
+int64_t StatHistogram::Snapshot::getPercentile(double pct,
+                                               int64_t bucketWidth,
+                                               int64_t min) const {
+  int64_t total = 0;
+  for (auto count : buckets) {
+    total += count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  double target = total * std::min(std::max(pct, 0.0), 100.0) / 100.0;
+  int64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    if (buckets[i] == 0 || seen + buckets[i] < target) {
+      seen += buckets[i];
+      continue;
+    }
+    if (i == 0) {
+      return min;
+    }
+    if (i == buckets.size() - 1) {
+      return min + int64_t(buckets.size() - 2) * bucketWidth;
+    }
+    // Interpolate within the bucket
+    auto lo = min + int64_t(i - 1) * bucketWidth;
+    return lo + int64_t((target - seen) / buckets[i] * bucketWidth);
+  }
+  return min + int64_t(buckets.size() - 2) * bucketWidth;
+}
+
+StatsRegistry& StatsRegistry::getDefault() {
+  static folly::Indestructible<StatsRegistry> registry;
+  return *registry;
+}
+
+StatCounter& StatsRegistry::getCounter(const std::string& name) {
+  std::lock_guard<std::mutex> g(mutex_);
+  auto& stat = counters_[name];
+  if (!stat) {
+    stat = std::make_unique<StatCounter>(name);
+  }
+  return *stat;
+}
+
+StatTimeseries& StatsRegistry::getTimeseries(const std::string& name) {
+  std::lock_guard<std::mutex> g(mutex_);
+  auto& stat = timeseries_[name];
+  if (!stat) {
+    stat = std::make_unique<StatTimeseries>(name);
+  }
+  return *stat;
+}
+
+StatHistogram& StatsRegistry::getHistogram(const std::string& name,
+                                           int64_t bucketWidth,
+                                           int64_t min,
+                                           int64_t max) {
+  std::lock_guard<std::mutex> g(mutex_);
+  auto& stat = histograms_[name];
+  if (!stat) {
+    stat = std::make_unique<StatHistogram>(name, bucketWidth, min, max);
+  }
+  return *stat;
+}
+
+std::map<std::string, double> StatsRegistry::getValues() const {
+  std::map<std::string, double> values;
+  std::lock_guard<std::mutex> g(mutex_);
+  for (const auto& it : counters_) {
+    values[it.first] = it.second->get();
+  }
+  for (const auto& it : timeseries_) {
+    auto& ts = *it.second;
+    values[it.first + ".sum.60"] = ts.getSum();
+    values[it.first + ".count.60"] = ts.getCount();
+    values[it.first + ".rate.60"] = ts.getRate();
+    values[it.first + ".sum"] = ts.getAllTimeSum();
+    values[it.first + ".count"] = ts.getAllTimeCount();
+  }
+  for (const auto& it : histograms_) {
+    auto& hist = *it.second;
+    auto snapshot = hist.getSnapshot();
+    values[it.first + ".count"] = snapshot.count;
+    values[it.first + ".avg"] =
+        snapshot.count ? double(snapshot.sum) / snapshot.count : 0;
+    for (auto pct : {50, 90, 99}) {
+      values[folly::to<std::string>(it.first, ".p", pct)] =
+          snapshot.getPercentile(pct, hist.getBucketWidth(), hist.getMin());
+    }
+  }
+  return values;
+}
+
+std::string StatsRegistry::toText() const {
+  std::string out;
+  for (const auto& it : getValues()) {
+    folly::toAppend(it.first, ' ', it.second, '\n', &out);
+  }
+  return out;
+}
+
+folly::dynamic StatsRegistry::toDynamic() const {
+  folly::dynamic out = folly::dynamic::object;
+  for (const auto& it : getValues()) {
+    out[it.first] = it.second;
+  }
+  return out;
+}
+
+}
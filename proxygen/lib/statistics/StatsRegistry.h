@@ -0,0 +1,228 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/ThreadLocal.h>
+#include <folly/dynamic.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Dependency free stats primitives for use where fb303 (see
+ * lib/stats/BaseStats.h) is not available.
+ *
+ * Every stat keeps one shard per thread which only that thread writes, with
+ * plain relaxed loads and stores, so updates never contend on a cacheline.
+ * Reads walk all the shards and aggregate lazily; they are meant for the
+ * occasional scrape and may miss updates racing with them.  When a thread
+ * exits its shard's all-time totals are folded into the stat.
+ */
+
+struct StatsShardTag {};
+
+/**
+ * Monotonic sum.
+ */
+class StatCounter {
+ public:
+  explicit StatCounter(std::string name);
+
+  void add(int64_t delta = 1) {
+    shards_->add(delta);
+  }
+
+  int64_t get() const;
+
+  const std::string& getName() const {
+    return name_;
+  }
+
+ private:
+  struct Shard {
+    explicit Shard(StatCounter& parent) : parent_(parent) {}
+    ~Shard();
+
+    void add(int64_t delta) {
+      // Only the owning thread writes, no need for a locked add
+      value.store(value.load(std::memory_order_relaxed) + delta,
+                  std::memory_order_relaxed);
+    }
+
+    StatCounter& parent_;
+    std::atomic<int64_t> value{0};
+  };
+
+  std::string name_;
+  std::atomic<int64_t> retired_{0};
+  mutable folly::ThreadLocal<Shard, StatsShardTag> shards_;
+};
+
+/**
+ * Sum and count of values over the last minute, in one second buckets, and
+ * over all time.
+ */
+class StatTimeseries {
+ public:
+  static const size_t kNumBuckets = 60;
+
+  explicit StatTimeseries(std::string name);
+
+  void add(int64_t value = 1);
+
+  // Over the last `seconds` seconds, at most kNumBuckets
+  int64_t getSum(uint32_t seconds = kNumBuckets) const;
+  int64_t getCount(uint32_t seconds = kNumBuckets) const;
+  double getRate(uint32_t seconds = kNumBuckets) const;
+
+  int64_t getAllTimeSum() const;
+  int64_t getAllTimeCount() const;
+
+  const std::string& getName() const {
+    return name_;
+  }
+
+ private:
+  struct Bucket {
+    std::atomic<int64_t> second{-1};
+    std::atomic<int64_t> sum{0};
+    std::atomic<int64_t> count{0};
+  };
+
+  struct Shard {
+    explicit Shard(StatTimeseries& parent) : parent_(parent) {}
+    ~Shard();
+
+    StatTimeseries& parent_;
+    std::array<Bucket, kNumBuckets> buckets;
+    std::atomic<int64_t> sum{0};
+    std::atomic<int64_t> count{0};
+  };
+
+  static int64_t nowSeconds();
+
+  void getWindow(uint32_t seconds, int64_t* sum, int64_t* count) const;
+
+  std::string name_;
+  std::atomic<int64_t> retiredSum_{0};
+  std::atomic<int64_t> retiredCount_{0};
+  mutable folly::ThreadLocal<Shard, StatsShardTag> shards_;
+};
+
+/**
+ * Fixed width bucket histogram over [min, max), with an extra bucket on each
+ * side for values out of range.
+ */
+class StatHistogram {
+ public:
+  StatHistogram(std::string name,
+                int64_t bucketWidth,
+                int64_t min,
+                int64_t max);
+
+  void add(int64_t value);
+
+  struct Snapshot {
+    int64_t count{0};
+    int64_t sum{0};
+    std::vector<int64_t> buckets;
+
+    // Estimated value at percentile pct (0-100)
+    int64_t getPercentile(double pct, int64_t bucketWidth, int64_t min) const;
+  };
+
+  Snapshot getSnapshot() const;
+
+  int64_t getPercentile(double pct) const {
+    return getSnapshot().getPercentile(pct, bucketWidth_, min_);
+  }
+
+  int64_t getBucketWidth() const {
+    return bucketWidth_;
+  }
+
+  int64_t getMin() const {
+    return min_;
+  }
+
+  const std::string& getName() const {
+    return name_;
+  }
+
+ private:
+  struct Shard {
+    Shard(StatHistogram& parent, size_t numBuckets)
+        : parent_(parent), buckets(numBuckets) {}
+    ~Shard();
+
+    StatHistogram& parent_;
+    std::vector<std::atomic<int64_t>> buckets;
+    std::atomic<int64_t> sum{0};
+    std::atomic<int64_t> count{0};
+  };
+
+  size_t getBucket(int64_t value) const;
+
+  std::string name_;
+  const int64_t bucketWidth_;
+  const int64_t min_;
+  const int64_t max_;
+  const size_t numBuckets_;
+  mutable std::mutex retiredMutex_;
+  Snapshot retired_;
+  mutable folly::ThreadLocal<Shard, StatsShardTag> shards_;
+};
+
+/**
+ * Named collection of stats, and their exposition as flat key/value pairs:
+ *
+ *   counter:     <name>
+ *   timeseries:  <name>.sum.60, <name>.count.60, <name>.rate.60,
+ *                <name>.sum, <name>.count
+ *   histogram:   <name>.count, <name>.avg, <name>.p50, <name>.p90,
+ *                <name>.p99
+ *
+ * Registering a name twice returns the existing stat.  Stats live as long as
+ * the registry.
+ */
+class StatsRegistry {
+ public:
+  static StatsRegistry& getDefault();
+
+  StatCounter& getCounter(const std::string& name);
+  StatTimeseries& getTimeseries(const std::string& name);
+  StatHistogram& getHistogram(const std::string& name,
+                              int64_t bucketWidth,
+                              int64_t min,
+                              int64_t max);
+
+  std::map<std::string, double> getValues() const;
+
+  // One "key value" line per value, sorted by key
+  std::string toText() const;
+
+  folly::dynamic toDynamic() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<StatCounter>> counters_;
+  std::map<std::string, std::unique_ptr<StatTimeseries>> timeseries_;
+  std::map<std::string, std::unique_ptr<StatHistogram>> histograms_;
+};
+
+}
@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/statistics/StandaloneStats.h>
+#include <proxygen/lib/statistics/StatsRegistry.h>
+
+#include <folly/portability/GTest.h>
+
+#include <thread>
+
+using namespace proxygen;
+
+TEST(StatsRegistryTest, CounterAcrossThreads) {
+  StatsRegistry registry;
+  auto& counter = registry.getCounter("requests");
+  EXPECT_EQ(&counter, &registry.getCounter("requests"));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&counter] {
+      for (int i = 0; i < 1000; i++) {
+        counter.add();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // The threads have exited, their shards are folded into the counter
+  EXPECT_EQ(4000, counter.get());
+  counter.add(5);
+  EXPECT_EQ(4005, counter.get());
+}
+
+TEST(StatsRegistryTest, Timeseries) {
+  StatsRegistry registry;
+  auto& ts = registry.getTimeseries("bytes");
+  ts.add(100);
+  ts.add(300);
+  EXPECT_EQ(400, ts.getSum());
+  EXPECT_EQ(2, ts.getCount());
+  EXPECT_EQ(400, ts.getAllTimeSum());
+  EXPECT_EQ(2, ts.getAllTimeCount());
+  EXPECT_DOUBLE_EQ(400.0 / 60, ts.getRate());
+
+  std::thread([&ts] { ts.add(50); }).join();
+  EXPECT_EQ(450, ts.getAllTimeSum());
+  EXPECT_EQ(3, ts.getAllTimeCount());
+}
+
+TEST(StatsRegistryTest, Histogram) {
+  StatsRegistry registry;
+  auto& hist = registry.getHistogram("latency", 10, 0, 100);
+  for (int i = 0; i < 100; i++) {
+    hist.add(i);
+  }
+  hist.add(-5);
+  hist.add(1000);
+  auto snapshot = hist.getSnapshot();
+  EXPECT_EQ(102, snapshot.count);
+  EXPECT_EQ(12, snapshot.buckets.size());
+  EXPECT_EQ(1, snapshot.buckets.front());
+  EXPECT_EQ(1, snapshot.buckets.back());
+  EXPECT_NEAR(50, hist.getPercentile(50), 10);
+  EXPECT_EQ(100, hist.getPercentile(100));
+  EXPECT_EQ(0, hist.getPercentile(0));
+}
+
+TEST(StatsRegistryTest, Exposition) {
+  StatsRegistry registry;
+  registry.getCounter("a").add(3);
+  registry.getTimeseries("b").add(7);
+
+  auto values = registry.getValues();
+  EXPECT_EQ(3, values["a"]);
+  EXPECT_EQ(7, values["b.sum.60"]);
+  EXPECT_EQ(1, values["b.count"]);
+
+  auto text = registry.toText();
+  EXPECT_EQ(0, text.find("a 3\n"));
+  EXPECT_NE(std::string::npos, text.find("b.sum 7\n"));
+
+  auto json = registry.toDynamic();
+  EXPECT_EQ(3, json["a"].asDouble());
+}
+
+TEST(StatsRegistryTest, StandaloneStats) {
+  StatsRegistry registry;
+  StandaloneHTTPSessionStats sessionStats("http", registry);
+  sessionStats.recordTransactionOpened();
+  sessionStats.recordTransactionOpened();
+  sessionStats.recordTransactionsServed(7);
+  sessionStats.recordTTLBATracked();
+  sessionStats.recordSessionIdleTime(std::chrono::seconds(4));
+
+  StandaloneHeaderCodecStats codecStats("codec", registry);
+  HTTPHeaderSize size;
+  size.compressed = 10;
+  size.uncompressed = 40;
+  codecStats.recordEncode(HeaderCodec::Type::HPACK, size);
+  codecStats.recordDecodeError(HeaderCodec::Type::QPACK);
+
+  auto values = registry.getValues();
+  EXPECT_EQ(2, values["http.transaction_opened.count"]);
+  EXPECT_EQ(7, values["http.transactions_served.sum"]);
+  EXPECT_EQ(1, values["http.ttlba_tracked.count.60"]);
+  EXPECT_EQ(1, values["http.session_idle_time.count"]);
+  EXPECT_EQ(4, values["http.session_idle_time.avg"]);
+  EXPECT_EQ(10, values["codec.hpack.encoded_bytes_compressed.sum"]);
+  EXPECT_EQ(40, values["codec.hpack.encoded_bytes_uncompressed.sum"]);
+  EXPECT_EQ(1, values["codec.qpack.decode_errors.count"]);
+  EXPECT_EQ(0, values["codec.gzip.encodes.count"]);
+}
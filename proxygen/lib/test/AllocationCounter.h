@@ -0,0 +1,54 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Counts every heap allocation made through operator new, for benchmarks
+ * that report allocations per operation.  This replaces the global operator
+ * new and delete, so include it from exactly one file of a benchmark binary.
+ */
+
+namespace proxygen {
+
+namespace detail {
+// Constant initialized, so it counts allocations made by static constructors
+std::atomic<uint64_t> allocationCount{0};
+} // namespace detail
+
+/**
+ * Allocations made by the process so far
+ */
+inline uint64_t getAllocationCount() {
+  return detail::allocationCount.load(std::memory_order_relaxed);
+}
+
+} // namespace proxygen
+
+void* operator new(size_t size) {
+  proxygen::detail::allocationCount.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
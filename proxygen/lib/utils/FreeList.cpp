@@ -0,0 +1,24 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/FreeList.h>
+
+namespace proxygen {
+
+std::atomic<size_t> FreeLists::maxFreeBlocks_{kDefaultMaxFreeBlocks};
+
+void FreeLists::setMaxFreeBlocks(size_t maxFreeBlocks) {
+  maxFreeBlocks_.store(maxFreeBlocks, std::memory_order_relaxed);
+}
+
+size_t FreeLists::getMaxFreeBlocks() {
+  return maxFreeBlocks_.load(std::memory_order_relaxed);
+}
+
+} // namespace proxygen
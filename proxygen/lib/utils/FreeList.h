@@ -0,0 +1,203 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/ThreadLocal.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace proxygen {
+
+struct FreeListStats {
+  // Blocks taken from the global allocator
+  uint64_t allocated;
+  // Blocks handed out again from the free list
+  uint64_t reused;
+  // Blocks currently on the free list
+  uint64_t free;
+};
+
+/**
+ * Process wide settings shared by every ThreadLocalFreeList.
+ */
+class FreeLists {
+ public:
+  /**
+   * The number of freed blocks each thread keeps per block size, beyond
+   * which blocks go back to the global allocator.  0 disables recycling.
+   */
+  static void setMaxFreeBlocks(size_t maxFreeBlocks);
+  static size_t getMaxFreeBlocks();
+
+  static const size_t kDefaultMaxFreeBlocks = 1024;
+
+ private:
+  static std::atomic<size_t> maxFreeBlocks_;
+};
+
+/**
+ * Per-thread free list of blocks of Size bytes.  Every worker thread runs
+ * one EventBase, so objects created and destroyed by a worker's sessions are
+ * recycled without going through the global allocator or taking any locks.
+ *
+ * A block freed on a different thread than it was allocated on simply joins
+ * that thread's list.  Blocks still on a list are released when its thread
+ * exits.
+ */
+template <size_t Size>
+class ThreadLocalFreeList {
+  struct Node {
+    Node* next;
+  };
+  static_assert(Size >= sizeof(Node), "blocks must fit a list node");
+
+ public:
+  static void* allocate() {
+    auto& list = *lists();
+    if (list.head_) {
+      auto node = list.head_;
+      list.head_ = node->next;
+      list.stats_.free--;
+      list.stats_.reused++;
+      return node;
+    }
+    list.stats_.allocated++;
+    return ::operator new(Size);
+  }
+
+  static void deallocate(void* p) {
+    auto& list = *lists();
+    if (list.stats_.free >= FreeLists::getMaxFreeBlocks()) {
+      ::operator delete(p);
+      return;
+    }
+    auto node = static_cast<Node*>(p);
+    node->next = list.head_;
+    list.head_ = node;
+    list.stats_.free++;
+  }
+
+  /**
+   * Stats for the calling thread's list
+   */
+  static FreeListStats getStats() {
+    return lists()->stats_;
+  }
+
+  /**
+   * Release the calling thread's free blocks and reset its stats
+   */
+  static void reset() {
+    lists()->clear();
+    lists()->stats_ = FreeListStats();
+  }
+
+ private:
+  struct List {
+    ~List() {
+      clear();
+    }
+
+    void clear() {
+      while (head_) {
+        auto node = head_;
+        head_ = node->next;
+        ::operator delete(node);
+      }
+      stats_.free = 0;
+    }
+
+    Node* head_{nullptr};
+    FreeListStats stats_{};
+  };
+
+  // Built on first use, as objects in other translation units may allocate
+  // during static initialization, and never destroyed for those freed at exit
+  static folly::ThreadLocal<List>& lists() {
+    static auto lists = new folly::ThreadLocal<List>();
+    return *lists;
+  }
+};
+
+/**
+ * Base for classes whose instances are recycled through a per-thread free
+ * list.  Instances of subclasses that are larger than T use the global
+ * allocator.
+ */
+template <typename T>
+class FreeListAllocated {
+ public:
+  static void* operator new(size_t size) {
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "over-aligned types need their own allocation");
+    if (size == sizeof(T)) {
+      return ThreadLocalFreeList<sizeof(T)>::allocate();
+    }
+    return ::operator new(size);
+  }
+
+  static void operator delete(void* p, size_t size) {
+    if (size == sizeof(T)) {
+      ThreadLocalFreeList<sizeof(T)>::deallocate(p);
+    } else {
+      ::operator delete(p);
+    }
+  }
+
+  static FreeListStats getFreeListStats() {
+    return ThreadLocalFreeList<sizeof(T)>::getStats();
+  }
+};
+
+/**
+ * Allocator for node based containers, such as std::map, that recycles
+ * nodes through a per-thread free list.
+ */
+template <typename T>
+class FreeListAllocator {
+ public:
+  using value_type = T;
+
+  FreeListAllocator() = default;
+
+  template <typename U>
+  /* implicit */ FreeListAllocator(const FreeListAllocator<U>&) {
+  }
+
+  T* allocate(size_t n) {
+    if (n == 1) {
+      return static_cast<T*>(ThreadLocalFreeList<sizeof(T)>::allocate());
+    }
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, size_t n) {
+    if (n == 1) {
+      ThreadLocalFreeList<sizeof(T)>::deallocate(p);
+    } else {
+      std::allocator<T>().deallocate(p, n);
+    }
+  }
+
+  template <typename U>
+  bool operator==(const FreeListAllocator<U>&) const {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const FreeListAllocator<U>&) const {
+    return false;
+  }
+};
+
+} // namespace proxygen
@@ -0,0 +1,235 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/IoUring.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+int ioUringSetup(uint32_t entries, io_uring_params* params) {
+  return int(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, uint32_t toSubmit, uint32_t minComplete,
+                 uint32_t flags) {
+  return int(syscall(
+      __NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, uint32_t opcode, const void* arg,
+                    uint32_t nrArgs) {
+  return int(syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+void* mapRing(int fd, size_t size, off_t offset) {
+  auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, offset);
+  return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+void* mapAnonymous(size_t size) {
+  auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+// Buffer ids are 16 bits
+constexpr uint32_t kMaxBuffers = 65536;
+
+}
+
+namespace proxygen {
+
+std::unique_ptr<IoUring> IoUring::create(const Options& options) {
+  std::unique_ptr<IoUring> ring(new IoUring());
+  if (!ring->init(options)) {
+    return nullptr;
+  }
+  return ring;
+}
+
+bool IoUring::init(const Options& options) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = options.queueDepth * 4;
+  ringFd_ = ioUringSetup(options.queueDepth, &params);
+  if (ringFd_ < 0) {
+    return false;
+  }
+  if (!(params.features & IORING_FEAT_NODROP)) {
+    // Completions could be lost when the queue overflows
+    return false;
+  }
+
+  sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMap) {
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+  }
+  sqRing_ = mapRing(ringFd_, sqRingSize_, IORING_OFF_SQ_RING);
+  if (!sqRing_) {
+    return false;
+  }
+  if (singleMap) {
+    cqRing_ = sqRing_;
+  } else {
+    cqRing_ = mapRing(ringFd_, cqRingSize_, IORING_OFF_CQ_RING);
+    if (!cqRing_) {
+      return false;
+    }
+  }
+  sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe*>(
+      mapRing(ringFd_, sqesSize_, IORING_OFF_SQES));
+  if (!sqes_) {
+    return false;
+  }
+
+  auto sq = static_cast<uint8_t*>(sqRing_);
+  sqHead_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+  sqTail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+  sqMask_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+  sqEntries_ = params.sq_entries;
+  // Entries are always used in order, so slot i holds entry i
+  auto array = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+  for (uint32_t i = 0; i < sqEntries_; i++) {
+    array[i] = i;
+  }
+  sqeTail_ = submittedTail_ = *sqTail_;
+
+  auto cq = static_cast<uint8_t*>(cqRing_);
+  cqHead_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+  cqTail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+  cqMask_ = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  return initBuffers(options.bufferCount, options.bufferSize);
+}
+
+bool IoUring::initBuffers(uint32_t count, uint32_t size) {
+  if (count == 0 || size == 0) {
+    return false;
+  }
+  count = std::min(count, kMaxBuffers);
+  buffersSize_ = size_t(count) * size;
+  buffers_ = static_cast<uint8_t*>(mapAnonymous(buffersSize_));
+  if (!buffers_) {
+    return false;
+  }
+  bufferSize_ = size;
+  if (!provideBuffers(0, count) || submit() != 1) {
+    return false;
+  }
+  // Wait for the kernel to take them, so an error shows up here
+  if (ioUringEnter(ringFd_, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+    return false;
+  }
+  auto head = *cqHead_;
+  if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  auto res = cqes_[head & cqMask_].res;
+  __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+  // Kernels before 5.7 do not know the opcode
+  return res >= 0;
+}
+
+bool IoUring::provideBuffers(uint16_t id, uint32_t count) {
+  auto sqe = getSqe();
+  if (!sqe) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = int32_t(count);
+  sqe->addr = reinterpret_cast<uint64_t>(getBuffer(id));
+  sqe->len = bufferSize_;
+  sqe->off = id;
+  sqe->buf_group = kBufferGroup;
+  sqe->user_data = kProvideBuffersData;
+  return true;
+}
+
+IoUring::~IoUring() {
+  if (ringFd_ >= 0) {
+    // Closing the ring cancels whatever is still in flight
+    close(ringFd_);
+  }
+  if (sqes_) {
+    munmap(sqes_, sqesSize_);
+  }
+  if (cqRing_ && cqRing_ != sqRing_) {
+    munmap(cqRing_, cqRingSize_);
+  }
+  if (sqRing_) {
+    munmap(sqRing_, sqRingSize_);
+  }
+  if (buffers_) {
+    munmap(buffers_, buffersSize_);
+  }
+}
+
+io_uring_sqe* IoUring::getSqe() {
+  if (sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+    submit();
+    if (sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+      return nullptr;
+    }
+  }
+  auto sqe = &sqes_[sqeTail_ & sqMask_];
+  sqeTail_++;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+int IoUring::submit() {
+  while (!unprovided_.empty() &&
+         sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) < sqEntries_) {
+    provideBuffers(unprovided_.back(), 1);
+    unprovided_.pop_back();
+  }
+  auto toSubmit = sqeTail_ - submittedTail_;
+  if (toSubmit == 0) {
+    return 0;
+  }
+  __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+  int ret;
+  do {
+    ret = ioUringEnter(ringFd_, toSubmit, 0, 0);
+    stats_.enters++;
+  } while (ret < 0 && errno == EINTR);
+  if (ret < 0) {
+    return -errno;
+  }
+  submittedTail_ += ret;
+  stats_.submitted += ret;
+  return ret;
+}
+
+int IoUring::registerEventFd(int fd) {
+  if (ioUringRegister(ringFd_, IORING_REGISTER_EVENTFD, &fd, 1) < 0) {
+    return -errno;
+  }
+  return 0;
+}
+
+void IoUring::recycleBuffer(uint16_t id) {
+  if (!provideBuffers(id, 1)) {
+    unprovided_.push_back(id);
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,169 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * A minimal io_uring instance, set up with the raw system calls so that no
+ * library is needed, with a group of receive buffers provided to the kernel
+ * up front for recvs with IOSQE_BUFFER_SELECT to pick from.
+ *
+ * Submissions are queued by filling the entries returned by getSqe() and
+ * only reach the kernel on submit(), so everything queued in one event loop
+ * iteration goes out in a single io_uring_enter.  Not thread safe.
+ */
+class IoUring {
+ public:
+  struct Options {
+    // Submission queue entries.  The completion queue gets 4 times as many.
+    uint32_t queueDepth{256};
+    // Provided receive buffers
+    uint32_t bufferCount{256};
+    uint32_t bufferSize{16 * 1024};
+  };
+
+  struct Stats {
+    // io_uring_enter calls
+    uint64_t enters{0};
+    uint64_t submitted{0};
+    uint64_t completions{0};
+  };
+
+  /**
+   * A new ring, nullptr when the kernel does not support io_uring with
+   * provided buffers
+   */
+  static std::unique_ptr<IoUring> create(const Options& options);
+
+  ~IoUring();
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  /**
+   * A cleared submission entry to fill, submitting the queued ones first if
+   * the queue is full.  nullptr if there is still no room.
+   */
+  io_uring_sqe* getSqe();
+
+  /**
+   * Pass every queued entry to the kernel in one call.  Returns how many it
+   * took, or -errno.
+   */
+  int submit();
+
+  uint32_t getQueuedSubmissions() const {
+    return sqeTail_ - submittedTail_;
+  }
+
+  /**
+   * Call fn(const io_uring_cqe&) for each completion posted, returning their
+   * number.  fn may queue new submissions.  Submissions must not use
+   * user_data 0, which marks the ones giving buffers back.
+   */
+  template <typename F>
+  size_t reapCompletions(F&& fn) {
+    size_t reaped = 0;
+    auto tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    auto head = *cqHead_;
+    while (head != tail) {
+      // Copy the entry out so its slot can be released before fn runs
+      io_uring_cqe cqe = cqes_[head & cqMask_];
+      __atomic_store_n(cqHead_, ++head, __ATOMIC_RELEASE);
+      reaped++;
+      if (cqe.user_data != kProvideBuffersData) {
+        fn(cqe);
+      }
+      tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    }
+    stats_.completions += reaped;
+    return reaped;
+  }
+
+  /**
+   * Have the kernel signal fd, an eventfd, when completions are posted
+   */
+  int registerEventFd(int fd);
+
+  int getFd() const {
+    return ringFd_;
+  }
+
+  // Buffer group recvs pass in buf_group to pick a provided buffer
+  uint16_t getBufferGroup() const {
+    return kBufferGroup;
+  }
+
+  uint32_t getBufferSize() const {
+    return bufferSize_;
+  }
+
+  const uint8_t* getBuffer(uint16_t id) const {
+    return buffers_ + size_t(id) * bufferSize_;
+  }
+
+  /**
+   * Give a buffer picked for a completed recv back to the kernel, with the
+   * next submit()
+   */
+  void recycleBuffer(uint16_t id);
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  static constexpr uint16_t kBufferGroup = 0;
+  static constexpr uint64_t kProvideBuffersData = 0;
+
+  IoUring() = default;
+
+  bool init(const Options& options);
+  bool initBuffers(uint32_t count, uint32_t size);
+  bool provideBuffers(uint16_t id, uint32_t count);
+
+  int ringFd_{-1};
+  // Submission queue
+  void* sqRing_{nullptr};
+  size_t sqRingSize_{0};
+  uint32_t* sqHead_{nullptr};
+  uint32_t* sqTail_{nullptr};
+  uint32_t sqMask_{0};
+  uint32_t sqEntries_{0};
+  io_uring_sqe* sqes_{nullptr};
+  size_t sqesSize_{0};
+  uint32_t sqeTail_{0};
+  uint32_t submittedTail_{0};
+  // Completion queue, in the same mapping as the submission queue when the
+  // kernel supports it
+  void* cqRing_{nullptr};
+  size_t cqRingSize_{0};
+  uint32_t* cqHead_{nullptr};
+  uint32_t* cqTail_{nullptr};
+  uint32_t cqMask_{0};
+  io_uring_cqe* cqes_{nullptr};
+  // Provided receive buffers
+  uint8_t* buffers_{nullptr};
+  size_t buffersSize_{0};
+  uint32_t bufferSize_{0};
+  // Buffers recycled while the submission queue was full
+  std::vector<uint16_t> unprovided_;
+  Stats stats_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,699 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/IoUringSocket.h>
+
+#include <algorithm>
+#include <cstring>
+#include <folly/io/async/EventBaseLocal.h>
+#include <glog/logging.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using folly::AsyncSocketException;
+using folly::EventBase;
+using folly::IOBuf;
+using folly::WriteFlags;
+
+// Older kernel headers
+#ifndef IORING_RECV_MULTISHOT
+#define IORING_RECV_MULTISHOT (1U << 1)
+#endif
+#ifndef IORING_CQE_F_MORE
+#define IORING_CQE_F_MORE (1U << 1)
+#endif
+
+namespace {
+
+constexpr uint64_t kOpMask = 3;
+
+folly::EventBaseLocal<std::unique_ptr<proxygen::IoUringContext>>&
+getContexts() {
+  static auto contexts =
+      new folly::EventBaseLocal<std::unique_ptr<proxygen::IoUringContext>>();
+  return *contexts;
+}
+
+}
+
+namespace proxygen {
+
+IoUringContext* IoUringContext::get(EventBase* evb) {
+  evb->dcheckIsInEventBaseThread();
+  return getContexts()
+      .getOrCreateFn(*evb, [evb] { return create(evb); })
+      .get();
+}
+
+std::unique_ptr<IoUringContext> IoUringContext::create(EventBase* evb) {
+  auto ring = IoUring::create(IoUring::Options());
+  if (!ring) {
+    VLOG(2) << "io_uring unavailable, sockets on evb=" << evb
+            << " use readiness events";
+    return nullptr;
+  }
+  int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  if (ring->registerEventFd(fd) < 0) {
+    ::close(fd);
+    return nullptr;
+  }
+  return std::unique_ptr<IoUringContext>(
+      new IoUringContext(evb, std::move(ring), fd));
+}
+
+IoUringContext::IoUringContext(EventBase* evb,
+                               std::unique_ptr<IoUring> ring,
+                               int fd)
+    : folly::EventHandler(evb, folly::NetworkSocket::fromFd(fd)),
+      evb_(evb),
+      ring_(std::move(ring)),
+      eventFd_(fd) {
+}
+
+IoUringContext::~IoUringContext() {
+  unregisterHandler();
+  // Closing the ring ends whatever is in flight
+  ring_.reset();
+  for (auto conn : released_) {
+    if (conn->heldFd >= 0) {
+      ::close(conn->heldFd);
+    }
+    delete conn;
+  }
+  ::close(eventFd_);
+}
+
+io_uring_sqe* IoUringContext::getSqe(Connection* conn, Op op) {
+  auto sqe = ring_->getSqe();
+  if (!sqe) {
+    return nullptr;
+  }
+  sqe->user_data = reinterpret_cast<uint64_t>(conn) | uint64_t(op);
+  conn->inflight++;
+  if (inflight_++ == 0) {
+    // Keeps the loop running like a socket waiting for reads does
+    registerHandler(folly::EventHandler::READ | folly::EventHandler::PERSIST);
+  }
+  scheduleSubmit();
+  return sqe;
+}
+
+bool IoUringContext::submitNow() {
+  auto ret = ring_->submit();
+  if (ret < 0) {
+    VLOG(4) << "io_uring submit failed, err=" << -ret;
+  }
+  return ring_->getQueuedSubmissions() == 0;
+}
+
+void IoUringContext::scheduleSend(Connection* conn) {
+  if (!conn->sendScheduled) {
+    conn->sendScheduled = true;
+    sendReady_.push_back(conn);
+    scheduleSubmit();
+  }
+}
+
+void IoUringContext::release(std::unique_ptr<Connection> conn) {
+  conn->socket = nullptr;
+  released_.insert(conn.release());
+}
+
+void IoUringContext::scheduleSubmit() {
+  if (!isLoopCallbackScheduled()) {
+    evb_->runInLoop(this);
+  }
+}
+
+void IoUringContext::maybeFree(Connection* conn) {
+  if (!conn->socket && conn->inflight == 0 && !conn->sendScheduled) {
+    released_.erase(conn);
+    delete conn;
+  }
+}
+
+void IoUringContext::runLoopCallback() noexcept {
+  auto ready = std::move(sendReady_);
+  sendReady_.clear();
+  for (auto conn : ready) {
+    conn->sendScheduled = false;
+    if (conn->socket) {
+      conn->socket->sendQueued();
+    } else {
+      maybeFree(conn);
+    }
+  }
+  auto ret = ring_->submit();
+  if (ret < 0) {
+    // Most likely EBUSY with completions to reap first; they wake us up
+    VLOG(4) << "io_uring submit failed, err=" << -ret;
+  }
+}
+
+void IoUringContext::handlerReady(uint16_t /*events*/) noexcept {
+  uint64_t count;
+  if (::read(eventFd_, &count, sizeof(count)) < 0) {
+    VLOG(4) << "eventfd read failed, errno=" << errno;
+  }
+  ring_->reapCompletions(
+      [this](const io_uring_cqe& cqe) { onCompletion(cqe); });
+  if (ring_->getQueuedSubmissions() > 0) {
+    scheduleSubmit();
+  }
+}
+
+void IoUringContext::onCompletion(const io_uring_cqe& cqe) {
+  auto conn = reinterpret_cast<Connection*>(cqe.user_data & ~kOpMask);
+  auto op = Op(cqe.user_data & kOpMask);
+  bool more = op == Op::RECV && (cqe.flags & IORING_CQE_F_MORE);
+  if (conn->socket) {
+    // The socket may go away in here, leaving conn to us as the operation
+    // is still counted
+    switch (op) {
+      case Op::RECV:
+        conn->socket->onRecv(cqe);
+        break;
+      case Op::SEND:
+        conn->socket->onSend(cqe);
+        break;
+      case Op::CANCEL:
+        break;
+    }
+  } else if (op == Op::RECV && (cqe.flags & IORING_CQE_F_BUFFER)) {
+    ring_->recycleBuffer(uint16_t(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+  }
+  if (!more) {
+    if (--conn->inflight == 0 && conn->heldFd >= 0) {
+      ::close(conn->heldFd);
+      conn->heldFd = -1;
+    }
+    maybeFree(conn);
+    if (--inflight_ == 0) {
+      unregisterHandler();
+    }
+  }
+}
+
+IoUringSocket::IoUringSocket(EventBase* evb) : folly::AsyncSocket(evb) {
+}
+
+IoUringSocket::IoUringSocket(EventBase* evb, folly::NetworkSocket fd)
+    : folly::AsyncSocket(evb, fd) {
+}
+
+IoUringSocket::~IoUringSocket() {
+  if (!conn_) {
+    return;
+  }
+  conn_->socket = nullptr;
+  if (conn_->inflight > 0 || conn_->sendScheduled) {
+    for (auto& write : ringWrites_) {
+      conn_->retained.push_back(std::move(write.buf));
+    }
+    ctx_->release(std::move(conn_));
+  }
+}
+
+bool IoUringSocket::maybeUseRing() {
+  if (conn_) {
+    return true;
+  }
+  // Anything AsyncSocket still has to write must go first
+  if (ioUringDisabled_ || state_ != StateEnum::ESTABLISHED || writeReqHead_ != nullptr ||
+      shutdownFlags_ != 0) {
+    return false;
+  }
+  ctx_ = IoUringContext::get(eventBase_);
+  if (!ctx_) {
+    return false;
+  }
+  conn_ = std::make_unique<IoUringContext::Connection>();
+  conn_->socket = this;
+  auto callback = AsyncSocket::getReadCallback();
+  if (callback) {
+    AsyncSocket::setReadCB(nullptr);
+    ringReadCallback_ = callback;
+    startRecv();
+  }
+  return true;
+}
+
+void IoUringSocket::setReadCB(ReadCallback* callback) {
+  if (!maybeUseRing() || state_ != StateEnum::ESTABLISHED) {
+    AsyncSocket::setReadCB(callback);
+    return;
+  }
+  eventBase_->dcheckIsInEventBaseThread();
+  ringReadCallback_ = callback;
+  if (!callback) {
+    stopRecv();
+  } else if (!pending_.empty() || readEOF_) {
+    // Like AsyncSocket, never call back from in here
+    eventBase_->runInLoop(
+        [this, dg = DestructorGuard(this)] { deliverPending(); });
+  } else {
+    startRecv();
+  }
+}
+
+folly::AsyncSocket::ReadCallback* IoUringSocket::getReadCallback() const {
+  return conn_ ? ringReadCallback_ : AsyncSocket::getReadCallback();
+}
+
+void IoUringSocket::startRecv() {
+  if (recvArmed_ || readEOF_) {
+    return;
+  }
+  auto sqe = ctx_->getSqe(conn_.get(), IoUringContext::Op::RECV);
+  if (!sqe) {
+    failRing(AsyncSocketException(AsyncSocketException::INTERNAL_ERROR,
+                                  "io_uring submission queue full"));
+    return;
+  }
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd_.toFd();
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = ctx_->getRing().getBufferGroup();
+  if (multishot_) {
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+  }
+  recvArmed_ = true;
+}
+
+void IoUringSocket::stopRecv() {
+  if (recvArmed_ && !recvCancelling_) {
+    // Whatever arrives before the cancel lands waits in pending_
+    cancel(IoUringContext::Op::RECV);
+    recvCancelling_ = true;
+  }
+}
+
+void IoUringSocket::cancel(IoUringContext::Op op) {
+  auto sqe = ctx_->getSqe(conn_.get(), IoUringContext::Op::CANCEL);
+  if (sqe) {
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = reinterpret_cast<uint64_t>(conn_.get()) | uint64_t(op);
+  }
+}
+
+void IoUringSocket::onRecv(const io_uring_cqe& cqe) {
+  DestructorGuard dg(this);
+  if (!(cqe.flags & IORING_CQE_F_MORE)) {
+    recvArmed_ = false;
+    recvCancelling_ = false;
+  }
+  if (cqe.res > 0) {
+    auto& ring = ctx_->getRing();
+    auto id = uint16_t(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    appBytesReceived_ += cqe.res;
+    deliver(ring.getBuffer(id), size_t(cqe.res));
+    ring.recycleBuffer(id);
+  }
+  if (recvArmed_) {
+    return;
+  }
+  if (cqe.res == 0) {
+    readEOF_ = true;
+    deliverPending();
+    return;
+  }
+  if (cqe.res < 0) {
+    if (cqe.res == -EINVAL && multishot_) {
+      VLOG(4) << "multishot recv unsupported, falling back to single recvs";
+      multishot_ = false;
+    } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED &&
+               cqe.res != -EINTR && cqe.res != -EAGAIN) {
+      failRing(AsyncSocketException(
+          AsyncSocketException::INTERNAL_ERROR, "recv failed", -cqe.res));
+      return;
+    }
+  }
+  if (ringReadCallback_ && state_ == StateEnum::ESTABLISHED) {
+    startRecv();
+  }
+}
+
+void IoUringSocket::deliver(const uint8_t* data, size_t len) {
+  while (len > 0 && ringReadCallback_ && pending_.empty()) {
+    auto callback = ringReadCallback_;
+    if (callback->isBufferMovable()) {
+      callback->readBufferAvailable(IOBuf::copyBuffer(data, len));
+      return;
+    }
+    void* buf = nullptr;
+    size_t size = 0;
+    callback->getReadBuffer(&buf, &size);
+    if (!buf || size == 0) {
+      failRing(AsyncSocketException(
+          AsyncSocketException::BAD_ARGS,
+          "ReadCallback::getReadBuffer() returned empty buffer"));
+      return;
+    }
+    size = std::min(size, len);
+    memcpy(buf, data, size);
+    data += size;
+    len -= size;
+    callback->readDataAvailable(size);
+  }
+  if (len > 0) {
+    pending_.append(IOBuf::copyBuffer(data, len));
+  }
+}
+
+void IoUringSocket::deliverPending() {
+  if (!ringReadCallback_) {
+    return;
+  }
+  DestructorGuard dg(this);
+  if (!pending_.empty()) {
+    auto buf = pending_.move();
+    buf->coalesce();
+    deliver(buf->data(), buf->length());
+  }
+  if (!ringReadCallback_ || !pending_.empty()) {
+    return;
+  }
+  if (readEOF_) {
+    auto callback = ringReadCallback_;
+    ringReadCallback_ = nullptr;
+    shutdownFlags_ |= SHUT_READ;
+    callback->readEOF();
+  } else if (state_ == StateEnum::ESTABLISHED) {
+    startRecv();
+  }
+}
+
+void IoUringSocket::write(WriteCallback* callback,
+                          const void* buf,
+                          size_t bytes,
+                          WriteFlags flags) {
+  if (!maybeUseRing()) {
+    AsyncSocket::write(callback, buf, bytes, flags);
+    return;
+  }
+  // The kernel may still read a write that failed, so it gets a copy the
+  // caller cannot free under it
+  queueWrite(callback, IOBuf::copyBuffer(buf, bytes), flags);
+}
+
+void IoUringSocket::writev(WriteCallback* callback,
+                           const iovec* vec,
+                           size_t count,
+                           WriteFlags flags) {
+  if (!maybeUseRing()) {
+    AsyncSocket::writev(callback, vec, count, flags);
+    return;
+  }
+  auto buf = IOBuf::create(0);
+  for (size_t i = 0; i < count; i++) {
+    buf->prependChain(IOBuf::copyBuffer(vec[i].iov_base, vec[i].iov_len));
+  }
+  queueWrite(callback, std::move(buf), flags);
+}
+
+void IoUringSocket::writeChain(WriteCallback* callback,
+                               std::unique_ptr<IOBuf>&& buf,
+                               WriteFlags flags) {
+  if (!maybeUseRing()) {
+    AsyncSocket::writeChain(callback, std::move(buf), flags);
+    return;
+  }
+  queueWrite(callback, std::move(buf), flags);
+}
+
+void IoUringSocket::queueWrite(WriteCallback* callback,
+                               std::unique_ptr<IOBuf> buf,
+                               WriteFlags flags) {
+  eventBase_->dcheckIsInEventBaseThread();
+  if (state_ != StateEnum::ESTABLISHED || closeOnDrain_ || shutdownOnDrain_ ||
+      (shutdownFlags_ & (SHUT_WRITE | SHUT_WRITE_PENDING))) {
+    if (callback) {
+      callback->writeErr(
+          0,
+          AsyncSocketException(AsyncSocketException::NOT_OPEN,
+                               "write() called on a closed or shut down "
+                               "socket"));
+    }
+    return;
+  }
+  ringWrites_.push_back(RingWrite{callback, std::move(buf), flags});
+  ctx_->scheduleSend(conn_.get());
+}
+
+void IoUringSocket::sendQueued() {
+  if (sendInFlight_ || ringWrites_.empty() ||
+      state_ != StateEnum::ESTABLISHED) {
+    return;
+  }
+  auto& msg = conn_->msg;
+  memset(&msg, 0, sizeof(msg));
+  size_t iovCount = 0;
+  size_t skip = ringWriteOffset_;
+  bool more = false;
+  for (auto& write : ringWrites_) {
+    for (auto range : *write.buf) {
+      if (skip >= range.size()) {
+        skip -= range.size();
+        continue;
+      }
+      if (iovCount == IoUringContext::Connection::kMaxIovecs) {
+        more = true;
+        break;
+      }
+      conn_->iov[iovCount].iov_base =
+          const_cast<uint8_t*>(range.data() + skip);
+      conn_->iov[iovCount].iov_len = range.size() - skip;
+      iovCount++;
+      skip = 0;
+    }
+    if (iovCount == IoUringContext::Connection::kMaxIovecs) {
+      more = true;
+      break;
+    }
+    more = isSet(write.flags, WriteFlags::CORK);
+  }
+  if (iovCount == 0) {
+    // Only empty writes
+    DestructorGuard dg(this);
+    onBytesWritten(0);
+    return;
+  }
+  auto sqe = ctx_->getSqe(conn_.get(), IoUringContext::Op::SEND);
+  if (!sqe) {
+    failRing(AsyncSocketException(AsyncSocketException::INTERNAL_ERROR,
+                                  "io_uring submission queue full"));
+    return;
+  }
+  msg.msg_iov = conn_->iov;
+  msg.msg_iovlen = iovCount;
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd_.toFd();
+  sqe->addr = reinterpret_cast<uint64_t>(&msg);
+  sqe->msg_flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
+  sendInFlight_ = true;
+  if (sendTimeout_ > 0) {
+    if (!ringSendTimeout_) {
+      ringSendTimeout_ =
+          folly::AsyncTimeout::make(*eventBase_, [this]() noexcept {
+            failRing(AsyncSocketException(AsyncSocketException::TIMED_OUT,
+                                          "write timed out"));
+          });
+    }
+    // Restarted on every send, so it fires when one stalls
+    ringSendTimeout_->scheduleTimeout(sendTimeout_);
+  }
+}
+
+void IoUringSocket::onSend(const io_uring_cqe& cqe) {
+  DestructorGuard dg(this);
+  sendInFlight_ = false;
+  conn_->retained.clear();
+  if (cqe.res < 0) {
+    if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+      sendQueued();
+    } else if (state_ == StateEnum::ESTABLISHED) {
+      failRing(AsyncSocketException(
+          AsyncSocketException::INTERNAL_ERROR, "sendmsg failed", -cqe.res));
+    }
+    return;
+  }
+  appBytesWritten_ += cqe.res;
+  onBytesWritten(size_t(cqe.res));
+  if (ringWrites_.empty()) {
+    if (ringSendTimeout_) {
+      ringSendTimeout_->cancelTimeout();
+    }
+    onWritesDrained();
+  } else {
+    sendQueued();
+  }
+}
+
+void IoUringSocket::onBytesWritten(size_t bytes) {
+  bytes += ringWriteOffset_;
+  while (!ringWrites_.empty()) {
+    auto length = ringWrites_.front().buf->computeChainDataLength();
+    if (bytes < length) {
+      break;
+    }
+    bytes -= length;
+    auto callback = ringWrites_.front().callback;
+    ringWrites_.pop_front();
+    ringWriteOffset_ = 0;
+    if (callback) {
+      callback->writeSuccess();
+    }
+    if (!conn_ || state_ != StateEnum::ESTABLISHED) {
+      return;
+    }
+  }
+  ringWriteOffset_ = bytes;
+}
+
+void IoUringSocket::onWritesDrained() {
+  if (closeOnDrain_) {
+    closeNow();
+  } else if (shutdownOnDrain_) {
+    shutdownOnDrain_ = false;
+    AsyncSocket::shutdownWriteNow();
+  }
+}
+
+void IoUringSocket::failWrites(const AsyncSocketException& ex) {
+  auto written = ringWriteOffset_;
+  ringWriteOffset_ = 0;
+  while (!ringWrites_.empty()) {
+    auto write = std::move(ringWrites_.front());
+    ringWrites_.pop_front();
+    if (sendInFlight_) {
+      conn_->retained.push_back(std::move(write.buf));
+    }
+    if (write.callback) {
+      write.callback->writeErr(written, ex);
+    }
+    written = 0;
+  }
+}
+
+void IoUringSocket::failRing(const AsyncSocketException& ex) {
+  DestructorGuard dg(this);
+  stopRecv();
+  if (sendInFlight_) {
+    cancel(IoUringContext::Op::SEND);
+  }
+  if (ringSendTimeout_) {
+    ringSendTimeout_->cancelTimeout();
+  }
+  auto callback = ringReadCallback_;
+  ringReadCallback_ = nullptr;
+  closeOnDrain_ = false;
+  closeFd();
+  failWrites(ex);
+  if (callback) {
+    callback->readErr(ex);
+  }
+}
+
+void IoUringSocket::closeFd() {
+  // A receive or cancel queued in this loop iteration would otherwise find
+  // fd_ only at the end of it, after an accept may have taken the number.
+  // Submitted operations hold the file itself.
+  if (!ctx_->submitNow() && conn_->inflight > 0) {
+    // Keep the number taken until they complete, closing a duplicate instead
+    int fd = ::dup(fd_.toFd());
+    if (fd >= 0) {
+      conn_->heldFd = fd_.toFd();
+      fd_ = folly::NetworkSocket::fromFd(fd);
+    }
+  }
+  AsyncSocket::closeNow();
+}
+
+void IoUringSocket::close() {
+  if (!conn_) {
+    AsyncSocket::close();
+    return;
+  }
+  if (ringWrites_.empty()) {
+    closeNow();
+    return;
+  }
+  // Stop reading now and close once the writes are out, as AsyncSocket does
+  DestructorGuard dg(this);
+  closeOnDrain_ = true;
+  stopRecv();
+  shutdownFlags_ |= SHUT_READ;
+  auto callback = ringReadCallback_;
+  ringReadCallback_ = nullptr;
+  if (callback) {
+    callback->readEOF();
+  }
+}
+
+void IoUringSocket::closeNow() {
+  if (!conn_) {
+    AsyncSocket::closeNow();
+    return;
+  }
+  DestructorGuard dg(this);
+  stopRecv();
+  if (sendInFlight_) {
+    cancel(IoUringContext::Op::SEND);
+  }
+  if (ringSendTimeout_) {
+    ringSendTimeout_->cancelTimeout();
+  }
+  auto callback = ringReadCallback_;
+  ringReadCallback_ = nullptr;
+  closeOnDrain_ = false;
+  closeFd();
+  failWrites(AsyncSocketException(AsyncSocketException::END_OF_FILE,
+                                  "socket closed locally"));
+  if (callback) {
+    callback->readEOF();
+  }
+}
+
+void IoUringSocket::shutdownWrite() {
+  if (!conn_ || ringWrites_.empty()) {
+    AsyncSocket::shutdownWrite();
+    return;
+  }
+  shutdownOnDrain_ = true;
+}
+
+void IoUringSocket::shutdownWriteNow() {
+  if (!conn_) {
+    AsyncSocket::shutdownWriteNow();
+    return;
+  }
+  DestructorGuard dg(this);
+  if (sendInFlight_) {
+    cancel(IoUringContext::Op::SEND);
+  }
+  shutdownOnDrain_ = false;
+  failWrites(AsyncSocketException(AsyncSocketException::END_OF_FILE,
+                                  "socket shut down for writes"));
+  AsyncSocket::shutdownWriteNow();
+}
+
+bool IoUringSocket::isPending() const {
+  return AsyncSocket::isPending() ||
+         (conn_ && (recvArmed_ || sendInFlight_ || !ringWrites_.empty()));
+}
+
+bool IoUringSocket::isDetachable() const {
+  // Operations in flight belong to this EventBase's ring
+  return !conn_ && AsyncSocket::isDetachable();
+}
+
+} // namespace proxygen
@@ -0,0 +1,234 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
+
+#include <proxygen/lib/utils/IoUring.h>
+
+#include <deque>
+#include <sys/socket.h>
+#include <unordered_set>
+#include <vector>
+
+namespace proxygen {
+
+class IoUringSocket;
+
+/**
+ * The io_uring shared by every IoUringSocket on one EventBase.  Sockets queue
+ * their receives and sends on it during the loop, and a loop callback passes
+ * all of them to the kernel in one io_uring_enter at the end of the
+ * iteration.  Completions wake the EventBase through an eventfd.
+ */
+class IoUringContext
+    : private folly::EventBase::LoopCallback
+    , private folly::EventHandler {
+ public:
+  /**
+   * The context for evb, created on first use.  nullptr when the kernel does
+   * not support io_uring; every later call returns nullptr as well.  Must be
+   * called in evb's thread.
+   */
+  static IoUringContext* get(folly::EventBase* evb);
+
+  ~IoUringContext() override;
+
+  /**
+   * What a socket keeps for its operations in flight.  user_data points here,
+   * so it lives until the last one completes, even past the socket.
+   */
+  struct Connection {
+    static constexpr size_t kMaxIovecs = 64;
+
+    IoUringSocket* socket{nullptr};
+    uint32_t inflight{0};
+    bool sendScheduled{false};
+    // The closed socket's fd, kept from reuse until its operations complete
+    int heldFd{-1};
+    // Send in flight
+    msghdr msg;
+    iovec iov[kMaxIovecs];
+    // Data it may still be reading after the socket is gone
+    std::vector<std::unique_ptr<folly::IOBuf>> retained;
+  };
+
+  enum class Op : uint64_t {
+    RECV = 1,
+    SEND = 2,
+    CANCEL = 3,
+  };
+
+  /**
+   * A cleared entry tagged for op on conn, nullptr if the queue is full.
+   * Submitted at the end of the loop iteration.
+   */
+  io_uring_sqe* getSqe(Connection* conn, Op op);
+
+  /**
+   * Submit what is queued now rather than at the end of the loop iteration.
+   * Queued entries name their fd by number, which is only resolved when the
+   * kernel takes them.  false if some are still queued.
+   */
+  bool submitNow();
+
+  IoUring& getRing() {
+    return *ring_;
+  }
+
+  /**
+   * Have conn's socket build its send just before the ring is submitted, so
+   * every write queued in this loop iteration goes out together
+   */
+  void scheduleSend(Connection* conn);
+
+  /**
+   * Called by a socket going away, which passes conn over until its
+   * operations complete
+   */
+  void release(std::unique_ptr<Connection> conn);
+
+ private:
+  IoUringContext(folly::EventBase* evb, std::unique_ptr<IoUring> ring, int fd);
+
+  static std::unique_ptr<IoUringContext> create(folly::EventBase* evb);
+
+  void runLoopCallback() noexcept override;
+  void handlerReady(uint16_t events) noexcept override;
+
+  void onCompletion(const io_uring_cqe& cqe);
+  void scheduleSubmit();
+  void maybeFree(Connection* conn);
+
+  folly::EventBase* evb_;
+  std::unique_ptr<IoUring> ring_;
+  int eventFd_;
+  // Operations in flight over every connection
+  uint64_t inflight_{0};
+  std::vector<Connection*> sendReady_;
+  std::unordered_set<Connection*> released_;
+};
+
+/**
+ * An AsyncSocket moving its data through the EventBase's io_uring instead of
+ * readiness events.  A multishot receive picks buffers from the group
+ * provided to the ring and keeps posting data until reads pause, so an idle
+ * connection costs nothing and a busy one no recv call per read.  Writes
+ * queued during a loop iteration go out as one sendmsg, and every socket's
+ * sendmsg and receive go to the kernel in one io_uring_enter.
+ *
+ * This saves syscalls, not copies.  Received data is copied out of the
+ * ring's buffers into the read callback's, or into a new IOBuf for movable
+ * callbacks.  writeChain() sends the caller's IOBufs as they are, but
+ * write() and writev() copy the data.  The kernel may still be reading a
+ * send after its failure was reported, and by then the caller may have
+ * freed its buffer.
+ *
+ * Connecting, TLS and everything else stay with AsyncSocket; the ring takes
+ * over on the first read or write once the socket is established.  Without
+ * io_uring support it is a plain AsyncSocket.
+ */
+class IoUringSocket : public folly::AsyncSocket {
+ public:
+  using UniquePtr = std::unique_ptr<IoUringSocket, Destructor>;
+
+  explicit IoUringSocket(folly::EventBase* evb);
+  IoUringSocket(folly::EventBase* evb, folly::NetworkSocket fd);
+
+  void setReadCB(ReadCallback* callback) override;
+  ReadCallback* getReadCallback() const override;
+
+  void write(WriteCallback* callback,
+             const void* buf,
+             size_t bytes,
+             folly::WriteFlags flags = folly::WriteFlags::NONE) override;
+  void writev(WriteCallback* callback,
+              const iovec* vec,
+              size_t count,
+              folly::WriteFlags flags = folly::WriteFlags::NONE) override;
+  void writeChain(WriteCallback* callback,
+                  std::unique_ptr<folly::IOBuf>&& buf,
+                  folly::WriteFlags flags = folly::WriteFlags::NONE) override;
+
+  void close() override;
+  void closeNow() override;
+  void shutdownWrite() override;
+  void shutdownWriteNow() override;
+
+  bool isPending() const override;
+  bool isDetachable() const override;
+
+  bool usingIoUring() const {
+    return conn_ != nullptr;
+  }
+
+ protected:
+  ~IoUringSocket() override;
+
+  // Keep to readiness events, for subclasses that make it optional
+  void disableIoUring() {
+    ioUringDisabled_ = true;
+  }
+
+ private:
+  friend class IoUringContext;
+
+  struct RingWrite {
+    WriteCallback* callback;
+    std::unique_ptr<folly::IOBuf> buf;
+    folly::WriteFlags flags;
+  };
+
+  // Move to the ring if it is available and the socket ready for it
+  bool maybeUseRing();
+
+  void startRecv();
+  void stopRecv();
+  void onRecv(const io_uring_cqe& cqe);
+  void deliver(const uint8_t* data, size_t len);
+  void deliverPending();
+
+  void sendQueued();
+  void onSend(const io_uring_cqe& cqe);
+
+  void cancel(IoUringContext::Op op);
+  void failRing(const folly::AsyncSocketException& ex);
+  void closeFd();
+  void failWrites(const folly::AsyncSocketException& ex);
+  void onBytesWritten(size_t bytes);
+  void queueWrite(WriteCallback* callback,
+                  std::unique_ptr<folly::IOBuf> buf,
+                  folly::WriteFlags flags);
+  void onWritesDrained();
+
+  IoUringContext* ctx_{nullptr};
+  std::unique_ptr<IoUringContext::Connection> conn_;
+  ReadCallback* ringReadCallback_{nullptr};
+  // Received while reads were paused
+  folly::IOBufQueue pending_{folly::IOBufQueue::cacheChainLength()};
+  std::deque<RingWrite> ringWrites_;
+  // Bytes of the first write already sent
+  size_t ringWriteOffset_{0};
+  std::unique_ptr<folly::AsyncTimeout> ringSendTimeout_;
+  bool ioUringDisabled_{false};
+  bool multishot_{true};
+  bool recvArmed_{false};
+  bool recvCancelling_{false};
+  bool sendInFlight_{false};
+  bool readEOF_{false};
+  bool closeOnDrain_{false};
+  bool shutdownOnDrain_{false};
+};
+
+} // namespace proxygen
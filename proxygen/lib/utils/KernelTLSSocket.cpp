@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/KernelTLSSocket.h>
+
+#include <folly/io/async/AsyncSSLSocket.h>
+#include <glog/logging.h>
+#include <openssl/bio.h>
+#include <openssl/ssl.h>
+
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+#define PROXYGEN_HAVE_KTLS 1
+#else
+#define PROXYGEN_HAVE_KTLS 0
+#endif
+
+namespace proxygen {
+
+KernelTLSSocket::KernelTLSSocket(folly::EventBase* evb,
+                                 folly::NetworkSocket fd,
+                                 std::string applicationProtocol,
+                                 bool useIoUring)
+    : IoUringSocket(evb, fd),
+      applicationProtocol_(std::move(applicationProtocol)) {
+  if (!useIoUring) {
+    disableIoUring();
+  }
+}
+
+void KernelTLSSocket::enable(folly::SSLContext& ctx) {
+#if PROXYGEN_HAVE_KTLS
+  SSL_CTX_set_options(ctx.getSSLCtx(), SSL_OP_ENABLE_KTLS);
+#else
+  (void)ctx;
+#endif
+}
+
+KernelTLSSocket::UniquePtr KernelTLSSocket::offload(
+    folly::AsyncTransportWrapper& sock, bool useIoUring) {
+#if PROXYGEN_HAVE_KTLS
+  auto sslSock = sock.getUnderlyingTransport<folly::AsyncSSLSocket>();
+  if (!sslSock || !sslSock->good() || sslSock->getPeerCert()) {
+    return nullptr;
+  }
+  auto ssl = const_cast<SSL*>(sslSock->getSSL());
+  if (!ssl) {
+    return nullptr;
+  }
+  if (!BIO_get_ktls_send(SSL_get_wbio(ssl)) ||
+      !BIO_get_ktls_recv(SSL_get_rbio(ssl)) || SSL_has_pending(ssl)) {
+    VLOG(4) << "kTLS unavailable for " << SSL_get_version(ssl) << " "
+            << SSL_get_cipher_name(ssl) << ", staying in userspace";
+    return nullptr;
+  }
+  // The kernel owns the record sequence now; a close_notify from OpenSSL
+  // would corrupt it
+  SSL_set_quiet_shutdown(ssl, 1);
+  auto applicationProtocol = sslSock->getApplicationProtocol();
+  auto evb = sslSock->getEventBase();
+  auto fd = sslSock->detachNetworkSocket();
+  return UniquePtr(new KernelTLSSocket(
+      evb, fd, std::move(applicationProtocol), useIoUring));
+#else
+  (void)sock;
+  (void)useIoUring;
+  return nullptr;
+#endif
+}
+
+} // namespace proxygen
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/async/SSLContext.h>
+#include <proxygen/lib/utils/IoUringSocket.h>
+
+namespace proxygen {
+
+/**
+ * A TLS connection carried on a plain socket once its handshake is done, with
+ * the kernel's TLS ULP (kTLS) encrypting what is written and decrypting what
+ * is read.  Writes skip the userspace encryption and its copy, and the socket
+ * takes any plaintext path, sendfile included.
+ *
+ * Post-handshake TLS messages cannot be read this way, so a KeyUpdate or an
+ * alert from the peer ends the connection with a read error.
+ */
+class KernelTLSSocket : public IoUringSocket {
+ public:
+  using UniquePtr = std::unique_ptr<KernelTLSSocket, Destructor>;
+
+  /**
+   * Have OpenSSL put the keys of handshakes completing on ctx into the kernel,
+   * when it supports kTLS (3.0 and up) and the kernel has the tls module.
+   */
+  static void enable(folly::SSLContext& ctx);
+
+  /**
+   * sock's connection moved to a plain socket, nullptr leaving sock as it was
+   * when that is not possible: sock is not an AsyncSSLSocket with both
+   * directions in the kernel (the cipher is not supported, or OpenSSL before
+   * 3.2 only offloads sending for TLS 1.3), it has decrypted data buffered,
+   * or the peer sent a certificate the socket could not report.
+   */
+  static UniquePtr offload(folly::AsyncTransportWrapper& sock,
+                           bool useIoUring);
+
+  std::string getSecurityProtocol() const override {
+    return "TLS";
+  }
+
+  std::string getApplicationProtocol() const noexcept override {
+    return applicationProtocol_;
+  }
+
+ protected:
+  ~KernelTLSSocket() override = default;
+
+ private:
+  KernelTLSSocket(folly::EventBase* evb,
+                  folly::NetworkSocket fd,
+                  std::string applicationProtocol,
+                  bool useIoUring);
+
+  std::string applicationProtocol_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <proxygen/lib/utils/RingBufferTraceEventObserver.h>
+
+namespace proxygen {
+
+RingBufferTraceEventObserver::RingBufferTraceEventObserver(
+  uint32_t capacityPerThread)
+    : capacity_(capacityPerThread + 1),
+      rings_([this] { return new Ring(*this, capacity_); }) {
+  CHECK_GT(capacityPerThread, 0);
+}
+
+void RingBufferTraceEventObserver::traceEventAvailable(
+  TraceEvent event) noexcept {
+  if (!rings_->write(std::move(event))) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void RingBufferTraceEventObserver::emitTraceEvents(
+  std::vector<TraceEvent> events) noexcept {
+  auto& ring = *rings_;
+  for (auto& event : events) {
+    if (!ring.write(std::move(event))) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+size_t RingBufferTraceEventObserver::drain(
+  const std::function<void(TraceEvent&&)>& sink) {
+  size_t drained = 0;
+  // Holding the accessor serializes drain() callers and thread exit
+  auto accessor = rings_.accessAllThreads();
+  for (auto& ring : accessor) {
+    drained += ring.drain(sink);
+  }
+  std::vector<TraceEvent> orphaned;
+  {
+    std::lock_guard<std::mutex> g(orphanedMutex_);
+    orphaned.swap(orphaned_);
+  }
+  for (auto& event : orphaned) {
+    sink(std::move(event));
+  }
+  return drained + orphaned.size();
+}
+
+RingBufferTraceEventObserver::Ring::~Ring() {
+  std::lock_guard<std::mutex> g(parent_.orphanedMutex_);
+  TraceEvent* event;
+  while ((event = queue_.frontPtr()) != nullptr) {
+    parent_.orphaned_.emplace_back(std::move(*event));
+    queue_.popFront();
+  }
+}
+
+size_t RingBufferTraceEventObserver::Ring::drain(
+  const std::function<void(TraceEvent&&)>& sink) {
+  size_t drained = 0;
+  TraceEvent* event;
+  while ((event = queue_.frontPtr()) != nullptr) {
+    sink(std::move(*event));
+    queue_.popFront();
+    drained++;
+  }
+  return drained;
+}
+
+}
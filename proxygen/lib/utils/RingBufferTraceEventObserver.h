@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/utils/TraceEventObserver.h>
+
+#include <folly/ProducerConsumerQueue.h>
+#include <folly/ThreadLocal.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+namespace proxygen {
+
+/**
+ * TraceEventObserver which buffers events in a fixed size ring per producing
+ * thread.  Recording an event never takes a lock or allocates beyond what
+ * moving the TraceEvent itself costs, so it can be left enabled on hot request
+ * paths.  When a thread's ring is full new events are dropped and counted.
+ *
+ * A single consumer periodically calls drain() to hand the buffered events to
+ * a sink.  Events still buffered by a thread when it exits are kept until the
+ * next drain().
+ */
+class RingBufferTraceEventObserver : public TraceEventObserver {
+ public:
+  static const uint32_t kDefaultCapacity = 4096;
+
+  explicit RingBufferTraceEventObserver(
+      uint32_t capacityPerThread = kDefaultCapacity);
+
+  void traceEventAvailable(TraceEvent event) noexcept override;
+
+  void emitTraceEvents(std::vector<TraceEvent> events) noexcept override;
+
+  /**
+   * Pops every buffered event and passes it to sink.  Returns the number of
+   * events drained.  Safe to call concurrently with producers, but only one
+   * drain() runs at a time.
+   */
+  size_t drain(const std::function<void(TraceEvent&&)>& sink);
+
+  uint64_t getDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  class Ring {
+   public:
+    Ring(RingBufferTraceEventObserver& parent, uint32_t capacity)
+        : parent_(parent), queue_(capacity) {}
+
+    ~Ring();
+
+    bool write(TraceEvent&& event) {
+      return queue_.write(std::move(event));
+    }
+
+    size_t drain(const std::function<void(TraceEvent&&)>& sink);
+
+   private:
+    RingBufferTraceEventObserver& parent_;
+    folly::ProducerConsumerQueue<TraceEvent> queue_;
+  };
+
+  struct RingTag {};
+
+  // ProducerConsumerQueue keeps one slot empty
+  uint32_t capacity_;
+  std::atomic<uint64_t> dropped_{0};
+  // Events left behind by exited threads.  Declared before rings_ so it
+  // outlives the rings flushing into it on destruction.
+  std::mutex orphanedMutex_;
+  std::vector<TraceEvent> orphaned_;
+  folly::ThreadLocal<Ring, RingTag> rings_;
+};
+
+}
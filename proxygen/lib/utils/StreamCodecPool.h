@@ -0,0 +1,162 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <proxygen/lib/utils/StreamCompressor.h>
+#include <proxygen/lib/utils/StreamDecompressor.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace proxygen {
+
+struct StreamCodecPoolStats {
+  // Contexts created because the pool was empty
+  uint64_t created{0};
+  // Contexts reset and handed out again
+  uint64_t reused{0};
+  // Returned contexts dropped because they failed to reset or the pool was
+  // full
+  uint64_t discarded{0};
+  // Contexts currently waiting in the pool
+  uint64_t idle{0};
+};
+
+/**
+ * Pool of compression contexts, all created by the same factory with the
+ * same parameters.  Creating a zlib or zstd context allocates and clears
+ * hundreds of KB of state; a context returned to the pool is reset in place
+ * (deflateReset, inflateReset, ZSTD_DCtx_reset) and handed out again instead.
+ *
+ * Codec must provide `bool reset()`, returning false if the context can not
+ * be reused.  A pool is not thread safe: keep one per worker thread.
+ */
+template <typename Codec>
+class StreamCodecPool {
+ public:
+  using Factory = std::function<std::unique_ptr<Codec>()>;
+
+  StreamCodecPool(Factory factory, size_t maxIdle)
+      : factory_(std::move(factory)), maxIdle_(maxIdle) {
+  }
+
+  /**
+   * A fresh context, reused from the pool when one is idle
+   */
+  std::unique_ptr<Codec> take() {
+    if (!idle_.empty()) {
+      auto codec = std::move(idle_.back());
+      idle_.pop_back();
+      stats_.idle--;
+      stats_.reused++;
+      return codec;
+    }
+    stats_.created++;
+    return factory_();
+  }
+
+  /**
+   * Return a context taken from this pool, in whatever state it was left
+   */
+  void give(std::unique_ptr<Codec> codec) {
+    if (!codec) {
+      return;
+    }
+    if (idle_.size() >= maxIdle_ || !codec->reset()) {
+      stats_.discarded++;
+      return;
+    }
+    idle_.push_back(std::move(codec));
+    stats_.idle++;
+  }
+
+  const StreamCodecPoolStats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  Factory factory_;
+  const size_t maxIdle_;
+  std::vector<std::unique_ptr<Codec>> idle_;
+  StreamCodecPoolStats stats_;
+};
+
+/**
+ * A StreamCompressor borrowed from a pool and given back when destroyed
+ */
+template <typename Codec>
+class PooledStreamCompressor : public StreamCompressor {
+ public:
+  explicit PooledStreamCompressor(std::shared_ptr<StreamCodecPool<Codec>> pool)
+      : pool_(std::move(pool)), codec_(pool_->take()) {
+  }
+
+  ~PooledStreamCompressor() override {
+    pool_->give(std::move(codec_));
+  }
+
+  std::unique_ptr<folly::IOBuf> compress(const folly::IOBuf* in,
+                                         bool trailer = true) override {
+    return codec_->compress(in, trailer);
+  }
+
+  bool hasError() override {
+    return !codec_ || codec_->hasError();
+  }
+
+ private:
+  std::shared_ptr<StreamCodecPool<Codec>> pool_;
+  std::unique_ptr<Codec> codec_;
+};
+
+/**
+ * A StreamDecompressor borrowed from a pool and given back when destroyed
+ */
+template <typename Codec>
+class PooledStreamDecompressor : public StreamDecompressor {
+ public:
+  explicit PooledStreamDecompressor(
+      std::shared_ptr<StreamCodecPool<Codec>> pool)
+      : pool_(std::move(pool)), codec_(pool_->take()) {
+  }
+
+  ~PooledStreamDecompressor() override {
+    pool_->give(std::move(codec_));
+  }
+
+  std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) override {
+    return codec_->decompress(in);
+  }
+
+  bool hasError() override {
+    return !codec_ || codec_->hasError();
+  }
+
+  bool finished() override {
+    return codec_ && codec_->finished();
+  }
+
+  void setOutputLimit(uint64_t limit) override {
+    if (codec_) {
+      codec_->setOutputLimit(limit);
+    }
+  }
+
+  bool outputLimitExceeded() override {
+    return codec_ && codec_->outputLimitExceeded();
+  }
+
+ private:
+  std::shared_ptr<StreamCodecPool<Codec>> pool_;
+  std::unique_ptr<Codec> codec_;
+};
+
+} // namespace proxygen
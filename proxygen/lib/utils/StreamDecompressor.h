@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
 namespace folly {
@@ -28,5 +29,14 @@ class StreamDecompressor {
   virtual std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) = 0;
   virtual bool hasError() = 0;
   virtual bool finished() = 0;
+
+  /**
+   * Make each later decompress() call fail once it has produced more than
+   * limit bytes, so a small input can not expand into unbounded memory.  The
+   * output of a failed call is dropped; outputLimitExceeded() then tells the
+   * failure apart from corrupt input.
+   */
+  virtual void setOutputLimit(uint64_t limit) = 0;
+  virtual bool outputLimitExceeded() = 0;
 };
 } // namespace proxygen
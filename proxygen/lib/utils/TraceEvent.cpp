@@ -69,15 +69,35 @@ bool TraceEvent::readBoolMeta(TraceFieldType key, bool& dest) const {
 bool TraceEvent::readStrMeta(TraceFieldType key, std::string& dest) const {
   return readMeta(key, dest);
 }
+
 bool TraceEvent::addMetaInternal(TraceFieldType key, MetaData&& value) {
-  auto rc = metaData_.emplace(key, value);
+  auto& slot = metaDataIndex_[static_cast<size_t>(key)];
 
   // replace if key already exist
-  if (!rc.second) {
-    rc.first->second = value;
+  if (slot != 0) {
+    metaData_[slot - 1].second = std::move(value);
+    return false;
   }
 
-  return rc.second;
+  metaData_.emplace_back(key, std::move(value));
+  slot = metaData_.size();
+  return true;
+}
+
+void TraceEvent::setMetaData(MetaDataMap&& input) {
+  metaData_.clear();
+  metaDataIndex_.fill(0);
+  for (auto& entry : input) {
+    addMetaInternal(entry.first, std::move(entry.second));
+  }
+}
+
+TraceEvent::MetaDataMap TraceEvent::getMetaData() const {
+  MetaDataMap result;
+  for (const auto& entry : metaData_) {
+    result.emplace(entry.first, entry.second);
+  }
+  return result;
 }
 
 std::string TraceEvent::toString() const {
@@ -20,7 +20,9 @@
 
 #include <folly/Conv.h>
 #include <folly/lang/Exception.h>
+#include <folly/small_vector.h>
 
+#include <array>
 #include <map>
 #include <string>
 #include <vector>
@@ -100,6 +102,13 @@ class TraceEvent {
 
   using MetaDataMap = std::map<TraceFieldType, MetaData>;
 
+  // Most events carry a handful of fields, keep that many inline so adding
+  // metadata does not allocate.
+  static constexpr size_t kInlineMetaData = 8;
+  using MetaDataEntry = std::pair<TraceFieldType, MetaData>;
+  using MetaDataVec = folly::small_vector<MetaDataEntry, kInlineMetaData>;
+
+  // Walks the fields in the order they were first added.
   class Iterator {
    public:
     explicit Iterator(const TraceEvent& event) :
@@ -132,7 +141,7 @@ class TraceEvent {
 
     private:
      const TraceEvent& event_;
-     MetaDataMap::const_iterator itr_;
+     MetaDataVec::const_iterator itr_;
 
   };
 
@@ -194,23 +203,23 @@ class TraceEvent {
   }
 
   bool hasTraceField(TraceFieldType field) const {
-    return metaData_.count(field);
+    return findMeta(field) != nullptr;
   }
 
   template<typename T>
   T getTraceFieldDataAs(TraceFieldType field) const {
-    const auto itr = metaData_.find(field);
-    CHECK(itr != metaData_.end());
-    return itr->second.getValueAs<T>();
+    const auto meta = findMeta(field);
+    CHECK(meta != nullptr);
+    return meta->getValueAs<T>();
   }
 
-  void setMetaData(MetaDataMap&& input) {
-    metaData_ = input;
-  }
+  FB_EXPORT void setMetaData(MetaDataMap&& input);
 
-  const MetaDataMap& getMetaData() const {
-    return metaData_;
-  }
+  /**
+   * Builds a map of all the fields.  Prefer getMetaDataItr(), which does not
+   * copy.
+   */
+  FB_EXPORT MetaDataMap getMetaData() const;
 
   Iterator getMetaDataItr() const {
     return Iterator(*this);
@@ -247,13 +256,18 @@ class TraceEvent {
   friend class Iterator;
 
  private:
+  const MetaData* findMeta(TraceFieldType key) const {
+    auto slot = metaDataIndex_[static_cast<size_t>(key)];
+    return slot == 0 ? nullptr : &metaData_[slot - 1].second;
+  }
+
   template<typename T>
   bool readMeta(TraceFieldType key, T& dest) const {
-    const auto itr = metaData_.find(key);
-    if (itr != metaData_.end()) {
+    const auto meta = findMeta(key);
+    if (meta != nullptr) {
       return folly::catch_exception<std::exception const&>(
           [&]() -> bool {
-            dest = itr->second.getValueAs<T>();
+            dest = meta->getValueAs<T>();
             return true;
           },
           [](auto&&) -> bool {
@@ -277,7 +291,12 @@ class TraceEvent {
   uint32_t parentID_;
   TimePoint start_;
   TimePoint end_;
-  MetaDataMap metaData_;
+  // Fields in insertion order, and for each TraceFieldType its 1-based slot
+  // in metaData_ (0 when absent).
+  MetaDataVec metaData_;
+  std::array<uint8_t, kNumTraceFieldTypes> metaDataIndex_{};
+  static_assert(kNumTraceFieldTypes < 256,
+                "metaDataIndex_ slots must fit in a uint8_t");
 
 };
 
@@ -105,6 +105,18 @@ ZlibStreamCompressor::~ZlibStreamCompressor() {
   }
 }
 
+bool ZlibStreamCompressor::reset() {
+  if (type_ == CompressionType::NONE) {
+    return false;
+  }
+  status_ = deflateReset(&zlibStream_);
+  zlibStream_.next_in = Z_NULL;
+  zlibStream_.avail_in = 0;
+  zlibStream_.next_out = Z_NULL;
+  zlibStream_.avail_out = 0;
+  return status_ == Z_OK;
+}
+
 // Compress an IOBuf chain. Compress can be called multiple times and the
 // Zlib stream will be synced after each call. trailer must be set to
 // true on the final compression call.
@@ -31,6 +31,12 @@ class ZlibStreamCompressor : public StreamCompressor {
 
   void init(CompressionType type, int level);
 
+  /**
+   * Start a new stream with the same type and level, keeping the allocated
+   * state.  Returns false if the stream could not be reset.
+   */
+  bool reset();
+
   std::unique_ptr<folly::IOBuf> compress(const folly::IOBuf* in,
                                          bool trailer = true) override;
 
@@ -52,12 +52,27 @@ ZlibStreamDecompressor::~ZlibStreamDecompressor() {
   }
 }
 
+bool ZlibStreamDecompressor::reset() {
+  if (type_ == CompressionType::NONE) {
+    return false;
+  }
+  status_ = inflateReset(&zlibStream_);
+  zlibStream_.next_in = Z_NULL;
+  zlibStream_.avail_in = 0;
+  zlibStream_.next_out = Z_NULL;
+  zlibStream_.avail_out = 0;
+  outputLimit_ = std::numeric_limits<uint64_t>::max();
+  outputLimitExceeded_ = false;
+  return status_ == Z_OK;
+}
+
 std::unique_ptr<IOBuf> ZlibStreamDecompressor::decompress(const IOBuf* in) {
   auto out = IOBuf::create(decompressor_buffer_growth_);
   auto appender = folly::io::Appender(out.get(), decompressor_buffer_growth_);
 
   const IOBuf* crtBuf = in;
   size_t offset = 0;
+  uint64_t produced = 0;
   while (true) {
     // Advance to the next IOBuf if necessary
     DCHECK_GE(crtBuf->length(), offset);
@@ -100,6 +115,14 @@ std::unique_ptr<IOBuf> ZlibStreamDecompressor::decompress(const IOBuf* in) {
     // Move output buffer ahead
     auto outMove = appender.length() - zlibStream_.avail_out;
     appender.append(outMove);
+    produced += outMove;
+    if (produced > outputLimit_) {
+      status_ = Z_BUF_ERROR;
+      outputLimitExceeded_ = true;
+      VLOG(4) << "error uncompressing buffer: output exceeds " << outputLimit_
+              << " bytes";
+      return nullptr;
+    }
   }
 
   return out;
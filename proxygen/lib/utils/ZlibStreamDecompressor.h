@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <limits>
 #include <memory>
 #include <proxygen/lib/utils/StreamDecompressor.h>
 #include <zlib.h>
@@ -46,6 +47,12 @@ class ZlibStreamDecompressor : public StreamDecompressor {
 
   void init(CompressionType type);
 
+  /**
+   * Start a new stream of the same type, keeping the allocated state.
+   * Returns false if the stream could not be reset.
+   */
+  bool reset();
+
   std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) override;
 
   int getStatus() {
@@ -60,6 +67,14 @@ class ZlibStreamDecompressor : public StreamDecompressor {
     return status_ == Z_STREAM_END;
   }
 
+  void setOutputLimit(uint64_t limit) override {
+    outputLimit_ = limit;
+  }
+
+  bool outputLimitExceeded() override {
+    return outputLimitExceeded_;
+  }
+
  private:
   CompressionType type_{CompressionType::NONE};
   uint64_t decompressor_buffer_growth_{kZlibDecompressorBufferGrowthDefault};
@@ -67,5 +82,7 @@ class ZlibStreamDecompressor : public StreamDecompressor {
       kZlibDecompressorBufferMinsizeDefault};
   z_stream zlibStream_;
   int status_{-1};
+  uint64_t outputLimit_{std::numeric_limits<uint64_t>::max()};
+  bool outputLimitExceeded_{false};
 };
 } // namespace proxygen
@@ -24,6 +24,18 @@ ZstdStreamDecompressor::ZstdStreamDecompressor()
     : status_(ZstdStatusType::NONE), dctx_(ZSTD_createDCtx()) {
 }
 
+bool ZstdStreamDecompressor::reset() {
+  if (!dctx_ ||
+      ZSTD_isError(ZSTD_DCtx_reset(dctx_.get(), ZSTD_reset_session_only))) {
+    status_ = ZstdStatusType::ERROR;
+    return false;
+  }
+  status_ = ZstdStatusType::NONE;
+  outputLimit_ = std::numeric_limits<uint64_t>::max();
+  outputLimitExceeded_ = false;
+  return true;
+}
+
 std::unique_ptr<folly::IOBuf> ZstdStreamDecompressor::decompress(
     const folly::IOBuf* in) {
   if (!dctx_) {
@@ -37,6 +49,7 @@ std::unique_ptr<folly::IOBuf> ZstdStreamDecompressor::decompress(
 
   auto out = folly::IOBuf::create(outBufAllocSize);
   auto appender = folly::io::Appender(out.get(), outBufAllocSize);
+  uint64_t produced = 0;
 
   for (const folly::ByteRange range : *in) {
     if (range.data() == nullptr) {
@@ -59,6 +72,12 @@ std::unique_ptr<folly::IOBuf> ZstdStreamDecompressor::decompress(
       }
 
       appender.append(obuf.pos);
+      produced += obuf.pos;
+      if (produced > outputLimit_) {
+        status_ = ZstdStatusType::ERROR;
+        outputLimitExceeded_ = true;
+        return nullptr;
+      }
     }
   }
 
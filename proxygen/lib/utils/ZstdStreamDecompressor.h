@@ -17,6 +17,7 @@
 #define ZDICT_STATIC_LINKING_ONLY
 #endif
 
+#include <limits>
 #include <memory>
 #include <zdict.h>
 #include <zstd.h>
@@ -35,6 +36,12 @@ class ZstdStreamDecompressor : public StreamDecompressor {
  public:
   explicit ZstdStreamDecompressor();
 
+  /**
+   * Start a new stream, keeping the allocated context.  Returns false if the
+   * context could not be reset.
+   */
+  bool reset();
+
   // May return nullptr on error / no output.
   std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) override;
 
@@ -50,12 +57,22 @@ class ZstdStreamDecompressor : public StreamDecompressor {
     return status_ == ZstdStatusType::FINISHED;
   }
 
+  void setOutputLimit(uint64_t limit) override {
+    outputLimit_ = limit;
+  }
+
+  bool outputLimitExceeded() override {
+    return outputLimitExceeded_;
+  }
+
  private:
   static void freeDCtx(ZSTD_DCtx* dctx);
 
   enum class ZstdStatusType : int { NONE, CONTINUE, ERROR, FINISHED };
 
   ZstdStatusType status_;
+  uint64_t outputLimit_{std::numeric_limits<uint64_t>::max()};
+  bool outputLimitExceeded_{false};
 
   const std::unique_ptr<ZSTD_DCtx,
                         folly::static_function_deleter<ZSTD_DCtx, freeDCtx>>
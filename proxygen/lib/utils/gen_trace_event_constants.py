@@ -140,6 +140,7 @@ def gen_cpp_header(items, class_name, install_dir, output_scope):
         outf.write("// Copyright 2015-present Facebook. All Rights Reserved.\n")
         outf.write("// ** AUTOGENERATED FILE. DO NOT HAND-EDIT **\n\n")
         outf.write("#pragma once\n\n")
+        outf.write("#include <cstddef>\n")
         outf.write("#include <string>\n\n")
         for ns in namespaces:
             outf.write("namespace %s { " % ns)
@@ -151,6 +152,11 @@ def gen_cpp_header(items, class_name, install_dir, output_scope):
             outf.write("    %s,\n" % item[0])
         outf.write("};\n\n")
 
+        # number of enum values, for tables indexed by the enum
+        outf.write(
+            "constexpr size_t kNum%ss = %d;\n\n" % (class_name, len(items))
+        )
+
         # enum to string convert function
         outf.write(
             "extern const std::string& get%sString(%s);\n" % (class_name, class_name)
@@ -0,0 +1,107 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/ScopeGuard.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/FreeList.h>
+
+#include <map>
+
+using namespace proxygen;
+
+namespace {
+
+struct Widget : public FreeListAllocated<Widget> {
+  explicit Widget(int v) : value(v) {
+  }
+  virtual ~Widget() {
+  }
+  int value;
+  char padding[40];
+};
+
+struct BigWidget : public Widget {
+  BigWidget() : Widget(1) {
+  }
+  char morePadding[40];
+};
+
+using WidgetList = ThreadLocalFreeList<sizeof(Widget)>;
+
+}
+
+class FreeListTest : public testing::Test {
+ public:
+  void SetUp() override {
+    WidgetList::reset();
+  }
+
+  void TearDown() override {
+    FreeLists::setMaxFreeBlocks(FreeLists::kDefaultMaxFreeBlocks);
+    WidgetList::reset();
+  }
+};
+
+TEST_F(FreeListTest, Recycle) {
+  auto w = new Widget(1);
+  auto raw = static_cast<void*>(w);
+  delete w;
+  EXPECT_EQ(Widget::getFreeListStats().free, 1);
+
+  w = new Widget(2);
+  EXPECT_EQ(static_cast<void*>(w), raw);
+  EXPECT_EQ(w->value, 2);
+  delete w;
+
+  auto stats = Widget::getFreeListStats();
+  EXPECT_EQ(stats.allocated, 1);
+  EXPECT_EQ(stats.reused, 1);
+  EXPECT_EQ(stats.free, 1);
+}
+
+TEST_F(FreeListTest, LargerSubclass) {
+  // Deleted through the base, the size of the subclass still routes it
+  Widget* w = new BigWidget();
+  delete w;
+  auto stats = Widget::getFreeListStats();
+  EXPECT_EQ(stats.allocated, 0);
+  EXPECT_EQ(stats.free, 0);
+}
+
+TEST_F(FreeListTest, MaxFreeBlocks) {
+  FreeLists::setMaxFreeBlocks(1);
+  auto w1 = new Widget(1);
+  auto w2 = new Widget(2);
+  delete w1;
+  delete w2;
+  EXPECT_EQ(Widget::getFreeListStats().free, 1);
+
+  FreeLists::setMaxFreeBlocks(0);
+  WidgetList::reset();
+  delete new Widget(3);
+  delete new Widget(4);
+  auto stats = Widget::getFreeListStats();
+  EXPECT_EQ(stats.allocated, 2);
+  EXPECT_EQ(stats.reused, 0);
+  EXPECT_EQ(stats.free, 0);
+}
+
+TEST_F(FreeListTest, MapNodes) {
+  std::map<int,
+           Widget,
+           std::less<int>,
+           FreeListAllocator<std::pair<const int, Widget>>>
+      widgets;
+  widgets.emplace(1, 1);
+  auto node = &widgets.begin()->second;
+  widgets.clear();
+  widgets.emplace(2, 2);
+  EXPECT_EQ(&widgets.begin()->second, node);
+  EXPECT_EQ(widgets.begin()->second.value, 2);
+}
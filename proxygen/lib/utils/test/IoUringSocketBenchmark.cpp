@@ -0,0 +1,271 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ *
+ *  Compares the server side cost of AsyncSocket and IoUringSocket at the same
+ *  request rate.  A client thread sends fixed size requests over loopback on
+ *  a fixed schedule, and a server thread answers each with a fixed size
+ *  response, through one socket type or the other.  Reported per request:
+ *  the server thread's CPU time and the system calls it made, e.g.:
+ *
+ *    IoUringSocketBenchmark --connections=64 --rate=50000 --duration=10
+ *
+ *  Counting system calls uses the raw_syscalls:sys_enter tracepoint, which
+ *  needs tracefs and perf_event_paranoid allowing it.
+ *
+ */
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/IoUringSocket.h>
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace folly;
+using namespace proxygen;
+
+DEFINE_int32(connections, 64, "Client connections");
+DEFINE_int32(rate, 20000, "Requests per second over all connections");
+DEFINE_int32(duration, 5, "Seconds to send requests for, per socket type");
+DEFINE_int32(request_size, 200, "Bytes per request");
+DEFINE_int32(response_size, 1000, "Bytes per response");
+
+namespace {
+
+struct ServerStats {
+  uint64_t requests{0};
+  std::chrono::microseconds cpu{0};
+  // -1 when they could not be counted
+  int64_t syscalls{-1};
+  uint64_t ringEnters{0};
+};
+
+// Answers every request_size bytes read with response_size bytes
+class Responder : public AsyncTransportWrapper::ReadCallback {
+ public:
+  Responder(AsyncSocket::UniquePtr socket, uint64_t& requests)
+      : socket_(std::move(socket)), requests_(requests) {
+    socket_->setReadCB(this);
+  }
+
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+    *bufReturn = buf_;
+    *lenReturn = sizeof(buf_);
+  }
+
+  void readDataAvailable(size_t len) noexcept override {
+    received_ += len;
+    while (received_ >= size_t(FLAGS_request_size)) {
+      received_ -= FLAGS_request_size;
+      requests_++;
+      socket_->writeChain(nullptr, IOBuf::copyBuffer(response()));
+    }
+  }
+
+  void readEOF() noexcept override {
+    socket_->close();
+  }
+
+  void readErr(const AsyncSocketException&) noexcept override {
+    socket_->closeNow();
+  }
+
+ private:
+  static const std::string& response() {
+    static const std::string response(FLAGS_response_size, 'r');
+    return response;
+  }
+
+  AsyncSocket::UniquePtr socket_;
+  uint64_t& requests_;
+  size_t received_{0};
+  char buf_[16 * 1024];
+};
+
+int openSyscallCounter() {
+  std::ifstream idFile(
+      "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id");
+  if (!idFile) {
+    idFile.open("/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id");
+  }
+  uint64_t id;
+  if (!(idFile >> id)) {
+    return -1;
+  }
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_TRACEPOINT;
+  attr.size = sizeof(attr);
+  attr.config = id;
+  attr.disabled = 1;
+  // This thread only
+  return int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+std::chrono::microseconds getThreadCpu() {
+  rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         std::chrono::microseconds(usage.ru_utime.tv_usec +
+                                   usage.ru_stime.tv_usec);
+}
+
+int makeListener(uint16_t& port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  CHECK_EQ(bind(fd, reinterpret_cast<sockaddr*>(&addr), len), 0);
+  CHECK_EQ(listen(fd, 1024), 0);
+  CHECK_EQ(getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+  port = ntohs(addr.sin_port);
+  return fd;
+}
+
+std::vector<int> connectClients(uint16_t port) {
+  std::vector<int> fds;
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  for (int i = 0; i < FLAGS_connections; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK_EQ(
+        connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fds.push_back(fd);
+  }
+  return fds;
+}
+
+// Sends one request per connection every connections / rate seconds, and
+// reads the responses before the next round
+void runClient(const std::vector<int>& fds) {
+  std::string request(FLAGS_request_size, 'q');
+  std::vector<char> response(FLAGS_response_size);
+  auto interval = std::chrono::nanoseconds(
+      uint64_t(1e9 * FLAGS_connections / FLAGS_rate));
+  auto end = std::chrono::steady_clock::now() +
+             std::chrono::seconds(FLAGS_duration);
+  for (auto due = std::chrono::steady_clock::now(); due < end;
+       due += interval) {
+    std::this_thread::sleep_until(due);
+    for (auto fd : fds) {
+      CHECK_EQ(::write(fd, request.data(), request.size()),
+               ssize_t(request.size()));
+    }
+    for (auto fd : fds) {
+      size_t read = 0;
+      while (read < response.size()) {
+        auto n = ::read(fd, response.data(), response.size() - read);
+        CHECK_GT(n, 0);
+        read += n;
+      }
+    }
+  }
+  for (auto fd : fds) {
+    ::close(fd);
+  }
+}
+
+ServerStats runServer(bool useIoUring) {
+  uint16_t port;
+  int listener = makeListener(port);
+  auto clients = connectClients(port);
+
+  ServerStats stats;
+  std::thread server([&] {
+    EventBase evb;
+    std::vector<std::unique_ptr<Responder>> responders;
+    for (int i = 0; i < FLAGS_connections; i++) {
+      auto fd = NetworkSocket::fromFd(accept(listener, nullptr, nullptr));
+      AsyncSocket::UniquePtr socket(useIoUring ? new IoUringSocket(&evb, fd)
+                                               : new AsyncSocket(&evb, fd));
+      socket->setNoDelay(true);
+      responders.push_back(
+          std::make_unique<Responder>(std::move(socket), stats.requests));
+    }
+    int counter = openSyscallCounter();
+    if (counter >= 0) {
+      ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    auto cpuStart = getThreadCpu();
+    // Runs until every client has closed
+    evb.loop();
+    stats.cpu = getThreadCpu() - cpuStart;
+    if (counter >= 0) {
+      ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+      uint64_t count;
+      if (::read(counter, &count, sizeof(count)) == sizeof(count)) {
+        stats.syscalls = int64_t(count);
+      }
+      ::close(counter);
+    }
+    if (auto ctx = IoUringContext::get(&evb)) {
+      stats.ringEnters = ctx->getRing().getStats().enters;
+    }
+    responders.clear();
+  });
+  runClient(clients);
+  server.join();
+  ::close(listener);
+  return stats;
+}
+
+void printStats(const std::string& name, const ServerStats& stats) {
+  double requests = std::max<uint64_t>(stats.requests, 1);
+  std::cout << name << ": " << stats.requests << " requests, "
+            << stats.cpu.count() / requests << " usecs CPU/request, ";
+  if (stats.syscalls >= 0) {
+    std::cout << stats.syscalls / requests << " syscalls/request";
+  } else {
+    std::cout << "syscalls not counted (no raw_syscalls tracepoint access)";
+  }
+  if (stats.ringEnters > 0) {
+    std::cout << ", " << stats.ringEnters / requests
+              << " io_uring_enter/request";
+  }
+  std::cout << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  {
+    EventBase evb;
+    if (!IoUringContext::get(&evb)) {
+      LOG(ERROR) << "io_uring is not supported here";
+      return EXIT_FAILURE;
+    }
+  }
+  std::cout << FLAGS_connections << " connections, " << FLAGS_rate
+            << " requests/s, " << FLAGS_request_size << "B requests, "
+            << FLAGS_response_size << "B responses" << std::endl;
+  printStats("AsyncSocket", runServer(false));
+  printStats("IoUringSocket", runServer(true));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/IoUringSocket.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace folly;
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+class ReadCallback : public AsyncTransportWrapper::ReadCallback {
+ public:
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+    // Small, so one receive takes several reads
+    *bufReturn = buf_;
+    *lenReturn = sizeof(buf_);
+  }
+
+  void readDataAvailable(size_t len) noexcept override {
+    data.append(buf_, len);
+    if (onData) {
+      onData();
+    }
+  }
+
+  void readEOF() noexcept override {
+    eof = true;
+  }
+
+  void readErr(const AsyncSocketException&) noexcept override {
+    error = true;
+  }
+
+  std::string data;
+  bool eof{false};
+  bool error{false};
+  std::function<void()> onData;
+
+ private:
+  char buf_[7];
+};
+
+class WriteCallback : public AsyncTransportWrapper::WriteCallback {
+ public:
+  void writeSuccess() noexcept override {
+    successes++;
+  }
+
+  void writeErr(size_t, const AsyncSocketException&) noexcept override {
+    errors++;
+  }
+
+  size_t successes{0};
+  size_t errors{0};
+};
+
+class IoUringSocketTest : public Test {
+ public:
+  void SetUp() override {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    socket_.reset(new IoUringSocket(&evb_, NetworkSocket::fromFd(fds[0])));
+    peer_ = fds[1];
+    supported_ = IoUringContext::get(&evb_) != nullptr;
+  }
+
+  void TearDown() override {
+    socket_.reset();
+    if (peer_ >= 0) {
+      ::close(peer_);
+    }
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+  }
+
+  std::string readPeer(size_t len) {
+    std::string result;
+    while (result.size() < len) {
+      char buf[4096];
+      auto n = ::read(peer_, buf, sizeof(buf));
+      if (n <= 0) {
+        evb_.loopOnce(EVLOOP_NONBLOCK);
+        continue;
+      }
+      result.append(buf, n);
+    }
+    return result;
+  }
+
+  EventBase evb_;
+  IoUringSocket::UniquePtr socket_;
+  int peer_{-1};
+  bool supported_{false};
+};
+
+}
+
+TEST_F(IoUringSocketTest, ReadAndWrite) {
+  ReadCallback readCb;
+  WriteCallback writeCb;
+  socket_->setReadCB(&readCb);
+  EXPECT_EQ(socket_->usingIoUring(), supported_);
+
+  std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  ASSERT_EQ(::write(peer_, request.data(), request.size()),
+            ssize_t(request.size()));
+  while (readCb.data.size() < request.size()) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(readCb.data, request);
+  EXPECT_EQ(socket_->getAppBytesReceived(), request.size());
+
+  // Queued in one loop iteration, sent together
+  socket_->write(&writeCb, "HTTP/1.1 200 OK\r\n", 17);
+  socket_->writeChain(&writeCb, IOBuf::copyBuffer("Content-Length: 0\r\n"));
+  socket_->writeChain(&writeCb, IOBuf::copyBuffer("\r\n"));
+  while (writeCb.successes < 3) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(readPeer(38), "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+  EXPECT_EQ(writeCb.errors, 0);
+}
+
+TEST_F(IoUringSocketTest, PauseAndResume) {
+  ReadCallback readCb;
+  socket_->setReadCB(&readCb);
+  ASSERT_EQ(::write(peer_, "abc", 3), 3);
+  while (readCb.data.size() < 3) {
+    evb_.loopOnce();
+  }
+
+  socket_->setReadCB(nullptr);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_EQ(::write(peer_, "defgh", 5), 5);
+  for (int i = 0; i < 10; i++) {
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+  }
+  EXPECT_EQ(readCb.data, "abc");
+
+  socket_->setReadCB(&readCb);
+  while (readCb.data.size() < 8) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(readCb.data, "abcdefgh");
+}
+
+TEST_F(IoUringSocketTest, ReadEOF) {
+  ReadCallback readCb;
+  socket_->setReadCB(&readCb);
+  ASSERT_EQ(::write(peer_, "bye", 3), 3);
+  ::close(peer_);
+  peer_ = -1;
+  while (!readCb.eof) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(readCb.data, "bye");
+  EXPECT_FALSE(readCb.error);
+  EXPECT_EQ(socket_->getReadCallback(), nullptr);
+}
+
+TEST_F(IoUringSocketTest, CloseFromReadCallback) {
+  ReadCallback readCb;
+  readCb.onData = [this] { socket_->closeNow(); };
+  socket_->setReadCB(&readCb);
+  ASSERT_EQ(::write(peer_, "x", 1), 1);
+  while (readCb.data.empty()) {
+    evb_.loopOnce();
+  }
+  EXPECT_TRUE(readCb.eof);
+  EXPECT_FALSE(socket_->good());
+  // The cancelled receive completes after the close
+  socket_.reset();
+  evb_.loop();
+}
+
+TEST_F(IoUringSocketTest, CloseRightAfterStartingRead) {
+  // The receive setReadCB queues has not been submitted yet
+  ReadCallback readCb;
+  socket_->setReadCB(&readCb);
+  socket_->closeNow();
+  EXPECT_TRUE(readCb.eof);
+  if (supported_) {
+    EXPECT_EQ(
+        IoUringContext::get(&evb_)->getRing().getQueuedSubmissions(), 0);
+  }
+
+  // Likely takes the closed socket's number; its data is not for the old
+  // receive
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  ASSERT_EQ(::write(fds[1], "new", 3), 3);
+  evb_.loop();
+  char buf[8];
+  EXPECT_EQ(::read(fds[0], buf, sizeof(buf)), 3);
+  EXPECT_EQ(readCb.data, "");
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
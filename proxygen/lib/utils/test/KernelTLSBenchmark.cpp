@@ -0,0 +1,211 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ *
+ *  Measures the server side CPU cost of a TLS download with OpenSSL
+ *  encrypting in userspace, and with the records handed to the kernel after
+ *  the handshake through KernelTLSSocket.  A client thread reads over
+ *  loopback as fast as it can; reported is the server thread's CPU time per
+ *  GB sent, e.g.:
+ *
+ *    KernelTLSBenchmark --cert=cert.pem --key=key.pem --size_mb=4096
+ *
+ *  The kTLS run needs OpenSSL 3.0 built with kTLS and the kernel's tls
+ *  module (modprobe tls), and is skipped otherwise.
+ *
+ */
+#include <folly/io/async/AsyncSSLSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/SSLContext.h>
+#include <folly/portability/GFlags.h>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/KernelTLSSocket.h>
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <openssl/ssl.h>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace folly;
+using namespace proxygen;
+
+DEFINE_string(cert, "", "Server certificate, PEM");
+DEFINE_string(key, "", "Server private key, PEM");
+DEFINE_int32(size_mb, 2048, "MB to send per run");
+DEFINE_int32(chunk_kb, 64, "KB per write");
+DEFINE_bool(tls13, false, "Negotiate TLS 1.3 instead of TLS 1.2");
+
+namespace {
+
+std::chrono::microseconds getThreadCpu() {
+  rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         std::chrono::microseconds(usage.ru_utime.tv_usec +
+                                   usage.ru_stime.tv_usec);
+}
+
+// Sends size_mb once the handshake is done, one chunk per write
+class Sender
+    : public AsyncSSLSocket::HandshakeCB
+    , public AsyncTransportWrapper::WriteCallback {
+ public:
+  Sender(AsyncSSLSocket::UniquePtr socket, bool offload)
+      : offload_(offload), chunk_(size_t(FLAGS_chunk_kb) * 1024, 'd') {
+    auto sslSocket = socket.get();
+    transport_ = std::move(socket);
+    sslSocket->sslAccept(this);
+  }
+
+  void handshakeSuc(AsyncSSLSocket*) noexcept override {
+    if (offload_) {
+      auto offloaded = KernelTLSSocket::offload(*transport_, false);
+      if (!offloaded) {
+        transport_->closeNow();
+        return;
+      }
+      transport_ = std::move(offloaded);
+      offloaded_ = true;
+    }
+    cpuStart_ = getThreadCpu();
+    remaining_ = uint64_t(FLAGS_size_mb) * 1024 * 1024;
+    sendNext();
+  }
+
+  void handshakeErr(AsyncSSLSocket*,
+                    const AsyncSocketException& ex) noexcept override {
+    LOG(ERROR) << "Handshake failed: " << ex.what();
+  }
+
+  void writeSuccess() noexcept override {
+    if (remaining_ > 0) {
+      sendNext();
+    } else {
+      cpu = getThreadCpu() - cpuStart_;
+      transport_->close();
+    }
+  }
+
+  void writeErr(size_t, const AsyncSocketException& ex) noexcept override {
+    LOG(ERROR) << "Write failed: " << ex.what();
+  }
+
+  bool offloaded() const {
+    return offloaded_;
+  }
+
+  std::chrono::microseconds cpu{0};
+
+ private:
+  void sendNext() {
+    auto bytes = std::min<uint64_t>(remaining_, chunk_.size());
+    remaining_ -= bytes;
+    transport_->write(this, chunk_.data(), bytes);
+  }
+
+  AsyncTransportWrapper::UniquePtr transport_;
+  bool offload_;
+  bool offloaded_{false};
+  std::string chunk_;
+  uint64_t remaining_{0};
+  std::chrono::microseconds cpuStart_{0};
+};
+
+void runClient(uint16_t port) {
+  auto ctx = SSL_CTX_new(TLS_client_method());
+  auto version = FLAGS_tls13 ? TLS1_3_VERSION : TLS1_2_VERSION;
+  SSL_CTX_set_min_proto_version(ctx, version);
+  SSL_CTX_set_max_proto_version(ctx, version);
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  CHECK_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+  auto ssl = SSL_new(ctx);
+  SSL_set_fd(ssl, fd);
+  if (SSL_connect(ssl) == 1) {
+    std::vector<char> buf(256 * 1024);
+    while (SSL_read(ssl, buf.data(), int(buf.size())) > 0) {
+    }
+  }
+  SSL_free(ssl);
+  ::close(fd);
+  SSL_CTX_free(ctx);
+}
+
+// Server thread CPU per GB, or a negative value when kTLS was not available
+double run(const std::shared_ptr<SSLContext>& ctx, bool offload) {
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  CHECK_EQ(bind(listener, reinterpret_cast<sockaddr*>(&addr), len), 0);
+  CHECK_EQ(listen(listener, 1), 0);
+  CHECK_EQ(
+      getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+  std::thread client(runClient, ntohs(addr.sin_port));
+
+  EventBase evb;
+  auto fd = NetworkSocket::fromFd(accept(listener, nullptr, nullptr));
+  Sender sender(AsyncSSLSocket::UniquePtr(new AsyncSSLSocket(
+                    ctx, &evb, fd, true /* server */)),
+                offload);
+  evb.loop();
+  client.join();
+  ::close(listener);
+  if (offload && !sender.offloaded()) {
+    return -1;
+  }
+  return sender.cpu.count() / 1e6 / (FLAGS_size_mb / 1024.0);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  if (FLAGS_cert.empty() || FLAGS_key.empty()) {
+    LOG(ERROR) << "--cert and --key are required";
+    return EXIT_FAILURE;
+  }
+
+  auto makeContext = [](bool kernelTLS) {
+    auto ctx = std::make_shared<SSLContext>();
+    ctx->loadCertificate(FLAGS_cert.c_str());
+    ctx->loadPrivateKey(FLAGS_key.c_str());
+    if (kernelTLS) {
+      KernelTLSSocket::enable(*ctx);
+    }
+    return ctx;
+  };
+
+  std::cout << "Sending " << FLAGS_size_mb << "MB over "
+            << (FLAGS_tls13 ? "TLS 1.3" : "TLS 1.2") << " in "
+            << FLAGS_chunk_kb << "KB writes" << std::endl;
+  // OpenSSL writes through the kernel's keys itself once they are installed,
+  // so the first run's context does not ask for them
+  std::cout << "OpenSSL: " << run(makeContext(false), false)
+            << " CPU seconds/GB" << std::endl;
+  auto offloaded = run(makeContext(true), true);
+  if (offloaded < 0) {
+    std::cout << "kTLS: unavailable for this kernel, OpenSSL build or "
+              << "cipher" << std::endl;
+  } else {
+    std::cout << "kTLS: " << offloaded << " CPU seconds/GB" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
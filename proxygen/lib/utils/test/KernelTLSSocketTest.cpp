@@ -0,0 +1,182 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/io/async/AsyncSSLSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/SSLContext.h>
+#include <folly/portability/GTest.h>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/KernelTLSSocket.h>
+#include <proxygen/lib/utils/TestUtils.h>
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace folly;
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+const std::string kTestDir = getContainingDirectory(__FILE__).str();
+const std::string kCert = kTestDir + "../../http/session/test/test_cert1.pem";
+const std::string kKey = kTestDir + "../../http/session/test/test_cert1.key";
+
+class HandshakeCallback : public AsyncSSLSocket::HandshakeCB {
+ public:
+  bool handshakeVer(AsyncSSLSocket*,
+                    bool /*preverifyOk*/,
+                    X509_STORE_CTX*) noexcept override {
+    // The test certificate is self signed
+    return true;
+  }
+
+  void handshakeSuc(AsyncSSLSocket*) noexcept override {
+    done = true;
+  }
+
+  void handshakeErr(AsyncSSLSocket*,
+                    const AsyncSocketException& ex) noexcept override {
+    ADD_FAILURE() << "Handshake failed: " << ex.what();
+    done = true;
+  }
+
+  bool done{false};
+};
+
+class ReadCallback : public AsyncTransportWrapper::ReadCallback {
+ public:
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+    *bufReturn = buf_;
+    *lenReturn = sizeof(buf_);
+  }
+
+  void readDataAvailable(size_t len) noexcept override {
+    data.append(buf_, len);
+  }
+
+  void readEOF() noexcept override {
+    done = true;
+  }
+
+  void readErr(const AsyncSocketException& ex) noexcept override {
+    ADD_FAILURE() << "Read failed: " << ex.what();
+    done = true;
+  }
+
+  std::string data;
+  bool done{false};
+
+ private:
+  char buf_[1024];
+};
+
+// A connected pair of loopback TCP sockets; kTLS only attaches to TCP
+void tcpPair(int fds[2]) {
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  CHECK_EQ(bind(listener, reinterpret_cast<sockaddr*>(&addr), len), 0);
+  CHECK_EQ(listen(listener, 1), 0);
+  CHECK_EQ(
+      getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+  fds[1] = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_EQ(connect(fds[1], reinterpret_cast<sockaddr*>(&addr), len), 0);
+  fds[0] = accept(listener, nullptr, nullptr);
+  CHECK_GE(fds[0], 0);
+  ::close(listener);
+}
+
+}
+
+class KernelTLSSocketTest : public Test {
+ protected:
+  static std::shared_ptr<SSLContext> makeContext() {
+    auto ctx = std::make_shared<SSLContext>();
+    ctx->loadCertificate(kCert.c_str());
+    ctx->loadPrivateKey(kKey.c_str());
+    return ctx;
+  }
+
+  void handshake(const std::shared_ptr<SSLContext>& serverCtx,
+                 const std::shared_ptr<SSLContext>& clientCtx) {
+    int fds[2];
+    tcpPair(fds);
+    server_.reset(new AsyncSSLSocket(
+        serverCtx, &evb_, NetworkSocket::fromFd(fds[0]), true /* server */));
+    client_.reset(new AsyncSSLSocket(
+        clientCtx, &evb_, NetworkSocket::fromFd(fds[1]), false /* server */));
+    server_->sslAccept(&serverHandshake_);
+    client_->sslConn(&clientHandshake_);
+    while (!serverHandshake_.done || !clientHandshake_.done) {
+      evb_.loopOnce();
+    }
+    ASSERT_TRUE(server_->good());
+    ASSERT_TRUE(client_->good());
+  }
+
+  // What sock writes reaches peer
+  void expectUsable(AsyncTransportWrapper& sock, AsyncTransportWrapper& peer) {
+    EXPECT_TRUE(sock.good());
+    ReadCallback readCallback;
+    peer.setReadCB(&readCallback);
+    sock.write(nullptr, "ping", 4);
+    while (readCallback.data.size() < 4 && !readCallback.done) {
+      evb_.loopOnce();
+    }
+    peer.setReadCB(nullptr);
+    EXPECT_EQ("ping", readCallback.data);
+  }
+
+  EventBase evb_;
+  AsyncSSLSocket::UniquePtr server_;
+  AsyncSSLSocket::UniquePtr client_;
+  HandshakeCallback serverHandshake_;
+  HandshakeCallback clientHandshake_;
+};
+
+TEST_F(KernelTLSSocketTest, PlaintextNotOffloaded) {
+  int fds[2];
+  tcpPair(fds);
+  AsyncSocket::UniquePtr server(
+      new AsyncSocket(&evb_, NetworkSocket::fromFd(fds[0])));
+  AsyncSocket::UniquePtr client(
+      new AsyncSocket(&evb_, NetworkSocket::fromFd(fds[1])));
+
+  EXPECT_EQ(nullptr, KernelTLSSocket::offload(*server, false));
+  expectUsable(*server, *client);
+}
+
+TEST_F(KernelTLSSocketTest, NotEnabled) {
+  // Without SSL_OP_ENABLE_KTLS OpenSSL keeps the keys in userspace
+  handshake(makeContext(), std::make_shared<SSLContext>());
+
+  EXPECT_EQ(nullptr, KernelTLSSocket::offload(*server_, false));
+  expectUsable(*server_, *client_);
+  expectUsable(*client_, *server_);
+}
+
+TEST_F(KernelTLSSocketTest, ClientCertificateNotOffloaded) {
+  // The peer certificate would be lost with the SSL object
+  auto serverCtx = makeContext();
+  serverCtx->setVerificationOption(SSLContext::SSLVerifyPeerEnum::VERIFY);
+  KernelTLSSocket::enable(*serverCtx);
+  handshake(serverCtx, makeContext());
+  ASSERT_NE(nullptr, server_->getPeerCert());
+
+  EXPECT_EQ(nullptr, KernelTLSSocket::offload(*server_, false));
+  expectUsable(*server_, *client_);
+  expectUsable(*client_, *server_);
+}
@@ -0,0 +1,117 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/IOBuf.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/utils/StreamCodecPool.h>
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+#include <proxygen/lib/utils/ZlibStreamDecompressor.h>
+
+using namespace folly;
+using namespace proxygen;
+
+DEFINE_int32(response_size, 2048, "Size of each compressed response");
+DEFINE_int32(level, 4, "zlib compression level");
+
+// Each iteration compresses, or decompresses, one small response the way
+// CompressionFilter does: with a new context, or with one from a pool.
+
+namespace {
+
+std::unique_ptr<IOBuf> makeResponse() {
+  std::string body;
+  while (body.size() < size_t(FLAGS_response_size)) {
+    body += "<li class=\"item\">proxygen response body</li>\n";
+  }
+  body.resize(FLAGS_response_size);
+  return IOBuf::copyBuffer(body);
+}
+
+std::unique_ptr<ZlibStreamCompressor> makeCompressor() {
+  return std::make_unique<ZlibStreamCompressor>(CompressionType::GZIP,
+                                                FLAGS_level);
+}
+
+std::unique_ptr<ZlibStreamDecompressor> makeDecompressor() {
+  return std::make_unique<ZlibStreamDecompressor>(CompressionType::GZIP);
+}
+
+void setCounters(UserCounters& counters, const StreamCodecPoolStats& stats) {
+  counters["created"] = int(stats.created);
+  counters["reused"] = int(stats.reused);
+  counters["idle"] = int(stats.idle);
+}
+}
+
+BENCHMARK(CompressNew, iters) {
+  std::unique_ptr<IOBuf> response;
+  BENCHMARK_SUSPEND {
+    response = makeResponse();
+  }
+  for (size_t i = 0; i < iters; i++) {
+    auto compressor = makeCompressor();
+    doNotOptimizeAway(compressor->compress(response.get(), true));
+  }
+}
+
+BENCHMARK_COUNTERS_RELATIVE(CompressPooled, counters, iters) {
+  std::unique_ptr<IOBuf> response;
+  std::shared_ptr<StreamCodecPool<ZlibStreamCompressor>> pool;
+  BENCHMARK_SUSPEND {
+    response = makeResponse();
+    pool = std::make_shared<StreamCodecPool<ZlibStreamCompressor>>(
+        makeCompressor, 16);
+  }
+  for (size_t i = 0; i < iters; i++) {
+    PooledStreamCompressor<ZlibStreamCompressor> compressor(pool);
+    doNotOptimizeAway(compressor.compress(response.get(), true));
+  }
+  BENCHMARK_SUSPEND {
+    setCounters(counters, pool->getStats());
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(DecompressNew, iters) {
+  std::unique_ptr<IOBuf> compressed;
+  BENCHMARK_SUSPEND {
+    auto response = makeResponse();
+    compressed = makeCompressor()->compress(response.get(), true);
+  }
+  for (size_t i = 0; i < iters; i++) {
+    auto decompressor = makeDecompressor();
+    doNotOptimizeAway(decompressor->decompress(compressed.get()));
+  }
+}
+
+BENCHMARK_COUNTERS_RELATIVE(DecompressPooled, counters, iters) {
+  std::unique_ptr<IOBuf> compressed;
+  std::shared_ptr<StreamCodecPool<ZlibStreamDecompressor>> pool;
+  BENCHMARK_SUSPEND {
+    auto response = makeResponse();
+    compressed = makeCompressor()->compress(response.get(), true);
+    pool = std::make_shared<StreamCodecPool<ZlibStreamDecompressor>>(
+        makeDecompressor, 16);
+  }
+  for (size_t i = 0; i < iters; i++) {
+    PooledStreamDecompressor<ZlibStreamDecompressor> decompressor(pool);
+    doNotOptimizeAway(decompressor.decompress(compressed.get()));
+  }
+  BENCHMARK_SUSPEND {
+    setCounters(counters, pool->getStats());
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
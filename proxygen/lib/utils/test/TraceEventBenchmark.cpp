@@ -0,0 +1,94 @@
+/*
+ *  Copyright (c) 2019-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/utils/NullTraceEventObserver.h>
+#include <proxygen/lib/utils/RingBufferTraceEventObserver.h>
+
+using namespace folly;
+using namespace proxygen;
+
+// Each iteration records one event, so iters/s is events/s on one core.
+
+namespace {
+
+const std::string kHost("www.example.com");
+
+// The fields a typical request trace carries
+template <class Event>
+void fillEvent(Event& event) {
+  event.addMeta(TraceFieldType::StatusCode, 200);
+  event.addMeta(TraceFieldType::Protocol, "h2");
+  event.addMeta(TraceFieldType::HostName, kHost);
+  event.addMeta(TraceFieldType::ReqHeaderSize, 380);
+  event.addMeta(TraceFieldType::RspHeaderSize, 420);
+  event.addMeta(TraceFieldType::RspBodySize, 16384);
+}
+
+// The std::map backed layout TraceEvent used to have
+struct MapTraceEvent {
+  template <typename T>
+  void addMeta(TraceFieldType key, T&& value) {
+    TraceEvent::MetaData val(std::forward<T>(value));
+    auto rc = metaData.emplace(key, val);
+    if (!rc.second) {
+      rc.first->second = std::move(val);
+    }
+  }
+
+  TraceEvent::MetaDataMap metaData;
+};
+
+void recordEvents(uint32_t iters, TraceEventObserver& observer) {
+  for (uint32_t i = 0; i < iters; i++) {
+    TraceEvent event(TraceEventType::TotalRequest);
+    fillEvent(event);
+    observer.traceEventAvailable(std::move(event));
+  }
+}
+}
+
+BENCHMARK(MapEvent, iters) {
+  for (uint32_t i = 0; i < iters; i++) {
+    MapTraceEvent event;
+    fillEvent(event);
+    doNotOptimizeAway(event.metaData.size());
+  }
+}
+
+BENCHMARK_RELATIVE(FlatEvent, iters) {
+  for (uint32_t i = 0; i < iters; i++) {
+    TraceEvent event(TraceEventType::TotalRequest);
+    fillEvent(event);
+    doNotOptimizeAway(event.hasTraceField(TraceFieldType::StatusCode));
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(NullObserver, iters) {
+  NullTraceEventObserver observer;
+  recordEvents(iters, observer);
+}
+
+BENCHMARK_RELATIVE(RingBufferObserver, iters) {
+  RingBufferTraceEventObserver observer(iters + 1);
+  recordEvents(iters, observer);
+  BENCHMARK_SUSPEND {
+    CHECK_EQ(observer.getDroppedCount(), 0);
+    observer.drain([](TraceEvent&&) {});
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -8,6 +8,7 @@
  *
  */
 #include <proxygen/lib/utils/Exception.h>
+#include <proxygen/lib/utils/RingBufferTraceEventObserver.h>
 #include <proxygen/lib/utils/TraceEvent.h>
 #include <proxygen/lib/utils/TraceEventType.h>
 #include <proxygen/lib/utils/TraceFieldType.h>
@@ -16,6 +17,7 @@
 #include <folly/portability/GMock.h>
 
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace proxygen;
@@ -247,3 +249,75 @@ TEST(TraceEventTest, StringArrayValueToString) {
 
   ASSERT_EQ(out.str(), traceEvent.toString());
 }
+
+TEST(TraceEventTest, ReplaceAndIterateInInsertionOrder) {
+  TraceEvent traceEvent(TraceEventType::TotalRequest);
+  ASSERT_TRUE(traceEvent.addMeta(TraceFieldType::StatusCode, 200));
+  ASSERT_TRUE(traceEvent.addMeta(TraceFieldType::Protocol, "h2"));
+  ASSERT_TRUE(traceEvent.addMeta(TraceFieldType::HostName, "example.com"));
+  ASSERT_FALSE(traceEvent.addMeta(TraceFieldType::StatusCode, 404));
+  ASSERT_FALSE(traceEvent.hasTraceField(TraceFieldType::ServerAddr));
+
+  std::vector<TraceFieldType> keys;
+  auto itr = traceEvent.getMetaDataItr();
+  while (itr.isValid()) {
+    keys.push_back(itr.getKey());
+    itr.next();
+  }
+  EXPECT_THAT(keys, testing::ElementsAre(TraceFieldType::StatusCode,
+                                         TraceFieldType::Protocol,
+                                         TraceFieldType::HostName));
+  EXPECT_EQ(404,
+      traceEvent.getTraceFieldDataAs<int64_t>(TraceFieldType::StatusCode));
+
+  auto copy = traceEvent;
+  auto map = copy.getMetaData();
+  EXPECT_EQ(3, map.size());
+  map.erase(TraceFieldType::HostName);
+  copy.setMetaData(std::move(map));
+  EXPECT_FALSE(copy.hasTraceField(TraceFieldType::HostName));
+  EXPECT_EQ("h2", copy.getTraceFieldDataAs<std::string>(
+                      TraceFieldType::Protocol));
+  EXPECT_TRUE(traceEvent.hasTraceField(TraceFieldType::HostName));
+}
+
+TEST(TraceEventTest, RingBufferObserverDrain) {
+  RingBufferTraceEventObserver observer(4);
+  for (int i = 0; i < 6; i++) {
+    TraceEvent traceEvent(TraceEventType::TotalRequest);
+    traceEvent.addMeta(TraceFieldType::StatusCode, i);
+    observer.traceEventAvailable(std::move(traceEvent));
+  }
+  EXPECT_EQ(2, observer.getDroppedCount());
+
+  std::vector<int64_t> codes;
+  auto sink = [&](TraceEvent&& event) {
+    codes.push_back(
+        event.getTraceFieldDataAs<int64_t>(TraceFieldType::StatusCode));
+  };
+  EXPECT_EQ(4, observer.drain(sink));
+  EXPECT_THAT(codes, testing::ElementsAre(0, 1, 2, 3));
+  EXPECT_EQ(0, observer.drain(sink));
+}
+
+TEST(TraceEventTest, RingBufferObserverThreads) {
+  RingBufferTraceEventObserver observer(100);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&observer] {
+      std::vector<TraceEvent> events;
+      for (int i = 0; i < 50; i++) {
+        events.emplace_back(TraceEventType::TotalRequest);
+      }
+      observer.emitTraceEvents(std::move(events));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // Threads have exited, their buffered events are still delivered
+  size_t count = 0;
+  EXPECT_EQ(200, observer.drain([&](TraceEvent&&) { count++; }));
+  EXPECT_EQ(200, count);
+  EXPECT_EQ(0, observer.getDroppedCount());
+}
@@ -13,6 +13,7 @@
 #include <folly/io/IOBuf.h>
 #include <folly/portability/GTest.h>
 #include <glog/logging.h>
+#include <proxygen/lib/utils/StreamCodecPool.h>
 #include <proxygen/lib/utils/ZlibStreamCompressor.h>
 #include <proxygen/lib/utils/ZlibStreamDecompressor.h>
 
@@ -148,3 +149,49 @@ TEST_F(ZlibTests, CompressDecompressSmallBuffer) {
     compressThenDecompress(CompressionType::GZIP, 4, makeBuf(127));
   });
 }
+
+TEST_F(ZlibTests, ResetReusesStreams) {
+  ASSERT_NO_FATAL_FAILURE({
+    ZlibStreamCompressor compressor(CompressionType::GZIP, 6);
+    ZlibStreamDecompressor decompressor(CompressionType::GZIP);
+    IOBufEqualTo eq;
+    for (int i = 0; i < 3; i++) {
+      auto buf = makeBuf(2000);
+      auto compressed = compressor.compress(buf.get(), true);
+      ASSERT_TRUE(compressor.finished());
+      auto decompressed = decompressor.decompress(compressed.get());
+      ASSERT_TRUE(decompressor.finished());
+      ASSERT_TRUE(eq(buf, decompressed));
+      ASSERT_TRUE(compressor.reset());
+      ASSERT_TRUE(decompressor.reset());
+    }
+  });
+}
+
+TEST_F(ZlibTests, PoolReusesCompressors) {
+  auto pool = std::make_shared<StreamCodecPool<ZlibStreamCompressor>>(
+      [] {
+        return std::make_unique<ZlibStreamCompressor>(CompressionType::GZIP,
+                                                      6);
+      },
+      1);
+  for (int i = 0; i < 3; i++) {
+    auto buf = makeBuf(500);
+    PooledStreamCompressor<ZlibStreamCompressor> compressor(pool);
+    auto compressed = compressor.compress(buf.get(), true);
+    ASSERT_FALSE(compressor.hasError());
+    verify(CompressionType::GZIP, std::move(buf), std::move(compressed));
+  }
+  EXPECT_EQ(pool->getStats().created, 1u);
+  EXPECT_EQ(pool->getStats().reused, 2u);
+  EXPECT_EQ(pool->getStats().idle, 1u);
+
+  // Beyond the pool size, returned compressors are freed
+  {
+    PooledStreamCompressor<ZlibStreamCompressor> first(pool);
+    PooledStreamCompressor<ZlibStreamCompressor> second(pool);
+  }
+  EXPECT_EQ(pool->getStats().created, 2u);
+  EXPECT_EQ(pool->getStats().discarded, 1u);
+  EXPECT_EQ(pool->getStats().idle, 1u);
+}